@@ -0,0 +1,76 @@
+{
+  "target_defaults": {
+    "include_dirs": [
+      "resources/reference",
+      "native/sdk"
+    ],
+    "cflags_cc": [ "-std=c++17", "-Wall", "-Wextra", "-Wno-unused-parameter" ],
+    "xcode_settings": {
+      "CLANG_CXX_LANGUAGE_STANDARD": "c++17"
+    },
+    "msvs_settings": {
+      "VCCLCompilerTool": { "AdditionalOptions": [ "/std:c++17" ] }
+    }
+  },
+  "targets": [
+    {
+      "target_name": "lse_native",
+      "sources": [
+        "native/addon.cc",
+        "native/bind_async.cc",
+        "native/bind_capture.cc",
+        "native/bind_controls.cc",
+        "native/bind_image.cc",
+        "native/bind_main.cc",
+        "native/bind_property.cc",
+        "native/bind_record.cc",
+        "native/bind_session.cc",
+        "native/bind_stub.cc",
+        "native/bind_visualization.cc",
+        "native/bind_worker.cc",
+        "native/callbacks.cc",
+        "native/capture_stream.cc",
+        "native/compositor.cc",
+        "native/constants.cc",
+        "native/controls_queue.cc",
+        "native/device_worker.cc",
+        "native/dispatcher.cc",
+        "native/frame_pool.cc",
+        "native/image_encoder.cc",
+        "native/image_kernels.cc",
+        "native/jpeg_encoder.cc",
+        "native/latency.cc",
+        "native/lse_api.cc",
+        "native/mapped_file.cc",
+        "native/napi_util.cc",
+        "native/overlay_raster.cc",
+        "native/overlay_scene.cc",
+        "native/png_encoder.cc",
+        "native/preview_channel.cc",
+        "native/property_cache.cc",
+        "native/quality_map.cc",
+        "native/recorder.cc",
+        "native/segmentation.cc",
+        "native/session.cc",
+        "native/task_pool.cc",
+        "native/worker_frames.cc"
+      ],
+      "conditions": [
+        [ "OS!='win'", { "libraries": [ "-ldl", "-lpthread" ] } ]
+      ]
+    }
+  ],
+  "conditions": [
+    [ "OS!='win'", {
+      "targets": [
+        {
+          "target_name": "LScanEssentials",
+          "type": "shared_library",
+          "product_dir": "<(PRODUCT_DIR)",
+          "sources": [ "native/stub/lscan_stub.cc" ],
+          "libraries": [ "-lpthread" ]
+        }
+      ]
+    } ]
+  ]
+}
@@ -0,0 +1,188 @@
+/// lse_native: N-API binding of the LScanEssentials SDK.
+
+#include "bindings.h"
+#include "clock.h"
+#include "dispatcher.h"
+#include "frame_pool.h"
+#include "worker_frames.h"
+
+#include <uv.h>
+
+#include <atomic>
+#include <string>
+
+namespace lse {
+
+void ThrowMissingEntry(napi_env env, const char *name) {
+  std::string message = IsApiLoaded() ? std::string(name) + " is not exported by " + LoadedApiPath()
+                                      : std::string("LScanEssentials library not loaded; call load() before ") + name;
+  napi_throw_error(env, "ERR_LSE_ENTRY", message.c_str());
+}
+
+namespace {
+
+/// load(libraryPath, eager): open the SDK library. Entry points resolve on first
+/// use, or all at once if @p eager.
+napi_value Load(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  const char *path = args.String(0);
+  bool eager = args.Bool(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  std::string error;
+  if (!LoadApi(path, eager, &error)) {
+    napi_throw_error(env, "ERR_LSE_LOAD", error.c_str());
+    return nullptr;
+  }
+  return nullptr;
+}
+
+napi_value IsLoaded(napi_env env, napi_callback_info /*info*/) {
+  return MakeBool(env, IsApiLoaded());
+}
+
+/// List of SDK functions the loaded library does not export.
+napi_value MissingEntries(napi_env env, napi_callback_info /*info*/) {
+  napi_value list = nullptr;
+  NAPI_CHECK(env, napi_create_array(env, &list));
+  uint32_t count = 0;
+  const Api &api = GetApi();
+#define LSE_API_MISSING(name, argBytes)                          \
+  if (api.name == nullptr) {                                     \
+    napi_set_element(env, list, count++, MakeString(env, #name)); \
+  }
+  LSE_API_FUNCTIONS(LSE_API_MISSING)
+#undef LSE_API_MISSING
+  return list;
+}
+
+/// Counters common to the shared and the per-handle pools.
+ResultObject &PoolCounters(ResultObject &object, const FramePoolStats &stats) {
+  return object.Double("allocations", static_cast<double>(stats.allocations))
+      .Double("reuses", static_cast<double>(stats.reuses))
+      .Double("preallocated", static_cast<double>(stats.preallocated))
+      .Double("outstanding", static_cast<double>(stats.outstanding))
+      .Double("peakOutstanding", static_cast<double>(stats.peakOutstanding))
+      .Double("pooledBlocks", static_cast<double>(stats.pooledBlocks))
+      .Double("pooledBytes", static_cast<double>(stats.pooledBytes));
+}
+
+/// framePoolStats([handle]): counters of the shared pool, or of the pool behind
+/// the image callbacks of @p handle with its mode, the bytes preallocated for it
+/// and the allocations and peak resident set size of its last capture.
+napi_value FramePoolStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  if (args.IsNullish(0)) {
+    ResultObject object(env);
+    return PoolCounters(object, SharedFramePool().Stats()).value();
+  }
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  HandlePoolStats stats = GetHandlePoolStats(handle);
+  const CaptureMemory &capture = stats.capture;
+  ResultObject object(env);
+  return PoolCounters(object, stats.pool)
+      .Int("imageType", stats.imageType)
+      .Int("resolution", stats.resolution)
+      .Double("reservedBytes", static_cast<double>(stats.reservedBytes))
+      .Double("captures", static_cast<double>(capture.captures))
+      .Double("steadyCaptures", static_cast<double>(capture.steadyCaptures))
+      .Set("lastCapture", ResultObject(env)
+                              .Bool("capturing", capture.capturing)
+                              .Double("frames", static_cast<double>(capture.frames))
+                              .Double("allocations", static_cast<double>(capture.allocations))
+                              .Double("peakRss", static_cast<double>(capture.peakRss))
+                              .value())
+      .Double("rss", static_cast<double>(ResidentBytes()))
+      .value();
+}
+
+/// dispatcherStats(): counters of the callback event queue.
+napi_value DispatcherStatistics(napi_env env, napi_callback_info /*info*/) {
+  DispatcherStats stats = SharedDispatcher().Stats();
+  return ResultObject(env)
+      .Double("posted", static_cast<double>(stats.posted))
+      .Double("delivered", static_cast<double>(stats.delivered))
+      .Double("discarded", static_cast<double>(stats.discarded))
+      .Double("pending", static_cast<double>(stats.posted - stats.delivered - stats.discarded))
+      .Double("batches", static_cast<double>(stats.batches))
+      .Double("maxBatch", static_cast<double>(stats.maxBatch))
+      .value();
+}
+
+/// now(): monotonic nanoseconds, the clock of the callback timestamps.
+napi_value Now(napi_env env, napi_callback_info /*info*/) {
+  return MakeDouble(env, static_cast<double>(NowNs()));
+}
+
+/// Exports of a worker thread loading the addon after the main thread did:
+/// frame delivery (worker_frames.h) and what needs no SDK handle state.
+napi_value InitWorker(napi_env env, napi_value exports) {
+  if (!StartWorkerEnv(env)) {
+    return nullptr;
+  }
+  MethodTable table;
+  table.Add("isLoaded", IsLoaded);
+  table.Add("now", Now);
+  table.AddValue("constants", CreateConstants(env));
+  AddImageKernelBindings(&table);
+  AddWorkerBindings(&table);
+  NAPI_CHECK(env, table.Define(env, exports));
+  return exports;
+}
+
+/// Whether @p env is the main thread's; worker threads run event loops of their own.
+bool IsMainThread(napi_env env) {
+  uv_loop_t *loop = nullptr;
+  return napi_get_uv_event_loop(env, &loop) == napi_ok && loop == uv_default_loop();
+}
+
+napi_value Init(napi_env env, napi_value exports) {
+  // The SDK callbacks, the out[] array and the dispatcher belong to the main
+  // thread, which outlives every worker; worker threads consume frames. A worker
+  // loading first would take them down with it when it exits.
+  static std::atomic<bool> primary_taken{false};
+  bool main_thread = IsMainThread(env);
+  if (!main_thread && !primary_taken.load()) {
+    napi_throw_error(env, "ERR_LSE_WORKER_FIRST",
+                     "lse_native must be loaded on the main thread before a worker thread loads it");
+    return nullptr;
+  }
+  if (!main_thread || primary_taken.exchange(true)) {
+    return InitWorker(env, exports);
+  }
+  if (!SharedDispatcher().Start(env)) {
+    return nullptr;
+  }
+  MethodTable table;
+  table.Add("load", Load);
+  table.Add("isLoaded", IsLoaded);
+  table.Add("missingEntries", MissingEntries);
+  table.Add("framePoolStats", FramePoolStatistics);
+  table.Add("dispatcherStats", DispatcherStatistics);
+  table.Add("now", Now);
+  table.AddValue("constants", CreateConstants(env));
+  table.AddValue("outputs", CreateOutputs(env));
+  AddMainBindings(&table);
+  AddCaptureBindings(&table);
+  AddControlsBindings(&table);
+  AddVisualizationBindings(&table);
+  AddSessionBindings(&table);
+  AddAsyncBindings(&table);
+  AddImageBindings(&table);
+  AddPropertyBindings(&table);
+  AddRecordBindings(&table);
+  AddStubBindings(&table);
+  AddWorkerBindings(&table);
+  NAPI_CHECK(env, table.Define(env, exports));
+  return exports;
+}
+
+}  // namespace
+
+}  // namespace lse
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, lse::Init)
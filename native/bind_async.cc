@@ -0,0 +1,129 @@
+/// Promise-returning variants of the SDK calls that block for seconds.
+///
+///   LSCAN_Main_InitializeAsync(deviceIndex, reset) -> Promise<{ status, handle }>
+///   LSCAN_Main_ImageQualityInfieldTestAsync(deviceIndex, logFilePath) -> Promise<status>
+///   LSCAN_Capture_OptimizeContrastAsync(handle) -> Promise<status>
+///   LSCAN_Main_CheckCleanlinessAsync(handle) -> Promise<status>
+///   LSCAN_Main_ForceReadjustmentAsync(handle) -> Promise<status>
+///
+/// The calls run on the TaskPool; the JS thread only creates the promise and,
+/// through the dispatcher, settles it. Progress arrives on the regular
+/// LSCAN_Main_RegisterCallbackProgress stream, and the handle-based calls can be
+/// ended early with LSCAN_Capture_Abort(). src/lse-binding.js adds the
+/// onProgress/signal options on top.
+
+#include "bindings.h"
+#include "controls_queue.h"
+#include "dispatcher.h"
+#include "property_cache.h"
+#include "task_pool.h"
+
+#include <string>
+
+namespace lse {
+
+namespace {
+
+/// Run @p call on the task pool; the promise resolves to what @p resolve builds
+/// from the call's status.
+template <typename Call, typename Resolve>
+napi_value RunAsync(napi_env env, Call call, Resolve resolve) {
+  napi_deferred deferred = nullptr;
+  napi_value promise = nullptr;
+  NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+  // Keep the event loop alive while the call is outstanding.
+  SharedDispatcher().AddListener();
+  SharedTaskPool().Post([deferred, call, resolve] {
+    auto result = call();
+    SharedDispatcher().PostCompletion([deferred, result, resolve](napi_env env) {
+      SharedDispatcher().RemoveListener();
+      napi_resolve_deferred(env, deferred, resolve(env, result));
+    });
+  });
+  return promise;
+}
+
+napi_value ResolveStatus(napi_env env, int status) {
+  return MakeInt(env, status);
+}
+
+/// Body of the (handle) -> Promise<status> bindings.
+template <typename Function>
+napi_value RunHandleAsync(napi_env env, napi_callback_info info, Function function, const char *name) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (function == nullptr) {
+    ThrowMissingEntry(env, name);
+    return nullptr;
+  }
+  return RunAsync(env, [function, handle] { return function(handle); }, ResolveStatus);
+}
+
+#define LSE_HANDLE_ASYNC_BINDING(binding, name)                                    \
+  napi_value binding(napi_env env, napi_callback_info info) {                      \
+    return RunHandleAsync(env, info, ::lse::GetApi().name.get(), #name);           \
+  }
+
+LSE_HANDLE_ASYNC_BINDING(OptimizeContrastAsync, LSCAN_Capture_OptimizeContrast)
+LSE_HANDLE_ASYNC_BINDING(CheckCleanlinessAsync, LSCAN_Main_CheckCleanliness)
+LSE_HANDLE_ASYNC_BINDING(ForceReadjustmentAsync, LSCAN_Main_ForceReadjustment)
+
+struct InitializeResult {
+  int status;
+  int handle;
+};
+
+napi_value InitializeAsync(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  bool reset = args.Bool(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_Initialize);
+  return RunAsync(
+      env,
+      [LSCAN_Main_Initialize, deviceIndex, reset] {
+        InitializeResult result = {0, -1};
+        result.status = LSCAN_Main_Initialize(deviceIndex, reset, &result.handle);
+        if (result.status >= 0) {
+          InvalidateProperties(result.handle, PropertyScope::kAll);
+          ForgetControls(result.handle);
+        }
+        return result;
+      },
+      [](napi_env env, const InitializeResult &result) {
+        return ResultObject(env).Int("status", result.status).Int("handle", result.handle).value();
+      });
+}
+
+napi_value ImageQualityInfieldTestAsync(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  std::string logFilePath = args.String(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_ImageQualityInfieldTest);
+  return RunAsync(
+      env,
+      [LSCAN_Main_ImageQualityInfieldTest, deviceIndex, logFilePath] {
+        return LSCAN_Main_ImageQualityInfieldTest(deviceIndex, logFilePath.c_str());
+      },
+      ResolveStatus);
+}
+
+}  // namespace
+
+void AddAsyncBindings(MethodTable *table) {
+  table->Add("LSCAN_Main_InitializeAsync", InitializeAsync);
+  table->Add("LSCAN_Main_ImageQualityInfieldTestAsync", ImageQualityInfieldTestAsync);
+  table->Add("LSCAN_Main_CheckCleanlinessAsync", CheckCleanlinessAsync);
+  table->Add("LSCAN_Main_ForceReadjustmentAsync", ForceReadjustmentAsync);
+  table->Add("LSCAN_Capture_OptimizeContrastAsync", OptimizeContrastAsync);
+}
+
+}  // namespace lse
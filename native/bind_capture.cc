@@ -0,0 +1,382 @@
+#include "bindings.h"
+#include "capture_stream.h"
+#include "clock.h"
+#include "controls_queue.h"
+#include "frame_pool.h"
+#include "latency.h"
+#include "property_cache.h"
+#include "preview_channel.h"
+
+namespace lse {
+
+namespace {
+
+napi_value IsModeAvailable(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int imageType = args.Int(1);
+  int imageResolution = args.Int(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_IsModeAvailable);
+  BOOL isAvailable = FALSE;
+  int status = LSCAN_Capture_IsModeAvailable(handle, static_cast<LScanImageType>(imageType),
+                                             static_cast<LScanImageResolution>(imageResolution), &isAvailable);
+  Outputs()[0] = isAvailable;
+  return MakeInt(env, status);
+}
+
+napi_value SetMode(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int imageType = args.Int(1);
+  int imageResolution = args.Int(2);
+  int lineOrder = args.Int(3);
+  DWORD captureOptions = args.Dword(4);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_SetMode);
+  CaptureCallScope capture(handle);
+  int resultWidth = 0;
+  int resultHeight = 0;
+  int baseResolutionX = 0;
+  int baseResolutionY = 0;
+  int status = LSCAN_Capture_SetMode(handle, static_cast<LScanImageType>(imageType),
+                                     static_cast<LScanImageResolution>(imageResolution),
+                                     static_cast<LScanImageOrientation>(lineOrder), captureOptions, &resultWidth,
+                                     &resultHeight, &baseResolutionX, &baseResolutionY);
+  InvalidateProperties(handle, PropertyScope::kSettable);
+  if (status == LSCAN_STATUS_OK) {
+    PrepareFramePool(handle, imageType, imageResolution, resultWidth, resultHeight);
+  }
+  double *out = Outputs();
+  out[0] = resultWidth;
+  out[1] = resultHeight;
+  out[2] = baseResolutionX;
+  out[3] = baseResolutionY;
+  return MakeInt(env, status);
+}
+
+napi_value Start(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int numberOfObjects = args.Int(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_Start);
+  CaptureCallScope capture(handle);
+  SharedLatencyMonitor().OnStart(handle, NowNs());
+  BeginCaptureMemory(handle);
+  int status = LSCAN_Capture_Start(handle, numberOfObjects);
+  if (status != LSCAN_STATUS_OK) {
+    SharedLatencyMonitor().OnStop(handle);
+    EndCaptureMemory(handle, false);
+  }
+  return MakeInt(env, status);
+}
+
+napi_value Abort(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_Abort);
+  CaptureCallScope capture(handle);
+  SharedLatencyMonitor().OnStop(handle);
+  EndCaptureMemory(handle);
+  return MakeInt(env, LSCAN_Capture_Abort(handle));
+}
+
+napi_value IsActive(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_IsActive);
+  BOOL isActive = FALSE;
+  int status = LSCAN_Capture_IsActive(handle, &isActive);
+  Outputs()[0] = isActive;
+  return MakeInt(env, status);
+}
+
+napi_value TakeResultImage(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_TakeResultImage);
+  CaptureCallScope capture(handle);
+  return MakeInt(env, LSCAN_Capture_TakeResultImage(handle));
+}
+
+napi_value OptimizeContrast(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_OptimizeContrast);
+  CaptureCallScope capture(handle);
+  return MakeInt(env, LSCAN_Capture_OptimizeContrast(handle));
+}
+
+napi_value GetContrast(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_GetContrast);
+  int contrastValue = 0;
+  int status = LSCAN_Capture_GetContrast(handle, &contrastValue);
+  Outputs()[0] = contrastValue;
+  return MakeInt(env, status);
+}
+
+napi_value SetContrast(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int contrastValue = args.Int(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_SetContrast);
+  CaptureCallScope capture(handle);
+  return MakeInt(env, LSCAN_Capture_SetContrast(handle, contrastValue));
+}
+
+napi_value SetActiveArea(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int x = args.Int(1);
+  int y = args.Int(2);
+  int width = args.Int(3);
+  int height = args.Int(4);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_SetActiveArea);
+  CaptureCallScope capture(handle);
+  int status = LSCAN_Capture_SetActiveArea(handle, x, y, width, height);
+  if (status == LSCAN_STATUS_OK) {
+    ReserveActiveArea(handle, width, height);
+  }
+  return MakeInt(env, status);
+}
+
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackPreviewImage, CallbackKind::kPreviewImage,
+                              LSCAN_Capture_RegisterCallbackPreviewImage, OnPreviewImage)
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackObjectCount, CallbackKind::kObjectCount,
+                              LSCAN_Capture_RegisterCallbackObjectCount, OnObjectCount)
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackObjectQuality, CallbackKind::kObjectQuality,
+                              LSCAN_Capture_RegisterCallbackObjectQuality, OnObjectQuality)
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackTakingResultImage, CallbackKind::kTakingResultImage,
+                              LSCAN_Capture_RegisterCallbackTakingResultImage, OnTakingResultImage)
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackAcquisitionComplete, CallbackKind::kAcquisitionComplete,
+                              LSCAN_Capture_RegisterCallbackAcquisitionComplete, OnAcquisitionComplete)
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackResultImage, CallbackKind::kResultImage,
+                              LSCAN_Capture_RegisterCallbackResultImage, OnResultImage)
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackClearObjectsFromPlaten, CallbackKind::kClearObjectsFromPlaten,
+                              LSCAN_Capture_RegisterCallbackClearObjectsFromPlaten, OnClearObjectsFromPlaten)
+
+/// setPreviewPolicy(handle, policy, capacity, timeoutMs): backpressure for the
+/// preview callback of @p handle; see PreviewChannel. Not an SDK function.
+napi_value SetPreviewPolicy(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int policy = args.Int(1);
+  int capacity = args.Int(2);
+  int timeoutMs = args.Int(3);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (policy < static_cast<int>(PreviewPolicy::kLatest) || policy > static_cast<int>(PreviewPolicy::kBlock) ||
+      !GetPreviewChannel(handle)->Configure(static_cast<PreviewPolicy>(policy), capacity, timeoutMs)) {
+    return MakeInt(env, LSCAN_ERR_INVALID_PARAM_VALUE);
+  }
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+/// previewStats(handle): policy and frame counters of the preview channel.
+napi_value PreviewStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  PreviewStats stats = GetPreviewChannel(handle)->Stats();
+  return ResultObject(env)
+      .Int("policy", static_cast<int>(stats.policy))
+      .Int("capacity", stats.capacity)
+      .Int("timeoutMs", stats.timeoutMs)
+      .Double("received", static_cast<double>(stats.received))
+      .Double("delivered", static_cast<double>(stats.delivered))
+      .Double("dropped", static_cast<double>(stats.dropped))
+      .Double("queued", static_cast<double>(stats.queued))
+      .value();
+}
+
+napi_value HistogramToJs(napi_env env, const LatencyHistogram::Snapshot &histogram) {
+  return ResultObject(env)
+      .Double("count", static_cast<double>(histogram.count))
+      .Double("min", static_cast<double>(histogram.min))
+      .Double("max", static_cast<double>(histogram.max))
+      .Double("mean", histogram.count > 0 ? static_cast<double>(histogram.sum) / histogram.count : 0)
+      .Double("p50", static_cast<double>(histogram.Quantile(0.5)))
+      .Double("p90", static_cast<double>(histogram.Quantile(0.9)))
+      .Double("p99", static_cast<double>(histogram.Quantile(0.99)))
+      .Double("p999", static_cast<double>(histogram.Quantile(0.999)))
+      .value();
+}
+
+/// latencyStats(handle): per-stage latency histograms (ns) of @p handle, the
+/// timestamps of its last capture and its preview frame rate; see latency.h.
+napi_value LatencyStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LatencySnapshot snapshot = SharedLatencyMonitor().Read(handle);
+  PreviewStats preview = GetPreviewChannel(handle)->Stats();
+  ResultObject stages(env);
+  for (int i = 0; i < kLatencyStageCount; i++) {
+    stages.Set(LatencyStageName(static_cast<LatencyStage>(i)), HistogramToJs(env, snapshot.stages[i]));
+  }
+  napi_value last = ResultObject(env)
+                        .Double("taking", static_cast<double>(snapshot.last.taking))
+                        .Double("acquired", static_cast<double>(snapshot.last.acquired))
+                        .Double("result", static_cast<double>(snapshot.last.result))
+                        .Double("delivered", static_cast<double>(snapshot.last.delivered))
+                        .value();
+  napi_value lastStart = ResultObject(env)
+                             .Double("start", static_cast<double>(snapshot.lastStart.start))
+                             .Double("firstPreview", static_cast<double>(snapshot.lastStart.firstPreview))
+                             .value();
+  return ResultObject(env)
+      .Double("captures", static_cast<double>(snapshot.captures))
+      .Double("fps", snapshot.fps)
+      .Double("previewFrames", static_cast<double>(preview.received))
+      .Double("previewDropped", static_cast<double>(preview.dropped))
+      .Set("lastCapture", last)
+      .Set("lastStart", lastStart)
+      .Set("stages", stages.value())
+      .value();
+}
+
+/// latencyReset(handle): clear the latency histograms of @p handle, or of all
+/// handles if -1.
+napi_value LatencyReset(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  SharedLatencyMonitor().Reset(handle);
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+/// latencyMarkStart(handle): measure the next startup of @p handle from now
+/// instead of from its LSCAN_Capture_Start(); returns the now() timestamp.
+napi_value LatencyMarkStart(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  uint64_t now = NowNs();
+  SharedLatencyMonitor().MarkStart(handle, now);
+  return MakeDouble(env, static_cast<double>(now));
+}
+
+/// latencyPrometheus(): latency histograms and frame counters of every handle
+/// in the Prometheus text exposition format.
+napi_value LatencyPrometheus(napi_env env, napi_callback_info /*info*/) {
+  std::string text = SharedLatencyMonitor().Prometheus();
+  napi_value result = nullptr;
+  NAPI_CHECK(env, napi_create_string_utf8(env, text.data(), text.size(), &result));
+  return result;
+}
+
+/// captureStreamOpen(handle, fn): route every capture callback of @p handle to
+/// fn(records, extras), batched; see CaptureStream. Not an SDK function.
+/// Registering an individual callback while the stream is open takes that
+/// callback back from the stream.
+napi_value CaptureStreamOpen(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  napi_value function = args.FunctionOrNull(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (function == nullptr) {
+    args.Fail(1, "function");
+    return nullptr;
+  }
+  return MakeInt(env, GetCaptureStream(handle)->Open(env, function));
+}
+
+/// captureStreamClose(handle): end the stream and restore the individual
+/// callback registrations.
+napi_value CaptureStreamClose(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  return MakeInt(env, GetCaptureStream(handle)->Close(env));
+}
+
+/// captureStreamStats(handle): event and batch counters of the stream.
+napi_value CaptureStreamStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  CaptureStreamStats stats = GetCaptureStream(handle)->Stats();
+  return ResultObject(env)
+      .Double("events", static_cast<double>(stats.events))
+      .Double("batches", static_cast<double>(stats.batches))
+      .Double("maxBatch", static_cast<double>(stats.maxBatch))
+      .value();
+}
+
+}  // namespace
+
+void AddCaptureBindings(MethodTable *table) {
+  table->Add("LSCAN_Capture_IsModeAvailable", IsModeAvailable);
+  table->Add("LSCAN_Capture_SetMode", SetMode);
+  table->Add("LSCAN_Capture_Start", Start);
+  table->Add("LSCAN_Capture_Abort", Abort);
+  table->Add("LSCAN_Capture_IsActive", IsActive);
+  table->Add("LSCAN_Capture_TakeResultImage", TakeResultImage);
+  table->Add("LSCAN_Capture_OptimizeContrast", OptimizeContrast);
+  table->Add("LSCAN_Capture_GetContrast", GetContrast);
+  table->Add("LSCAN_Capture_SetContrast", SetContrast);
+  table->Add("LSCAN_Capture_SetActiveArea", SetActiveArea);
+  table->Add("LSCAN_Capture_RegisterCallbackPreviewImage", RegisterCallbackPreviewImage);
+  table->Add("LSCAN_Capture_RegisterCallbackObjectCount", RegisterCallbackObjectCount);
+  table->Add("LSCAN_Capture_RegisterCallbackObjectQuality", RegisterCallbackObjectQuality);
+  table->Add("LSCAN_Capture_RegisterCallbackTakingResultImage", RegisterCallbackTakingResultImage);
+  table->Add("LSCAN_Capture_RegisterCallbackAcquisitionComplete", RegisterCallbackAcquisitionComplete);
+  table->Add("LSCAN_Capture_RegisterCallbackResultImage", RegisterCallbackResultImage);
+  table->Add("LSCAN_Capture_RegisterCallbackClearObjectsFromPlaten", RegisterCallbackClearObjectsFromPlaten);
+  table->Add("setPreviewPolicy", SetPreviewPolicy);
+  table->Add("previewStats", PreviewStatistics);
+  table->Add("captureStreamOpen", CaptureStreamOpen);
+  table->Add("captureStreamClose", CaptureStreamClose);
+  table->Add("captureStreamStats", CaptureStreamStatistics);
+  table->Add("latencyStats", LatencyStatistics);
+  table->Add("latencyReset", LatencyReset);
+  table->Add("latencyMarkStart", LatencyMarkStart);
+  table->Add("latencyPrometheus", LatencyPrometheus);
+}
+
+}  // namespace lse
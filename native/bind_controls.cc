@@ -0,0 +1,306 @@
+#include "bindings.h"
+#include "controls_queue.h"
+#include "dispatcher.h"
+
+#include <string>
+
+namespace lse {
+
+namespace {
+
+/// Number of object colour arguments of the display screen functions (9 per hand).
+constexpr int kDisplayColorCount = 18;
+
+napi_value GetAvailableBeeper(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_GetAvailableBeeper);
+  LScanBeeperType beeperType = LSCAN_BEEPER_NONE;
+  int status = LSCAN_Controls_GetAvailableBeeper(handle, &beeperType);
+  Outputs()[0] = beeperType;
+  return MakeInt(env, status);
+}
+
+napi_value Beeper(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int pattern = args.Int(1);
+  int volume = args.Int(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_Beeper);
+  int status = LSCAN_Controls_Beeper(handle, pattern, volume);
+  ForgetControl(handle, ControlFunction::kBeeper);
+  return MakeInt(env, status);
+}
+
+napi_value GetAvailableKeys(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_GetAvailableKeys);
+  LScanKeypadType keypadType = LSCAN_KEYPAD_NONE;
+  int keyCount = 0;
+  DWORD availableKeys = 0;
+  int status = LSCAN_Controls_GetAvailableKeys(handle, &keypadType, &keyCount, &availableKeys);
+  double *out = Outputs();
+  out[0] = keypadType;
+  out[1] = keyCount;
+  out[2] = availableKeys;
+  return MakeInt(env, status);
+}
+
+napi_value SetActiveKeys(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  DWORD activeKeys = args.Dword(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_SetActiveKeys);
+  int status = LSCAN_Controls_SetActiveKeys(handle, activeKeys);
+  ForgetControl(handle, ControlFunction::kSetActiveKeys);
+  return MakeInt(env, status);
+}
+
+napi_value GetAvailableLEDs(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_GetAvailableLEDs);
+  LScanLedType ledType = LSCAN_LED_NONE;
+  int ledCount = 0;
+  DWORD availableLEDs = 0;
+  int status = LSCAN_Controls_GetAvailableLEDs(handle, &ledType, &ledCount, &availableLEDs);
+  double *out = Outputs();
+  out[0] = ledType;
+  out[1] = ledCount;
+  out[2] = availableLEDs;
+  return MakeInt(env, status);
+}
+
+napi_value SetActiveLEDs(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  DWORD activeLEDs = args.Dword(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_SetActiveLEDs);
+  int status = LSCAN_Controls_SetActiveLEDs(handle, activeLEDs);
+  ForgetControl(handle, ControlFunction::kSetActiveLEDs);
+  return MakeInt(env, status);
+}
+
+napi_value GetActiveLEDs(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_GetActiveLEDs);
+  DWORD activeLEDs = 0;
+  int status = LSCAN_Controls_GetActiveLEDs(handle, &activeLEDs);
+  Outputs()[0] = activeLEDs;
+  return MakeInt(env, status);
+}
+
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackKeys, CallbackKind::kKeys, LSCAN_Controls_RegisterCallbackKeys,
+                              OnKeys)
+
+napi_value DisplayShowLogoScreen(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int logoOption = args.Int(1);
+  int progressBarPercent = args.Int(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_DisplayShowLogoScreen);
+  int status = LSCAN_Controls_DisplayShowLogoScreen(handle, static_cast<LScanDisplayLogoOption>(logoOption),
+                                                    progressBarPercent);
+  ForgetControl(handle, ControlFunction::kShowLogoScreen);
+  return MakeInt(env, status);
+}
+
+napi_value DisplayShowModeSelectScreen(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_DisplayShowModeSelectScreen);
+  int status = LSCAN_Controls_DisplayShowModeSelectScreen(handle);
+  ForgetControl(handle, ControlFunction::kShowModeSelectScreen);
+  return MakeInt(env, status);
+}
+
+napi_value DisplayShowResolutionSelectScreen(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_DisplayShowResolutionSelectScreen);
+  int status = LSCAN_Controls_DisplayShowResolutionSelectScreen(handle);
+  ForgetControl(handle, ControlFunction::kShowResolutionSelectScreen);
+  return MakeInt(env, status);
+}
+
+/// Read the 18 object colours starting at argument @p first (left palm .. right small finger).
+void ReadDisplayColors(Args *args, size_t first, LScanDisplayObjectColor *colors) {
+  for (int i = 0; i < kDisplayColorCount; i++) {
+    colors[i] = static_cast<LScanDisplayObjectColor>(args->Int(first + i));
+  }
+}
+
+napi_value DisplayShowFingerSelectionScreen(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int ctrlLeft = args.Int(1);
+  int ctrlRight = args.Int(2);
+  LScanDisplayObjectColor c[kDisplayColorCount];
+  ReadDisplayColors(&args, 3, c);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_DisplayShowFingerSelectionScreen);
+  int status = LSCAN_Controls_DisplayShowFingerSelectionScreen(
+      handle, static_cast<LScanDisplaySelectionCtrl>(ctrlLeft), static_cast<LScanDisplayCommonCtrl>(ctrlRight), c[0],
+      c[1], c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9], c[10], c[11], c[12], c[13], c[14], c[15], c[16], c[17]);
+  ForgetControl(handle, ControlFunction::kShowFingerSelectionScreen);
+  return MakeInt(env, status);
+}
+
+napi_value DisplayShowNextFingerSelection(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_DisplayShowNextFingerSelection);
+  LScanDisplaySelectionCtrl nextCtrlLeft = LSCAN_DISPLAY_SELECTION_NONE;
+  int status = LSCAN_Controls_DisplayShowNextFingerSelection(handle, &nextCtrlLeft);
+  // Moves the selection of the finger selection screen the queue may have shown.
+  ForgetControl(handle, ControlFunction::kShowFingerSelectionScreen);
+  Outputs()[0] = nextCtrlLeft;
+  return MakeInt(env, status);
+}
+
+napi_value DisplayShowCaptureProgressScreen(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int ctrlLeft = args.Int(1);
+  int ctrlRight = args.Int(2);
+  int scanStatTop = args.Int(3);
+  int scanStatBottom = args.Int(4);
+  LScanDisplayObjectColor c[kDisplayColorCount];
+  ReadDisplayColors(&args, 5, c);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Controls_DisplayShowCaptureProgressScreen);
+  int status = LSCAN_Controls_DisplayShowCaptureProgressScreen(
+      handle, static_cast<LScanDisplayCommonCtrl>(ctrlLeft), static_cast<LScanDisplayCommonCtrl>(ctrlRight),
+      static_cast<LScanDisplayStatTop>(scanStatTop), static_cast<LScanDisplayStatBottom>(scanStatBottom), c[0], c[1],
+      c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9], c[10], c[11], c[12], c[13], c[14], c[15], c[16], c[17]);
+  ForgetControl(handle, ControlFunction::kShowCaptureProgressScreen);
+  return MakeInt(env, status);
+}
+
+/// queueControl(handle, name, ...args) -> Promise<status>: the SDK function
+/// @e name (an LED, key, beeper or display screen call) with its [in] arguments
+/// after the handle, through the handle's ControlsQueue. The status is that of
+/// the device round trip that carried the call, or LSCAN_STATUS_OK if none was
+/// needed.
+napi_value QueueControl(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  const char *name = args.String(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  ControlCall call;
+  if (!FindControlFunction(name, &call.function)) {
+    napi_throw_type_error(env, "ERR_LSE_CONTROL", (std::string(name) + " cannot be queued as a control").c_str());
+    return nullptr;
+  }
+  if (!ControlAvailable(call.function)) {
+    ThrowMissingEntry(env, name);
+    return nullptr;
+  }
+  call.argc = ControlArgCount(call.function);
+  for (int i = 0; i < call.argc; i++) {
+    call.args[i] = args.Int(2 + i);
+  }
+  if (!args.ok()) {
+    return nullptr;
+  }
+
+  napi_deferred deferred = nullptr;
+  napi_value promise = nullptr;
+  NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+  SharedDispatcher().AddListener();
+  GetControlsQueue(handle)->Push(call, [deferred](int status) {
+    SharedDispatcher().PostCompletion([deferred, status](napi_env env) {
+      SharedDispatcher().RemoveListener();
+      napi_resolve_deferred(env, deferred, MakeInt(env, status));
+    });
+  });
+  return promise;
+}
+
+/// controlsStats(handle): counters of the handle's ControlsQueue; @e saved is
+/// the number of queued calls that needed no round trip of their own.
+napi_value ControlsStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  ControlsStats stats = GetControlsQueue(handle)->Stats();
+  return ResultObject(env)
+      .Double("requests", static_cast<double>(stats.requests))
+      .Double("calls", static_cast<double>(stats.calls))
+      .Double("coalesced", static_cast<double>(stats.coalesced))
+      .Double("skipped", static_cast<double>(stats.skipped))
+      .Double("saved", static_cast<double>(stats.coalesced + stats.skipped))
+      .Double("failed", static_cast<double>(stats.failed))
+      .Double("pending", static_cast<double>(stats.pending))
+      .Double("callNs", static_cast<double>(stats.callNs))
+      .Double("maxCallNs", static_cast<double>(stats.maxCallNs))
+      .Double("yields", static_cast<double>(stats.yields))
+      .Double("yieldNs", static_cast<double>(stats.yieldNs))
+      .value();
+}
+
+}  // namespace
+
+void AddControlsBindings(MethodTable *table) {
+  table->Add("LSCAN_Controls_GetAvailableBeeper", GetAvailableBeeper);
+  table->Add("LSCAN_Controls_Beeper", Beeper);
+  table->Add("LSCAN_Controls_GetAvailableKeys", GetAvailableKeys);
+  table->Add("LSCAN_Controls_SetActiveKeys", SetActiveKeys);
+  table->Add("LSCAN_Controls_GetAvailableLEDs", GetAvailableLEDs);
+  table->Add("LSCAN_Controls_SetActiveLEDs", SetActiveLEDs);
+  table->Add("LSCAN_Controls_GetActiveLEDs", GetActiveLEDs);
+  table->Add("LSCAN_Controls_RegisterCallbackKeys", RegisterCallbackKeys);
+  table->Add("LSCAN_Controls_DisplayShowLogoScreen", DisplayShowLogoScreen);
+  table->Add("LSCAN_Controls_DisplayShowModeSelectScreen", DisplayShowModeSelectScreen);
+  table->Add("LSCAN_Controls_DisplayShowResolutionSelectScreen", DisplayShowResolutionSelectScreen);
+  table->Add("LSCAN_Controls_DisplayShowFingerSelectionScreen", DisplayShowFingerSelectionScreen);
+  table->Add("LSCAN_Controls_DisplayShowNextFingerSelection", DisplayShowNextFingerSelection);
+  table->Add("LSCAN_Controls_DisplayShowCaptureProgressScreen", DisplayShowCaptureProgressScreen);
+  table->Add("queueControl", QueueControl);
+  table->Add("controlsStats", ControlsStatistics);
+}
+
+}  // namespace lse
@@ -0,0 +1,492 @@
+/// Host-side image transforms on the { width, height, resolution, bitsPerPixel,
+/// data } images the callbacks deliver; see image_kernels.h. Not SDK functions.
+///
+///   imageFlipVertical(data, width, height)                                  in place
+///   imageCrop(data, width, height, resolution, x, y, cropWidth, cropHeight) -> image
+///   imageDownscale(data, width, height, resolution, factor)                 -> image
+///   imageStats(data, width, height) -> { count, min, max, mean, stdDev, p1, p50, p99, histogram }
+///   simdLevel() -> { active, detected }, setSimdLevel(level) -> active
+///   encodePng(data, width, height, resolution, level, filter) -> Promise<Buffer>
+///   encodeJpeg(data, width, height, quality) -> Promise<Buffer>
+///   setResultImageEncoding(handle, format, level, filter, quality) -> status
+///   encoderStats() -> { jobs, failed, bytesIn, bytesOut, encodeNs, pending }
+///   qualityAnalyze(data, width, height, objects, minContrast, minBlocks, threads, maps) -> frame
+///   qualityMapOpen(handle, objects, minContrast, minBlocks, threads, maps, threshold, stableFrames,
+///                  maxFps, callback) -> status
+///   qualityMapRearm(handle), qualityMapClose(handle) -> status
+///   qualityMapStats(handle) -> { open, received, analyzed, ..., overBudget }
+///   segmentSlap(data, width, height, imageType, hand, fingers, minContrast, minBlocks, threads)
+///              -> segmentation
+///   setResultImageSegmentation(handle, enabled, imageType, hand, ...) -> status
+///   segmentationStats() -> { images, fingers, incomplete, splits, segmentNs, maxSegmentNs }
+///
+/// New images and encoded files live in pooled blocks, like callback images.
+/// Geometry that does not fit the data throws a RangeError.
+
+#include "bindings.h"
+#include "callbacks.h"
+#include "frame_pool.h"
+#include "image_encoder.h"
+#include "image_kernels.h"
+#include "quality_map.h"
+#include "segmentation.h"
+#include "task_pool.h"
+
+namespace lse {
+
+namespace {
+
+/// Pixels of an 8-bit @p width x @p height image at argument 0, or nullptr after
+/// throwing.
+uint8_t *ImagePixels(Args &args, int width, int height) {
+  size_t length = 0;
+  uint8_t *pixels = args.Bytes(0, &length);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (width <= 0 || height <= 0 || static_cast<size_t>(width) * height > length) {
+    napi_throw_range_error(args.env(), "ERR_LSE_IMAGE_GEOMETRY", "Image width x height exceeds the pixel data");
+    return nullptr;
+  }
+  return pixels;
+}
+
+/// Pooled @p width x @p height image for a transform to fill, or false after throwing.
+bool NewImage(napi_env env, int width, int height, int resolution, ImageFrame *image) {
+  image->width = width;
+  image->height = height;
+  image->resolution = resolution;
+  image->bitsPerPixel = 8;
+  image->pixels.reset(SharedFramePool().Acquire(static_cast<size_t>(width) * height));
+  if (!image->pixels) {
+    napi_throw_error(env, "ERR_LSE_OUT_OF_MEMORY", "Out of memory for the image");
+    return false;
+  }
+  return true;
+}
+
+napi_value FlipVerticalBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  FlipVertical(pixels, width, height);
+  return nullptr;
+}
+
+napi_value CropBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  int resolution = args.Int(3);
+  int x = args.Int(4);
+  int y = args.Int(5);
+  int cropWidth = args.Int(6);
+  int cropHeight = args.Int(7);
+  const uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  if (x < 0 || y < 0 || cropWidth <= 0 || cropHeight <= 0 || cropWidth > width - x || cropHeight > height - y) {
+    napi_throw_range_error(env, "ERR_LSE_IMAGE_GEOMETRY", "Crop rectangle outside the image");
+    return nullptr;
+  }
+  ImageFrame image;
+  if (!NewImage(env, cropWidth, cropHeight, resolution, &image)) {
+    return nullptr;
+  }
+  Crop(pixels, width, x, y, cropWidth, cropHeight, image.pixels->data);
+  return ImageToJs(env, &image);
+}
+
+napi_value DownscaleBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  int resolution = args.Int(3);
+  int factor = args.Int(4);
+  const uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  if ((factor != 2 && factor != 4) || width < factor || height < factor) {
+    napi_throw_range_error(env, "ERR_LSE_IMAGE_GEOMETRY", "Downscale factor must be 2 or 4 and fit the image");
+    return nullptr;
+  }
+  ImageFrame image;
+  if (!NewImage(env, width / factor, height / factor, resolution / factor, &image)) {
+    return nullptr;
+  }
+  Downscale(pixels, width, height, factor, image.pixels->data);
+  return ImageToJs(env, &image);
+}
+
+napi_value StatsBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  const uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  ImageStats stats;
+  ComputeStats(pixels, static_cast<size_t>(width) * height, &stats);
+
+  void *data = nullptr;
+  napi_value buffer = nullptr;
+  napi_value histogram = nullptr;
+  NAPI_CHECK(env, napi_create_arraybuffer(env, sizeof(stats.histogram), &data, &buffer));
+  memcpy(data, stats.histogram, sizeof(stats.histogram));
+  NAPI_CHECK(env, napi_create_typedarray(env, napi_uint32_array, 256, buffer, 0, &histogram));
+  return ResultObject(env)
+      .Double("count", static_cast<double>(stats.count))
+      .Int("min", stats.min)
+      .Int("max", stats.max)
+      .Double("mean", stats.mean)
+      .Double("stdDev", stats.stdDev)
+      .Int("p1", stats.p1)
+      .Int("p50", stats.p50)
+      .Int("p99", stats.p99)
+      .Set("histogram", histogram)
+      .value();
+}
+
+napi_value SimdLevelBinding(napi_env env, napi_callback_info info) {
+  return ResultObject(env)
+      .Int("active", static_cast<int>(ActiveSimdLevel()))
+      .Int("detected", static_cast<int>(DetectedSimdLevel()))
+      .value();
+}
+
+napi_value SetSimdLevelBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int level = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (level < static_cast<int>(SimdLevel::kScalar) || level > static_cast<int>(SimdLevel::kAvx2)) {
+    napi_throw_range_error(env, "ERR_LSE_SIMD_LEVEL", "Unknown SIMD level");
+    return nullptr;
+  }
+  return MakeInt(env, static_cast<int>(SetSimdLevel(static_cast<SimdLevel>(level))));
+}
+
+/// PNG options from arguments @p i (level) and @p i + 1 (filter), or false
+/// after throwing.
+bool ReadPngOptions(Args &args, size_t i, PngOptions *options) {
+  options->level = args.Int(i);
+  int filter = args.Int(i + 1);
+  if (!args.ok()) {
+    return false;
+  }
+  if (options->level < 0 || options->level > 9 || filter < static_cast<int>(PngFilter::kNone) ||
+      filter > static_cast<int>(PngFilter::kPaeth)) {
+    napi_throw_range_error(args.env(), "ERR_LSE_ENCODING", "PNG level must be 0-9 and filter 0-3");
+    return false;
+  }
+  options->filter = static_cast<PngFilter>(filter);
+  return true;
+}
+
+napi_value EncodePngBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  int resolution = args.Int(3);
+  EncodingOptions options;
+  options.format = ImageEncoding::kPng;
+  if (!ReadPngOptions(args, 4, &options.png)) {
+    return nullptr;
+  }
+  const uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  ImageFrame geometry;
+  geometry.width = width;
+  geometry.height = height;
+  geometry.resolution = resolution;
+  geometry.bitsPerPixel = 8;
+  // The job copies the pixels, so the caller may reuse the Buffer right away.
+  return EncodeJob::Start(geometry, pixels, static_cast<size_t>(width) * height, options)->Promise(env);
+}
+
+/// JPEG quality from argument @p i, or false after throwing.
+bool ReadJpegOptions(Args &args, size_t i, JpegOptions *options) {
+  options->quality = args.Int(i);
+  if (!args.ok()) {
+    return false;
+  }
+  if (options->quality < JpegOptions::kMinQuality || options->quality > JpegOptions::kMaxQuality) {
+    napi_throw_range_error(args.env(), "ERR_LSE_ENCODING", "JPEG quality must be 1-100");
+    return false;
+  }
+  return true;
+}
+
+napi_value EncodeJpegBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  EncodingOptions options;
+  options.format = ImageEncoding::kJpeg;
+  if (!ReadJpegOptions(args, 3, &options.jpeg)) {
+    return nullptr;
+  }
+  const uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  ImageFrame geometry;
+  geometry.width = width;
+  geometry.height = height;
+  geometry.bitsPerPixel = 8;
+  return EncodeJob::Start(geometry, pixels, static_cast<size_t>(width) * height, options)->Promise(env);
+}
+
+/// setResultImageEncoding(handle, format, level, filter, quality): encode every
+/// result image of @p handle in the background; format 0 turns it off.
+napi_value SetResultImageEncoding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int format = args.Int(1);
+  EncodingOptions options;
+  if (!ReadPngOptions(args, 2, &options.png) || !ReadJpegOptions(args, 4, &options.jpeg)) {
+    return nullptr;
+  }
+  if (format < static_cast<int>(ImageEncoding::kNone) || format > static_cast<int>(ImageEncoding::kJpeg)) {
+    return MakeInt(env, LSCAN_ERR_INVALID_PARAM_VALUE);
+  }
+  options.format = static_cast<ImageEncoding>(format);
+  SetResultEncoding(handle, options);
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+napi_value EncoderStatistics(napi_env env, napi_callback_info info) {
+  EncoderStats stats = GetEncoderStats();
+  return ResultObject(env)
+      .Double("jobs", static_cast<double>(stats.jobs))
+      .Double("failed", static_cast<double>(stats.failed))
+      .Double("bytesIn", static_cast<double>(stats.bytesIn))
+      .Double("bytesOut", static_cast<double>(stats.bytesOut))
+      .Double("encodeNs", static_cast<double>(stats.encodeNs))
+      .Double("pending", static_cast<double>(stats.pending))
+      .value();
+}
+
+/// Analysis settings from arguments @p i (objects), minContrast, minBlocks,
+/// threads and maps, or false after throwing.
+bool ReadQualityConfig(Args &args, size_t i, QualityMapConfig *config) {
+  config->objects = args.Int(i);
+  config->minContrast = args.Int(i + 1);
+  config->minBlocks = args.Int(i + 2);
+  config->threads = args.Int(i + 3);
+  config->maps = args.Bool(i + 4) != 0;
+  if (!args.ok()) {
+    return false;
+  }
+  if (config->objects < 0 || config->objects > LSCAN_MAX_OBJECTS || config->minContrast < 0 ||
+      config->minBlocks < 1 || config->threads < 0 || config->threads > TaskPool::kMaxThreads) {
+    napi_throw_range_error(args.env(), "ERR_LSE_QUALITY_MAP", "Quality map settings out of range");
+    return false;
+  }
+  return true;
+}
+
+/// qualityAnalyze(data, width, height, ...settings): the quality map of one
+/// image, computed on the calling thread and its helpers; stable and trigger
+/// are always 0 and false.
+napi_value QualityAnalyzeBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  QualityMapConfig config;
+  if (!ReadQualityConfig(args, 3, &config)) {
+    return nullptr;
+  }
+  const uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  QualityFrame frame;
+  if (!AnalyzeQuality(pixels, width, height, config, &frame)) {
+    napi_throw_error(env, "ERR_LSE_OUT_OF_MEMORY", "Out of memory for the quality map");
+    return nullptr;
+  }
+  return QualityFrameToJs(env, &frame, 0, false);
+}
+
+/// qualityMapOpen(handle, ...settings, threshold, stableFrames, maxFps, callback)
+/// -> status: analyze the handle's preview frames into @p callback; see
+/// QualityMap. Reopening reconfigures.
+napi_value QualityMapOpenBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  QualityMapConfig config;
+  if (!ReadQualityConfig(args, 1, &config)) {
+    return nullptr;
+  }
+  config.threshold = args.Double(6);
+  config.stableFrames = args.Int(7);
+  config.maxFps = args.Double(8);
+  napi_value function = args.FunctionOrNull(9);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (function == nullptr) {
+    args.Fail(9, "function");
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_RegisterCallbackPreviewImage);
+  if (!(config.threshold >= 0) || config.threshold > 1 || config.stableFrames < 1 || !(config.maxFps >= 0)) {
+    return MakeInt(env, LSCAN_ERR_INVALID_PARAM_VALUE);
+  }
+  return MakeInt(env, GetQualityMap(handle)->Open(env, config, function));
+}
+
+napi_value QualityMapRearmBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  GetQualityMap(handle)->Rearm();
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+napi_value QualityMapCloseBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_RegisterCallbackPreviewImage);
+  return MakeInt(env, GetQualityMap(handle)->Close(env));
+}
+
+/// qualityMapStats(handle): frame counters, triggers and analysis times in
+/// nanoseconds against the preview frame interval.
+napi_value QualityMapStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  QualityMap *map = GetQualityMap(handle);
+  QualityMapStats stats = map->Stats();
+  return ResultObject(env)
+      .Bool("open", map->open())
+      .Double("received", static_cast<double>(stats.received))
+      .Double("analyzed", static_cast<double>(stats.analyzed))
+      .Double("delivered", static_cast<double>(stats.delivered))
+      .Double("dropped", static_cast<double>(stats.dropped))
+      .Double("skipped", static_cast<double>(stats.skipped))
+      .Double("triggers", static_cast<double>(stats.triggers))
+      .Double("analyzeMean", stats.analyzed > 0 ? static_cast<double>(stats.analyzeNs) / stats.analyzed : 0)
+      .Double("analyzeMax", static_cast<double>(stats.maxAnalyzeNs))
+      .Double("analyzeLast", static_cast<double>(stats.lastAnalyzeNs))
+      .Double("frameInterval", static_cast<double>(stats.intervalNs))
+      .Double("overBudget", static_cast<double>(stats.overBudget))
+      .Int("hardwareThreads", HardwareThreads())
+      .value();
+}
+
+/// Segmentation settings from arguments @p i (imageType), hand, fingers,
+/// minContrast, minBlocks and threads, or false after throwing.
+bool ReadSegmentationConfig(Args &args, size_t i, SegmentationConfig *config) {
+  config->imageType = args.Int(i);
+  int hand = args.Int(i + 1);
+  config->fingers = args.Int(i + 2);
+  config->minContrast = args.Int(i + 3);
+  config->minBlocks = args.Int(i + 4);
+  config->threads = args.Int(i + 5);
+  if (!args.ok()) {
+    return false;
+  }
+  if (hand < static_cast<int>(Hand::kUnknown) || hand > static_cast<int>(Hand::kLeft) || config->fingers < 0 ||
+      config->fingers > LSCAN_MAX_OBJECTS || config->minContrast < 0 || config->minBlocks < 1 ||
+      config->threads < 0 || config->threads > TaskPool::kMaxThreads) {
+    napi_throw_range_error(args.env(), "ERR_LSE_SEGMENTATION", "Segmentation settings out of range");
+    return false;
+  }
+  config->hand = static_cast<Hand>(hand);
+  return true;
+}
+
+/// segmentSlap(data, width, height, ...settings): the fingers of one slap image,
+/// segmented on the calling thread and its helpers; their data are views into
+/// @p data.
+napi_value SegmentSlapBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int width = args.Int(1);
+  int height = args.Int(2);
+  SegmentationConfig config;
+  if (!ReadSegmentationConfig(args, 3, &config)) {
+    return nullptr;
+  }
+  const uint8_t *pixels = ImagePixels(args, width, height);
+  if (pixels == nullptr) {
+    return nullptr;
+  }
+  SlapSegmentation result;
+  SegmentSlap(pixels, width, height, config, &result);
+  return SegmentationToJs(env, result, args[0]);
+}
+
+/// setResultImageSegmentation(handle, enabled, ...settings): segment every
+/// result image of @p handle on the SDK thread before it is delivered.
+napi_value SetResultImageSegmentation(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  bool enabled = args.Bool(1) != 0;
+  SegmentationConfig config;
+  if (!ReadSegmentationConfig(args, 2, &config)) {
+    return nullptr;
+  }
+  SetResultSegmentation(handle, enabled, config);
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+napi_value SegmentationStatistics(napi_env env, napi_callback_info info) {
+  SegmentationStats stats = GetSegmentationStats();
+  return ResultObject(env)
+      .Double("images", static_cast<double>(stats.images))
+      .Double("fingers", static_cast<double>(stats.fingers))
+      .Double("incomplete", static_cast<double>(stats.incomplete))
+      .Double("splits", static_cast<double>(stats.splits))
+      .Double("segmentNs", static_cast<double>(stats.segmentNs))
+      .Double("maxSegmentNs", static_cast<double>(stats.maxSegmentNs))
+      .value();
+}
+
+}  // namespace
+
+void AddImageKernelBindings(MethodTable *table) {
+  table->Add("imageFlipVertical", FlipVerticalBinding);
+  table->Add("imageCrop", CropBinding);
+  table->Add("imageDownscale", DownscaleBinding);
+  table->Add("imageStats", StatsBinding);
+  table->Add("simdLevel", SimdLevelBinding);
+  table->Add("qualityAnalyze", QualityAnalyzeBinding);
+  table->Add("segmentSlap", SegmentSlapBinding);
+}
+
+void AddImageBindings(MethodTable *table) {
+  AddImageKernelBindings(table);
+  table->Add("setSimdLevel", SetSimdLevelBinding);
+  table->Add("encodePng", EncodePngBinding);
+  table->Add("encodeJpeg", EncodeJpegBinding);
+  table->Add("setResultImageEncoding", SetResultImageEncoding);
+  table->Add("encoderStats", EncoderStatistics);
+  table->Add("qualityMapOpen", QualityMapOpenBinding);
+  table->Add("qualityMapRearm", QualityMapRearmBinding);
+  table->Add("qualityMapClose", QualityMapCloseBinding);
+  table->Add("qualityMapStats", QualityMapStatistics);
+  table->Add("setResultImageSegmentation", SetResultImageSegmentation);
+  table->Add("segmentationStats", SegmentationStatistics);
+}
+
+}  // namespace lse
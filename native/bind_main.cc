@@ -0,0 +1,250 @@
+#include "bindings.h"
+#include "controls_queue.h"
+#include "frame_pool.h"
+#include "property_cache.h"
+
+namespace lse {
+
+namespace {
+
+napi_value GetAPIVersion(napi_env env, napi_callback_info /*info*/) {
+  LSE_ENTRY(env, LSCAN_Main_GetAPIVersion);
+  LScanApiVersion version = {};
+  int status = GetCachedApiVersion(&version);
+  double *out = Outputs();
+  out[0] = version.MajorVersion;
+  out[1] = version.MinorVersion;
+  out[2] = version.PatchVersion;
+  out[3] = version.BuildVersion;
+  return MakeInt(env, status);
+}
+
+napi_value GetDeviceCount(napi_env env, napi_callback_info /*info*/) {
+  LSE_ENTRY(env, LSCAN_Main_GetDeviceCount);
+  int deviceCount = 0;
+  int status = LSCAN_Main_GetDeviceCount(&deviceCount);
+  if (status == LSCAN_STATUS_OK) {
+    NoteDeviceCount(deviceCount);
+  }
+  Outputs()[0] = deviceCount;
+  return MakeInt(env, status);
+}
+
+napi_value GetDeviceInfo(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_GetDeviceInfo);
+  LScanDeviceInfo deviceInfo = {};
+  int status = LSCAN_Main_GetDeviceInfo(deviceIndex, &deviceInfo);
+  return ResultObject(env)
+      .Int("status", status)
+      .String("serialNumber", deviceInfo.DeviceSerialNumber)
+      .String("productName", deviceInfo.ProductName)
+      .String("interfaceType", deviceInfo.InterfaceType)
+      .String("firmwareVersion", deviceInfo.FirmwareVersion)
+      .String("hardwareVersion", deviceInfo.HardwareVersion)
+      .Bool("isInitialized", deviceInfo.IsInitialized != FALSE)
+      .value();
+}
+
+napi_value RegisterCallbackProgress(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  napi_value function = args.FunctionOrNull(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_RegisterCallbackProgress);
+  CallbackSlot *slot = GetCallbackSlot(CallbackKind::kProgress, -1);
+  if (!AssignCallback(env, slot, function)) {
+    return nullptr;
+  }
+  return MakeInt(env,
+                 LSCAN_Main_RegisterCallbackProgress(function != nullptr ? OnProgress : nullptr, SlotSink(slot)));
+}
+
+napi_value RegisterCallbackDeviceCount(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  napi_value function = args.FunctionOrNull(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_RegisterCallbackDeviceCount);
+  CallbackSlot *slot = GetCallbackSlot(CallbackKind::kDeviceCount, -1);
+  if (!AssignCallback(env, slot, function)) {
+    return nullptr;
+  }
+  return MakeInt(env,
+                 LSCAN_Main_RegisterCallbackDeviceCount(function != nullptr ? OnDeviceCount : nullptr, SlotSink(slot)));
+}
+
+napi_value ImageQualityInfieldTest(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  const char *logFilePath = args.String(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_ImageQualityInfieldTest);
+  return MakeInt(env, LSCAN_Main_ImageQualityInfieldTest(deviceIndex, logFilePath));
+}
+
+napi_value InstallLicenseFile(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  const char *licenseFileName = args.String(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_InstallLicenseFile);
+  int status = LSCAN_Main_InstallLicenseFile(deviceIndex, licenseFileName);
+  InvalidateProperties(-1, PropertyScope::kSettable);
+  return MakeInt(env, status);
+}
+
+napi_value Initialize(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  BOOL reset = args.Bool(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_Initialize);
+  int handle = -1;
+  int status = LSCAN_Main_Initialize(deviceIndex, reset, &handle);
+  if (status >= 0) {
+    InvalidateProperties(handle, PropertyScope::kAll);
+    ForgetControls(handle);
+  }
+  Outputs()[0] = handle;
+  return MakeInt(env, status);
+}
+
+napi_value InitializeExternalVisualization(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  BOOL reset = args.Bool(1);
+  const char *pipeName = args.String(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_Initialize_ExternalVisualization);
+  int handle = -1;
+  int status = LSCAN_Main_Initialize_ExternalVisualization(deviceIndex, reset, &handle, pipeName);
+  if (status >= 0) {
+    InvalidateProperties(handle, PropertyScope::kAll);
+    ForgetControls(handle);
+  }
+  Outputs()[0] = handle;
+  return MakeInt(env, status);
+}
+
+napi_value Release(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  BOOL sendToStandby = args.Bool(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_Release);
+  InvalidateProperties(handle, PropertyScope::kAll);
+  ForgetControls(handle);
+  TrimFramePool(handle);
+  return MakeInt(env, LSCAN_Main_Release(handle, sendToStandby));
+}
+
+napi_value ReleaseAll(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  BOOL sendToStandby = args.Bool(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_ReleaseAll);
+  InvalidateProperties(-1, PropertyScope::kAll);
+  ForgetControls(-1);
+  return MakeInt(env, LSCAN_Main_ReleaseAll(sendToStandby));
+}
+
+napi_value IsInitialized(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_IsInitialized);
+  return MakeInt(env, LSCAN_Main_IsInitialized(handle));
+}
+
+napi_value GetProperty(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int propertyId = args.Int(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_GetProperty);
+  char value[LSCAN_MAX_STR_LEN] = {};
+  int status = GetCachedProperty(handle, static_cast<LScanPropertyId>(propertyId), value);
+  return ResultObject(env).Int("status", status).String("value", value).value();
+}
+
+napi_value SetProperty(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int propertyId = args.Int(1);
+  const char *value = args.String(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_SetProperty);
+  return MakeInt(env, SetCachedProperty(handle, static_cast<LScanPropertyId>(propertyId), value));
+}
+
+napi_value CheckCleanliness(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_CheckCleanliness);
+  return MakeInt(env, LSCAN_Main_CheckCleanliness(handle));
+}
+
+napi_value ForceReadjustment(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_ForceReadjustment);
+  return MakeInt(env, LSCAN_Main_ForceReadjustment(handle));
+}
+
+LSE_REGISTER_CALLBACK_BINDING(RegisterCallbackCommunicationBreak, CallbackKind::kCommunicationBreak,
+                              LSCAN_Main_RegisterCallbackCommunicationBreak, OnCommunicationBreak)
+
+}  // namespace
+
+void AddMainBindings(MethodTable *table) {
+  table->Add("LSCAN_Main_GetAPIVersion", GetAPIVersion);
+  table->Add("LSCAN_Main_GetDeviceCount", GetDeviceCount);
+  table->Add("LSCAN_Main_GetDeviceInfo", GetDeviceInfo);
+  table->Add("LSCAN_Main_RegisterCallbackProgress", RegisterCallbackProgress);
+  table->Add("LSCAN_Main_RegisterCallbackDeviceCount", RegisterCallbackDeviceCount);
+  table->Add("LSCAN_Main_ImageQualityInfieldTest", ImageQualityInfieldTest);
+  table->Add("LSCAN_Main_InstallLicenseFile", InstallLicenseFile);
+  table->Add("LSCAN_Main_Initialize", Initialize);
+  table->Add("LSCAN_Main_Initialize_ExternalVisualization", InitializeExternalVisualization);
+  table->Add("LSCAN_Main_Release", Release);
+  table->Add("LSCAN_Main_ReleaseAll", ReleaseAll);
+  table->Add("LSCAN_Main_IsInitialized", IsInitialized);
+  table->Add("LSCAN_Main_GetProperty", GetProperty);
+  table->Add("LSCAN_Main_SetProperty", SetProperty);
+  table->Add("LSCAN_Main_CheckCleanliness", CheckCleanliness);
+  table->Add("LSCAN_Main_ForceReadjustment", ForceReadjustment);
+  table->Add("LSCAN_Main_RegisterCallbackCommunicationBreak", RegisterCallbackCommunicationBreak);
+}
+
+}  // namespace lse
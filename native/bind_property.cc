@@ -0,0 +1,158 @@
+/// Batch property reads through the property cache (see property_cache.h). Not
+/// SDK functions; LSCAN_Main_GetProperty/SetProperty use the same cache.
+///
+///   getProperties(handle, [propertyId...]) -> { status, values, statuses, hits }
+///   getPropertiesAsync(handle, [propertyId...]) -> Promise<{ status, values, statuses, hits }>
+///   propertyCacheStats() -> { hits, misses, invalidations, entries, deviceInfoHits, deviceInfoMisses }
+///   propertyCacheClear(handle) -> status; handle -1 clears every handle and the device infos
+///
+/// @e values and @e statuses follow the order of the ids; @e status is the first
+/// failing status, or LSCAN_STATUS_OK. The async variant reads on the TaskPool,
+/// so properties that go to the device do not block the event loop.
+
+#include "bindings.h"
+#include "dispatcher.h"
+#include "property_cache.h"
+#include "task_pool.h"
+
+#include <string>
+#include <vector>
+
+namespace lse {
+
+namespace {
+
+struct PropertyBatch {
+  int handle = -1;
+  std::vector<int> ids;
+  std::vector<std::string> values;
+  std::vector<int> statuses;
+  int status = LSCAN_STATUS_OK;
+  int hits = 0;
+
+  void Read() {
+    char value[LSCAN_MAX_STR_LEN];
+    for (int id : ids) {
+      bool hit = false;
+      int result = GetCachedProperty(handle, static_cast<LScanPropertyId>(id), value, &hit);
+      values.emplace_back(result >= 0 ? value : "");
+      statuses.push_back(result);
+      hits += hit ? 1 : 0;
+      if (result < 0 && status == LSCAN_STATUS_OK) {
+        status = result;
+      }
+    }
+  }
+
+  napi_value ToJs(napi_env env) const {
+    napi_value valueList = nullptr;
+    napi_value statusList = nullptr;
+    napi_create_array_with_length(env, ids.size(), &valueList);
+    napi_create_array_with_length(env, ids.size(), &statusList);
+    for (uint32_t k = 0; k < ids.size(); k++) {
+      napi_set_element(env, valueList, k, MakeString(env, values[k].c_str()));
+      napi_set_element(env, statusList, k, MakeInt(env, statuses[k]));
+    }
+    return ResultObject(env)
+        .Int("status", status)
+        .Set("values", valueList)
+        .Set("statuses", statusList)
+        .Int("hits", hits)
+        .value();
+  }
+};
+
+/// (handle, [propertyId...]) arguments into @p batch.
+bool BatchArguments(napi_env env, Args &args, PropertyBatch *batch) {
+  batch->handle = args.Int(0);
+  bool isArray = false;
+  napi_is_array(env, args[1], &isArray);
+  if (!args.ok()) {
+    return false;
+  }
+  if (!isArray) {
+    args.Fail(1, "array of property ids");
+    return false;
+  }
+  uint32_t length = 0;
+  NAPI_CHECK_RETURN(env, napi_get_array_length(env, args[1], &length), false);
+  for (uint32_t k = 0; k < length; k++) {
+    napi_value element = nullptr;
+    int32_t id = 0;
+    NAPI_CHECK_RETURN(env, napi_get_element(env, args[1], k, &element), false);
+    if (napi_get_value_int32(env, element, &id) != napi_ok) {
+      args.Fail(1, "array of property ids");
+      return false;
+    }
+    batch->ids.push_back(id);
+  }
+  return true;
+}
+
+napi_value GetProperties(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  PropertyBatch batch;
+  if (!BatchArguments(env, args, &batch)) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_GetProperty);
+  batch.Read();
+  return batch.ToJs(env);
+}
+
+napi_value GetPropertiesAsync(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  auto batch = std::make_shared<PropertyBatch>();
+  if (!BatchArguments(env, args, batch.get())) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_GetProperty);
+  napi_deferred deferred = nullptr;
+  napi_value promise = nullptr;
+  NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+  SharedDispatcher().AddListener();
+  SharedTaskPool().Post([deferred, batch] {
+    batch->Read();
+    SharedDispatcher().PostCompletion([deferred, batch](napi_env env) {
+      SharedDispatcher().RemoveListener();
+      napi_resolve_deferred(env, deferred, batch->ToJs(env));
+    });
+  });
+  return promise;
+}
+
+napi_value PropertyCacheStatistics(napi_env env, napi_callback_info /*info*/) {
+  PropertyCacheStats stats = GetPropertyCacheStats();
+  return ResultObject(env)
+      .Double("hits", static_cast<double>(stats.hits))
+      .Double("misses", static_cast<double>(stats.misses))
+      .Double("invalidations", static_cast<double>(stats.invalidations))
+      .Double("entries", static_cast<double>(stats.entries))
+      .Double("deviceInfoHits", static_cast<double>(stats.deviceInfoHits))
+      .Double("deviceInfoMisses", static_cast<double>(stats.deviceInfoMisses))
+      .value();
+}
+
+napi_value PropertyCacheClear(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  InvalidateProperties(handle, PropertyScope::kAll);
+  if (handle < 0) {
+    InvalidateDeviceInfo();
+  }
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+}  // namespace
+
+void AddPropertyBindings(MethodTable *table) {
+  table->Add("getProperties", GetProperties);
+  table->Add("getPropertiesAsync", GetPropertiesAsync);
+  table->Add("propertyCacheStats", PropertyCacheStatistics);
+  table->Add("propertyCacheClear", PropertyCacheClear);
+}
+
+}  // namespace lse
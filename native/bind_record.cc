@@ -0,0 +1,80 @@
+/// Session recording and replay; see recorder.h. Not SDK functions.
+///
+///   recordStart(path, handle)      -> status; handle -1 records every handle
+///   recordStop()                   -> { active, events, bytes, failed }
+///   recordStats()                  -> { active, events, bytes, failed }
+///   replay(path, speed, handle)    -> Promise<{ events, bytes, durationNs, stopped }>
+///   replayStop()                   -> number of replays stopped
+///
+/// File errors throw ERR_LSE_RECORD / ERR_LSE_REPLAY.
+
+#include "bindings.h"
+#include "recorder.h"
+
+namespace lse {
+
+namespace {
+
+napi_value RecorderStatsToJs(napi_env env, const RecorderStats &stats) {
+  return ResultObject(env)
+      .Bool("active", stats.active)
+      .Double("events", static_cast<double>(stats.events))
+      .Double("bytes", static_cast<double>(stats.bytes))
+      .Double("failed", static_cast<double>(stats.failed))
+      .value();
+}
+
+napi_value RecordStart(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  const char *path = args.String(0);
+  int handle = args.Int(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  std::string error;
+  if (!StartRecording(path, handle, &error)) {
+    napi_throw_error(env, "ERR_LSE_RECORD", error.c_str());
+    return nullptr;
+  }
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+napi_value RecordStop(napi_env env, napi_callback_info /*info*/) {
+  return RecorderStatsToJs(env, StopRecording());
+}
+
+napi_value RecordStatistics(napi_env env, napi_callback_info /*info*/) {
+  return RecorderStatsToJs(env, GetRecorderStats());
+}
+
+napi_value Replay(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  const char *path = args.String(0);
+  ReplayOptions options;
+  options.speed = args.Double(1);
+  options.handle = args.Int(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (!(options.speed >= 0)) {
+    napi_throw_range_error(env, "ERR_LSE_REPLAY", "Replay speed must be 0 (unpaced) or positive");
+    return nullptr;
+  }
+  return StartReplay(env, path, options);
+}
+
+napi_value ReplayStop(napi_env env, napi_callback_info /*info*/) {
+  return MakeInt(env, StopReplays());
+}
+
+}  // namespace
+
+void AddRecordBindings(MethodTable *table) {
+  table->Add("recordStart", RecordStart);
+  table->Add("recordStop", RecordStop);
+  table->Add("recordStats", RecordStatistics);
+  table->Add("replay", Replay);
+  table->Add("replayStop", ReplayStop);
+}
+
+}  // namespace lse
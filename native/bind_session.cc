@@ -0,0 +1,540 @@
+/// Multi-device session: every opened device gets a DeviceWorker, and the
+/// session bindings run SDK calls on that worker and return promises.
+///
+///   sessionOpen(reset, [deviceIndex...]?) -> Promise<[{ deviceIndex, status, handle, ...deviceInfo }]>
+///   sessionCall(deviceIndex, name, ...args) -> Promise<status>
+///   sessionRecover(deviceIndex, reset, [[name, ...args]...]) -> Promise<{ status, handle, ... }>
+///   sessionClose(sendToStandby) -> Promise<[{ deviceIndex, status }]>
+///   sessionDevices() -> [deviceIndex...]
+///
+/// sessionCall() supports the handle-based SDK functions listed in
+/// LSE_SESSION_OPS; @e name is the SDK function name and @e args are its [in]
+/// parameters after the handle. Promises settle through the dispatcher, so they
+/// resolve after every callback the SDK fired during the call. Opening a device
+/// that is already open releases its handle before initializing it again.
+///
+/// sessionRecover() brings a device back after a communication break in one
+/// task on its worker, ahead of any call queued behind it: it releases the
+/// broken handle, initializes the device again, re-registers the callbacks of
+/// the handle (RestoreCallbacks()) and replays the given session calls, which
+/// continue past a failing one.
+
+#include "bindings.h"
+#include "capture_stream.h"
+#include "clock.h"
+#include "controls_queue.h"
+#include "dispatcher.h"
+#include "frame_pool.h"
+#include "latency.h"
+#include "property_cache.h"
+#include "session.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lse {
+
+namespace {
+
+/// X(name, argc, arguments): handle-based functions callable through sessionCall().
+/// @e arguments is the call's argument list in terms of @e handle and the int
+/// array @e a.
+#define LSE_SESSION_OPS(X)                                                                                   \
+  X(LSCAN_Main_Release, 1, (handle, a[0]))                                                                   \
+  X(LSCAN_Main_CheckCleanliness, 0, (handle))                                                                \
+  X(LSCAN_Main_ForceReadjustment, 0, (handle))                                                               \
+  X(LSCAN_Capture_SetMode, 4,                                                                                \
+    (handle, static_cast<LScanImageType>(a[0]), static_cast<LScanImageResolution>(a[1]),                     \
+     static_cast<LScanImageOrientation>(a[2]), static_cast<DWORD>(a[3]), nullptr, nullptr, nullptr, nullptr)) \
+  X(LSCAN_Capture_Start, 1, (handle, a[0]))                                                                  \
+  X(LSCAN_Capture_Abort, 0, (handle))                                                                        \
+  X(LSCAN_Capture_TakeResultImage, 0, (handle))                                                              \
+  X(LSCAN_Capture_OptimizeContrast, 0, (handle))                                                             \
+  X(LSCAN_Capture_SetContrast, 1, (handle, a[0]))                                                            \
+  X(LSCAN_Capture_SetActiveArea, 4, (handle, a[0], a[1], a[2], a[3]))                                        \
+  X(LSCAN_Controls_Beeper, 2, (handle, a[0], a[1]))                                                          \
+  X(LSCAN_Controls_SetActiveKeys, 1, (handle, static_cast<DWORD>(a[0])))                                     \
+  X(LSCAN_Controls_SetActiveLEDs, 1, (handle, static_cast<DWORD>(a[0])))
+
+constexpr size_t kMaxOpArgs = 4;
+
+struct SessionOp {
+  const char *name;
+  size_t argc;
+  bool (*available)();
+  int (*call)(int handle, const int *a);
+};
+
+#define LSE_SESSION_OP(name, argc, arguments)                           \
+  {#name, argc, [] { return GetApi().name != nullptr; },               \
+   [](int handle, const int *a) -> int {                               \
+     (void)a;                                                          \
+     return GetApi().name arguments;                                   \
+   }},
+const SessionOp kSessionOps[] = {LSE_SESSION_OPS(LSE_SESSION_OP)};
+#undef LSE_SESSION_OP
+
+const SessionOp *FindOp(const char *name) {
+  for (const SessionOp &op : kSessionOps) {
+    if (strcmp(op.name, name) == 0) {
+      return &op;
+    }
+  }
+  return nullptr;
+}
+
+/// A session op with its arguments and the bookkeeping around its SDK call.
+struct OpCall {
+  const SessionOp *op = nullptr;
+  int values[kMaxOpArgs] = {};
+  // Calls that change device properties keep the property cache in step.
+  bool invalidates = false;
+  PropertyScope scope = PropertyScope::kSettable;
+  // Starts and aborts bound the startup latency, as through the direct bindings.
+  bool starts = false;
+  bool aborts = false;
+  // Geometry changes size the handle's frame pool. SetMode runs without its
+  // outputs here, so only what the mode needed before is preallocated.
+  bool setsMode = false;
+  bool setsArea = false;
+  bool releases = false;
+  // Capture calls hold back the handle's queued controls (CaptureCallScope),
+  // and control calls make the queue forget what it applied for their control.
+  bool captures = false;
+  bool controls = false;
+  ControlFunction control = ControlFunction::kSetActiveLEDs;
+};
+
+OpCall MakeOpCall(const SessionOp *op) {
+  OpCall call;
+  call.op = op;
+  call.releases = strcmp(op->name, "LSCAN_Main_Release") == 0;
+  call.setsMode = strcmp(op->name, "LSCAN_Capture_SetMode") == 0;
+  call.setsArea = strcmp(op->name, "LSCAN_Capture_SetActiveArea") == 0;
+  call.invalidates = call.setsMode || call.releases;
+  call.scope = call.releases ? PropertyScope::kAll : PropertyScope::kSettable;
+  call.starts = strcmp(op->name, "LSCAN_Capture_Start") == 0;
+  call.aborts = strcmp(op->name, "LSCAN_Capture_Abort") == 0;
+  call.captures = strncmp(op->name, "LSCAN_Capture_", 14) == 0;
+  call.controls = FindControlFunction(op->name, &call.control);
+  return call;
+}
+
+/// Run @p call for @p device; worker thread only.
+int RunOp(SessionDevice *device, const OpCall &call) {
+  if (call.starts) {
+    SharedLatencyMonitor().OnStart(device->handle, NowNs());
+    BeginCaptureMemory(device->handle);
+  }
+  if (call.releases) {
+    TrimFramePool(device->handle);
+  }
+  int status = LSCAN_STATUS_OK;
+  if (call.captures) {
+    CaptureCallScope capture(device->handle);
+    status = call.op->call(device->handle, call.values);
+  } else {
+    status = call.op->call(device->handle, call.values);
+  }
+  if (call.aborts || (call.starts && status != LSCAN_STATUS_OK)) {
+    SharedLatencyMonitor().OnStop(device->handle);
+    EndCaptureMemory(device->handle, call.aborts);
+  }
+  if (call.setsMode && status == LSCAN_STATUS_OK) {
+    PrepareFramePool(device->handle, call.values[0], call.values[1], 0, 0);
+  }
+  if (call.setsArea && status == LSCAN_STATUS_OK) {
+    ReserveActiveArea(device->handle, call.values[2], call.values[3]);
+  }
+  if (call.invalidates) {
+    InvalidateProperties(device->handle, call.scope);
+  }
+  if (call.controls) {
+    ForgetControl(device->handle, call.control);
+  }
+  if (call.releases && status == LSCAN_STATUS_OK) {
+    // As sessionOpen() and sessionRecover() do: the handle is gone, and a
+    // later open must not release it a second time.
+    ForgetControls(device->handle);
+    device->handle = -1;
+  }
+  return status;
+}
+
+/// Op for SDK function @p name; throws and returns nullptr if there is none or
+/// the SDK lacks it.
+const SessionOp *FindAvailableOp(napi_env env, const char *name) {
+  const SessionOp *op = FindOp(name);
+  if (op == nullptr) {
+    napi_throw_type_error(env, "ERR_LSE_SESSION_OP",
+                          (std::string(name) + " cannot be called through a session").c_str());
+    return nullptr;
+  }
+  if (!op->available()) {
+    ThrowMissingEntry(env, op->name);
+    return nullptr;
+  }
+  return op;
+}
+
+/// Session calls from argument @p i, an array of [name, ...args] arrays.
+bool OpListArgument(napi_env env, Args &args, size_t i, std::vector<OpCall> *calls) {
+  bool isArray = false;
+  napi_is_array(env, args[i], &isArray);
+  if (!isArray) {
+    args.Fail(i, "array of [name, ...args] calls");
+    return false;
+  }
+  uint32_t length = 0;
+  NAPI_CHECK_RETURN(env, napi_get_array_length(env, args[i], &length), false);
+  for (uint32_t k = 0; k < length; k++) {
+    napi_value entry = nullptr;
+    napi_value element = nullptr;
+    uint32_t entryLength = 0;
+    char name[64];
+    NAPI_CHECK_RETURN(env, napi_get_element(env, args[i], k, &entry), false);
+    napi_is_array(env, entry, &isArray);
+    if (!isArray || napi_get_array_length(env, entry, &entryLength) != napi_ok || entryLength == 0 ||
+        napi_get_element(env, entry, 0, &element) != napi_ok ||
+        napi_get_value_string_utf8(env, element, name, sizeof(name), nullptr) != napi_ok) {
+      args.Fail(i, "array of [name, ...args] calls");
+      return false;
+    }
+    const SessionOp *op = FindAvailableOp(env, name);
+    if (op == nullptr) {
+      return false;
+    }
+    OpCall call = MakeOpCall(op);
+    for (size_t a = 0; a < op->argc; a++) {
+      if (napi_get_element(env, entry, static_cast<uint32_t>(a + 1), &element) != napi_ok ||
+          napi_get_value_int32(env, element, &call.values[a]) != napi_ok) {
+        args.Fail(i, "array of [name, ...args] calls with integer arguments");
+        return false;
+      }
+    }
+    calls->push_back(call);
+  }
+  return true;
+}
+
+/// Promise for an array filled in by several device workers. JS thread only.
+struct PendingResults {
+  napi_deferred deferred = nullptr;
+  napi_ref results = nullptr;
+  uint32_t remaining = 0;
+};
+
+/// Create a promise resolving to an array of @p count results.
+napi_value NewPendingResults(napi_env env, uint32_t count, PendingResults **pending) {
+  napi_value promise = nullptr;
+  napi_value results = nullptr;
+  std::unique_ptr<PendingResults> created(new PendingResults());
+  NAPI_CHECK(env, napi_create_promise(env, &created->deferred, &promise));
+  NAPI_CHECK(env, napi_create_array_with_length(env, count, &results));
+  NAPI_CHECK(env, napi_create_reference(env, results, 1, &created->results));
+  created->remaining = count;
+  if (count == 0) {
+    napi_resolve_deferred(env, created->deferred, results);
+    napi_delete_reference(env, created->results);
+    return promise;
+  }
+  // Keep the event loop alive until every worker has reported back.
+  SharedDispatcher().AddListener();
+  *pending = created.release();
+  return promise;
+}
+
+/// Store @p result at @p index and resolve once all results are in.
+void CompleteResult(napi_env env, PendingResults *pending, uint32_t index, napi_value result) {
+  napi_value results = nullptr;
+  napi_get_reference_value(env, pending->results, &results);
+  napi_set_element(env, results, index, result);
+  if (--pending->remaining == 0) {
+    SharedDispatcher().RemoveListener();
+    napi_resolve_deferred(env, pending->deferred, results);
+    napi_delete_reference(env, pending->results);
+    delete pending;
+  }
+}
+
+/// Device indices from the optional array argument @p i, or all connected devices.
+bool DeviceIndexArgument(napi_env env, Args &args, size_t i, std::vector<int> *indices) {
+  if (args.IsNullish(i)) {
+    auto getDeviceCount = GetApi().LSCAN_Main_GetDeviceCount.get();
+    if (getDeviceCount == nullptr) {
+      ThrowMissingEntry(env, "LSCAN_Main_GetDeviceCount");
+      return false;
+    }
+    int count = 0;
+    if (getDeviceCount(&count) < 0) {
+      count = 0;
+    } else {
+      NoteDeviceCount(count);
+    }
+    for (int index = 0; index < count; index++) {
+      indices->push_back(index);
+    }
+    return true;
+  }
+  bool isArray = false;
+  napi_is_array(env, args[i], &isArray);
+  if (!isArray) {
+    args.Fail(i, "array of device indices or undefined");
+    return false;
+  }
+  uint32_t length = 0;
+  NAPI_CHECK_RETURN(env, napi_get_array_length(env, args[i], &length), false);
+  for (uint32_t k = 0; k < length; k++) {
+    napi_value element = nullptr;
+    int32_t index = 0;
+    NAPI_CHECK_RETURN(env, napi_get_element(env, args[i], k, &element), false);
+    if (napi_get_value_int32(env, element, &index) != napi_ok) {
+      args.Fail(i, "array of device indices or undefined");
+      return false;
+    }
+    indices->push_back(index);
+  }
+  return true;
+}
+
+napi_value SessionOpen(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  bool reset = args.Bool(0);
+  std::vector<int> indices;
+  if (!args.ok() || !DeviceIndexArgument(env, args, 1, &indices)) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_Initialize);
+  LSE_ENTRY(env, LSCAN_Main_Release);
+  LSE_ENTRY(env, LSCAN_Main_GetDeviceInfo);
+  (void)LSCAN_Main_GetDeviceInfo;  // Called through the device info cache
+
+  PendingResults *pending = nullptr;
+  napi_value promise = NewPendingResults(env, static_cast<uint32_t>(indices.size()), &pending);
+  for (uint32_t k = 0; k < indices.size(); k++) {
+    SessionDevice *device = SharedSession().Open(indices[k]);
+    device->worker->Post([device, pending, k, reset, LSCAN_Main_Initialize, LSCAN_Main_Release] {
+      if (device->handle >= 0) {
+        // Opened before: the SDK would hand out a second handle and leak the first.
+        LSCAN_Main_Release(device->handle, false);
+        InvalidateProperties(device->handle, PropertyScope::kAll);
+        ForgetControls(device->handle);
+        TrimFramePool(device->handle);
+        device->handle = -1;
+      }
+      auto deviceInfo = std::make_shared<LScanDeviceInfo>();
+      GetCachedDeviceInfo(device->deviceIndex, deviceInfo.get());
+      int handle = -1;
+      int status = LSCAN_Main_Initialize(device->deviceIndex, reset, &handle);
+      device->handle = status >= 0 ? handle : -1;
+      if (status >= 0) {
+        InvalidateProperties(handle, PropertyScope::kAll);
+        ForgetControls(handle);
+      }
+      int deviceIndex = device->deviceIndex;
+      SharedDispatcher().PostCompletion([pending, k, deviceIndex, status, handle, deviceInfo](napi_env env) {
+        CompleteResult(env, pending, k,
+                       ResultObject(env)
+                           .Int("deviceIndex", deviceIndex)
+                           .Int("status", status)
+                           .Int("handle", status >= 0 ? handle : -1)
+                           .String("serialNumber", deviceInfo->DeviceSerialNumber)
+                           .String("productName", deviceInfo->ProductName)
+                           .String("interfaceType", deviceInfo->InterfaceType)
+                           .String("firmwareVersion", deviceInfo->FirmwareVersion)
+                           .String("hardwareVersion", deviceInfo->HardwareVersion)
+                           .value());
+      });
+    });
+  }
+  return promise;
+}
+
+napi_value SessionCall(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  const char *name = args.String(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  const SessionOp *op = FindAvailableOp(env, name);
+  if (op == nullptr) {
+    return nullptr;
+  }
+  OpCall call = MakeOpCall(op);
+  for (size_t i = 0; i < op->argc; i++) {
+    call.values[i] = args.Int(2 + i);
+  }
+  if (!args.ok()) {
+    return nullptr;
+  }
+  SessionDevice *device = SharedSession().Find(deviceIndex);
+  if (device == nullptr) {
+    napi_throw_error(env, "ERR_LSE_SESSION_DEVICE",
+                     ("device " + std::to_string(deviceIndex) + " is not open; call sessionOpen() first").c_str());
+    return nullptr;
+  }
+
+  napi_deferred deferred = nullptr;
+  napi_value promise = nullptr;
+  NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+  SharedDispatcher().AddListener();
+  device->worker->Post([device, deferred, call] {
+    int status = RunOp(device, call);
+    SharedDispatcher().PostCompletion([deferred, status](napi_env env) {
+      SharedDispatcher().RemoveListener();
+      napi_resolve_deferred(env, deferred, MakeInt(env, status));
+    });
+  });
+  return promise;
+}
+
+/// Outcome of sessionRecover(), filled in on the worker.
+struct Recovery {
+  int status = LSCAN_STATUS_OK;  ///< Of LSCAN_Main_Initialize()
+  int handle = -1;
+  int previousHandle = -1;
+  int callbackStatus = LSCAN_STATUS_OK;
+  int replayed = 0;
+  int failed = -1;  ///< Index of the first replayed call that failed
+  int failedStatus = LSCAN_STATUS_OK;
+  uint64_t releaseNs = 0;
+  uint64_t initializeNs = 0;
+  uint64_t restoreNs = 0;
+  uint64_t replayNs = 0;
+};
+
+napi_value SessionRecover(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  bool reset = args.Bool(1);
+  std::vector<OpCall> calls;
+  if (!args.ok() || !OpListArgument(env, args, 2, &calls)) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_Initialize);
+  LSE_ENTRY(env, LSCAN_Main_Release);
+  SessionDevice *device = SharedSession().Find(deviceIndex);
+  if (device == nullptr) {
+    napi_throw_error(env, "ERR_LSE_SESSION_DEVICE",
+                     ("device " + std::to_string(deviceIndex) + " is not open; call sessionOpen() first").c_str());
+    return nullptr;
+  }
+
+  napi_deferred deferred = nullptr;
+  napi_value promise = nullptr;
+  NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+  SharedDispatcher().AddListener();
+  device->worker->Post([device, deferred, reset, calls, LSCAN_Main_Initialize, LSCAN_Main_Release] {
+    auto recovery = std::make_shared<Recovery>();
+    uint64_t start = NowNs();
+    recovery->previousHandle = device->handle;
+    if (device->handle >= 0) {
+      // The broken connection's status is of no interest; the SDK wants it released.
+      LSCAN_Main_Release(device->handle, false);
+      InvalidateProperties(device->handle, PropertyScope::kAll);
+      ForgetControls(device->handle);
+      TrimFramePool(device->handle);
+      device->handle = -1;
+    }
+    uint64_t released = NowNs();
+    int handle = -1;
+    recovery->status = LSCAN_Main_Initialize(device->deviceIndex, reset, &handle);
+    uint64_t initialized = NowNs();
+    recovery->releaseNs = released - start;
+    recovery->initializeNs = initialized - released;
+    if (recovery->status >= 0) {
+      device->handle = handle;
+      recovery->handle = handle;
+      InvalidateProperties(handle, PropertyScope::kAll);
+      ForgetControls(handle);
+      recovery->callbackStatus = RestoreCallbacks(handle);
+      uint64_t restored = NowNs();
+      recovery->restoreNs = restored - initialized;
+      for (size_t k = 0; k < calls.size(); k++) {
+        int status = RunOp(device, calls[k]);
+        recovery->replayed++;
+        if (status < 0 && recovery->failed < 0) {
+          recovery->failed = static_cast<int>(k);
+          recovery->failedStatus = status;
+        }
+      }
+      recovery->replayNs = NowNs() - restored;
+    }
+    SharedDispatcher().PostCompletion([deferred, recovery](napi_env env) {
+      SharedDispatcher().RemoveListener();
+      napi_resolve_deferred(env, deferred,
+                            ResultObject(env)
+                                .Int("status", recovery->status)
+                                .Int("handle", recovery->handle)
+                                .Int("previousHandle", recovery->previousHandle)
+                                .Int("callbackStatus", recovery->callbackStatus)
+                                .Int("replayed", recovery->replayed)
+                                .Int("failed", recovery->failed)
+                                .Int("failedStatus", recovery->failedStatus)
+                                .Double("releaseNs", static_cast<double>(recovery->releaseNs))
+                                .Double("initializeNs", static_cast<double>(recovery->initializeNs))
+                                .Double("restoreNs", static_cast<double>(recovery->restoreNs))
+                                .Double("replayNs", static_cast<double>(recovery->replayNs))
+                                .value());
+    });
+  });
+  return promise;
+}
+
+napi_value SessionClose(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  bool sendToStandby = args.Bool(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Main_Release);
+
+  std::vector<int> indices = SharedSession().DeviceIndices();
+  PendingResults *pending = nullptr;
+  napi_value promise = NewPendingResults(env, static_cast<uint32_t>(indices.size()), &pending);
+  for (uint32_t k = 0; k < indices.size(); k++) {
+    // The device leaves the session now; it is destroyed (joining its worker)
+    // once the release has run behind any calls still queued for it.
+    SessionDevice *device = SharedSession().Detach(indices[k]).release();
+    device->worker->Post([device, pending, k, sendToStandby, LSCAN_Main_Release] {
+      int status = device->handle >= 0 ? LSCAN_Main_Release(device->handle, sendToStandby) : LSCAN_STATUS_OK;
+      if (device->handle >= 0) {
+        // Never with -1, which invalidates the properties of every handle.
+        InvalidateProperties(device->handle, PropertyScope::kAll);
+        ForgetControls(device->handle);
+        TrimFramePool(device->handle);
+      }
+      SharedDispatcher().PostCompletion([device, pending, k, status](napi_env env) {
+        int deviceIndex = device->deviceIndex;
+        delete device;
+        CompleteResult(env, pending, k, ResultObject(env).Int("deviceIndex", deviceIndex).Int("status", status).value());
+      });
+    });
+  }
+  return promise;
+}
+
+napi_value SessionDevices(napi_env env, napi_callback_info /*info*/) {
+  std::vector<int> indices = SharedSession().DeviceIndices();
+  napi_value list = nullptr;
+  NAPI_CHECK(env, napi_create_array_with_length(env, indices.size(), &list));
+  for (uint32_t k = 0; k < indices.size(); k++) {
+    napi_set_element(env, list, k, MakeInt(env, indices[k]));
+  }
+  return list;
+}
+
+}  // namespace
+
+void AddSessionBindings(MethodTable *table) {
+  table->Add("sessionOpen", SessionOpen);
+  table->Add("sessionCall", SessionCall);
+  table->Add("sessionRecover", SessionRecover);
+  table->Add("sessionClose", SessionClose);
+  table->Add("sessionDevices", SessionDevices);
+}
+
+}  // namespace lse
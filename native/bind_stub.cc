@@ -0,0 +1,136 @@
+/// Control functions of the stub library (native/stub/lscan_stub.h), for load
+/// tests and benchmarks. Not SDK functions; each throws ERR_LSE_ENTRY unless the
+/// stub library is loaded.
+///
+///   stubFireCallbacks(handle, kind, threads, perThread, intervalUs) -> status
+///   stubSetDeviceCount(count)                                        -> status
+///   stubSetPreview(handle, fps, divisor)                             -> status
+///   stubSetResultImages(handle, path|null)                           -> status
+///   stubInjectError(functionName, handle, status, count)             -> status
+///   stubSetLatency(functionName|null, handle, microseconds)          -> status
+///   stubDisconnect(handle)                                           -> status
+///   stubUnplug(deviceIndex, milliseconds)                            -> status
+///
+/// handle LSCAN_STUB_ALL_DEVICES applies to every device.
+
+#include "bindings.h"
+
+namespace lse {
+
+namespace {
+
+/// Fetch stub entry point @p name into a local of the same name, like LSE_ENTRY.
+#define LSE_STUB_ENTRY(env, name)             \
+  auto name = ::lse::GetStubApi().name.get(); \
+  if (name == nullptr) {                      \
+    ::lse::ThrowMissingEntry(env, #name);     \
+    return nullptr;                           \
+  }
+
+napi_value StubFireCallbacks(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int kind = args.Int(1);
+  int threads = args.Int(2);
+  int perThread = args.Int(3);
+  int intervalUs = args.Int(4);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_FireCallbacks);
+  return MakeInt(env, LScanStub_FireCallbacks(handle, kind, threads, perThread, intervalUs));
+}
+
+napi_value StubSetDeviceCount(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int count = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_SetDeviceCount);
+  return MakeInt(env, LScanStub_SetDeviceCount(count));
+}
+
+napi_value StubSetPreview(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int fps = args.Int(1);
+  int divisor = args.Int(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_SetPreview);
+  return MakeInt(env, LScanStub_SetPreview(handle, fps, divisor));
+}
+
+napi_value StubSetResultImages(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  const char *path = args.IsNullish(1) ? nullptr : args.String(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_SetResultImages);
+  return MakeInt(env, LScanStub_SetResultImages(handle, path));
+}
+
+napi_value StubInjectError(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  const char *function = args.String(0);
+  int handle = args.Int(1);
+  int status = args.Int(2);
+  int count = args.Int(3);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_InjectError);
+  return MakeInt(env, LScanStub_InjectError(function, handle, status, count));
+}
+
+napi_value StubSetLatency(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  const char *function = args.IsNullish(0) ? nullptr : args.String(0);
+  int handle = args.Int(1);
+  int microseconds = args.Int(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_SetLatency);
+  return MakeInt(env, LScanStub_SetLatency(function, handle, microseconds));
+}
+
+napi_value StubDisconnect(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_Disconnect);
+  return MakeInt(env, LScanStub_Disconnect(handle));
+}
+
+napi_value StubUnplug(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int deviceIndex = args.Int(0);
+  int milliseconds = args.Int(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_STUB_ENTRY(env, LScanStub_Unplug);
+  return MakeInt(env, LScanStub_Unplug(deviceIndex, milliseconds));
+}
+
+}  // namespace
+
+void AddStubBindings(MethodTable *table) {
+  table->Add("stubFireCallbacks", StubFireCallbacks);
+  table->Add("stubSetDeviceCount", StubSetDeviceCount);
+  table->Add("stubSetPreview", StubSetPreview);
+  table->Add("stubSetResultImages", StubSetResultImages);
+  table->Add("stubInjectError", StubInjectError);
+  table->Add("stubSetLatency", StubSetLatency);
+  table->Add("stubDisconnect", StubDisconnect);
+  table->Add("stubUnplug", StubUnplug);
+}
+
+}  // namespace lse
@@ -0,0 +1,536 @@
+#include "bindings.h"
+#include "compositor.h"
+#include "overlay_scene.h"
+
+#include <string>
+#include <vector>
+
+namespace lse {
+
+namespace {
+
+napi_value Create(napi_env env, napi_callback_info /*info*/) {
+  LSE_ENTRY(env, LSCAN_Visualization_Create);
+  const char *pipeName = LSCAN_Visualization_Create();
+  if (pipeName == nullptr) {
+    napi_value null = nullptr;
+    napi_get_null(env, &null);
+    return null;
+  }
+  return MakeString(env, pipeName);
+}
+
+napi_value Destroy(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  const char *pipeName = args.String(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_Destroy);
+  LSCAN_Visualization_Destroy(pipeName);
+  return nullptr;
+}
+
+napi_value SetMode(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int mode = args.Int(1);
+  DWORD options = args.Dword(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_SetMode);
+  return MakeInt(env, LSCAN_Visualization_SetMode(handle, static_cast<LScanVisMode>(mode), options));
+}
+
+/// Window handles arrive either as the Buffer returned by Electron's
+/// BrowserWindow.getNativeWindowHandle() or as a plain number.
+bool ReadWindowHandle(napi_env env, napi_value value, HWND *window) {
+  bool isBuffer = false;
+  napi_is_buffer(env, value, &isBuffer);
+  if (isBuffer) {
+    void *data = nullptr;
+    size_t length = 0;
+    napi_get_buffer_info(env, value, &data, &length);
+    if (length < sizeof(HWND)) {
+      return false;
+    }
+    memcpy(window, data, sizeof(HWND));
+    return true;
+  }
+  double number = 0;
+  if (napi_get_value_double(env, value, &number) != napi_ok) {
+    return false;
+  }
+  *window = reinterpret_cast<HWND>(static_cast<uintptr_t>(number));
+  return true;
+}
+
+bool ReadRectField(napi_env env, napi_value object, const char *name, int32_t *field) {
+  napi_value value = nullptr;
+  return napi_get_named_property(env, object, name, &value) == napi_ok &&
+         napi_get_value_int32(env, value, field) == napi_ok;
+}
+
+napi_value SetWindow(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  HWND window = nullptr;
+  if (!ReadWindowHandle(env, args[1], &window)) {
+    args.Fail(1, "a window handle Buffer or number");
+    return nullptr;
+  }
+  RECT drawRect = {-1, -1, -1, -1};
+  if (!args.IsNullish(2)) {
+    int32_t left = 0, top = 0, right = 0, bottom = 0;
+    if (!ReadRectField(env, args[2], "left", &left) || !ReadRectField(env, args[2], "top", &top) ||
+        !ReadRectField(env, args[2], "right", &right) || !ReadRectField(env, args[2], "bottom", &bottom)) {
+      args.Fail(2, "a {left, top, right, bottom} object");
+      return nullptr;
+    }
+    drawRect.left = left;
+    drawRect.top = top;
+    drawRect.right = right;
+    drawRect.bottom = bottom;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_SetWindow);
+  return MakeInt(env, LSCAN_Visualization_SetWindow(handle, window, drawRect));
+}
+
+napi_value GetScaleFactor(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_GetScaleFactor);
+  double scaleFactor = 0;
+  int status = LSCAN_Visualization_GetScaleFactor(handle, &scaleFactor);
+  Outputs()[0] = scaleFactor;
+  return MakeInt(env, status);
+}
+
+napi_value SetBackgroundColor(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  COLORREF color = args.Dword(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_SetBackgroundColor);
+  return MakeInt(env, LSCAN_Visualization_SetBackgroundColor(handle, color));
+}
+
+napi_value RemoveOverlay(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  DWORD overlayHandle = args.Dword(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_RemoveOverlay);
+  return MakeInt(env, LSCAN_Visualization_RemoveOverlay(handle, overlayHandle));
+}
+
+napi_value RemoveAllOverlays(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_RemoveAllOverlays);
+  return MakeInt(env, LSCAN_Visualization_RemoveAllOverlays(handle));
+}
+
+napi_value ShowOverlay(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  DWORD overlayHandle = args.Dword(1);
+  BOOL show = args.Bool(2);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_ShowOverlay);
+  return MakeInt(env, LSCAN_Visualization_ShowOverlay(handle, overlayHandle, show));
+}
+
+napi_value ShowAllOverlays(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  BOOL show = args.Bool(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_ShowAllOverlays);
+  return MakeInt(env, LSCAN_Visualization_ShowAllOverlays(handle, show));
+}
+
+napi_value AddOverlayText(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  const char *text = args.String(1);
+  int posX = args.Int(2);
+  int posY = args.Int(3);
+  COLORREF color = args.Dword(4);
+  const char *fontName = args.String(5);
+  int fontSize = args.Int(6);
+  BOOL belongsToImage = args.Bool(7);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_AddOverlayText);
+  DWORD overlayHandle = 0;
+  int status = LSCAN_Visualization_AddOverlayText(handle, text, posX, posY, color, fontName, fontSize,
+                                                  belongsToImage, &overlayHandle);
+  Outputs()[0] = overlayHandle;
+  return MakeInt(env, status);
+}
+
+napi_value ModifyOverlayText(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  DWORD overlayHandle = args.Dword(1);
+  const char *text = args.String(2);
+  int posX = args.Int(3);
+  int posY = args.Int(4);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_ModifyOverlayText);
+  return MakeInt(env, LSCAN_Visualization_ModifyOverlayText(handle, overlayHandle, text, posX, posY));
+}
+
+napi_value AddOverlayQuadrangle(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int p[8];
+  for (int i = 0; i < 8; i++) {
+    p[i] = args.Int(1 + i);
+  }
+  COLORREF color = args.Dword(9);
+  int lineWidth = args.Int(10);
+  BOOL belongsToImage = args.Bool(11);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_AddOverlayQuadrangle);
+  DWORD overlayHandle = 0;
+  int status = LSCAN_Visualization_AddOverlayQuadrangle(handle, p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7],
+                                                        color, lineWidth, belongsToImage, &overlayHandle);
+  Outputs()[0] = overlayHandle;
+  return MakeInt(env, status);
+}
+
+napi_value ModifyOverlayQuadrangle(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  DWORD overlayHandle = args.Dword(1);
+  int p[8];
+  for (int i = 0; i < 8; i++) {
+    p[i] = args.Int(2 + i);
+  }
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_ModifyOverlayQuadrangle);
+  return MakeInt(env, LSCAN_Visualization_ModifyOverlayQuadrangle(handle, overlayHandle, p[0], p[1], p[2], p[3],
+                                                                  p[4], p[5], p[6], p[7]));
+}
+
+napi_value AddOverlayLine(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int x1 = args.Int(1);
+  int y1 = args.Int(2);
+  int x2 = args.Int(3);
+  int y2 = args.Int(4);
+  COLORREF color = args.Dword(5);
+  int lineWidth = args.Int(6);
+  BOOL belongsToImage = args.Bool(7);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_AddOverlayLine);
+  DWORD overlayHandle = 0;
+  int status = LSCAN_Visualization_AddOverlayLine(handle, x1, y1, x2, y2, color, lineWidth, belongsToImage,
+                                                  &overlayHandle);
+  Outputs()[0] = overlayHandle;
+  return MakeInt(env, status);
+}
+
+napi_value ModifyOverlayLine(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  DWORD overlayHandle = args.Dword(1);
+  int x1 = args.Int(2);
+  int y1 = args.Int(3);
+  int x2 = args.Int(4);
+  int y2 = args.Int(5);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_ModifyOverlayLine);
+  return MakeInt(env, LSCAN_Visualization_ModifyOverlayLine(handle, overlayHandle, x1, y1, x2, y2));
+}
+
+/// Values per overlay in the overlaySceneCommit() records:
+/// [id, kind, visible, color, lineWidth, fontSize, belongsToImage, stringIndex, points x8].
+/// Text overlays take their text and font name from strings[stringIndex] and
+/// strings[stringIndex + 1].
+constexpr size_t kOverlayRecordSize = 16;
+
+bool ReadString(napi_env env, napi_value strings, uint32_t index, std::string *value) {
+  napi_value element = nullptr;
+  size_t length = 0;
+  if (napi_get_element(env, strings, index, &element) != napi_ok ||
+      napi_get_value_string_utf8(env, element, nullptr, 0, &length) != napi_ok) {
+    return false;
+  }
+  value->resize(length);
+  return napi_get_value_string_utf8(env, element, &(*value)[0], length + 1, &length) == napi_ok;
+}
+
+/// The (records: Int32Array, strings) arguments at 1 and 2 as overlay specs.
+/// Returns false with a pending TypeError on malformed records.
+bool ReadOverlayRecords(napi_env env, Args &args, std::vector<OverlaySpec> *frame) {
+  napi_typedarray_type type = napi_int8_array;
+  size_t length = 0;
+  void *data = nullptr;
+  bool isTypedArray = false;
+  napi_is_typedarray(env, args[1], &isTypedArray);
+  if (!isTypedArray || napi_get_typedarray_info(env, args[1], &type, &length, &data, nullptr, nullptr) != napi_ok ||
+      type != napi_int32_array || length % kOverlayRecordSize != 0) {
+    args.Fail(1, "Int32Array of overlay records");
+    return false;
+  }
+  bool isArray = false;
+  napi_is_array(env, args[2], &isArray);
+  if (!isArray) {
+    args.Fail(2, "array of strings");
+    return false;
+  }
+
+  const int32_t *records = static_cast<const int32_t *>(data);
+  frame->resize(length / kOverlayRecordSize);
+  for (size_t i = 0; i < frame->size(); i++) {
+    const int32_t *record = records + i * kOverlayRecordSize;
+    OverlaySpec &spec = (*frame)[i];
+    spec.id = record[0];
+    if (record[1] < static_cast<int>(OverlayKind::kText) || record[1] > static_cast<int>(OverlayKind::kLine)) {
+      args.Fail(1, "Int32Array of overlay records with valid kinds");
+      return false;
+    }
+    spec.kind = static_cast<OverlayKind>(record[1]);
+    spec.visible = record[2] != 0;
+    spec.color = static_cast<COLORREF>(record[3]);
+    spec.lineWidth = record[4];
+    spec.fontSize = record[5];
+    spec.belongsToImage = record[6] != 0;
+    memcpy(spec.points, record + 8, sizeof(spec.points));
+    if (spec.kind == OverlayKind::kText &&
+        (!ReadString(env, args[2], record[7], &spec.text) || !ReadString(env, args[2], record[7] + 1, &spec.fontName))) {
+      args.Fail(2, "array of strings");
+      return false;
+    }
+  }
+  return true;
+}
+
+/// overlaySceneCommit(handle, records: Int32Array, strings) -> status: make the
+/// handle's overlays match the frame; see OverlayScene. The calls it took are
+/// in outputs [total, adds, modifies, shows, removes, reused]. Not an SDK function.
+napi_value OverlaySceneCommit(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  std::vector<OverlaySpec> frame;
+  if (!ReadOverlayRecords(env, args, &frame)) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_AddOverlayText);
+  LSE_ENTRY(env, LSCAN_Visualization_AddOverlayQuadrangle);
+  LSE_ENTRY(env, LSCAN_Visualization_AddOverlayLine);
+  LSE_ENTRY(env, LSCAN_Visualization_ModifyOverlayText);
+  LSE_ENTRY(env, LSCAN_Visualization_ModifyOverlayQuadrangle);
+  LSE_ENTRY(env, LSCAN_Visualization_ModifyOverlayLine);
+  LSE_ENTRY(env, LSCAN_Visualization_ShowOverlay);
+  LSE_ENTRY(env, LSCAN_Visualization_RemoveOverlay);
+
+  OverlayCalls calls;
+  int status = GetOverlayScene(handle)->Commit(frame, &calls);
+  double *out = Outputs();
+  out[0] = static_cast<double>(calls.total());
+  out[1] = static_cast<double>(calls.adds);
+  out[2] = static_cast<double>(calls.modifies);
+  out[3] = static_cast<double>(calls.shows);
+  out[4] = static_cast<double>(calls.removes);
+  out[5] = static_cast<double>(calls.reused);
+  return MakeInt(env, status);
+}
+
+/// overlaySceneReset(handle, remove) -> status: forget the scene, removing its
+/// overlays first if @p remove.
+napi_value OverlaySceneReset(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  bool remove = args.Bool(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Visualization_RemoveOverlay);
+  return MakeInt(env, GetOverlayScene(handle)->Reset(remove));
+}
+
+/// overlaySceneStats(handle): call counters of the scene.
+napi_value OverlaySceneStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  OverlaySceneStats stats = GetOverlayScene(handle)->Stats();
+  return ResultObject(env)
+      .Double("frames", static_cast<double>(stats.frames))
+      .Double("calls", static_cast<double>(stats.calls.total()))
+      .Double("adds", static_cast<double>(stats.calls.adds))
+      .Double("modifies", static_cast<double>(stats.calls.modifies))
+      .Double("shows", static_cast<double>(stats.calls.shows))
+      .Double("removes", static_cast<double>(stats.calls.removes))
+      .Double("reused", static_cast<double>(stats.calls.reused))
+      .Double("lastFrameCalls", static_cast<double>(stats.lastFrameCalls))
+      .Double("callsPerFrame", stats.frames > 0 ? static_cast<double>(stats.calls.total()) / stats.frames : 0)
+      .Double("redrawCalls", static_cast<double>(stats.redrawCalls))
+      .Double("overlays", static_cast<double>(stats.overlays))
+      .Double("parked", static_cast<double>(stats.parked))
+      .value();
+}
+
+/// compositorOpen(handle, width, height, format, background, keepAspect, encoding,
+/// quality, minQuality, maxBytesPerSecond, maxFps, callback) -> status: render the
+/// handle's preview headlessly into @p callback; see Compositor. @p format is a
+/// CompositorFormat and @p encoding an ImageEncoding. Reopening reconfigures.
+napi_value OpenCompositor(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  CompositorConfig config;
+  config.width = args.Int(1);
+  config.height = args.Int(2);
+  int format = args.Int(3);
+  config.background = args.Dword(4);
+  config.keepAspect = args.Bool(5) != 0;
+  int encoding = args.Int(6);
+  config.jpeg.quality = args.Int(7);
+  config.minQuality = args.Int(8);
+  double maxBytesPerSecond = args.Double(9);
+  config.maxFps = args.Double(10);
+  napi_value function = args.FunctionOrNull(11);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (function == nullptr) {
+    args.Fail(11, "function");
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_RegisterCallbackPreviewImage);
+  if (config.width <= 0 || config.height <= 0 || config.width > CompositorConfig::kMaxSize ||
+      config.height > CompositorConfig::kMaxSize || format < static_cast<int>(CompositorFormat::kGray) ||
+      format > static_cast<int>(CompositorFormat::kRgba) || encoding < static_cast<int>(ImageEncoding::kNone) ||
+      encoding > static_cast<int>(ImageEncoding::kJpeg) ||
+      (encoding == static_cast<int>(ImageEncoding::kPng) && format != static_cast<int>(CompositorFormat::kGray)) ||
+      config.jpeg.quality < JpegOptions::kMinQuality || config.jpeg.quality > JpegOptions::kMaxQuality ||
+      config.minQuality < JpegOptions::kMinQuality || config.minQuality > config.jpeg.quality ||
+      !(maxBytesPerSecond >= 0) || !(config.maxFps >= 0)) {
+    return MakeInt(env, LSCAN_ERR_INVALID_PARAM_VALUE);
+  }
+  config.format = static_cast<CompositorFormat>(format);
+  config.encoding = static_cast<ImageEncoding>(encoding);
+  config.maxBytesPerSecond = static_cast<uint64_t>(maxBytesPerSecond);
+  return MakeInt(env, GetCompositor(handle)->Open(env, config, function));
+}
+
+/// compositorSetOverlays(handle, records: Int32Array, strings) -> status: the
+/// overlays the compositor draws, in the overlaySceneCommit() record format.
+napi_value SetCompositorOverlays(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  std::vector<OverlaySpec> overlays;
+  if (!ReadOverlayRecords(env, args, &overlays)) {
+    return nullptr;
+  }
+  GetCompositor(handle)->SetOverlays(std::move(overlays));
+  return MakeInt(env, LSCAN_STATUS_OK);
+}
+
+napi_value CloseCompositor(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  LSE_ENTRY(env, LSCAN_Capture_RegisterCallbackPreviewImage);
+  return MakeInt(env, GetCompositor(handle)->Close(env));
+}
+
+/// compositorStats(handle): frame counters, output bytes, the current JPEG
+/// quality and render and encode times in nanoseconds.
+napi_value CompositorStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  Compositor *compositor = GetCompositor(handle);
+  CompositorStats stats = compositor->Stats();
+  return ResultObject(env)
+      .Bool("open", compositor->open())
+      .Double("received", static_cast<double>(stats.received))
+      .Double("rendered", static_cast<double>(stats.rendered))
+      .Double("delivered", static_cast<double>(stats.delivered))
+      .Double("dropped", static_cast<double>(stats.dropped))
+      .Double("skipped", static_cast<double>(stats.skipped))
+      .Double("renderMean", stats.rendered > 0 ? static_cast<double>(stats.renderNs) / stats.rendered : 0)
+      .Double("renderMax", static_cast<double>(stats.maxRenderNs))
+      .Double("renderLast", static_cast<double>(stats.lastRenderNs))
+      .Double("encodeMean", stats.rendered > 0 ? static_cast<double>(stats.encodeNs) / stats.rendered : 0)
+      .Double("bytes", static_cast<double>(stats.bytes))
+      .Int("quality", stats.quality)
+      .value();
+}
+
+}  // namespace
+
+void AddVisualizationBindings(MethodTable *table) {
+  table->Add("LSCAN_Visualization_Create", Create);
+  table->Add("LSCAN_Visualization_Destroy", Destroy);
+  table->Add("LSCAN_Visualization_SetMode", SetMode);
+  table->Add("LSCAN_Visualization_SetWindow", SetWindow);
+  table->Add("LSCAN_Visualization_GetScaleFactor", GetScaleFactor);
+  table->Add("LSCAN_Visualization_SetBackgroundColor", SetBackgroundColor);
+  table->Add("LSCAN_Visualization_RemoveOverlay", RemoveOverlay);
+  table->Add("LSCAN_Visualization_RemoveAllOverlays", RemoveAllOverlays);
+  table->Add("LSCAN_Visualization_ShowOverlay", ShowOverlay);
+  table->Add("LSCAN_Visualization_ShowAllOverlays", ShowAllOverlays);
+  table->Add("LSCAN_Visualization_AddOverlayText", AddOverlayText);
+  table->Add("LSCAN_Visualization_ModifyOverlayText", ModifyOverlayText);
+  table->Add("LSCAN_Visualization_AddOverlayQuadrangle", AddOverlayQuadrangle);
+  table->Add("LSCAN_Visualization_ModifyOverlayQuadrangle", ModifyOverlayQuadrangle);
+  table->Add("LSCAN_Visualization_AddOverlayLine", AddOverlayLine);
+  table->Add("LSCAN_Visualization_ModifyOverlayLine", ModifyOverlayLine);
+  table->Add("overlaySceneCommit", OverlaySceneCommit);
+  table->Add("overlaySceneReset", OverlaySceneReset);
+  table->Add("overlaySceneStats", OverlaySceneStatistics);
+  table->Add("compositorOpen", OpenCompositor);
+  table->Add("compositorSetOverlays", SetCompositorOverlays);
+  table->Add("compositorClose", CloseCompositor);
+  table->Add("compositorStats", CompositorStatistics);
+}
+
+}  // namespace lse
@@ -0,0 +1,63 @@
+#include "bindings.h"
+#include "worker_frames.h"
+
+namespace lse {
+
+namespace {
+
+/// workerFramesOpen(handle, kind, function|null, policy, capacity, timeoutMs):
+/// deliver the preview frames (kind 0) or result images (kind 1) of @p handle to
+/// @p function in this worker, or stop if null; see worker_frames.h.
+/// LSCAN_ERR_NOT_SUPPORTED on the main thread.
+napi_value WorkerFramesOpenBinding(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  int kind = args.Int(1);
+  napi_value function = args.FunctionOrNull(2);
+  int policy = args.Int(3);
+  int capacity = args.Int(4);
+  int timeoutMs = args.Int(5);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if ((kind != 0 && kind != 1) || policy < static_cast<int>(PreviewPolicy::kLatest) ||
+      policy > static_cast<int>(PreviewPolicy::kBlock)) {
+    return MakeInt(env, LSCAN_ERR_INVALID_PARAM_VALUE);
+  }
+  CallbackKind callbackKind = kind == 0 ? CallbackKind::kPreviewImage : CallbackKind::kResultImage;
+  return MakeInt(env, OpenWorkerFrames(env, callbackKind, handle, function, static_cast<PreviewPolicy>(policy),
+                                       capacity, timeoutMs));
+}
+
+/// workerFrameStats(handle): whether workers take the images of @p handle, the
+/// preview channel counters of the one taking the preview frames and the result
+/// images handed over.
+napi_value WorkerFrameStatistics(napi_env env, napi_callback_info info) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  WorkerFrameStats stats = GetWorkerFrameStats(handle);
+  const PreviewStats &preview = stats.previewStats;
+  return ResultObject(env)
+      .Bool("preview", stats.preview)
+      .Bool("result", stats.result)
+      .Int("policy", static_cast<int>(preview.policy))
+      .Int("capacity", preview.capacity)
+      .Double("received", static_cast<double>(preview.received))
+      .Double("delivered", static_cast<double>(preview.delivered))
+      .Double("dropped", static_cast<double>(preview.dropped))
+      .Double("queued", static_cast<double>(preview.queued))
+      .Double("results", static_cast<double>(stats.results))
+      .value();
+}
+
+}  // namespace
+
+void AddWorkerBindings(MethodTable *table) {
+  table->Add("workerFramesOpen", WorkerFramesOpenBinding);
+  table->Add("workerFrameStats", WorkerFrameStatistics);
+}
+
+}  // namespace lse
@@ -0,0 +1,75 @@
+/// Per-group registration of the LScanEssentials bindings.
+///
+/// Every binding is exported under the SDK function name and returns the SDK status
+/// code. Numeric [out] parameters are written to Outputs() in declaration order;
+/// string [out] parameters (device info, properties) are returned as an object
+/// holding @e status plus one property per field.
+
+#pragma once
+
+#include "callbacks.h"
+#include "lse_api.h"
+#include "napi_util.h"
+
+namespace lse {
+
+void ThrowMissingEntry(napi_env env, const char *name);
+
+/// Fetch entry point @p name of the loaded library into a local of the same name,
+/// throwing if the library is not loaded or does not export it.
+#define LSE_ENTRY(env, name)                  \
+  auto name = ::lse::GetApi().name.get();     \
+  if (name == nullptr) {                      \
+    ::lse::ThrowMissingEntry(env, #name);     \
+    return nullptr;                           \
+  }
+
+/// Shared body of the per-handle LSCAN_*_RegisterCallback* bindings:
+/// (handle, function|null) -> status.
+template <typename Register, typename Callback>
+napi_value RegisterHandleCallback(napi_env env, napi_callback_info info, CallbackKind kind,
+                                  Register registerCallback, const char *name, Callback trampoline) {
+  Args args(env, info);
+  int handle = args.Int(0);
+  napi_value function = args.FunctionOrNull(1);
+  if (!args.ok()) {
+    return nullptr;
+  }
+  if (registerCallback == nullptr) {
+    ThrowMissingEntry(env, name);
+    return nullptr;
+  }
+  CallbackSlot *slot = GetCallbackSlot(kind, handle);
+  if (!AssignCallback(env, slot, function)) {
+    return nullptr;
+  }
+  // A compositor, quality map or worker needs images even without a JS handler.
+  bool keep = function != nullptr || NativeConsumerOpen(kind, handle);
+  return MakeInt(env, registerCallback(handle, keep ? trampoline : nullptr, SlotSink(slot)));
+}
+
+#define LSE_REGISTER_CALLBACK_BINDING(binding, kind, name, trampoline)                             \
+  napi_value binding(napi_env env, napi_callback_info info) {                                      \
+    return RegisterHandleCallback(env, info, kind, ::lse::GetApi().name.get(), #name, trampoline); \
+  }
+
+void AddMainBindings(MethodTable *table);
+void AddCaptureBindings(MethodTable *table);
+void AddControlsBindings(MethodTable *table);
+void AddVisualizationBindings(MethodTable *table);
+void AddSessionBindings(MethodTable *table);
+void AddAsyncBindings(MethodTable *table);
+void AddImageBindings(MethodTable *table);
+void AddPropertyBindings(MethodTable *table);
+void AddRecordBindings(MethodTable *table);
+void AddStubBindings(MethodTable *table);
+void AddWorkerBindings(MethodTable *table);
+
+/// The bindings of AddImageBindings() that need neither the SDK nor the main
+/// thread's dispatcher, for worker threads.
+void AddImageKernelBindings(MethodTable *table);
+
+/// Status/warning/error codes and enum constants as a plain object.
+napi_value CreateConstants(napi_env env);
+
+}  // namespace lse
@@ -0,0 +1,460 @@
+#include "callbacks.h"
+
+#include "capture_stream.h"
+#include "clock.h"
+#include "compositor.h"
+#include "controls_queue.h"
+#include "dispatcher.h"
+#include "image_encoder.h"
+#include "latency.h"
+#include "napi_util.h"
+#include "preview_channel.h"
+#include "property_cache.h"
+#include "quality_map.h"
+#include "recorder.h"
+#include "segmentation.h"
+#include "task_pool.h"
+#include "worker_frames.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace lse {
+
+class CallbackSlot : public EventSink {
+ public:
+  explicit CallbackSlot(CallbackKind kind) : kind_(kind) {}
+
+  CallbackKind kind() const { return kind_; }
+
+  bool Assign(napi_env env, napi_value function) {
+    napi_ref created = nullptr;
+    if (function != nullptr) {
+      NAPI_CHECK_RETURN(env, napi_create_reference(env, function, 1, &created), false);
+    }
+    bool had_function = function_ != nullptr;
+    if (had_function) {
+      napi_delete_reference(env, function_);
+    }
+    function_ = created;
+    if (created == nullptr) {
+      preview_.Clear();
+    }
+    if (!had_function && created != nullptr) {
+      SharedDispatcher().AddListener();
+    } else if (had_function && created == nullptr) {
+      SharedDispatcher().RemoveListener();
+    }
+    active_.store(created != nullptr, std::memory_order_release);
+    return true;
+  }
+
+  bool active() const override { return active_.load(std::memory_order_acquire); }
+
+  void Post(std::unique_ptr<CallbackEvent> event) override {
+    if (!active_.load(std::memory_order_acquire)) {
+      return;
+    }
+    event->sink = this;
+    SharedDispatcher().Push(event.release());
+  }
+
+  /// Queues a drain event only if the preview channel has none.
+  void PostPreview(int handle, const LScanImageData &image, uint64_t timestamp) override {
+    if (!active_.load(std::memory_order_acquire) || !preview_.Offer(handle, image, timestamp)) {
+      return;
+    }
+    std::unique_ptr<CallbackEvent> event(new CallbackEvent());
+    event->kind = CallbackKind::kPreviewImage;
+    event->handle = handle;
+    event->timestamp = timestamp;
+    event->sink = this;
+    SharedDispatcher().Push(event.release());
+  }
+
+  PreviewChannel &preview() { return preview_; }
+
+  bool Deliver(napi_env env, CallbackEvent &event) override {
+    napi_value function = nullptr;
+    if (function_ == nullptr || napi_get_reference_value(env, function_, &function) != napi_ok ||
+        function == nullptr) {
+      return false;
+    }
+    if (event.kind == CallbackKind::kPreviewImage) {
+      DeliverPreviews(env, function, event.handle);
+      return true;
+    }
+    uint64_t start = NowNs();
+    SharedLatencyMonitor().OnDelivered(event.kind, event.handle, event.timestamp, start);
+    napi_value argv[4];
+    size_t argc = ToArguments(env, event, argv);
+    argv[argc++] = MakeDouble(env, static_cast<double>(event.timestamp));
+    napi_value undefined = nullptr;
+    napi_get_undefined(env, &undefined);
+    napi_call_function(env, undefined, function, argc, argv, nullptr);
+    if (event.kind != CallbackKind::kProgress && event.kind != CallbackKind::kDeviceCount) {
+      SharedLatencyMonitor().OnHandled(event.handle, NowNs() - start);
+    }
+    return true;
+  }
+
+ private:
+  void DeliverPreviews(napi_env env, napi_value function, int handle) {
+    std::vector<PreviewFrame> frames;
+    preview_.Take(&frames);
+    napi_value undefined = nullptr;
+    napi_get_undefined(env, &undefined);
+    size_t delivered = 0;
+    for (PreviewFrame &frame : frames) {
+      uint64_t start = NowNs();
+      SharedLatencyMonitor().OnDelivered(CallbackKind::kPreviewImage, handle, frame.timestamp, start);
+      napi_value argv[3] = {MakeInt(env, handle), ImageToJs(env, &frame.image),
+                            MakeDouble(env, static_cast<double>(frame.timestamp))};
+      napi_call_function(env, undefined, function, 3, argv, nullptr);
+      SharedLatencyMonitor().OnHandled(handle, NowNs() - start);
+      delivered++;
+      bool pending = false;
+      napi_is_exception_pending(env, &pending);
+      if (pending) {
+        break;
+      }
+    }
+    preview_.Account(delivered, frames.size() - delivered);
+  }
+
+  static size_t ToArguments(napi_env env, CallbackEvent &event, napi_value *argv) {
+    argv[0] = MakeInt(env, event.handle);
+    switch (event.kind) {
+      case CallbackKind::kDeviceCount:
+        argv[0] = MakeInt(env, event.value);
+        return 1;
+      case CallbackKind::kCommunicationBreak:
+      case CallbackKind::kCompletion:
+      case CallbackKind::kTakingResultImage:
+      case CallbackKind::kAcquisitionComplete:
+        return 1;
+      case CallbackKind::kProgress:
+      case CallbackKind::kObjectCount:
+      case CallbackKind::kClearObjectsFromPlaten:
+      case CallbackKind::kKeys:
+        argv[1] = MakeInt(env, event.value);
+        return 2;
+      case CallbackKind::kObjectQuality: {
+        napi_create_array_with_length(env, event.qualityCount, &argv[1]);
+        for (int i = 0; i < event.qualityCount; i++) {
+          napi_set_element(env, argv[1], i, MakeInt(env, event.qualities[i]));
+        }
+        return 2;
+      }
+      case CallbackKind::kPreviewImage:
+        argv[1] = ImageToJs(env, &event.image);
+        return 2;
+      case CallbackKind::kResultImage:
+        argv[1] = ResultImageToJs(env, &event);
+        argv[2] = MakeInt(env, event.value);
+        return 3;
+    }
+    return 1;
+  }
+
+  const CallbackKind kind_;
+  std::atomic<bool> active_{false};
+  napi_ref function_ = nullptr;  // JS thread only
+  PreviewChannel preview_;       // kPreviewImage slots only
+};
+
+namespace {
+
+std::mutex g_slots_mutex;
+std::map<std::pair<CallbackKind, int>, std::unique_ptr<CallbackSlot>> g_slots;
+
+void FinalizePixels(napi_env env, void * /*data*/, void *hint) {
+  FrameBlock *block = static_cast<FrameBlock *>(hint);
+  int64_t adjusted = 0;
+  napi_adjust_external_memory(env, -static_cast<int64_t>(block->capacity), &adjusted);
+  FramePool::Release(block);
+}
+
+void Post(void *context, std::unique_ptr<CallbackEvent> event) {
+  SharedLatencyMonitor().OnCallback(event->kind, event->handle, event->timestamp);
+  if (IsRecording()) {
+    RecordEvent(*event);
+  }
+  if (context != nullptr) {
+    static_cast<EventSink *>(context)->Post(std::move(event));
+  }
+}
+
+}  // namespace
+
+DeferredEvent::~DeferredEvent() {
+  delete event.load(std::memory_order_acquire);
+}
+
+std::unique_ptr<CallbackEvent> NewEvent(CallbackKind kind, int handle, int value) {
+  std::unique_ptr<CallbackEvent> event(new CallbackEvent());
+  event->kind = kind;
+  event->handle = handle;
+  event->value = value;
+  event->timestamp = NowNs();
+  return event;
+}
+
+void CopyImage(const LScanImageData &source, ImageFrame *target, int handle) {
+  target->width = source.width;
+  target->height = source.height;
+  target->resolution = source.resolution;
+  target->bitsPerPixel = source.bitsPerPixel;
+  if (source.buffer == nullptr || source.bufferSize <= 0) {
+    target->pixels.reset();
+    return;
+  }
+  size_t size = static_cast<size_t>(source.bufferSize);
+  if (target->pixels && target->pixels->capacity >= size) {
+    target->pixels->size = size;
+  } else {
+    target->pixels.reset(HandleFramePool(handle).Acquire(size));
+  }
+  if (target->pixels) {
+    memcpy(target->pixels->data, source.buffer, size);
+  }
+  SampleCaptureMemory(handle);
+}
+
+napi_value BlockToJs(napi_env env, FrameBlockPtr block) {
+  napi_value data = nullptr;
+  if (!block) {
+    napi_create_buffer(env, 0, nullptr, &data);
+  } else if (napi_create_external_buffer(env, block->size, block->data, FinalizePixels, block.get(), &data) ==
+             napi_ok) {
+    // Report the block so V8 schedules collections (and thus returns blocks
+    // to the pool) at a rate proportional to frame traffic.
+    int64_t adjusted = 0;
+    napi_adjust_external_memory(env, static_cast<int64_t>(block->capacity), &adjusted);
+    block.release();
+  } else {
+    // Runtimes that forbid external buffers (e.g. Electron's V8 sandbox) get a copy.
+    napi_create_buffer_copy(env, block->size, block->data, nullptr, &data);
+  }
+  return data;
+}
+
+napi_value ImageToJs(napi_env env, ImageFrame *image) {
+  return ResultObject(env)
+      .Int("width", image->width)
+      .Int("height", image->height)
+      .Int("resolution", image->resolution)
+      .Int("bitsPerPixel", image->bitsPerPixel)
+      .Set("data", BlockToJs(env, std::move(image->pixels)))
+      .value();
+}
+
+napi_value ResultImageToJs(napi_env env, CallbackEvent *event) {
+  napi_value image = ImageToJs(env, &event->image);
+  if (event->encode && image != nullptr) {
+    napi_set_named_property(env, image, "encoded", event->encode->Promise(env));
+    event->encode.reset();
+  }
+  if (event->segmentation && image != nullptr) {
+    napi_value data = nullptr;
+    napi_get_named_property(env, image, "data", &data);
+    napi_set_named_property(env, image, "segmentation", SegmentationToJs(env, *event->segmentation, data));
+    event->segmentation.reset();
+  }
+  return image;
+}
+
+CallbackSlot *GetCallbackSlot(CallbackKind kind, int handle) {
+  std::lock_guard<std::mutex> lock(g_slots_mutex);
+  std::unique_ptr<CallbackSlot> &slot = g_slots[std::make_pair(kind, handle)];
+  if (!slot) {
+    slot.reset(new CallbackSlot(kind));
+  }
+  return slot.get();
+}
+
+bool AssignCallback(napi_env env, CallbackSlot *slot, napi_value function) {
+  return slot->Assign(env, function);
+}
+
+PreviewChannel *GetPreviewChannel(int handle) {
+  return &GetCallbackSlot(CallbackKind::kPreviewImage, handle)->preview();
+}
+
+bool HasCallback(CallbackSlot *slot) {
+  return slot->active();
+}
+
+EventSink *SlotSink(CallbackSlot *slot) {
+  return slot;
+}
+
+bool NativeConsumerOpen(CallbackKind kind, int handle) {
+  switch (kind) {
+    case CallbackKind::kPreviewImage:
+      return CompositorOpen(handle) || QualityMapOpen(handle) || WorkerFramesOpen(kind, handle);
+    case CallbackKind::kResultImage:
+      return WorkerFramesOpen(kind, handle);
+    default:
+      return false;
+  }
+}
+
+int RefreshPreviewCallback(int handle) {
+  const Api &api = GetApi();
+  if (api.LSCAN_Capture_RegisterCallbackPreviewImage == nullptr) {
+    return LSCAN_ERR_NOT_SUPPORTED;
+  }
+  if (GetCaptureStream(handle)->open()) {
+    return LSCAN_STATUS_OK;
+  }
+  CallbackSlot *slot = GetCallbackSlot(CallbackKind::kPreviewImage, handle);
+  bool keep = NativeConsumerOpen(CallbackKind::kPreviewImage, handle) || HasCallback(slot);
+  return api.LSCAN_Capture_RegisterCallbackPreviewImage(handle, keep ? OnPreviewImage : nullptr,
+                                                        keep ? SlotSink(slot) : nullptr);
+}
+
+int RefreshResultCallback(int handle) {
+  const Api &api = GetApi();
+  if (api.LSCAN_Capture_RegisterCallbackResultImage == nullptr) {
+    return LSCAN_ERR_NOT_SUPPORTED;
+  }
+  if (GetCaptureStream(handle)->open()) {
+    return LSCAN_STATUS_OK;
+  }
+  CallbackSlot *slot = GetCallbackSlot(CallbackKind::kResultImage, handle);
+  bool keep = NativeConsumerOpen(CallbackKind::kResultImage, handle) || HasCallback(slot);
+  return api.LSCAN_Capture_RegisterCallbackResultImage(handle, keep ? OnResultImage : nullptr,
+                                                       keep ? SlotSink(slot) : nullptr);
+}
+
+bool DeliverEvent(napi_env env, CallbackEvent *event) {
+  if (event->kind == CallbackKind::kCompletion) {
+    event->complete(env);
+    return true;
+  }
+  return event->sink != nullptr && event->sink->Deliver(env, *event);
+}
+
+void CALLBACK OnProgress(int deviceIndex, int progressValue, void *context) {
+  Post(context, NewEvent(CallbackKind::kProgress, deviceIndex, progressValue));
+}
+
+void CALLBACK OnDeviceCount(int deviceCount, void *context) {
+  InvalidateDeviceInfo();
+  NoteDeviceCount(deviceCount);
+  Post(context, NewEvent(CallbackKind::kDeviceCount, -1, deviceCount));
+}
+
+void CALLBACK OnCommunicationBreak(int handle, void *context) {
+  // The device may come back as a different one.
+  InvalidateProperties(handle, PropertyScope::kAll);
+  ForgetControls(handle);
+  InvalidateDeviceInfo();
+  Post(context, NewEvent(CallbackKind::kCommunicationBreak, handle));
+}
+
+void CALLBACK OnPreviewImage(int handle, const LScanImageData imageData, void *context) {
+  uint64_t timestamp = NowNs();
+  SharedLatencyMonitor().OnPreviewFrame(handle, timestamp);
+  if (IsRecording()) {
+    RecordImage(CallbackKind::kPreviewImage, handle, 0, timestamp, imageData);
+  }
+  if (CompositorsOpen()) {
+    GetCompositor(handle)->Offer(imageData, timestamp);
+  }
+  if (QualityMapsOpen()) {
+    GetQualityMap(handle)->Offer(imageData, timestamp);
+  }
+  if (WorkerFramesOpen()) {
+    OfferWorkerPreview(handle, imageData, timestamp);
+  }
+  if (context != nullptr) {
+    static_cast<EventSink *>(context)->PostPreview(handle, imageData, timestamp);
+  }
+}
+
+void CALLBACK OnObjectCount(int handle, const LScanObjectCountState state, void *context) {
+  Post(context, NewEvent(CallbackKind::kObjectCount, handle, state));
+}
+
+void CALLBACK OnObjectQuality(int handle, const LScanObjectQualityState *qualities, const int qualityCount,
+                              void *context) {
+  std::unique_ptr<CallbackEvent> event = NewEvent(CallbackKind::kObjectQuality, handle);
+  int count = qualityCount < LSCAN_MAX_OBJECTS ? qualityCount : LSCAN_MAX_OBJECTS;
+  for (int i = 0; i < count && qualities != nullptr; i++) {
+    event->qualities[event->qualityCount++] = qualities[i];
+  }
+  Post(context, std::move(event));
+}
+
+void CALLBACK OnTakingResultImage(int handle, void *context) {
+  Post(context, NewEvent(CallbackKind::kTakingResultImage, handle));
+}
+
+void CALLBACK OnAcquisitionComplete(int handle, void *context) {
+  Post(context, NewEvent(CallbackKind::kAcquisitionComplete, handle));
+}
+
+void CALLBACK OnResultImage(int handle, const LScanImageData imageData, const DWORD imageStatus,
+                            void *context) {
+  std::unique_ptr<CallbackEvent> event = NewEvent(CallbackKind::kResultImage, handle,
+                                                  static_cast<int>(imageStatus));
+  if (IsRecording()) {
+    RecordImage(CallbackKind::kResultImage, handle, event->value, event->timestamp, imageData);
+  }
+  if (WorkerFramesOpen()) {
+    OfferWorkerResult(handle, imageData, event->value, event->timestamp);
+  }
+  if (context == nullptr || !static_cast<EventSink *>(context)->active()) {
+    // Only a worker takes the image, with a copy of its own: the main thread's
+    // event goes out without one, for the latency monitor.
+    EndCaptureMemory(handle);
+    Post(context, std::move(event));
+    return;
+  }
+  CopyImage(imageData, &event->image, handle);
+  EndCaptureMemory(handle);
+  EncodingOptions encoding = ResultEncoding(handle);
+  if (encoding.format != ImageEncoding::kNone && event->image.pixels) {
+    // Start now, on the SDK thread, so encoding overlaps delivery to JS.
+    event->encode = EncodeJob::Start(event->image, event->image.pixels->data, event->image.pixels->size, encoding);
+  }
+  SegmentationConfig segmentation;
+  const ImageFrame &image = event->image;
+  if (ResultSegmentation(handle, &segmentation) && image.pixels && image.bitsPerPixel == 8 &&
+      image.pixels->size >= static_cast<size_t>(image.width) * image.height) {
+    // On the TaskPool, so the SDK thread does not wait for it. A placeholder
+    // takes the event's place in the queue now, so later callbacks cannot
+    // overtake it, and the fingers still arrive with the image.
+    std::unique_ptr<CallbackEvent> placeholder = NewEvent(CallbackKind::kResultImage, handle, event->value);
+    placeholder->timestamp = event->timestamp;
+    placeholder->deferred = std::make_shared<DeferredEvent>();
+    std::shared_ptr<DeferredEvent> deferred = placeholder->deferred;
+    event->segmentation = std::make_shared<SlapSegmentation>();
+    // std::function needs a copyable callable, so the event travels as a raw pointer.
+    CallbackEvent *pending = event.release();
+    SharedTaskPool().Post([deferred, pending, segmentation] {
+      const ImageFrame &frame = pending->image;
+      SegmentSlap(frame.pixels->data, frame.width, frame.height, segmentation, pending->segmentation.get());
+      deferred->event.store(pending, std::memory_order_seq_cst);
+      SharedDispatcher().Wake();
+    });
+    Post(context, std::move(placeholder));
+    return;
+  }
+  Post(context, std::move(event));
+}
+
+void CALLBACK OnClearObjectsFromPlaten(int handle, const LScanClearPlatenState state, void *context) {
+  Post(context, NewEvent(CallbackKind::kClearObjectsFromPlaten, handle, state));
+}
+
+void CALLBACK OnKeys(int handle, const DWORD pressedKeys, void *context) {
+  Post(context, NewEvent(CallbackKind::kKeys, handle, static_cast<int>(pressedKeys)));
+}
+
+}  // namespace lse
@@ -0,0 +1,183 @@
+/// Bridge from SDK callbacks (fired on SDK-internal threads) to JS functions.
+///
+/// Every LSCAN_*_RegisterCallback* binding stores the JS function in a CallbackSlot
+/// keyed by callback kind and device handle. The slot's address is handed to the SDK
+/// as the callback context and stays valid for the lifetime of the process, so a
+/// late callback racing with re-registration never touches freed memory.
+///
+/// Trampolines capture each notification into a CallbackEvent stamped with
+/// NowNs() and push it to the Dispatcher; they take no locks. JS functions receive
+/// the capture timestamp as their last argument. Preview frames are the
+/// exception: they pass through a per-handle PreviewChannel that bounds how many
+/// can wait for JS (see preview_channel.h).
+
+#pragma once
+
+#include "frame_pool.h"
+#include "lse_api.h"
+
+#include <node_api.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace lse {
+
+enum class CallbackKind : uint8_t {
+  kProgress,
+  kDeviceCount,
+  kCommunicationBreak,
+  kPreviewImage,
+  kObjectCount,
+  kObjectQuality,
+  kTakingResultImage,
+  kAcquisitionComplete,
+  kResultImage,
+  kClearObjectsFromPlaten,
+  kKeys,
+  kCompletion,  ///< Not an SDK callback: runs CallbackEvent::complete on the JS thread
+};
+
+/// Copy of an SDK image in a pooled block; SDK image memory is only valid during
+/// the callback. The block's ownership moves to JS with ImageToJs().
+struct ImageFrame {
+  int width = 0;
+  int height = 0;
+  int resolution = 0;
+  int bitsPerPixel = 0;
+  FrameBlockPtr pixels;
+};
+
+class EventSink;
+class EncodeJob;
+struct SlapSegmentation;
+struct CallbackEvent;
+
+/// An event still being completed on the TaskPool, e.g. a result image being
+/// segmented. A placeholder holding it keeps the event's place in the
+/// dispatcher queue; the dispatcher holds back the placeholder, and every
+/// event behind it, until the worker has published the finished event.
+struct DeferredEvent {
+  std::atomic<CallbackEvent *> event{nullptr};  ///< The finished event, once ready
+  ~DeferredEvent();
+};
+
+/// One SDK notification, captured on the SDK thread.
+struct CallbackEvent {
+  CallbackKind kind = CallbackKind::kProgress;
+  EventSink *sink = nullptr;
+  uint64_t timestamp = 0;   ///< NowNs() when the SDK invoked the trampoline
+  int handle = -1;          ///< Device handle; device index for kProgress; -1 for kDeviceCount
+  int value = 0;            ///< Progress, device count, state, image status or key bits
+  int qualityCount = 0;
+  int qualities[LSCAN_MAX_OBJECTS] = {};
+  ImageFrame image;
+  std::shared_ptr<EncodeJob> encode;           ///< kResultImage with result encoding configured
+  std::shared_ptr<SlapSegmentation> segmentation;  ///< kResultImage with result segmentation configured
+  std::function<void(napi_env)> complete;      ///< kCompletion only
+  std::shared_ptr<DeferredEvent> deferred;     ///< Set on placeholders only
+  std::atomic<CallbackEvent *> next{nullptr};  ///< MpscQueue link
+};
+
+/// Receiver of SDK callbacks; the trampolines' context argument. Sinks are
+/// handed to the SDK and must never be destroyed.
+class EventSink {
+ public:
+  virtual ~EventSink() = default;
+
+  /// SDK thread; never blocks on the JS thread.
+  virtual void Post(std::unique_ptr<CallbackEvent> event) = 0;
+  virtual void PostPreview(int handle, const LScanImageData &image, uint64_t timestamp) = 0;
+
+  /// Any thread. Whether Post() would queue an event rather than drop it, so a
+  /// trampoline can skip the work of building one nobody takes.
+  virtual bool active() const { return true; }
+
+  /// JS thread: hand @p event to JS. Returns false if the event was dropped
+  /// because the sink has no JS function any more.
+  virtual bool Deliver(napi_env env, CallbackEvent &event) = 0;
+
+  /// JS thread, at the end of a dispatcher drain in which Deliver() collected
+  /// events for one JS call instead of calling JS per event (see
+  /// Dispatcher::FlushAfterDrain()).
+  virtual void Flush(napi_env /*env*/) {}
+};
+
+/// Capture @p kind for @p handle, stamped with NowNs().
+std::unique_ptr<CallbackEvent> NewEvent(CallbackKind kind, int handle, int value = 0);
+
+/// Copy SDK image memory of @p handle into @p target, reusing its pooled block
+/// if it is large enough and else drawing from HandleFramePool(@p handle).
+void CopyImage(const LScanImageData &source, ImageFrame *target, int handle);
+
+/// JS image object { width, height, resolution, bitsPerPixel, data } where
+/// @e data is an external Buffer over the frame's pooled block. The block returns
+/// to the pool when the Buffer is garbage collected.
+napi_value ImageToJs(napi_env env, ImageFrame *image);
+
+/// ImageToJs() of a kResultImage event, plus the @e encoded promise if the event
+/// carries an encode job and the @e segmentation (SegmentationToJs(), with views
+/// into @e data) if it was segmented.
+napi_value ResultImageToJs(napi_env env, CallbackEvent *event);
+
+/// External Buffer over @p block, which returns to its pool when the Buffer is
+/// garbage collected.
+napi_value BlockToJs(napi_env env, FrameBlockPtr block);
+
+class CallbackSlot;
+
+/// Slot for @p kind and @p handle; global callbacks use handle -1.
+CallbackSlot *GetCallbackSlot(CallbackKind kind, int handle);
+
+class PreviewChannel;
+
+/// Backpressure channel between the preview callback of @p handle and JS.
+PreviewChannel *GetPreviewChannel(int handle);
+
+/// Attach @p function (or detach if null) to @p slot.
+/// Returns false with a pending JS exception on failure.
+bool AssignCallback(napi_env env, CallbackSlot *slot, napi_value function);
+
+/// Whether @p slot has a JS function attached; any thread.
+bool HasCallback(CallbackSlot *slot);
+
+/// The slot as the SDK callback context.
+EventSink *SlotSink(CallbackSlot *slot);
+
+/// Whether a native consumer of images of @p kind is open for @p handle: a
+/// compositor, quality map or worker for preview frames, a worker for result
+/// images. The callback then stays registered without a JS handler.
+bool NativeConsumerOpen(CallbackKind kind, int handle);
+
+/// Point the preview callback of @p handle at whoever needs it now that a native
+/// consumer opened or closed: a capture() stream keeps its own registration;
+/// otherwise the per-callback slot, which drops frames while it has no JS
+/// function. Returns the SDK status.
+int RefreshPreviewCallback(int handle);
+
+/// RefreshPreviewCallback() for the result image callback of @p handle.
+int RefreshResultCallback(int handle);
+
+/// Run a kCompletion event or hand @p event to its sink. Returns false if the
+/// event was dropped. JS thread only.
+bool DeliverEvent(napi_env env, CallbackEvent *event);
+
+/// SDK-facing trampolines; the context argument must be an EventSink.
+void CALLBACK OnProgress(int deviceIndex, int progressValue, void *context);
+void CALLBACK OnDeviceCount(int deviceCount, void *context);
+void CALLBACK OnCommunicationBreak(int handle, void *context);
+void CALLBACK OnPreviewImage(int handle, const LScanImageData imageData, void *context);
+void CALLBACK OnObjectCount(int handle, const LScanObjectCountState state, void *context);
+void CALLBACK OnObjectQuality(int handle, const LScanObjectQualityState *qualities, const int qualityCount,
+                              void *context);
+void CALLBACK OnTakingResultImage(int handle, void *context);
+void CALLBACK OnAcquisitionComplete(int handle, void *context);
+void CALLBACK OnResultImage(int handle, const LScanImageData imageData, const DWORD imageStatus,
+                            void *context);
+void CALLBACK OnClearObjectsFromPlaten(int handle, const LScanClearPlatenState state, void *context);
+void CALLBACK OnKeys(int handle, const DWORD pressedKeys, void *context);
+
+}  // namespace lse
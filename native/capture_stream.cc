@@ -0,0 +1,240 @@
+#include "capture_stream.h"
+
+#include "clock.h"
+#include "dispatcher.h"
+#include "latency.h"
+#include "napi_util.h"
+#include "preview_channel.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace lse {
+
+/// X(kind, registration, trampoline) for the callbacks a stream takes over.
+#define LSE_CAPTURE_CALLBACKS(X)                                                                         \
+  X(kPreviewImage, LSCAN_Capture_RegisterCallbackPreviewImage, OnPreviewImage)                           \
+  X(kObjectCount, LSCAN_Capture_RegisterCallbackObjectCount, OnObjectCount)                              \
+  X(kObjectQuality, LSCAN_Capture_RegisterCallbackObjectQuality, OnObjectQuality)                        \
+  X(kTakingResultImage, LSCAN_Capture_RegisterCallbackTakingResultImage, OnTakingResultImage)            \
+  X(kAcquisitionComplete, LSCAN_Capture_RegisterCallbackAcquisitionComplete, OnAcquisitionComplete)      \
+  X(kResultImage, LSCAN_Capture_RegisterCallbackResultImage, OnResultImage)                              \
+  X(kClearObjectsFromPlaten, LSCAN_Capture_RegisterCallbackClearObjectsFromPlaten, OnClearObjectsFromPlaten) \
+  X(kKeys, LSCAN_Controls_RegisterCallbackKeys, OnKeys)
+
+int CaptureStream::Open(napi_env env, napi_value function) {
+  const Api &api = GetApi();
+  napi_ref created = nullptr;
+  NAPI_CHECK_RETURN(env, napi_create_reference(env, function, 1, &created), LSCAN_ERR_GENERAL);
+  if (function_ != nullptr) {
+    napi_delete_reference(env, function_);
+  } else {
+    SharedDispatcher().AddListener();
+  }
+  function_ = created;
+  open_.store(true, std::memory_order_release);
+
+  int status = LSCAN_STATUS_OK;
+#define LSE_CAPTURE_REGISTER(kind, registration, trampoline)                                  \
+  if (status >= 0) {                                                                          \
+    status = api.registration != nullptr ? api.registration(handle_, trampoline, this)        \
+                                         : LSCAN_ERR_NOT_SUPPORTED;                            \
+  }
+  LSE_CAPTURE_CALLBACKS(LSE_CAPTURE_REGISTER)
+#undef LSE_CAPTURE_REGISTER
+  if (status < 0) {
+    Close(env);
+  }
+  return status;
+}
+
+int CaptureStream::Close(napi_env env) {
+  const Api &api = GetApi();
+  int status = LSCAN_STATUS_OK;
+#define LSE_CAPTURE_RESTORE(kind, registration, trampoline)                                   \
+  if (api.registration != nullptr) {                                                          \
+    CallbackSlot *slot = GetCallbackSlot(CallbackKind::kind, handle_);                        \
+    bool keep = HasCallback(slot) || NativeConsumerOpen(CallbackKind::kind, handle_);         \
+    int restored = api.registration(handle_, keep ? trampoline : nullptr, keep ? SlotSink(slot) : nullptr); \
+    if (status >= 0 && restored < 0) {                                                        \
+      status = restored;                                                                      \
+    }                                                                                         \
+  }
+  LSE_CAPTURE_CALLBACKS(LSE_CAPTURE_RESTORE)
+#undef LSE_CAPTURE_RESTORE
+
+  open_.store(false, std::memory_order_release);
+  if (!HasCallback(GetCallbackSlot(CallbackKind::kPreviewImage, handle_))) {
+    // Frames behind a marker that is now discarded would never be taken.
+    GetPreviewChannel(handle_)->Clear();
+  }
+  if (function_ != nullptr) {
+    napi_delete_reference(env, function_);
+    function_ = nullptr;
+    SharedDispatcher().RemoveListener();
+  }
+  return status;
+}
+
+void CaptureStream::Post(std::unique_ptr<CallbackEvent> event) {
+  if (!open_.load(std::memory_order_acquire)) {
+    return;
+  }
+  event->sink = this;
+  SharedDispatcher().Push(event.release());
+}
+
+void CaptureStream::PostPreview(int handle, const LScanImageData &image, uint64_t timestamp) {
+  if (!open_.load(std::memory_order_acquire) || !GetPreviewChannel(handle)->Offer(handle, image, timestamp)) {
+    return;
+  }
+  // A marker at the position of the first waiting frame; the frames themselves
+  // stay in the channel, where newer ones replace them according to the policy.
+  std::unique_ptr<CallbackEvent> marker = NewEvent(CallbackKind::kPreviewImage, handle);
+  marker->timestamp = timestamp;
+  marker->sink = this;
+  SharedDispatcher().Push(marker.release());
+}
+
+void CaptureStream::AddRecord(napi_env env, CallbackKind kind, int value, uint64_t timestamp, napi_value extra,
+                              const int *qualities) {
+  SharedLatencyMonitor().OnDelivered(kind, handle_, timestamp, batch_start_);
+  records_.push_back(static_cast<double>(kind));
+  records_.push_back(value);
+  records_.push_back(static_cast<double>(timestamp));
+  napi_value extras = nullptr;
+  if (extra != nullptr && napi_get_reference_value(env, extras_, &extras) == napi_ok) {
+    napi_set_element(env, extras, extra_count_, extra);
+    records_.push_back(extra_count_++);
+  } else {
+    records_.push_back(-1);
+  }
+  for (int i = 0; i < LSCAN_MAX_OBJECTS; i++) {
+    records_.push_back(qualities != nullptr ? qualities[i] : 0);
+  }
+}
+
+bool CaptureStream::Deliver(napi_env env, CallbackEvent &event) {
+  if (function_ == nullptr) {
+    return false;
+  }
+  if (extras_ == nullptr) {
+    // First event of this batch: JS gets it once the drain is through.
+    napi_value extras = nullptr;
+    if (napi_create_array(env, &extras) != napi_ok || napi_create_reference(env, extras, 1, &extras_) != napi_ok) {
+      extras_ = nullptr;
+      return false;
+    }
+    extra_count_ = 0;
+    batch_start_ = NowNs();
+    SharedDispatcher().FlushAfterDrain(this);
+  }
+  switch (event.kind) {
+    case CallbackKind::kPreviewImage: {
+      std::vector<PreviewFrame> frames;
+      GetPreviewChannel(handle_)->Take(&frames);
+      for (PreviewFrame &frame : frames) {
+        AddRecord(env, CallbackKind::kPreviewImage, 0, frame.timestamp, ImageToJs(env, &frame.image), nullptr);
+      }
+      GetPreviewChannel(handle_)->Account(frames.size(), 0);
+      break;
+    }
+    case CallbackKind::kResultImage:
+      AddRecord(env, event.kind, event.value, event.timestamp, ResultImageToJs(env, &event), nullptr);
+      break;
+    case CallbackKind::kObjectQuality:
+      AddRecord(env, event.kind, event.qualityCount, event.timestamp, nullptr, event.qualities);
+      break;
+    default:
+      AddRecord(env, event.kind, event.value, event.timestamp, nullptr, nullptr);
+      break;
+  }
+  return true;
+}
+
+void CaptureStream::Flush(napi_env env) {
+  bool pending = false;
+  napi_is_exception_pending(env, &pending);
+  if (pending && function_ != nullptr) {
+    // The drain stopped for an exception thrown by JS, and no JS can be called
+    // until Node has reported it. Keep the batch, a resultImage that ends the
+    // iteration perhaps, for the next drain.
+    SharedDispatcher().FlushAfterDrain(this);
+    SharedDispatcher().Wake();
+    return;
+  }
+  napi_value extras = nullptr;
+  if (extras_ != nullptr) {
+    napi_get_reference_value(env, extras_, &extras);
+    napi_delete_reference(env, extras_);
+    extras_ = nullptr;
+  }
+  std::vector<double> records;
+  records.swap(records_);
+  size_t count = records.size() / kRecordSize;
+  napi_value function = nullptr;
+  if (count == 0 || extras == nullptr || function_ == nullptr ||
+      napi_get_reference_value(env, function_, &function) != napi_ok || function == nullptr) {
+    return;
+  }
+  void *data = nullptr;
+  napi_value buffer = nullptr;
+  napi_value array = nullptr;
+  NAPI_CHECK_RETURN(env, napi_create_arraybuffer(env, records.size() * sizeof(double), &data, &buffer), );
+  memcpy(data, records.data(), records.size() * sizeof(double));
+  NAPI_CHECK_RETURN(env, napi_create_typedarray(env, napi_float64_array, records.size(), buffer, 0, &array), );
+
+  stats_.events += count;
+  stats_.batches++;
+  if (count > stats_.maxBatch) {
+    stats_.maxBatch = count;
+  }
+  napi_value argv[2] = {array, extras};
+  napi_value undefined = nullptr;
+  napi_get_undefined(env, &undefined);
+  napi_call_function(env, undefined, function, 2, argv, nullptr);
+  SharedLatencyMonitor().OnHandled(handle_, NowNs() - batch_start_);
+}
+
+CaptureStream *GetCaptureStream(int handle) {
+  static std::mutex mutex;
+  static std::map<int, std::unique_ptr<CaptureStream>> *streams = new std::map<int, std::unique_ptr<CaptureStream>>();
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<CaptureStream> &stream = (*streams)[handle];
+  if (!stream) {
+    stream.reset(new CaptureStream(handle));
+  }
+  return stream.get();
+}
+
+int RestoreCallbacks(int handle) {
+  const Api &api = GetApi();
+  CaptureStream *stream = GetCaptureStream(handle);
+  bool streaming = stream->open();
+  int status = LSCAN_STATUS_OK;
+#define LSE_CAPTURE_REREGISTER(kind, registration, trampoline)                                          \
+  if (api.registration != nullptr) {                                                                    \
+    CallbackSlot *slot = GetCallbackSlot(CallbackKind::kind, handle);                                   \
+    bool keep = HasCallback(slot) || NativeConsumerOpen(CallbackKind::kind, handle);                    \
+    int restored = streaming ? api.registration(handle, trampoline, stream)                             \
+                   : keep    ? api.registration(handle, trampoline, SlotSink(slot))                     \
+                             : LSCAN_STATUS_OK;                                                         \
+    if (status >= 0 && restored < 0) {                                                                  \
+      status = restored;                                                                                \
+    }                                                                                                   \
+  }
+  LSE_CAPTURE_CALLBACKS(LSE_CAPTURE_REREGISTER)
+#undef LSE_CAPTURE_REREGISTER
+  CallbackSlot *slot = GetCallbackSlot(CallbackKind::kCommunicationBreak, handle);
+  if (api.LSCAN_Main_RegisterCallbackCommunicationBreak != nullptr && HasCallback(slot)) {
+    int restored = api.LSCAN_Main_RegisterCallbackCommunicationBreak(handle, OnCommunicationBreak, SlotSink(slot));
+    if (status >= 0 && restored < 0) {
+      status = restored;
+    }
+  }
+  return status;
+}
+
+}  // namespace lse
@@ -0,0 +1,85 @@
+/// All capture callbacks of one handle as a single batched event stream.
+///
+/// While a stream is open it owns the handle's eight capture-related SDK
+/// callbacks (preview, object count/quality, taking result, acquisition
+/// complete, result, clear platen, keys). Its events travel through the
+/// dispatcher queue like any other; the dispatcher's drain collects those of
+/// one wakeup and calls JS once with all of them, in SDK order, after the rest
+/// of the batch (Dispatcher::FlushAfterDrain()). A stream adds no wakeups.
+///
+/// JS receives (records, extras): @e records is a Float64Array of kRecordSize
+/// values per event, [kind, value, timestamp, extra, quality0..3], where @e kind
+/// is a CallbackKind, @e value the state/status/key bits (quality count for
+/// kObjectQuality) and @e extra an index into the @e extras array holding the
+/// image object of preview and result events (-1 if none). Preview frames pass
+/// through the handle's PreviewChannel, so setPreviewPolicy() applies.
+
+#pragma once
+
+#include "callbacks.h"
+
+#include <node_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace lse {
+
+struct CaptureStreamStats {
+  uint64_t events = 0;    ///< Events handed to JS
+  uint64_t batches = 0;   ///< JS calls
+  uint64_t maxBatch = 0;  ///< Most events in one JS call
+};
+
+class CaptureStream : public EventSink {
+ public:
+  static constexpr size_t kRecordSize = 8;
+
+  explicit CaptureStream(int handle) : handle_(handle) {}
+
+  /// JS thread. Attach @p function and route the handle's capture callbacks to
+  /// this stream. Returns the first failing SDK status, or LSCAN_STATUS_OK.
+  int Open(napi_env env, napi_value function);
+
+  /// JS thread. Give the callbacks back to the per-callback registrations that
+  /// were made with the LSCAN_*_RegisterCallback* bindings, if any.
+  int Close(napi_env env);
+
+  CaptureStreamStats Stats() const { return stats_; }
+  bool open() const { return open_.load(std::memory_order_acquire); }
+
+  void Post(std::unique_ptr<CallbackEvent> event) override;
+  void PostPreview(int handle, const LScanImageData &image, uint64_t timestamp) override;
+  bool Deliver(napi_env env, CallbackEvent &event) override;
+  void Flush(napi_env env) override;
+
+ private:
+  void AddRecord(napi_env env, CallbackKind kind, int value, uint64_t timestamp, napi_value extra,
+                 const int *qualities);
+
+  const int handle_;
+  std::atomic<bool> open_{false};
+  napi_ref function_ = nullptr;  // JS thread only
+  CaptureStreamStats stats_;     // JS thread only
+
+  // The batch collected during one dispatcher drain; JS thread only. It stays
+  // for the next drain if JS could not be called (an exception pending), hence
+  // a reference to @e extras_.
+  std::vector<double> records_;
+  napi_ref extras_ = nullptr;
+  uint32_t extra_count_ = 0;
+  uint64_t batch_start_ = 0;
+};
+
+/// Stream for @p handle; created on first use and never destroyed.
+CaptureStream *GetCaptureStream(int handle);
+
+/// Register the callbacks of @p handle with the SDK again after it was
+/// initialized anew (the SDK forgets them with the old connection): the capture
+/// callbacks to the open stream or to their slots, and the communication break
+/// callback. Callbacks nobody receives stay unregistered. Any thread; returns
+/// the first failing SDK status.
+int RestoreCallbacks(int handle);
+
+}  // namespace lse
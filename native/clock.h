@@ -0,0 +1,18 @@
+/// Monotonic timestamps shared by callbacks, dispatcher and JS (`now()`).
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace lse {
+
+/// Nanoseconds on the steady clock (CLOCK_MONOTONIC on Linux, the same clock as
+/// process.hrtime()).
+inline uint64_t NowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+}  // namespace lse
@@ -0,0 +1,350 @@
+#include "compositor.h"
+
+#include "clock.h"
+#include "dispatcher.h"
+#include "image_kernels.h"
+#include "napi_util.h"
+#include "overlay_raster.h"
+#include "task_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace lse {
+
+namespace {
+
+std::atomic<int> g_open{0};
+
+}  // namespace
+
+/// A rendered frame on its way to the JS thread.
+struct Compositor::Output {
+  FrameBlockPtr pixels;
+  uint64_t timestamp = 0;
+  uint64_t generation = 0;
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  int quality = 0;  ///< JPEG quality; 0 when not JPEG
+};
+
+int Compositor::Open(napi_env env, const CompositorConfig &config, napi_value function) {
+  napi_ref created = nullptr;
+  NAPI_CHECK_RETURN(env, napi_create_reference(env, function, 1, &created), LSCAN_ERR_GENERAL);
+  if (function_ != nullptr) {
+    napi_delete_reference(env, function_);
+  } else {
+    SharedDispatcher().AddListener();
+  }
+  function_ = created;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    config_ = config;
+    stats_ = CompositorStats();
+    next_due_ = 0;
+    quality_ = config.jpeg.quality;
+    last_encoded_ = 0;
+    interval_ns_ = 0;
+  }
+  if (!open_.exchange(true, std::memory_order_acq_rel)) {
+    g_open.fetch_add(1, std::memory_order_relaxed);
+  }
+  int status = RefreshPreviewCallback(handle_);
+  if (status < 0) {
+    Close(env);
+  }
+  return status;
+}
+
+int Compositor::Close(napi_env env) {
+  if (open_.exchange(false, std::memory_order_acq_rel)) {
+    g_open.fetch_sub(1, std::memory_order_relaxed);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    has_pending_ = false;
+    pending_.pixels.reset();
+  }
+  int status = RefreshPreviewCallback(handle_);
+  if (function_ != nullptr) {
+    napi_delete_reference(env, function_);
+    function_ = nullptr;
+    SharedDispatcher().RemoveListener();
+  }
+  return status;
+}
+
+void Compositor::SetOverlays(std::vector<OverlaySpec> overlays) {
+  auto shared = std::make_shared<const std::vector<OverlaySpec>>(std::move(overlays));
+  std::lock_guard<std::mutex> lock(mutex_);
+  overlays_ = std::move(shared);
+}
+
+void Compositor::Offer(const LScanImageData &image, uint64_t timestamp) {
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open()) {
+      return;
+    }
+    stats_.received++;
+    if (config_.maxFps > 0) {
+      // A quarter interval of slack, so that jitter does not halve a rate that
+      // divides the preview rate evenly.
+      const uint64_t interval = static_cast<uint64_t>(1e9 / config_.maxFps);
+      if (timestamp + interval / 4 < next_due_) {
+        stats_.skipped++;
+        return;
+      }
+      next_due_ = std::max(next_due_, timestamp) + interval;
+    }
+    if (image.bitsPerPixel != 8 || image.buffer == nullptr ||
+        static_cast<int64_t>(image.bufferSize) < static_cast<int64_t>(image.width) * image.height ||
+        image.width <= 0 || image.height <= 0) {
+      stats_.dropped++;
+      return;
+    }
+    if (has_pending_) {
+      stats_.dropped++;
+    }
+    // Reuses the source block of the last rendered frame.
+    CopyImage(image, &pending_, handle_);
+    pending_timestamp_ = timestamp;
+    has_pending_ = pending_.pixels != nullptr;
+    if (busy_ || !has_pending_) {
+      return;
+    }
+    busy_ = true;
+    generation = generation_;
+  }
+  SharedTaskPool().Post([this, generation] { Render(generation); });
+}
+
+void Compositor::Render(uint64_t generation) {
+  ImageFrame frame;
+  uint64_t timestamp = 0;
+  CompositorConfig config;
+  std::shared_ptr<const std::vector<OverlaySpec>> overlays;
+  int quality = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (generation != generation_ || !has_pending_) {
+      busy_ = false;
+      return;
+    }
+    frame = std::move(pending_);
+    has_pending_ = false;
+    timestamp = pending_timestamp_;
+    config = config_;
+    overlays = overlays_;
+    quality = quality_;
+  }
+
+  const uint64_t start = NowNs();
+  const int width = config.width;
+  const int height = config.height;
+  const int channels = config.format == CompositorFormat::kRgba ? 4 : 1;
+  std::unique_ptr<Output> output(new Output());
+  output->pixels.reset(SharedFramePool().Acquire(static_cast<size_t>(width) * height * channels));
+  if (output->pixels) {
+    // Where the preview lands: centred and scaled uniformly, or stretched.
+    int drawnWidth = width;
+    int drawnHeight = height;
+    if (config.keepAspect) {
+      double scale = std::min(static_cast<double>(width) / frame.width, static_cast<double>(height) / frame.height);
+      drawnWidth = std::min(width, std::max(1, static_cast<int>(std::lround(frame.width * scale))));
+      drawnHeight = std::min(height, std::max(1, static_cast<int>(std::lround(frame.height * scale))));
+    }
+    const int left = (width - drawnWidth) / 2;
+    const int top = (height - drawnHeight) / 2;
+    uint8_t *pixels = output->pixels->data;
+    const size_t stride = static_cast<size_t>(width) * channels;
+
+    uint8_t background[4];
+    CanvasColor(config.background, channels, background);
+    for (int y = 0; y < height; y++) {
+      uint8_t *row = pixels + y * stride;
+      if (y < top || y >= top + drawnHeight) {
+        BlendSpan(row, width, channels, background, 255);
+        continue;
+      }
+      BlendSpan(row, left, channels, background, 255);
+      BlendSpan(row + (left + drawnWidth) * channels, width - left - drawnWidth, channels, background, 255);
+    }
+
+    if (channels == 1) {
+      Resize(frame.pixels->data, frame.width, frame.height, pixels + top * stride + left, drawnWidth, drawnHeight,
+             width);
+    } else {
+      static thread_local std::vector<uint8_t> scaled;
+      scaled.resize(static_cast<size_t>(drawnWidth) * drawnHeight);
+      Resize(frame.pixels->data, frame.width, frame.height, scaled.data(), drawnWidth, drawnHeight, drawnWidth);
+      for (int y = 0; y < drawnHeight; y++) {
+        GrayToRgba(scaled.data() + static_cast<size_t>(y) * drawnWidth, drawnWidth,
+                   pixels + (top + y) * stride + left * 4);
+      }
+    }
+
+    if (overlays) {
+      Canvas canvas{pixels, width, height, channels};
+      ImagePlacement placement{static_cast<double>(left), static_cast<double>(top),
+                               static_cast<double>(drawnWidth) / frame.width,
+                               static_cast<double>(drawnHeight) / frame.height};
+      for (const OverlaySpec &overlay : *overlays) {
+        DrawOverlay(canvas, placement, overlay);
+      }
+    }
+  }
+  const uint64_t rendered = NowNs();
+  const uint64_t elapsed = rendered - start;
+
+  // Encode once here, on the pool, for every viewer the frame goes to.
+  const bool encode = config.encoding != ImageEncoding::kNone && output->pixels;
+  if (encode) {
+    const uint8_t *pixels = output->pixels->data;
+    if (config.encoding == ImageEncoding::kJpeg) {
+      JpegOptions options;
+      options.quality = quality;
+      output->pixels = EncodeJpeg(pixels, width, height, channels, options);
+      output->quality = quality;
+    } else {
+      output->pixels = EncodePng(pixels, width, height, 0, PngOptions());
+    }
+  }
+  const uint64_t encodeNs = encode ? NowNs() - rendered : 0;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Hand the source block back for the next Offer() to copy into.
+    if (!pending_.pixels && generation == generation_) {
+      pending_.pixels = std::move(frame.pixels);
+    }
+    if (output->pixels) {
+      stats_.rendered++;
+      stats_.renderNs += elapsed;
+      stats_.lastRenderNs = elapsed;
+      stats_.maxRenderNs = std::max(stats_.maxRenderNs, elapsed);
+      stats_.encodeNs += encodeNs;
+      stats_.bytes += output->pixels->size;
+      if (config.encoding == ImageEncoding::kJpeg && generation == generation_) {
+        AdaptQuality(output->pixels->size, timestamp);
+      }
+    } else {
+      stats_.dropped++;
+    }
+  }
+  output->timestamp = timestamp;
+  output->generation = generation;
+  output->width = width;
+  output->height = height;
+  output->channels = channels;
+  Output *posted = output.release();
+  SharedDispatcher().PostCompletion([this, posted](napi_env env) { Deliver(env, posted); });
+}
+
+void Compositor::Deliver(napi_env env, Output *posted) {
+  std::unique_ptr<Output> output(posted);
+  bool current = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current = output->generation == generation_;
+  }
+  napi_value function = nullptr;
+  if (current && output->pixels && function_ != nullptr &&
+      napi_get_reference_value(env, function_, &function) == napi_ok && function != nullptr) {
+    ResultObject result(env);
+    result.Int("width", output->width)
+        .Int("height", output->height)
+        .Int("channels", output->channels)
+        .Set("data", BlockToJs(env, std::move(output->pixels)));
+    if (output->quality > 0) {
+      result.Int("quality", output->quality);
+    }
+    napi_value frame = result.value();
+    napi_value argv[3] = {MakeInt(env, handle_), frame, MakeDouble(env, static_cast<double>(output->timestamp))};
+    napi_value undefined = nullptr;
+    napi_get_undefined(env, &undefined);
+    napi_call_function(env, undefined, function, 3, argv, nullptr);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.delivered++;
+  }
+
+  // Render the newest frame that arrived meanwhile, if any.
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_pending_ || !open()) {
+      busy_ = false;
+      return;
+    }
+    generation = generation_;
+  }
+  SharedTaskPool().Post([this, generation] { Render(generation); });
+}
+
+/// Steer the quality towards maxBytesPerSecond at the rate frames are actually
+/// encoded: down in proportion to the overshoot, so a scene change is corrected
+/// within a frame or two, and up one step at a time while well under budget.
+void Compositor::AdaptQuality(size_t bytes, uint64_t timestamp) {
+  if (config_.maxBytesPerSecond == 0) {
+    return;
+  }
+  if (last_encoded_ != 0 && timestamp > last_encoded_) {
+    const double interval = static_cast<double>(timestamp - last_encoded_);
+    interval_ns_ = interval_ns_ > 0 ? interval_ns_ * 0.875 + interval * 0.125 : interval;
+  }
+  last_encoded_ = timestamp;
+  if (interval_ns_ <= 0) {
+    return;
+  }
+  const double budget = static_cast<double>(config_.maxBytesPerSecond) * interval_ns_ / 1e9;
+  if (bytes > budget) {
+    quality_ -= std::max(1, static_cast<int>(quality_ * (bytes / budget - 1) / 2));
+  } else if (bytes < budget * 0.8) {
+    quality_++;
+  }
+  quality_ = std::min(std::max(quality_, std::max(config_.minQuality, JpegOptions::kMinQuality)),
+                      config_.jpeg.quality);
+}
+
+CompositorStats Compositor::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CompositorStats stats = stats_;
+  stats.quality = config_.encoding == ImageEncoding::kJpeg ? quality_ : 0;
+  return stats;
+}
+
+namespace {
+
+std::mutex g_compositors_mutex;
+std::map<int, std::unique_ptr<Compositor>> g_compositors;
+
+}  // namespace
+
+Compositor *GetCompositor(int handle) {
+  std::lock_guard<std::mutex> lock(g_compositors_mutex);
+  std::unique_ptr<Compositor> &compositor = g_compositors[handle];
+  if (!compositor) {
+    compositor.reset(new Compositor(handle));
+  }
+  return compositor.get();
+}
+
+bool CompositorsOpen() {
+  return g_open.load(std::memory_order_relaxed) > 0;
+}
+
+bool CompositorOpen(int handle) {
+  if (!CompositorsOpen()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(g_compositors_mutex);
+  auto it = g_compositors.find(handle);
+  return it != g_compositors.end() && it->second->open();
+}
+
+}  // namespace lse
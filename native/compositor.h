@@ -0,0 +1,134 @@
+/// Headless stand-in for the SDK's preview window, per device handle.
+///
+/// LSCAN_Visualization_SetWindow() renders into an HWND, which a server has
+/// none of. A compositor takes the handle's preview frames straight from the
+/// LSCAN_CallbackPreviewImage trampoline, scales them to a fixed output size
+/// (letterboxed on the background colour when the aspect ratio is kept), draws
+/// the overlays of the LSCAN_Visualization_* model on top (see overlay_raster.h)
+/// and hands the result to a JS function as an 8-bit gray or RGBA Buffer.
+///
+/// Rendering runs on the TaskPool with the SIMD kernels of image_kernels.h.
+/// Each compositor has at most one frame rendering or waiting for JS; frames
+/// that arrive meanwhile replace each other and only the newest is rendered, so
+/// a slow consumer lowers the output rate instead of queueing stale frames.
+///
+/// With an encoding configured, each rendered frame is also encoded on that job,
+/// once, however many viewers the JS side fans it out to (src/preview-broadcast.js).
+/// Two knobs keep the encoded stream within bounds: maxFps skips preview frames
+/// that arrive sooner than the rate allows, and maxBytesPerSecond steers the
+/// JPEG quality between minQuality and the configured quality from the size of
+/// the frames encoded so far.
+///
+/// A compositor works with or without a JS preview handler or capture() stream
+/// on the same handle: while it is open the preview callback stays registered
+/// with the SDK.
+
+#pragma once
+
+#include "callbacks.h"
+#include "image_encoder.h"
+#include "overlay_scene.h"
+
+#include <node_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lse {
+
+enum class CompositorFormat : int {
+  kGray = 0,
+  kRgba = 1,
+};
+
+struct CompositorConfig {
+  static constexpr int kMaxSize = 8192;
+
+  int width = 0;
+  int height = 0;
+  CompositorFormat format = CompositorFormat::kRgba;
+  COLORREF background = 0;
+  bool keepAspect = true;  ///< Letterbox instead of stretching
+  ImageEncoding encoding = ImageEncoding::kNone;  ///< kPng needs kGray
+  JpegOptions jpeg;                ///< Initial and highest quality
+  int minQuality = 1;              ///< Floor of the adaptive JPEG quality
+  uint64_t maxBytesPerSecond = 0;  ///< Encoded byte budget; 0 keeps the quality fixed
+  double maxFps = 0;               ///< Output rate cap; 0 renders every frame it can
+};
+
+struct CompositorStats {
+  uint64_t received = 0;   ///< Preview frames offered by the SDK
+  uint64_t rendered = 0;
+  uint64_t delivered = 0;  ///< Frames handed to the JS function
+  uint64_t dropped = 0;    ///< Frames replaced by a newer one before rendering
+  uint64_t skipped = 0;    ///< Frames over the maxFps rate, never copied
+  uint64_t renderNs = 0;   ///< Total render time, encoding excluded
+  uint64_t maxRenderNs = 0;
+  uint64_t lastRenderNs = 0;
+  uint64_t encodeNs = 0;   ///< Total encode time
+  uint64_t bytes = 0;      ///< Output bytes, encoded or not
+  int quality = 0;         ///< Current JPEG quality
+};
+
+class Compositor {
+ public:
+  explicit Compositor(int handle) : handle_(handle) {}
+
+  /// JS thread. Start (or reconfigure) compositing into @p function, which is
+  /// called as (handle, { width, height, channels, data, quality }, timestamp);
+  /// data is the encoded file with an encoding, and quality is set for JPEG.
+  /// Resets the statistics. Returns the SDK status of registering the preview
+  /// callback.
+  int Open(napi_env env, const CompositorConfig &config, napi_value function);
+
+  /// JS thread. Stop; a frame being rendered is discarded.
+  int Close(napi_env env);
+
+  /// Any thread. Overlays drawn from the next rendered frame on.
+  void SetOverlays(std::vector<OverlaySpec> overlays);
+
+  /// SDK thread: keep a copy of @p image as the next frame to render.
+  void Offer(const LScanImageData &image, uint64_t timestamp);
+
+  CompositorStats Stats();
+  bool open() const { return open_.load(std::memory_order_acquire); }
+
+ private:
+  struct Output;
+
+  void Render(uint64_t generation);
+  void Deliver(napi_env env, Output *output);
+  void AdaptQuality(size_t bytes, uint64_t timestamp);  // mutex_ held
+
+  const int handle_;
+  std::atomic<bool> open_{false};
+  napi_ref function_ = nullptr;  // JS thread only
+
+  std::mutex mutex_;
+  uint64_t generation_ = 0;  // Bumped by Open and Close; stale renders are discarded
+  CompositorConfig config_;
+  std::shared_ptr<const std::vector<OverlaySpec>> overlays_;
+  ImageFrame pending_;
+  uint64_t pending_timestamp_ = 0;
+  bool has_pending_ = false;
+  bool busy_ = false;  // A frame is rendering or waiting for JS
+  uint64_t next_due_ = 0;  // Earliest timestamp maxFps lets through
+  int quality_ = 0;
+  uint64_t last_encoded_ = 0;   // Timestamp of the last encoded frame
+  double interval_ns_ = 0;      // Smoothed interval between encoded frames
+  CompositorStats stats_;
+};
+
+/// Compositor of @p handle; created on first use and never destroyed.
+Compositor *GetCompositor(int handle);
+
+/// Whether any compositor is open; cheap enough for every preview frame.
+bool CompositorsOpen();
+
+/// Whether the preview callback of @p handle must stay registered for a compositor.
+bool CompositorOpen(int handle);
+
+}  // namespace lse
@@ -0,0 +1,134 @@
+#include "bindings.h"
+
+namespace lse {
+
+/// Every status code and enum value from the SDK headers, exported as `constants`.
+#define LSE_CONSTANTS(X)                        \
+  X(LSCAN_STATUS_OK)                            \
+  X(LSCAN_WRN_ALREADY_INITIALIZED)              \
+  X(LSCAN_WRN_OPTICS_SURFACE_DIRTY)             \
+  X(LSCAN_ERR_GENERAL)                          \
+  X(LSCAN_ERR_API_NOT_INITIALIZED)              \
+  X(LSCAN_ERR_INVALID_PARAM_VALUE)              \
+  X(LSCAN_ERR_NOT_INITIALIZED)                  \
+  X(LSCAN_ERR_DEVICE_IO)                        \
+  X(LSCAN_ERR_RESOURCE_LOCKED)                  \
+  X(LSCAN_ERR_NOT_SUPPORTED)                    \
+  X(LSCAN_ERR_NO_HARDWARE_SUPPORT)              \
+  X(LSCAN_ERR_CAPTURE_IN_PROGRESS)              \
+  X(LSCAN_ERR_NOT_CAPTURING)                    \
+  X(LSCAN_ERR_CHANNEL_INVALID_CAPTURE_MODE)     \
+  X(LSCAN_ERR_CHANNEL_NOT_ACTIVE)               \
+  X(LSCAN_ERR_NO_HAND_FINGER)                   \
+  X(LSCAN_ERR_INVALID_DEVICE_INDEX)             \
+  X(LSCAN_ERR_TIMEOUT)                          \
+  X(LSCAN_ERR_LICENSE)                          \
+  X(LSCAN_MAX_STR_LEN)                          \
+  X(LSCAN_MAX_CONTRAST_VALUE)                   \
+  X(LSCAN_MAX_OBJECTS)                          \
+  X(LSCAN_PROPERTY_SERIAL_NUMBER)               \
+  X(LSCAN_PROPERTY_PRODUCT_NAME)                \
+  X(LSCAN_PROPERTY_FIRMWARE_VERSION)            \
+  X(LSCAN_PROPERTY_HARDWARE_VERSION)            \
+  X(LSCAN_PROPERTY_AUTOMATIC_ADJUSTMENT)        \
+  X(LSCAN_PROPERTY_ROLL_ALLOW_RESTART)          \
+  X(LSCAN_PROPERTY_ROLL_MODE)                   \
+  X(LSCAN_PROPERTY_LICENSES)                    \
+  X(LSCAN_PROPERTY_TEMPERATURE)                 \
+  X(LSCAN_PROPERTY_PLATEN_STATE)                \
+  X(LSCAN_TYPE_NONE)                            \
+  X(LSCAN_FLAT_SINGLE_FINGER)                   \
+  X(LSCAN_ROLL_SINGLE_FINGER)                   \
+  X(LSCAN_FLAT_TWO_FINGERS)                     \
+  X(LSCAN_FLAT_FOUR_FINGERS)                    \
+  X(LSCAN_FLAT_THUMBS)                          \
+  X(LSCAN_FLAT_PALM)                            \
+  X(LSCAN_FLAT_WRITERS_PALM)                    \
+  X(LSCAN_RES_500)                              \
+  X(LSCAN_RES_1000)                             \
+  X(LSCAN_ORIENTATION_TOP_DOWN)                 \
+  X(LSCAN_ORIENTATION_BOTTOM_UP)                \
+  X(LSCAN_OPTION_AUTO_CAPTURE)                  \
+  X(LSCAN_OPTION_AUTO_CONTRAST)                 \
+  X(LSCAN_OPTION_FLAT_SEGMENTATION)             \
+  X(LSCAN_OPTION_ROLL_SHIFT_CHECK)              \
+  X(LSCAN_OPTION_VIS_FULL_IMAGE)                \
+  X(LSCAN_OPTION_VIS_FINGER_MARKERS)            \
+  X(LSCAN_VIS_NONE)                             \
+  X(LSCAN_VIS_PREVIEW)                          \
+  X(LSCAN_VIS_RESULT)                           \
+  X(LSCAN_VIS_PREVIEW_AND_RESULT)               \
+  X(LSCAN_BEEPER_NONE)                          \
+  X(LSCAN_BEEPER_STANDARD)                      \
+  X(LSCAN_BEEPER_VOLUME)                        \
+  X(LSCAN_KEYPAD_NONE)                          \
+  X(LSCAN_KEYPAD_TWO_KEYS)                      \
+  X(LSCAN_KEYPAD_FOUR_KEYS)                     \
+  X(LSCAN_KEYPAD_DISPLAY)                       \
+  X(LSCAN_LED_NONE)                             \
+  X(LSCAN_LED_STATUS)                           \
+  X(LSCAN_LED_FINGER)                           \
+  X(LSCAN_KEY_LEFT)                             \
+  X(LSCAN_KEY_RIGHT)                            \
+  X(LSCAN_KEY_UP)                               \
+  X(LSCAN_KEY_DOWN)                             \
+  X(LSCAN_KEY_FOOT_SWITCH)                      \
+  X(LSCAN_DISPLAY_LOGO_PLAIN)                   \
+  X(LSCAN_DISPLAY_LOGO_PROGRESS)                \
+  X(LSCAN_DISPLAY_SELECTION_NONE)               \
+  X(LSCAN_DISPLAY_SELECTION_BANDAGED)           \
+  X(LSCAN_DISPLAY_SELECTION_MISSING)            \
+  X(LSCAN_DISPLAY_SELECTION_RESTRICTED)         \
+  X(LSCAN_DISPLAY_SELECTION_UNRESTRICTED)       \
+  X(LSCAN_DISPLAY_CTRL_NONE)                    \
+  X(LSCAN_DISPLAY_CTRL_OK)                      \
+  X(LSCAN_DISPLAY_CTRL_CANCEL)                  \
+  X(LSCAN_DISPLAY_CTRL_REPEAT)                  \
+  X(LSCAN_DISPLAY_CTRL_NEXT)                    \
+  X(LSCAN_DISPLAY_STAT_TOP_NONE)                \
+  X(LSCAN_DISPLAY_STAT_TOP_ROLL_LEFT)           \
+  X(LSCAN_DISPLAY_STAT_TOP_ROLL_RIGHT)          \
+  X(LSCAN_DISPLAY_STAT_TOP_SCANNING)            \
+  X(LSCAN_DISPLAY_STAT_BOTTOM_NONE)             \
+  X(LSCAN_DISPLAY_STAT_BOTTOM_OK)               \
+  X(LSCAN_DISPLAY_STAT_BOTTOM_ROLL_ERROR)       \
+  X(LSCAN_DISPLAY_STAT_BOTTOM_QUALITY_BAD)      \
+  X(LSCAN_DISPLAY_COLOR_NONE)                   \
+  X(LSCAN_DISPLAY_COLOR_GRAY)                   \
+  X(LSCAN_DISPLAY_COLOR_GREEN)                  \
+  X(LSCAN_DISPLAY_COLOR_YELLOW)                 \
+  X(LSCAN_DISPLAY_COLOR_RED)                    \
+  X(LSCAN_DISPLAY_COLOR_BLINK_GREEN)            \
+  X(LSCAN_OBJECT_COUNT_OK)                      \
+  X(LSCAN_OBJECT_COUNT_TOO_FEW)                 \
+  X(LSCAN_OBJECT_COUNT_TOO_MANY)                \
+  X(LSCAN_QUALITY_GOOD)                         \
+  X(LSCAN_QUALITY_NOT_PRESENT)                  \
+  X(LSCAN_QUALITY_TOO_LIGHT)                    \
+  X(LSCAN_QUALITY_TOO_DARK)                     \
+  X(LSCAN_QUALITY_BAD_SHAPE)                    \
+  X(LSCAN_QUALITY_WRONG_SLAP)                   \
+  X(LSCAN_QUALITY_BAD_POSITION)                 \
+  X(LSCAN_QUALITY_ROLL_SHIFTED)                 \
+  X(LSCAN_CLEAR_OBJECT_FROM_PLATEN)             \
+  X(LSCAN_PLATED_CLEARED)                       \
+  X(LSCAN_IMAGE_STATUS_OK)                      \
+  X(LSCAN_IMAGE_STATUS_QUALITY_LOW)             \
+  X(LSCAN_IMAGE_STATUS_ROLL_SHIFTED)            \
+  X(LSCAN_IMAGE_STATUS_ABORTED)                 \
+  X(LSCAN_STUB_FIRE_KEYS)                       \
+  X(LSCAN_STUB_FIRE_OBJECT_QUALITY)             \
+  X(LSCAN_STUB_FIRE_PREVIEW)                    \
+  X(LSCAN_STUB_ALL_DEVICES)
+
+napi_value CreateConstants(napi_env env) {
+  napi_value object = nullptr;
+  NAPI_CHECK(env, napi_create_object(env, &object));
+#define LSE_CONSTANT(name) napi_set_named_property(env, object, #name, MakeInt(env, static_cast<int32_t>(name)));
+  LSE_CONSTANTS(LSE_CONSTANT)
+#undef LSE_CONSTANT
+  napi_object_freeze(env, object);
+  return object;
+}
+
+}  // namespace lse
@@ -0,0 +1,279 @@
+#include "controls_queue.h"
+
+#include "clock.h"
+#include "lse_api.h"
+
+#include <cstring>
+#include <map>
+
+namespace lse {
+
+namespace {
+
+/// X(function, name, slot, argc, arguments): the queueable controls, in
+/// ControlFunction order. @e slot is the control the call sets, @e arguments
+/// its argument list in terms of @e handle and the int array @e a.
+#define LSE_CONTROL_FUNCTIONS(X)                                                                                \
+  X(kSetActiveLEDs, LSCAN_Controls_SetActiveLEDs, kLeds, 1, (handle, static_cast<DWORD>(a[0])))                 \
+  X(kSetActiveKeys, LSCAN_Controls_SetActiveKeys, kKeys, 1, (handle, static_cast<DWORD>(a[0])))                 \
+  X(kBeeper, LSCAN_Controls_Beeper, kBeeper, 2, (handle, a[0], a[1]))                                           \
+  X(kShowLogoScreen, LSCAN_Controls_DisplayShowLogoScreen, kDisplay, 2,                                         \
+    (handle, static_cast<LScanDisplayLogoOption>(a[0]), a[1]))                                                  \
+  X(kShowModeSelectScreen, LSCAN_Controls_DisplayShowModeSelectScreen, kDisplay, 0, (handle))                   \
+  X(kShowResolutionSelectScreen, LSCAN_Controls_DisplayShowResolutionSelectScreen, kDisplay, 0, (handle))       \
+  X(kShowFingerSelectionScreen, LSCAN_Controls_DisplayShowFingerSelectionScreen, kDisplay, 20,                  \
+    (handle, static_cast<LScanDisplaySelectionCtrl>(a[0]), static_cast<LScanDisplayCommonCtrl>(a[1]),           \
+     LSE_DISPLAY_COLORS(a, 2)))                                                                                 \
+  X(kShowCaptureProgressScreen, LSCAN_Controls_DisplayShowCaptureProgressScreen, kDisplay, 22,                  \
+    (handle, static_cast<LScanDisplayCommonCtrl>(a[0]), static_cast<LScanDisplayCommonCtrl>(a[1]),              \
+     static_cast<LScanDisplayStatTop>(a[2]), static_cast<LScanDisplayStatBottom>(a[3]), LSE_DISPLAY_COLORS(a, 4)))
+
+#define LSE_DISPLAY_COLOR(a, i) static_cast<LScanDisplayObjectColor>(a[i])
+#define LSE_DISPLAY_COLORS(a, f)                                                                                 \
+  LSE_DISPLAY_COLOR(a, f), LSE_DISPLAY_COLOR(a, f + 1), LSE_DISPLAY_COLOR(a, f + 2), LSE_DISPLAY_COLOR(a, f + 3), \
+      LSE_DISPLAY_COLOR(a, f + 4), LSE_DISPLAY_COLOR(a, f + 5), LSE_DISPLAY_COLOR(a, f + 6),                      \
+      LSE_DISPLAY_COLOR(a, f + 7), LSE_DISPLAY_COLOR(a, f + 8), LSE_DISPLAY_COLOR(a, f + 9),                      \
+      LSE_DISPLAY_COLOR(a, f + 10), LSE_DISPLAY_COLOR(a, f + 11), LSE_DISPLAY_COLOR(a, f + 12),                   \
+      LSE_DISPLAY_COLOR(a, f + 13), LSE_DISPLAY_COLOR(a, f + 14), LSE_DISPLAY_COLOR(a, f + 15),                   \
+      LSE_DISPLAY_COLOR(a, f + 16), LSE_DISPLAY_COLOR(a, f + 17)
+
+/// Controls of a device; a queued call replaces the waiting call of its control.
+enum ControlSlot { kLeds, kKeys, kBeeper, kDisplay, kSlotCount };
+
+struct ControlEntry {
+  ControlFunction function;
+  const char *name;
+  ControlSlot slot;
+  int argc;
+  bool (*available)();
+  int (*call)(int handle, const int *a);
+};
+
+#define LSE_CONTROL_ENTRY(function, name, slot, argc, arguments) \
+  {ControlFunction::function,                                   \
+   #name,                                                        \
+   slot,                                                         \
+   argc,                                                         \
+   [] { return GetApi().name != nullptr; },                      \
+   [](int handle, const int *a) -> int {                         \
+     (void)a;                                                    \
+     return GetApi().name arguments;                             \
+   }},
+const ControlEntry kControls[] = {LSE_CONTROL_FUNCTIONS(LSE_CONTROL_ENTRY)};
+#undef LSE_CONTROL_ENTRY
+#undef LSE_DISPLAY_COLORS
+#undef LSE_DISPLAY_COLOR
+
+const ControlEntry &Entry(ControlFunction function) {
+  return kControls[static_cast<int>(function)];
+}
+
+std::mutex &RegistryMutex() {
+  static std::mutex *mutex = new std::mutex();
+  return *mutex;
+}
+
+std::map<int, std::unique_ptr<ControlsQueue>> &Registry() {
+  static auto *queues = new std::map<int, std::unique_ptr<ControlsQueue>>();
+  return *queues;
+}
+
+}  // namespace
+
+bool ControlCall::operator==(const ControlCall &other) const {
+  return function == other.function && argc == other.argc && memcmp(args, other.args, argc * sizeof(int)) == 0;
+}
+
+bool FindControlFunction(const char *name, ControlFunction *function) {
+  for (const ControlEntry &entry : kControls) {
+    if (strcmp(entry.name, name) == 0) {
+      *function = entry.function;
+      return true;
+    }
+  }
+  return false;
+}
+
+int ControlArgCount(ControlFunction function) {
+  return Entry(function).argc;
+}
+
+bool ControlAvailable(ControlFunction function) {
+  return Entry(function).available();
+}
+
+void ControlsQueue::Push(const ControlCall &call, Done done) {
+  static_assert(sizeof(slots_) / sizeof(slots_[0]) == kSlotCount, "one slot per control");
+  const ControlEntry &entry = Entry(call.function);
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats_.requests++;
+  Slot &slot = slots_[entry.slot];
+  if (slot.pending) {
+    // Last writer wins; the replaced call settles with the one replacing it.
+    stats_.coalesced++;
+    slot.call = call;
+    slot.waiters.push_back(std::move(done));
+    return;
+  }
+  if (!slot.running && slot.applied && entry.slot != kBeeper && slot.last == call) {
+    stats_.skipped++;
+    lock.unlock();
+    done(LSCAN_STATUS_OK);
+    return;
+  }
+  slot.pending = true;
+  slot.order = next_order_++;
+  slot.call = call;
+  slot.waiters.push_back(std::move(done));
+  if (draining_) {
+    return;
+  }
+  draining_ = true;
+  if (!worker_) {
+    worker_.reset(new DeviceWorker(handle_));
+  }
+  worker_->Post([this] { Drain(); });
+}
+
+void ControlsQueue::Drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    if (capture_calls_ > 0) {
+      uint64_t start = NowNs();
+      stats_.yields++;
+      capture_done_.wait(lock, [this] { return capture_calls_ == 0; });
+      stats_.yieldNs += NowNs() - start;
+    }
+    Slot *next = nullptr;
+    for (Slot &slot : slots_) {
+      if (slot.pending && (next == nullptr || slot.order < next->order)) {
+        next = &slot;
+      }
+    }
+    if (next == nullptr) {
+      draining_ = false;
+      return;
+    }
+    ControlCall call = next->call;
+    std::vector<Done> waiters;
+    waiters.swap(next->waiters);
+    next->pending = false;
+    const ControlEntry &entry = Entry(call.function);
+    int status = LSCAN_STATUS_OK;
+    // Coalescing may have turned the call back into what the device shows.
+    if (next->applied && entry.slot != kBeeper && next->last == call) {
+      stats_.skipped++;
+    } else {
+      next->running = true;
+      uint64_t generation = generation_;
+      lock.unlock();
+      uint64_t start = NowNs();
+      status = entry.call(handle_, call.args);
+      uint64_t elapsed = NowNs() - start;
+      lock.lock();
+      next->running = false;
+      call_done_.notify_all();
+      stats_.calls++;
+      stats_.callNs += elapsed;
+      if (elapsed > stats_.maxCallNs) {
+        stats_.maxCallNs = elapsed;
+      }
+      if (status != LSCAN_STATUS_OK) {
+        stats_.failed++;
+      }
+      // A failed call leaves the device state unknown, as does a Forget() during the call.
+      next->applied = status == LSCAN_STATUS_OK && generation == generation_;
+      next->last = call;
+    }
+    lock.unlock();
+    for (Done &done : waiters) {
+      done(status);
+    }
+    lock.lock();
+  }
+}
+
+void ControlsQueue::Forget() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_++;
+  for (Slot &slot : slots_) {
+    slot.applied = false;
+  }
+}
+
+void ControlsQueue::Forget(ControlFunction function) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_++;
+  slots_[Entry(function).slot].applied = false;
+}
+
+void ControlsQueue::EnterCapture() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  capture_calls_++;
+  // The SDK takes one call of a handle at a time; the queue starts no call now,
+  // but one in progress must finish.
+  call_done_.wait(lock, [this] {
+    for (const Slot &slot : slots_) {
+      if (slot.running) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+void ControlsQueue::LeaveCapture() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (--capture_calls_ == 0) {
+    capture_done_.notify_all();
+  }
+}
+
+ControlsStats ControlsQueue::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ControlsStats stats = stats_;
+  for (const Slot &slot : slots_) {
+    stats.pending += slot.pending ? 1 : 0;
+  }
+  return stats;
+}
+
+ControlsQueue *GetControlsQueue(int handle) {
+  std::lock_guard<std::mutex> lock(RegistryMutex());
+  std::unique_ptr<ControlsQueue> &queue = Registry()[handle];
+  if (!queue) {
+    queue.reset(new ControlsQueue(handle));
+  }
+  return queue.get();
+}
+
+void ForgetControls(int handle) {
+  // Queues are never destroyed, so they outlive the registry lock.
+  std::vector<ControlsQueue *> queues;
+  {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    for (auto &entry : Registry()) {
+      if (handle < 0 || entry.first == handle) {
+        queues.push_back(entry.second.get());
+      }
+    }
+  }
+  for (ControlsQueue *queue : queues) {
+    queue->Forget();
+  }
+}
+
+void ForgetControl(int handle, ControlFunction function) {
+  ControlsQueue *queue = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    auto found = Registry().find(handle);
+    if (found == Registry().end()) {
+      return;
+    }
+    queue = found->second.get();
+  }
+  queue->Forget(function);
+}
+
+}  // namespace lse
@@ -0,0 +1,160 @@
+/// Asynchronous, coalescing queue for the device controls of one handle.
+///
+/// LEDs, keys, the beeper and the display screens give the operator feedback,
+/// yet every LSCAN_Controls_* call is a blocking device round trip, and the
+/// display screens take some twenty arguments. A UI state machine calls them on
+/// each of its state changes, far more often than the device needs.
+/// queueControl() hands such calls to the handle's ControlsQueue instead, which
+/// runs them on a DeviceWorker of its own:
+///
+///  - last writer wins per control: a call replaces the call of the same control
+///    still waiting (LEDs, keys, beeper, display; every screen replaces any
+///    other), keeping its place in the queue, and both settle with its status;
+///  - a call that would leave the device as it is, the same LEDs, keys or screen
+///    as the last call applied, is skipped. Beeps are actions and never skipped,
+///    but a burst of them collapses into the last;
+///  - controls give way to capture calls: while a capture call of the handle
+///    runs (CaptureCallScope), the queue does not start its next call, and a
+///    capture call waits for a control call in progress to finish.
+///
+/// What a handle last applied is forgotten when it is initialized, released or
+/// loses its connection (ForgetControls()), and per control when the control is
+/// set around the queue, by its direct binding or sessionCall() (ForgetControl()).
+
+#pragma once
+
+#include "device_worker.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lse {
+
+/// The SDK functions queueControl() accepts.
+enum class ControlFunction : int {
+  kSetActiveLEDs,
+  kSetActiveKeys,
+  kBeeper,
+  kShowLogoScreen,
+  kShowModeSelectScreen,
+  kShowResolutionSelectScreen,
+  kShowFingerSelectionScreen,
+  kShowCaptureProgressScreen,
+};
+
+/// A control call: its function and [in] arguments after the handle.
+struct ControlCall {
+  static constexpr int kMaxArgs = 22;  ///< Of LSCAN_Controls_DisplayShowCaptureProgressScreen()
+
+  ControlFunction function = ControlFunction::kSetActiveLEDs;
+  int argc = 0;
+  int args[kMaxArgs] = {};
+
+  bool operator==(const ControlCall &other) const;
+};
+
+/// Function for SDK name @p name; false if it cannot be queued.
+bool FindControlFunction(const char *name, ControlFunction *function);
+
+/// [in] arguments of @p function after the handle.
+int ControlArgCount(ControlFunction function);
+
+/// Whether the loaded SDK has @p function.
+bool ControlAvailable(ControlFunction function);
+
+struct ControlsStats {
+  uint64_t requests = 0;   ///< Calls queued
+  uint64_t calls = 0;      ///< Device round trips made
+  uint64_t coalesced = 0;  ///< Calls replaced by a later one of the same control before they ran
+  uint64_t skipped = 0;    ///< Calls the device state already matched
+  uint64_t failed = 0;     ///< Round trips with an error status
+  uint64_t pending = 0;    ///< Controls waiting now
+  uint64_t callNs = 0;     ///< Time in the SDK, summed
+  uint64_t maxCallNs = 0;
+  uint64_t yields = 0;     ///< Times the queue waited for capture calls
+  uint64_t yieldNs = 0;
+};
+
+class ControlsQueue {
+ public:
+  /// Settles a queued call with the status of the round trip that carried it;
+  /// LSCAN_STATUS_OK for a skipped one. Runs on the queue's worker, or on the
+  /// pushing thread for a call skipped at once.
+  using Done = std::function<void(int status)>;
+
+  explicit ControlsQueue(int handle) : handle_(handle) {}
+
+  /// Any thread. Queue @p call.
+  void Push(const ControlCall &call, Done done);
+
+  /// Any thread. Forget what the device shows; the next call of each control
+  /// goes to the device.
+  void Forget();
+
+  /// Any thread. Forget what the device shows for the control @p function sets;
+  /// its next queued call goes to the device.
+  void Forget(ControlFunction function);
+
+  /// Any thread. A capture call of the handle starts or ends. EnterCapture()
+  /// blocks while a control call runs on the queue's worker.
+  void EnterCapture();
+  void LeaveCapture();
+
+  ControlsStats Stats();
+
+ private:
+  /// One control: the call waiting for it and the call the device last applied.
+  struct Slot {
+    bool pending = false;
+    uint64_t order = 0;  ///< Queue position of the waiting call
+    ControlCall call;
+    std::vector<Done> waiters;
+    bool running = false;
+    bool applied = false;
+    ControlCall last;
+  };
+
+  void Drain();
+
+  const int handle_;
+  std::mutex mutex_;
+  std::condition_variable capture_done_;
+  std::condition_variable call_done_;
+  Slot slots_[4];
+  uint64_t next_order_ = 0;
+  uint64_t generation_ = 0;  ///< Forget() calls
+  int capture_calls_ = 0;
+  bool draining_ = false;
+  ControlsStats stats_;
+  std::unique_ptr<DeviceWorker> worker_;  // Created by the first call that needs it
+};
+
+/// Queue of @p handle; created on first use and never destroyed.
+ControlsQueue *GetControlsQueue(int handle);
+
+/// ControlsQueue::Forget() of @p handle, if it has a queue; of every handle if
+/// @p handle is negative.
+void ForgetControls(int handle);
+
+/// ControlsQueue::Forget(@p function) of @p handle, if it has a queue; after a
+/// call of @p function that did not go through the queue.
+void ForgetControl(int handle, ControlFunction function);
+
+/// Marks a capture call of a handle for the scope's lifetime, holding back its
+/// queued controls.
+class CaptureCallScope {
+ public:
+  explicit CaptureCallScope(int handle) : queue_(GetControlsQueue(handle)) { queue_->EnterCapture(); }
+  ~CaptureCallScope() { queue_->LeaveCapture(); }
+  CaptureCallScope(const CaptureCallScope &) = delete;
+  CaptureCallScope &operator=(const CaptureCallScope &) = delete;
+
+ private:
+  ControlsQueue *queue_;
+};
+
+}  // namespace lse
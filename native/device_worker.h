@@ -0,0 +1,42 @@
+/// Dedicated thread that serializes the SDK calls of one device.
+///
+/// The SDK blocks the calling thread for the duration of a call, and calls such
+/// as LSCAN_Main_Initialize() take seconds. Giving every device its own worker
+/// keeps a slow call on one unit from delaying calls on the others, while calls
+/// to the same device still run one at a time and in submission order.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace lse {
+
+class DeviceWorker {
+ public:
+  explicit DeviceWorker(int deviceIndex);
+  /// Runs the tasks already posted, then joins the thread.
+  ~DeviceWorker();
+  DeviceWorker(const DeviceWorker &) = delete;
+  DeviceWorker &operator=(const DeviceWorker &) = delete;
+
+  int deviceIndex() const { return device_index_; }
+
+  /// Any thread. Tasks run on the worker thread in posting order.
+  void Post(std::function<void()> task);
+
+ private:
+  void Run();
+
+  const int device_index_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+}  // namespace lse
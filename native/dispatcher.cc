@@ -0,0 +1,192 @@
+#include "dispatcher.h"
+
+#include "napi_util.h"
+
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace lse {
+
+bool Dispatcher::Start(napi_env env) {
+  env_ = env;
+  napi_value name = MakeString(env, "LScanEssentialsDispatcher");
+  NAPI_CHECK_RETURN(env,
+                    napi_create_threadsafe_function(env, nullptr, nullptr, name, 0, 1, nullptr, nullptr, this,
+                                                    CallJs, &tsfn_),
+                    false);
+  // Unreferenced until a JS callback is registered, like the ffi binding.
+  napi_unref_threadsafe_function(env, tsfn_);
+  napi_add_env_cleanup_hook(env, Cleanup, this);
+  return true;
+}
+
+void Dispatcher::Cleanup(void *data) {
+  Dispatcher *dispatcher = static_cast<Dispatcher *>(data);
+  dispatcher->closed_.store(true, std::memory_order_seq_cst);
+  // A Push() that got past the closed check may still be calling the
+  // threadsafe function; it must not outlive the release. Pushes never block,
+  // so this wait is short.
+  while (dispatcher->pushing_.load(std::memory_order_seq_cst) > 0) {
+    std::this_thread::yield();
+  }
+  napi_release_threadsafe_function(dispatcher->tsfn_, napi_tsfn_abort);
+  // Drop whatever is still queued; SDK threads pushing after this point see
+  // closed_ and free their events themselves.
+  while (CallbackEvent *event = dispatcher->queue_.Pop()) {
+    delete event;
+  }
+  delete dispatcher->held_;
+  dispatcher->held_ = nullptr;
+}
+
+void Dispatcher::Push(CallbackEvent *event) {
+  // Announce the push before checking closed_, and Cleanup() sets closed_
+  // before counting pushes: one of the two always sees the other.
+  pushing_.fetch_add(1, std::memory_order_seq_cst);
+  if (closed_.load(std::memory_order_seq_cst)) {
+    pushing_.fetch_sub(1, std::memory_order_release);
+    delete event;
+    return;
+  }
+  posted_.fetch_add(1, std::memory_order_relaxed);
+  queue_.Push(event);
+  // Pairs with the fence in Drain(): either this push sees the flag cleared, or
+  // the drain sees the event linked.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!scheduled_.exchange(true, std::memory_order_acq_rel)) {
+    Schedule();
+  }
+  pushing_.fetch_sub(1, std::memory_order_release);
+}
+
+void Dispatcher::Wake() {
+  pushing_.fetch_add(1, std::memory_order_seq_cst);
+  if (!closed_.load(std::memory_order_seq_cst) && !scheduled_.exchange(true, std::memory_order_seq_cst)) {
+    Schedule();
+  }
+  pushing_.fetch_sub(1, std::memory_order_release);
+}
+
+void Dispatcher::PostCompletion(std::function<void(napi_env)> complete) {
+  CallbackEvent *event = new CallbackEvent();
+  event->kind = CallbackKind::kCompletion;
+  event->complete = std::move(complete);
+  Push(event);
+}
+
+void Dispatcher::Schedule() {
+  if (napi_call_threadsafe_function(tsfn_, nullptr, napi_tsfn_nonblocking) != napi_ok) {
+    scheduled_.store(false, std::memory_order_release);
+  }
+}
+
+void Dispatcher::FlushAfterDrain(EventSink *sink) {
+  flush_.push_back(sink);
+}
+
+void Dispatcher::AddListener() {
+  if (listeners_++ == 0) {
+    napi_ref_threadsafe_function(env_, tsfn_);
+  }
+}
+
+void Dispatcher::RemoveListener() {
+  if (listeners_ > 0 && --listeners_ == 0) {
+    napi_unref_threadsafe_function(env_, tsfn_);
+  }
+}
+
+void Dispatcher::CallJs(napi_env env, napi_value /*function*/, void *context, void * /*data*/) {
+  if (env != nullptr) {
+    static_cast<Dispatcher *>(context)->Drain(env);
+  }
+}
+
+/// The next event to deliver, or nullptr if there is none or the next one is a
+/// placeholder whose event is not ready; that one is kept in held_ until it is.
+CallbackEvent *Dispatcher::NextEvent() {
+  CallbackEvent *event = held_ != nullptr ? held_ : queue_.Pop();
+  held_ = nullptr;
+  if (event == nullptr || !event->deferred) {
+    return event;
+  }
+  CallbackEvent *ready = event->deferred->event.exchange(nullptr, std::memory_order_seq_cst);
+  if (ready == nullptr) {
+    // Its worker calls Wake() once the event is published.
+    held_ = event;
+    return nullptr;
+  }
+  ready->sink = event->sink;
+  delete event;
+  return ready;
+}
+
+void Dispatcher::Drain(napi_env env) {
+  // Clear the flag before popping: a producer that pushes while we drain either
+  // has its event popped here or sees the flag clear and schedules another pass.
+  // A release store alone lets the queue loads below move ahead of it, so the
+  // fence orders them, as the one in Push() orders the producer's link.
+  scheduled_.exchange(false, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  uint64_t count = 0;
+  bool more = true;
+  while (count < kMaxBatch) {
+    CallbackEvent *event = NextEvent();
+    if (event == nullptr) {
+      more = false;
+      break;
+    }
+    count++;
+    std::unique_ptr<CallbackEvent> owned(event);
+    if (!DeliverEvent(env, owned.get())) {
+      discarded_++;
+      continue;
+    }
+    delivered_++;
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (pending) {
+      // Leave the exception for Node to report as uncaught; the rest of the
+      // queue is delivered on the next wakeup.
+      break;
+    }
+  }
+
+  // Sinks that collected events call JS once each, after the whole batch.
+  std::vector<EventSink *> flush;
+  flush.swap(flush_);
+  for (EventSink *sink : flush) {
+    sink->Flush(env);
+  }
+
+  if (count > 0) {
+    batches_++;
+    if (count > max_batch_) {
+      max_batch_ = count;
+    }
+  }
+  // A batch cut short yields to the event loop; producers do not reschedule
+  // while the flag is set, so do it here.
+  if (more && !scheduled_.exchange(true, std::memory_order_acq_rel)) {
+    Schedule();
+  }
+}
+
+DispatcherStats Dispatcher::Stats() const {
+  DispatcherStats stats;
+  stats.posted = posted_.load(std::memory_order_relaxed);
+  stats.delivered = delivered_;
+  stats.discarded = discarded_;
+  stats.batches = batches_;
+  stats.maxBatch = max_batch_;
+  return stats;
+}
+
+Dispatcher &SharedDispatcher() {
+  static Dispatcher *dispatcher = new Dispatcher();
+  return *dispatcher;
+}
+
+}  // namespace lse
@@ -0,0 +1,89 @@
+/// Delivery of SDK callback events to the JS thread.
+///
+/// SDK threads push CallbackEvents onto a lock-free MPSC queue and, only if no
+/// delivery is already scheduled, poke a single napi_threadsafe_function without
+/// blocking. The JS thread then drains the queue in one tick, up to kMaxBatch
+/// events, so bursts of callbacks cost one event-loop wakeup instead of one each.
+/// Events keep their global push order across devices and callback kinds; a
+/// placeholder for an event still being completed on the TaskPool
+/// (DeferredEvent) holds back the events behind it until it is done.
+
+#pragma once
+
+#include "callbacks.h"
+#include "mpsc_queue.h"
+
+#include <node_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace lse {
+
+struct DispatcherStats {
+  uint64_t posted = 0;     ///< Events pushed by SDK threads
+  uint64_t delivered = 0;  ///< Events handed to a JS function
+  uint64_t discarded = 0;  ///< Events whose slot was unregistered before delivery
+  uint64_t batches = 0;    ///< JS-thread wakeups that drained events
+  uint64_t maxBatch = 0;   ///< Largest number of events drained in one wakeup
+};
+
+class Dispatcher {
+ public:
+  static constexpr uint64_t kMaxBatch = 4096;
+
+  /// Create the threadsafe function for @p env. Called once per env from module
+  /// init: for the main thread on SharedDispatcher(), for workers on their own.
+  bool Start(napi_env env);
+
+  /// Any thread; never blocks. Takes ownership of @p event.
+  void Push(CallbackEvent *event);
+
+  /// Any thread: run @p complete on the JS thread, in order with SDK callbacks
+  /// posted before it. Used to settle promises of work done on native threads.
+  void PostCompletion(std::function<void(napi_env)> complete);
+
+  /// Any thread; never blocks. Schedule a drain, e.g. once the event of a
+  /// placeholder is ready.
+  void Wake();
+
+  /// JS thread, from EventSink::Deliver(): call @p sink's Flush() once this
+  /// drain has delivered its batch, in the same wakeup.
+  void FlushAfterDrain(EventSink *sink);
+
+  /// Keep the event loop alive while at least one JS callback is registered.
+  void AddListener();
+  void RemoveListener();
+
+  DispatcherStats Stats() const;
+
+ private:
+  static void CallJs(napi_env env, napi_value function, void *context, void *data);
+  static void Cleanup(void *data);
+  void Schedule();
+  void Drain(napi_env env);
+  CallbackEvent *NextEvent();
+
+  MpscQueue<CallbackEvent> queue_;
+  napi_env env_ = nullptr;
+  napi_threadsafe_function tsfn_ = nullptr;
+  std::atomic<bool> scheduled_{false};
+  std::atomic<bool> closed_{false};
+  std::atomic<int> pushing_{0};  // Push() calls past the closed_ check; Cleanup() waits for them
+  int listeners_ = 0;  // JS thread only
+  std::vector<EventSink *> flush_;  // JS thread only
+  CallbackEvent *held_ = nullptr;   // JS thread only: popped placeholder whose event is not ready yet
+
+  std::atomic<uint64_t> posted_{0};
+  uint64_t delivered_ = 0;  // Written on the JS thread only
+  uint64_t discarded_ = 0;
+  uint64_t batches_ = 0;
+  uint64_t max_batch_ = 0;
+};
+
+/// Dispatcher used by all callback slots.
+Dispatcher &SharedDispatcher();
+
+}  // namespace lse
@@ -0,0 +1,374 @@
+#include "frame_pool.h"
+
+#include "clock.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX  // std::min and std::max below
+#endif
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace lse {
+
+namespace {
+
+/// Result images a mode preallocates for: one on its way to JS, one arriving.
+constexpr size_t kResultBlocks = 2;
+
+/// Least time between two resident set size samples during a capture; reading
+/// it costs a system call (a /proc read on Linux), too much for every frame.
+constexpr uint64_t kRssSampleNs = 50 * 1000 * 1000;
+
+/// Per-handle state around HandleFramePool(); guarded by its mutex.
+struct HandlePool {
+  FramePool pool;
+  std::mutex mutex;
+  std::pair<int, int> mode{0, 0};  // imageType, resolution
+  std::map<std::pair<int, int>, std::vector<PoolDemand>> demand;  // What each mode needed
+  size_t reservedBytes = 0;
+  uint64_t startAllocations = 0;
+  uint64_t nextRssSample = 0;  // NowNs() from which a frame samples the resident set size again
+  CaptureMemory capture;
+};
+
+std::mutex g_handles_mutex;
+std::map<int, HandlePool *> g_handles;
+
+HandlePool &GetHandlePool(int handle) {
+  std::lock_guard<std::mutex> lock(g_handles_mutex);
+  HandlePool *&pool = g_handles[handle];
+  if (pool == nullptr) {
+    // Never destroyed, like SharedFramePool(): Buffers may return blocks at any time.
+    pool = new HandlePool();
+  }
+  return *pool;
+}
+
+/// Fold what the current mode of @p state needed into its remembered demand.
+void RememberDemand(HandlePool &state) {
+  if (state.mode.first == 0) {
+    return;
+  }
+  std::vector<PoolDemand> &known = state.demand[state.mode];
+  for (const PoolDemand &use : state.pool.Demand()) {
+    auto found = std::find_if(known.begin(), known.end(),
+                              [&](const PoolDemand &d) { return d.capacity == use.capacity; });
+    if (found == known.end()) {
+      known.push_back(use);
+    } else {
+      found->blocks = std::max(found->blocks, use.blocks);
+    }
+  }
+}
+
+}  // namespace
+
+FramePool::~FramePool() {
+  for (auto &bucket : buckets_) {
+    for (FrameBlock *block : bucket.second.idle) {
+      free(block->data);
+      delete block;
+    }
+  }
+}
+
+size_t FramePool::Capacity(size_t size) {
+  size_t capacity = (size + kGranularity - 1) / kGranularity * kGranularity;
+  return capacity == 0 ? kGranularity : capacity;
+}
+
+FrameBlock *FramePool::Allocate(size_t capacity) {
+  FrameBlock *block = new FrameBlock();
+  block->data = static_cast<uint8_t *>(malloc(capacity));
+  if (block->data == nullptr) {
+    delete block;
+    return nullptr;
+  }
+  block->capacity = capacity;
+  block->pool = this;
+  return block;
+}
+
+FrameBlock *FramePool::Acquire(size_t size) {
+  const size_t capacity = Capacity(size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Bucket &bucket = buckets_[capacity];
+    bucket.inUse++;
+    bucket.peak = std::max(bucket.peak, bucket.inUse);
+    stats_.outstanding++;
+    stats_.peakOutstanding = std::max(stats_.peakOutstanding, stats_.outstanding);
+    if (!bucket.idle.empty()) {
+      FrameBlock *block = bucket.idle.back();
+      bucket.idle.pop_back();
+      block->size = size;
+      stats_.reuses++;
+      stats_.pooledBlocks--;
+      stats_.pooledBytes -= capacity;
+      return block;
+    }
+    stats_.allocations++;
+  }
+  // Allocate outside the lock; large frames take a while to map.
+  FrameBlock *block = Allocate(capacity);
+  if (block == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buckets_[capacity].inUse--;
+    stats_.allocations--;
+    stats_.outstanding--;
+    return nullptr;
+  }
+  block->size = size;
+  return block;
+}
+
+void FramePool::Release(FrameBlock *block) {
+  if (block != nullptr) {
+    block->pool->Put(block);
+  }
+}
+
+void FramePool::Put(FrameBlock *block) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.outstanding--;
+    Bucket &bucket = buckets_[block->capacity];
+    bucket.inUse--;
+    if (retain_ || bucket.idle.size() < kMaxIdlePerBucket) {
+      bucket.idle.push_back(block);
+      stats_.pooledBlocks++;
+      stats_.pooledBytes += block->capacity;
+      return;
+    }
+  }
+  free(block->data);
+  delete block;
+}
+
+bool FramePool::Reserve(size_t size, size_t count) {
+  const size_t capacity = Capacity(size);
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const Bucket &bucket = buckets_[capacity];
+      if (bucket.idle.size() + bucket.inUse >= count) {
+        return true;
+      }
+    }
+    FrameBlock *block = Allocate(capacity);
+    if (block == nullptr) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    buckets_[capacity].idle.push_back(block);
+    stats_.preallocated++;
+    stats_.pooledBlocks++;
+    stats_.pooledBytes += capacity;
+  }
+}
+
+void FramePool::Retain(bool retain) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  retain_ = retain;
+}
+
+void FramePool::Trim() {
+  std::vector<FrameBlock *> freed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retain_ = false;
+    for (auto &entry : buckets_) {
+      Bucket &bucket = entry.second;
+      freed.insert(freed.end(), bucket.idle.begin(), bucket.idle.end());
+      bucket.idle.clear();
+      bucket.peak = bucket.inUse;
+    }
+    stats_.pooledBlocks = 0;
+    stats_.pooledBytes = 0;
+  }
+  for (FrameBlock *block : freed) {
+    free(block->data);
+    delete block;
+  }
+}
+
+std::vector<PoolDemand> FramePool::Demand() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<PoolDemand> demand;
+  for (const auto &entry : buckets_) {
+    if (entry.second.peak > 0) {
+      demand.push_back(PoolDemand{entry.first, entry.second.peak});
+    }
+  }
+  return demand;
+}
+
+FramePoolStats FramePool::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+FramePool &SharedFramePool() {
+  // Intentionally leaked: external Buffers may be finalized during
+  // environment teardown, after static destructors would have run.
+  static FramePool *pool = new FramePool();
+  return *pool;
+}
+
+FramePool &HandleFramePool(int handle) {
+  return GetHandlePool(handle).pool;
+}
+
+void PrepareFramePool(int handle, int imageType, int resolution, int width, int height) {
+  HandlePool &state = GetHandlePool(handle);
+  std::lock_guard<std::mutex> lock(state.mutex);
+  RememberDemand(state);
+  const std::pair<int, int> mode(imageType, resolution);
+  if (mode != state.mode) {
+    // The old mode's frames do not fit the new one; blocks still in JS are freed as they return.
+    state.pool.Trim();
+  }
+  state.mode = imageType != 0 ? mode : std::make_pair(0, 0);
+  state.reservedBytes = 0;
+  if (imageType == 0) {
+    return;
+  }
+  state.pool.Retain(true);
+  if (width > 0 && height > 0) {
+    const size_t size = static_cast<size_t>(width) * height;
+    state.pool.Reserve(size, kResultBlocks);
+    state.reservedBytes += kResultBlocks * size;
+  }
+  auto known = state.demand.find(mode);
+  if (known != state.demand.end()) {
+    for (const PoolDemand &use : known->second) {
+      state.pool.Reserve(use.capacity, use.blocks);
+      state.reservedBytes += use.blocks * use.capacity;
+    }
+  }
+}
+
+void ReserveActiveArea(int handle, int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  HandlePool &state = GetHandlePool(handle);
+  std::lock_guard<std::mutex> lock(state.mutex);
+  const size_t size = static_cast<size_t>(width) * height;
+  state.pool.Retain(state.mode.first != 0);
+  state.pool.Reserve(size, kResultBlocks);
+  state.reservedBytes += kResultBlocks * size;
+}
+
+void TrimFramePool(int handle) {
+  PrepareFramePool(handle, 0, 0, 0, 0);
+}
+
+void BeginCaptureMemory(int handle) {
+  HandlePool &state = GetHandlePool(handle);
+  const uint64_t rss = ResidentBytes();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.startAllocations = state.pool.Stats().allocations;
+  state.nextRssSample = NowNs() + kRssSampleNs;
+  state.capture.capturing = true;
+  state.capture.frames = 0;
+  state.capture.allocations = 0;
+  state.capture.peakRss = rss;
+}
+
+void SampleCaptureMemory(int handle) {
+  HandlePool &state = GetHandlePool(handle);
+  const uint64_t now = NowNs();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.capture.capturing) {
+      return;
+    }
+    state.capture.frames++;
+    if (now < state.nextRssSample) {
+      return;
+    }
+    state.nextRssSample = now + kRssSampleNs;
+  }
+  // Outside the lock, which the frame copies of other threads take.
+  const uint64_t rss = ResidentBytes();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.capture.peakRss = std::max(state.capture.peakRss, rss);
+}
+
+void EndCaptureMemory(int handle, bool completed) {
+  HandlePool &state = GetHandlePool(handle);
+  const uint64_t rss = completed ? ResidentBytes() : 0;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.capture.capturing) {
+    return;
+  }
+  state.capture.capturing = false;
+  if (!completed) {
+    return;
+  }
+  state.capture.allocations = state.pool.Stats().allocations - state.startAllocations;
+  state.capture.peakRss = std::max(state.capture.peakRss, rss);
+  state.capture.captures++;
+  state.capture.steadyCaptures += state.capture.allocations == 0 ? 1 : 0;
+}
+
+HandlePoolStats GetHandlePoolStats(int handle) {
+  HandlePool &state = GetHandlePool(handle);
+  std::lock_guard<std::mutex> lock(state.mutex);
+  HandlePoolStats stats;
+  stats.pool = state.pool.Stats();
+  stats.capture = state.capture;
+  stats.imageType = state.mode.first;
+  stats.resolution = state.mode.second;
+  stats.reservedBytes = state.reservedBytes;
+  return stats;
+}
+
+uint64_t ResidentBytes() {
+#ifdef _WIN32
+  // The kernel32 export (Windows 7 and later), so no psapi.lib is needed.
+  PROCESS_MEMORY_COUNTERS counters;
+  if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return counters.WorkingSetSize;
+  }
+  return 0;
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) ==
+      KERN_SUCCESS) {
+    return info.resident_size;
+  }
+  return 0;
+#else
+  // statm: total and resident pages, first two fields.
+  int fd = open("/proc/self/statm", O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  char text[128];
+  ssize_t length = read(fd, text, sizeof(text) - 1);
+  close(fd);
+  if (length <= 0) {
+    return 0;
+  }
+  text[length] = '\0';
+  char *end = nullptr;
+  strtoull(text, &end, 10);  // Total pages
+  return strtoull(end, nullptr, 10) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+}  // namespace lse
@@ -0,0 +1,165 @@
+/// Pool of pixel buffers shared between SDK threads and JS.
+///
+/// Image callbacks copy the SDK's frame (valid only during the callback) into a
+/// pooled block once; the block is then handed to JS as the backing store of an
+/// external Buffer and returns to the pool from the Buffer's finalizer. Frames
+/// therefore cross into JS without a second copy and without growing the V8 heap.
+///
+/// Each device handle has a pool of its own for the frames of its callbacks,
+/// sized by its capture mode: PrepareFramePool(), from LSCAN_Capture_SetMode()
+/// and LSCAN_Capture_SetActiveArea(), preallocates blocks for the result image
+/// and for whatever else the mode needed before (preview frames, typically),
+/// and keeps every block it hands out until the mode changes. Once a mode has
+/// been captured in, its captures therefore allocate nothing. Switching modes
+/// frees the old mode's idle blocks; LSCAN_TYPE_NONE and LSCAN_Main_Release()
+/// leave the pool empty. Per capture, the pool counts the blocks it had to
+/// allocate and samples the process's resident set size.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lse {
+
+class FramePool;
+
+/// One pooled allocation. @e size is the used length, @e capacity the allocation.
+struct FrameBlock {
+  uint8_t *data = nullptr;
+  size_t size = 0;
+  size_t capacity = 0;
+  FramePool *pool = nullptr;
+};
+
+struct FramePoolStats {
+  uint64_t allocations = 0;   ///< Blocks obtained from the system allocator by Acquire()
+  uint64_t reuses = 0;        ///< Acquire() calls served from the free lists
+  uint64_t preallocated = 0;  ///< Blocks allocated ahead of use by Reserve()
+  uint64_t outstanding = 0;   ///< Blocks currently held by callers or JS
+  uint64_t peakOutstanding = 0;
+  uint64_t pooledBlocks = 0;  ///< Idle blocks kept for reuse
+  uint64_t pooledBytes = 0;
+};
+
+/// Blocks of one capacity that were in use at the same time.
+struct PoolDemand {
+  size_t capacity = 0;
+  size_t blocks = 0;
+};
+
+class FramePool {
+ public:
+  /// Block capacities are rounded up to this granularity so that frames of
+  /// slightly different size (e.g. auto-clipped result images) share a bucket.
+  static constexpr size_t kGranularity = 64 * 1024;
+  /// Idle blocks kept per bucket; more are freed on release.
+  static constexpr size_t kMaxIdlePerBucket = 8;
+
+  FramePool() = default;
+  ~FramePool();
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  /// Block with capacity >= @p size and size set to @p size, or nullptr if out of
+  /// memory. Callable from any thread.
+  FrameBlock *Acquire(size_t size);
+
+  /// Return @p block to its pool. Callable from any thread.
+  static void Release(FrameBlock *block);
+
+  /// Allocate idle blocks until blocks for @p size, idle and in use, number
+  /// at least @p count. Returns false if out of memory.
+  bool Reserve(size_t size, size_t count);
+
+  /// Keep every released block rather than kMaxIdlePerBucket per capacity.
+  void Retain(bool retain);
+
+  /// Free all idle blocks, stop retaining and restart Demand().
+  void Trim();
+
+  /// Per capacity, the most blocks in use at once since the last Trim().
+  std::vector<PoolDemand> Demand();
+
+  FramePoolStats Stats();
+
+ private:
+  struct Bucket {
+    std::vector<FrameBlock *> idle;
+    size_t inUse = 0;
+    size_t peak = 0;  // Most blocks in use at once since the last Trim()
+  };
+
+  static size_t Capacity(size_t size);
+  FrameBlock *Allocate(size_t capacity);
+  void Put(FrameBlock *block);
+
+  std::mutex mutex_;
+  std::map<size_t, Bucket> buckets_;
+  bool retain_ = false;
+  FramePoolStats stats_;
+};
+
+/// Deleter so blocks can be held in std::unique_ptr until handed to JS.
+struct FrameBlockRelease {
+  void operator()(FrameBlock *block) const { FramePool::Release(block); }
+};
+using FrameBlockPtr = std::unique_ptr<FrameBlock, FrameBlockRelease>;
+
+/// Process-wide pool for images not tied to a handle: transforms, encoded
+/// files, quality maps and composited frames.
+FramePool &SharedFramePool();
+
+/// Pool of the image callbacks of @p handle; created on first use and never
+/// destroyed, since its blocks may outlive the handle in JS.
+FramePool &HandleFramePool(int handle);
+
+/// The capture mode of @p handle changed to @p imageType (an LScanImageType;
+/// 0, LSCAN_TYPE_NONE, empties the pool) at @p resolution, with result images
+/// of @p width x @p height (0 if not known). Remembers what the previous mode
+/// needed, frees its idle blocks and preallocates for the new one. Any thread.
+void PrepareFramePool(int handle, int imageType, int resolution, int width, int height);
+
+/// LSCAN_Capture_SetActiveArea(): result images of @p handle are now at most
+/// @p width x @p height; preallocate for them.
+void ReserveActiveArea(int handle, int width, int height);
+
+/// Empty the pool of @p handle, e.g. on LSCAN_Main_Release().
+void TrimFramePool(int handle);
+
+struct CaptureMemory {
+  uint64_t captures = 0;        ///< Captures measured, from LSCAN_Capture_Start() to the result or abort
+  uint64_t steadyCaptures = 0;  ///< Captures that allocated no block
+  uint64_t frames = 0;          ///< Frames copied during the last capture
+  uint64_t allocations = 0;     ///< Blocks the last capture allocated
+  uint64_t peakRss = 0;         ///< Highest resident set size sampled during the last capture, bytes
+                                ///< (at its start and end, and at most every 50 ms in between)
+  bool capturing = false;
+};
+
+/// Capture accounting of @p handle's pool: a capture starts, copies frames
+/// (counting them, and sampling the resident set size now and then) and ends
+/// with its result image or abort; a capture that failed to start ends with
+/// @p completed false and is not counted.
+void BeginCaptureMemory(int handle);
+void SampleCaptureMemory(int handle);
+void EndCaptureMemory(int handle, bool completed = true);
+
+struct HandlePoolStats {
+  FramePoolStats pool;
+  CaptureMemory capture;
+  int imageType = 0;
+  int resolution = 0;
+  size_t reservedBytes = 0;  ///< Capacity preallocated by the last PrepareFramePool() or ReserveActiveArea()
+};
+
+HandlePoolStats GetHandlePoolStats(int handle);
+
+/// Resident set size of the process in bytes; 0 where it cannot be read.
+uint64_t ResidentBytes();
+
+}  // namespace lse
@@ -0,0 +1,147 @@
+#include "image_encoder.h"
+
+#include "clock.h"
+#include "dispatcher.h"
+#include "napi_util.h"
+#include "task_pool.h"
+
+#include <cstring>
+#include <map>
+
+namespace lse {
+
+namespace {
+
+std::mutex g_options_mutex;
+std::map<int, EncodingOptions> g_options;
+
+struct AtomicEncoderStats {
+  std::atomic<uint64_t> jobs{0};
+  std::atomic<uint64_t> failed{0};
+  std::atomic<uint64_t> bytesIn{0};
+  std::atomic<uint64_t> bytesOut{0};
+  std::atomic<uint64_t> encodeNs{0};
+  std::atomic<uint64_t> pending{0};
+} g_stats;
+
+}  // namespace
+
+std::shared_ptr<EncodeJob> EncodeJob::Start(const ImageFrame &image, const uint8_t *pixels, size_t size,
+                                            const EncodingOptions &options) {
+  std::shared_ptr<EncodeJob> job(new EncodeJob());
+  job->source_.width = image.width;
+  job->source_.height = image.height;
+  job->source_.resolution = image.resolution;
+  job->source_.bitsPerPixel = image.bitsPerPixel;
+  job->options_ = options;
+
+  FrameBlock *copy = pixels != nullptr ? SharedFramePool().Acquire(size) : nullptr;
+  if (copy != nullptr) {
+    memcpy(copy->data, pixels, size);
+  }
+  g_stats.pending++;
+  // std::function needs a copyable callable, so the block travels as a raw pointer.
+  SharedTaskPool().Post([job, copy] { job->Run(FrameBlockPtr(copy)); });
+  return job;
+}
+
+void EncodeJob::Run(FrameBlockPtr pixels) {
+  FrameBlockPtr output;
+  const size_t size = static_cast<size_t>(source_.width) * source_.height;
+  if (pixels && source_.bitsPerPixel == 8 && pixels->size >= size && options_.format != ImageEncoding::kNone) {
+    uint64_t start = NowNs();
+    if (options_.format == ImageEncoding::kPng) {
+      output = EncodePng(pixels->data, source_.width, source_.height, source_.resolution, options_.png);
+    } else {
+      output = EncodeJpeg(pixels->data, source_.width, source_.height, 1, options_.jpeg);
+    }
+    g_stats.encodeNs += NowNs() - start;
+  }
+  pixels.reset();
+  if (output) {
+    g_stats.jobs++;
+    g_stats.bytesIn += size;
+    g_stats.bytesOut += output->size;
+  } else {
+    g_stats.failed++;
+  }
+  g_stats.pending--;
+
+  napi_deferred deferred = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+    deferred = deferred_;
+    deferred_ = nullptr;
+    if (deferred == nullptr) {
+      output_ = std::move(output);
+      return;
+    }
+  }
+  FrameBlock *block = output.release();
+  SharedDispatcher().PostCompletion([deferred, block](napi_env env) {
+    SharedDispatcher().RemoveListener();
+    Settle(env, deferred, FrameBlockPtr(block));
+  });
+}
+
+napi_value EncodeJob::Promise(napi_env env) {
+  napi_deferred deferred = nullptr;
+  napi_value promise = nullptr;
+  NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+  FrameBlockPtr output;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!done_) {
+      deferred_ = deferred;
+      // Keep the event loop alive until the worker settles the promise.
+      SharedDispatcher().AddListener();
+      return promise;
+    }
+    output = std::move(output_);
+  }
+  Settle(env, deferred, std::move(output));
+  return promise;
+}
+
+void EncodeJob::Settle(napi_env env, napi_deferred deferred, FrameBlockPtr output) {
+  if (output) {
+    napi_resolve_deferred(env, deferred, BlockToJs(env, std::move(output)));
+    return;
+  }
+  napi_value code = nullptr;
+  napi_value message = nullptr;
+  napi_value error = nullptr;
+  napi_create_string_utf8(env, "ERR_LSE_ENCODE", NAPI_AUTO_LENGTH, &code);
+  napi_create_string_utf8(env, "Image encoding failed", NAPI_AUTO_LENGTH, &message);
+  napi_create_error(env, code, message, &error);
+  napi_reject_deferred(env, deferred, error);
+}
+
+void SetResultEncoding(int handle, const EncodingOptions &options) {
+  std::lock_guard<std::mutex> lock(g_options_mutex);
+  if (options.format == ImageEncoding::kNone) {
+    g_options.erase(handle);
+  } else {
+    g_options[handle] = options;
+  }
+}
+
+EncodingOptions ResultEncoding(int handle) {
+  std::lock_guard<std::mutex> lock(g_options_mutex);
+  auto found = g_options.find(handle);
+  return found != g_options.end() ? found->second : EncodingOptions();
+}
+
+EncoderStats GetEncoderStats() {
+  EncoderStats stats;
+  stats.jobs = g_stats.jobs.load();
+  stats.failed = g_stats.failed.load();
+  stats.bytesIn = g_stats.bytesIn.load();
+  stats.bytesOut = g_stats.bytesOut.load();
+  stats.encodeNs = g_stats.encodeNs.load();
+  stats.pending = g_stats.pending.load();
+  return stats;
+}
+
+}  // namespace lse
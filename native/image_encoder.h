@@ -0,0 +1,76 @@
+/// Background encoding of images on the TaskPool.
+///
+/// With setResultImageEncoding(handle, ...) configured, the result image
+/// callback copies the frame once more and starts an encode job right on the
+/// SDK thread, so encoding overlaps both the delivery to JS and the next
+/// capture. JS sees the job as the `encoded` promise of the result image; jobs
+/// settle through the dispatcher like every other completion.
+
+#pragma once
+
+#include "callbacks.h"
+#include "jpeg_encoder.h"
+#include "png_encoder.h"
+
+#include <node_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace lse {
+
+enum class ImageEncoding : int {
+  kNone,
+  kPng,
+  kJpeg,
+};
+
+struct EncodingOptions {
+  ImageEncoding format = ImageEncoding::kNone;
+  PngOptions png;
+  JpegOptions jpeg;
+};
+
+struct EncoderStats {
+  uint64_t jobs = 0;       ///< Finished encodes
+  uint64_t failed = 0;
+  uint64_t bytesIn = 0;    ///< Raw pixel bytes encoded
+  uint64_t bytesOut = 0;   ///< Encoded bytes produced
+  uint64_t encodeNs = 0;   ///< Wall time spent in the encoder, summed over workers
+  uint64_t pending = 0;    ///< Jobs queued or running
+};
+
+/// One encode in flight. Either side may come first: the worker finishing, or
+/// the JS thread asking for the promise.
+class EncodeJob {
+ public:
+  /// Start encoding the @p size bytes at @p pixels, with the geometry of
+  /// @p image, on the TaskPool. The pixels are copied, so the caller's frame may
+  /// go to JS (and be modified there) right away.
+  static std::shared_ptr<EncodeJob> Start(const ImageFrame &image, const uint8_t *pixels, size_t size,
+                                          const EncodingOptions &options);
+
+  /// JS thread. Promise for the encoded Buffer; call at most once.
+  napi_value Promise(napi_env env);
+
+ private:
+  void Run(FrameBlockPtr pixels);
+  static void Settle(napi_env env, napi_deferred deferred, FrameBlockPtr output);
+
+  ImageFrame source_;  // geometry only; pixels move into Run()
+  EncodingOptions options_;
+  std::mutex mutex_;
+  bool done_ = false;                // guarded by mutex_
+  FrameBlockPtr output_;             // guarded by mutex_; null on failure
+  napi_deferred deferred_ = nullptr; // guarded by mutex_
+};
+
+/// Encoding applied to result images of @p handle.
+void SetResultEncoding(int handle, const EncodingOptions &options);
+EncodingOptions ResultEncoding(int handle);
+
+EncoderStats GetEncoderStats();
+
+}  // namespace lse
@@ -0,0 +1,1143 @@
+#include "image_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define LSE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC compiles intrinsics for any target; the dispatch decides what runs.
+#define LSE_TARGET(isa)
+#else
+#define LSE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define LSE_X86 0
+#endif
+
+namespace lse {
+
+namespace {
+
+SimdLevel Detect() {
+#if LSE_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  int maxLeaf = info[0];
+  __cpuid(info, 1);
+  bool sse41 = (info[2] & (1 << 19)) != 0;
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  bool avx2 = false;
+  // AVX2 also needs the OS to save the YMM registers (XCR0 bits 1 and 2).
+  if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  bool sse41 = __builtin_cpu_supports("sse4.1");
+  bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+  if (avx2) {
+    return SimdLevel::kAvx2;
+  }
+  if (sse41) {
+    return SimdLevel::kSse41;
+  }
+#endif
+  return SimdLevel::kScalar;
+}
+
+std::atomic<int> g_level{-1};
+
+SimdLevel Level() {
+  int level = g_level.load(std::memory_order_relaxed);
+  if (level < 0) {
+    level = static_cast<int>(DetectedSimdLevel());
+    g_level.store(level, std::memory_order_relaxed);
+  }
+  return static_cast<SimdLevel>(level);
+}
+
+// Scalar kernels; also used for the columns the vector loops leave over.
+
+void SwapRowsScalar(uint8_t *a, uint8_t *b, int from, int width) {
+  for (int x = from; x < width; x++) {
+    uint8_t t = a[x];
+    a[x] = b[x];
+    b[x] = t;
+  }
+}
+
+void DownscaleRowScalar(const uint8_t *row, int width, int factor, int from, int to, uint8_t *out) {
+  const int area = factor * factor;
+  for (int ox = from; ox < to; ox++) {
+    int sum = 0;
+    for (int dy = 0; dy < factor; dy++) {
+      const uint8_t *block = row + static_cast<size_t>(dy) * width + ox * factor;
+      for (int dx = 0; dx < factor; dx++) {
+        sum += block[dx];
+      }
+    }
+    out[ox] = static_cast<uint8_t>((sum + area / 2) / area);
+  }
+}
+
+void BlendRowsScalar(const uint8_t *a, const uint8_t *b, int weight, int from, int width, uint8_t *out) {
+  const int inverse = 256 - weight;
+  for (int x = from; x < width; x++) {
+    out[x] = static_cast<uint8_t>((a[x] * inverse + b[x] * weight + 128) >> 8);
+  }
+}
+
+void InterpolateRowScalar(const uint8_t *row, const int *lefts, const int *weights, int from, int count,
+                          uint8_t *out) {
+  for (int x = from; x < count; x++) {
+    int w = weights[x];
+    int right = w != 0 ? row[lefts[x] + 1] : 0;
+    out[x] = static_cast<uint8_t>((row[lefts[x]] * (256 - w) + right * w + 128) >> 8);
+  }
+}
+
+void GrayToRgbaScalar(const uint8_t *gray, size_t from, size_t count, uint8_t *rgba) {
+  for (size_t i = from; i < count; i++) {
+    rgba[4 * i] = gray[i];
+    rgba[4 * i + 1] = gray[i];
+    rgba[4 * i + 2] = gray[i];
+    rgba[4 * i + 3] = 255;
+  }
+}
+
+// (p * (255 - alpha) + c * alpha) / 255, rounded: t + (t >> 8) >> 8 divides the
+// rounded 16-bit sum by 255 exactly.
+void BlendBytesScalar(uint8_t *pixels, size_t from, size_t bytes, int channels, const uint8_t *color, int alpha) {
+  const int inverse = 255 - alpha;
+  for (size_t i = from; i < bytes; i++) {
+    int t = pixels[i] * inverse + color[i % channels] * alpha + 128;
+    pixels[i] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+  }
+}
+
+// AAN forward DCT of d[0..7] in place (the float factorization of IJG's
+// jfdctflt.c), written once for float, __m128 and __m256 lanes. Outputs are
+// scaled by kAanScale[u] * 8 per dimension; ForwardDct() callers fold that into
+// their scales. Every level runs the same operations in the same order, so the
+// coefficients match bit for bit.
+#define LSE_FDCT8(V, ADD, SUB, MUL, K, d)            \
+  do {                                               \
+    V t0 = ADD(d[0], d[7]), t7 = SUB(d[0], d[7]);    \
+    V t1 = ADD(d[1], d[6]), t6 = SUB(d[1], d[6]);    \
+    V t2 = ADD(d[2], d[5]), t5 = SUB(d[2], d[5]);    \
+    V t3 = ADD(d[3], d[4]), t4 = SUB(d[3], d[4]);    \
+    V t10 = ADD(t0, t3), t13 = SUB(t0, t3);          \
+    V t11 = ADD(t1, t2), t12 = SUB(t1, t2);          \
+    d[0] = ADD(t10, t11);                            \
+    d[4] = SUB(t10, t11);                            \
+    V z1 = MUL(ADD(t12, t13), K(0.707106781f));      \
+    d[2] = ADD(t13, z1);                             \
+    d[6] = SUB(t13, z1);                             \
+    t10 = ADD(t4, t5);                               \
+    t11 = ADD(t5, t6);                               \
+    t12 = ADD(t6, t7);                               \
+    V z5 = MUL(SUB(t10, t12), K(0.382683433f));      \
+    V z2 = ADD(MUL(t10, K(0.541196100f)), z5);       \
+    V z4 = ADD(MUL(t12, K(1.306562965f)), z5);       \
+    V z3 = MUL(t11, K(0.707106781f));                \
+    V z11 = ADD(t7, z3), z13 = SUB(t7, z3);          \
+    d[5] = ADD(z13, z2);                             \
+    d[3] = SUB(z13, z2);                             \
+    d[1] = ADD(z11, z4);                             \
+    d[7] = SUB(z11, z4);                             \
+  } while (0)
+
+inline float AddScalar(float a, float b) { return a + b; }
+inline float SubScalar(float a, float b) { return a - b; }
+inline float MulScalar(float a, float b) { return a * b; }
+inline float ConstScalar(float k) { return k; }
+
+// Columns first, then rows, like the vector variants (which transform all eight
+// columns at once with one vector per row).
+void ForwardDctScalar(const uint8_t *pixels, size_t stride, const float *scales, int16_t *coefficients) {
+  float block[64];
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) {
+      block[y * 8 + x] = static_cast<float>(pixels[y * stride + x]) - 128.0f;
+    }
+  }
+  float d[8];
+  for (int x = 0; x < 8; x++) {
+    for (int i = 0; i < 8; i++) {
+      d[i] = block[i * 8 + x];
+    }
+    LSE_FDCT8(float, AddScalar, SubScalar, MulScalar, ConstScalar, d);
+    for (int i = 0; i < 8; i++) {
+      block[i * 8 + x] = d[i];
+    }
+  }
+  for (int y = 0; y < 8; y++) {
+    LSE_FDCT8(float, AddScalar, SubScalar, MulScalar, ConstScalar, (block + y * 8));
+  }
+  for (int i = 0; i < 64; i++) {
+    // nearbyint rounds ties to even, as cvtps2dq does.
+    float q = std::nearbyint(block[i] * scales[i]);
+    coefficients[i] = static_cast<int16_t>(std::min(std::max(q, -32768.0f), 32767.0f));
+  }
+}
+
+// Block moments. Gradient sums are exact in 32 bits: 256 products of at most
+// 255 * 255 each.
+
+const uint8_t *ClampedRow(const uint8_t *pixels, int width, int height, int y) {
+  return pixels + static_cast<size_t>(std::min(std::max(y, 0), height - 1)) * width;
+}
+
+// Pixels above the block mean: p > sum / 256, that is p >= (sum >> 8) + 1.
+void BrightScalar(const uint8_t *pixels, int width, int x0, int y0, BlockMoments *m) {
+  const int threshold = (m->sum >> 8) + 1;
+  for (int y = y0; y < y0 + kMomentBlock; y++) {
+    const uint8_t *row = pixels + static_cast<size_t>(y) * width + x0;
+    for (int x = 0; x < kMomentBlock; x++) {
+      if (row[x] >= threshold) {
+        m->brightSum += row[x];
+        m->brightCount++;
+      }
+    }
+  }
+}
+
+void MomentsScalar(const uint8_t *pixels, int width, int height, int x0, int y0, BlockMoments *m) {
+  *m = BlockMoments();
+  for (int y = y0; y < y0 + kMomentBlock; y++) {
+    const uint8_t *row = pixels + static_cast<size_t>(y) * width;
+    const uint8_t *up = ClampedRow(pixels, width, height, y - 1);
+    const uint8_t *down = ClampedRow(pixels, width, height, y + 1);
+    for (int x = x0; x < x0 + kMomentBlock; x++) {
+      int p = row[x];
+      int gx = row[std::min(x + 1, width - 1)] - row[std::max(x - 1, 0)];
+      int gy = down[x] - up[x];
+      m->sum += p;
+      m->squares += p * p;
+      m->gxx += gx * gx;
+      m->gyy += gy * gy;
+      m->gxy += gx * gy;
+    }
+  }
+  BrightScalar(pixels, width, x0, y0, m);
+}
+
+#if LSE_X86
+
+LSE_TARGET("sse4.1") void FlipSse41(uint8_t *pixels, int width, int height) {
+  for (int y = 0; y < height / 2; y++) {
+    uint8_t *a = pixels + static_cast<size_t>(y) * width;
+    uint8_t *b = pixels + static_cast<size_t>(height - 1 - y) * width;
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+      __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x));
+      __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(a + x), vb);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(b + x), va);
+    }
+    SwapRowsScalar(a, b, x, width);
+  }
+}
+
+LSE_TARGET("avx2") void FlipAvx2(uint8_t *pixels, int width, int height) {
+  for (int y = 0; y < height / 2; y++) {
+    uint8_t *a = pixels + static_cast<size_t>(y) * width;
+    uint8_t *b = pixels + static_cast<size_t>(height - 1 - y) * width;
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + x));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(a + x), vb);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(b + x), va);
+    }
+    SwapRowsScalar(a, b, x, width);
+  }
+}
+
+// 2:1 — pmaddubsw against ones adds horizontal pixel pairs into 16-bit lanes;
+// adding the two rows' pairs gives the 2x2 block sums.
+
+LSE_TARGET("sse4.1") __m128i PairSums2Sse41(const uint8_t *r0, const uint8_t *r1) {
+  const __m128i ones = _mm_set1_epi8(1);
+  __m128i a = _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(r0)), ones);
+  __m128i b = _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(r1)), ones);
+  return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a, b), _mm_set1_epi16(2)), 2);
+}
+
+LSE_TARGET("sse4.1") void Downscale2Sse41(const uint8_t *source, int width, int height, uint8_t *target) {
+  const int outWidth = width / 2;
+  for (int oy = 0; oy < height / 2; oy++) {
+    const uint8_t *r0 = source + static_cast<size_t>(oy) * 2 * width;
+    const uint8_t *r1 = r0 + width;
+    uint8_t *out = target + static_cast<size_t>(oy) * outWidth;
+    int ox = 0;
+    for (; ox + 16 <= outWidth; ox += 16) {
+      __m128i lo = PairSums2Sse41(r0 + 2 * ox, r1 + 2 * ox);
+      __m128i hi = PairSums2Sse41(r0 + 2 * ox + 16, r1 + 2 * ox + 16);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + ox), _mm_packus_epi16(lo, hi));
+    }
+    DownscaleRowScalar(r0, width, 2, ox, outWidth, out);
+  }
+}
+
+LSE_TARGET("avx2") __m256i PairSums2Avx2(const uint8_t *r0, const uint8_t *r1) {
+  const __m256i ones = _mm256_set1_epi8(1);
+  __m256i a = _mm256_maddubs_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(r0)), ones);
+  __m256i b = _mm256_maddubs_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(r1)), ones);
+  return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a, b), _mm256_set1_epi16(2)), 2);
+}
+
+LSE_TARGET("avx2") void Downscale2Avx2(const uint8_t *source, int width, int height, uint8_t *target) {
+  const int outWidth = width / 2;
+  for (int oy = 0; oy < height / 2; oy++) {
+    const uint8_t *r0 = source + static_cast<size_t>(oy) * 2 * width;
+    const uint8_t *r1 = r0 + width;
+    uint8_t *out = target + static_cast<size_t>(oy) * outWidth;
+    int ox = 0;
+    for (; ox + 32 <= outWidth; ox += 32) {
+      __m256i lo = PairSums2Avx2(r0 + 2 * ox, r1 + 2 * ox);
+      __m256i hi = PairSums2Avx2(r0 + 2 * ox + 32, r1 + 2 * ox + 32);
+      // packus works per 128-bit lane; restore the order of the 64-bit quarters.
+      __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + ox), packed);
+    }
+    DownscaleRowScalar(r0, width, 2, ox, outWidth, out);
+  }
+}
+
+// 4:1 — pair sums of four rows, then pmaddwd against ones adds neighbouring
+// pairs into the 32-bit 4x4 block sums (at most 16 * 255).
+
+LSE_TARGET("sse4.1") __m128i BlockSums4Sse41(const uint8_t *row, int width) {
+  const __m128i ones8 = _mm_set1_epi8(1);
+  __m128i sum = _mm_setzero_si128();
+  for (int dy = 0; dy < 4; dy++) {
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + static_cast<size_t>(dy) * width));
+    sum = _mm_add_epi16(sum, _mm_maddubs_epi16(pixels, ones8));
+  }
+  return _mm_madd_epi16(sum, _mm_set1_epi16(1));
+}
+
+LSE_TARGET("sse4.1") void Downscale4Sse41(const uint8_t *source, int width, int height, uint8_t *target) {
+  const int outWidth = width / 4;
+  const __m128i rounding = _mm_set1_epi16(8);
+  for (int oy = 0; oy < height / 4; oy++) {
+    const uint8_t *row = source + static_cast<size_t>(oy) * 4 * width;
+    uint8_t *out = target + static_cast<size_t>(oy) * outWidth;
+    int ox = 0;
+    for (; ox + 16 <= outWidth; ox += 16) {
+      const uint8_t *block = row + 4 * ox;
+      __m128i s01 = _mm_packus_epi32(BlockSums4Sse41(block, width), BlockSums4Sse41(block + 16, width));
+      __m128i s23 = _mm_packus_epi32(BlockSums4Sse41(block + 32, width), BlockSums4Sse41(block + 48, width));
+      s01 = _mm_srli_epi16(_mm_add_epi16(s01, rounding), 4);
+      s23 = _mm_srli_epi16(_mm_add_epi16(s23, rounding), 4);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + ox), _mm_packus_epi16(s01, s23));
+    }
+    DownscaleRowScalar(row, width, 4, ox, outWidth, out);
+  }
+}
+
+LSE_TARGET("avx2") __m256i BlockSums4Avx2(const uint8_t *row, int width) {
+  const __m256i ones8 = _mm256_set1_epi8(1);
+  __m256i sum = _mm256_setzero_si256();
+  for (int dy = 0; dy < 4; dy++) {
+    __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + static_cast<size_t>(dy) * width));
+    sum = _mm256_add_epi16(sum, _mm256_maddubs_epi16(pixels, ones8));
+  }
+  return _mm256_madd_epi16(sum, _mm256_set1_epi16(1));
+}
+
+LSE_TARGET("avx2") void Downscale4Avx2(const uint8_t *source, int width, int height, uint8_t *target) {
+  const int outWidth = width / 4;
+  const __m256i rounding = _mm256_set1_epi16(8);
+  // After the two per-lane packs, 4-pixel groups sit in the order 0 2 4 6 | 1 3 5 7.
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  for (int oy = 0; oy < height / 4; oy++) {
+    const uint8_t *row = source + static_cast<size_t>(oy) * 4 * width;
+    uint8_t *out = target + static_cast<size_t>(oy) * outWidth;
+    int ox = 0;
+    for (; ox + 32 <= outWidth; ox += 32) {
+      const uint8_t *block = row + 4 * ox;
+      __m256i s01 = _mm256_packus_epi32(BlockSums4Avx2(block, width), BlockSums4Avx2(block + 32, width));
+      __m256i s23 = _mm256_packus_epi32(BlockSums4Avx2(block + 64, width), BlockSums4Avx2(block + 96, width));
+      s01 = _mm256_srli_epi16(_mm256_add_epi16(s01, rounding), 4);
+      s23 = _mm256_srli_epi16(_mm256_add_epi16(s23, rounding), 4);
+      __m256i packed = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(s01, s23), order);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + ox), packed);
+    }
+    DownscaleRowScalar(row, width, 4, ox, outWidth, out);
+  }
+}
+
+// Resize: the vertical bilinear pass blends two source rows in 16-bit lanes;
+// a * (256 - w) + b * w + 128 stays below 65536.
+
+LSE_TARGET("sse4.1") void BlendRowsSse41(const uint8_t *a, const uint8_t *b, int weight, int width, uint8_t *out) {
+  const __m128i wa = _mm_set1_epi16(static_cast<int16_t>(256 - weight));
+  const __m128i wb = _mm_set1_epi16(static_cast<int16_t>(weight));
+  const __m128i rounding = _mm_set1_epi16(128);
+  const __m128i zero = _mm_setzero_si128();
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x));
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, rounding), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, rounding), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(lo, hi));
+  }
+  BlendRowsScalar(a, b, weight, x, width, out);
+}
+
+LSE_TARGET("avx2") void BlendRowsAvx2(const uint8_t *a, const uint8_t *b, int weight, int width, uint8_t *out) {
+  const __m256i wa = _mm256_set1_epi16(static_cast<int16_t>(256 - weight));
+  const __m256i wb = _mm256_set1_epi16(static_cast<int16_t>(weight));
+  const __m256i rounding = _mm256_set1_epi16(128);
+  const __m256i zero = _mm256_setzero_si256();
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + x));
+    // unpack and packus both work per 128-bit lane, so the order survives.
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), wa),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), wb));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), wa),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), wb));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, rounding), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, rounding), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), _mm256_packus_epi16(lo, hi));
+  }
+  BlendRowsScalar(a, b, weight, x, width, out);
+}
+
+// Resize: the horizontal pass gathers one 32-bit word per target pixel, whose
+// low two bytes are the left and right source pixels. Only columns with three
+// readable bytes after the left pixel are gathered.
+
+LSE_TARGET("avx2") void InterpolateRowAvx2(const uint8_t *row, const int *lefts, const int *weights, int gathered,
+                                           int count, uint8_t *out) {
+  const __m256i low = _mm256_set1_epi32(0xff);
+  const __m256i rounding = _mm256_set1_epi32(128);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int x = 0;
+  for (; x + 8 <= gathered; x += 8) {
+    __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int *>(row),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lefts + x)), 1);
+    __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + x));
+    __m256i left = _mm256_and_si256(words, low);
+    __m256i right = _mm256_and_si256(_mm256_srli_epi32(words, 8), low);
+    // left * (256 - w) + right * w == left * 256 + (right - left) * w
+    __m256i value = _mm256_add_epi32(_mm256_slli_epi32(left, 8), _mm256_mullo_epi32(_mm256_sub_epi32(right, left), w));
+    value = _mm256_srli_epi32(_mm256_add_epi32(value, rounding), 8);
+    // Both packs work per lane: bytes 0-3 of each lane hold the lane's pixels.
+    __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(value, value), value);
+    packed = _mm256_permutevar8x32_epi32(packed, order);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x), _mm256_castsi256_si128(packed));
+  }
+  InterpolateRowScalar(row, lefts, weights, x, count, out);
+}
+
+// Gray to RGBA: pshufb replicates each gray byte into R, G and B and zeroes A,
+// which the OR then sets.
+
+LSE_TARGET("sse4.1") void GrayToRgbaSse41(const uint8_t *gray, size_t count, uint8_t *rgba) {
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+  const __m128i spread[4] = {
+      _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+      _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+      _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+      _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1),
+  };
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(gray + i));
+    for (int k = 0; k < 4; k++) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + 4 * i + 16 * k),
+                       _mm_or_si128(_mm_shuffle_epi8(g, spread[k]), alpha));
+    }
+  }
+  GrayToRgbaScalar(gray, i, count, rgba);
+}
+
+LSE_TARGET("avx2") void GrayToRgbaAvx2(const uint8_t *gray, size_t count, uint8_t *rgba) {
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+  // vpshufb indexes within each lane, so both lanes hold all 16 gray bytes.
+  const __m256i spread0 = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+                                           4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+  const __m256i spread1 = _mm256_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+                                           12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i g = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(gray + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + 4 * i),
+                        _mm256_or_si256(_mm256_shuffle_epi8(g, spread0), alpha));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + 4 * i + 32),
+                        _mm256_or_si256(_mm256_shuffle_epi8(g, spread1), alpha));
+  }
+  GrayToRgbaScalar(gray, i, count, rgba);
+}
+
+// Span blending: 16-bit lanes as in BlendBytesScalar(). The colour repeats every
+// channels (1 or 4) bytes, so one 8-byte pattern serves both unpacked halves.
+
+LSE_TARGET("sse4.1") void BlendBytesSse41(uint8_t *pixels, size_t bytes, int channels, const uint8_t *color,
+                                          int alpha) {
+  uint8_t pattern[8];
+  for (int i = 0; i < 8; i++) {
+    pattern[i] = color[i % channels];
+  }
+  const __m128i base = _mm_add_epi16(
+      _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pattern))),
+                      _mm_set1_epi16(static_cast<int16_t>(alpha))),
+      _mm_set1_epi16(128));
+  const __m128i inverse = _mm_set1_epi16(static_cast<int16_t>(255 - alpha));
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), inverse), base);
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), inverse), base);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), _mm_packus_epi16(lo, hi));
+  }
+  BlendBytesScalar(pixels, i, bytes, channels, color, alpha);
+}
+
+LSE_TARGET("avx2") void BlendBytesAvx2(uint8_t *pixels, size_t bytes, int channels, const uint8_t *color,
+                                       int alpha) {
+  uint8_t pattern[16];
+  for (int i = 0; i < 16; i++) {
+    pattern[i] = color[i % channels];
+  }
+  const __m256i base = _mm256_add_epi16(
+      _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern))),
+                         _mm256_set1_epi16(static_cast<int16_t>(alpha))),
+      _mm256_set1_epi16(128));
+  const __m256i inverse = _mm256_set1_epi16(static_cast<int16_t>(255 - alpha));
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(p, zero), inverse), base);
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(p, zero), inverse), base);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i), _mm256_packus_epi16(lo, hi));
+  }
+  BlendBytesScalar(pixels, i, bytes, channels, color, alpha);
+}
+
+// Forward DCT: one vector per row transforms all columns at once; a transpose
+// turns the rows into columns for the second pass and another restores the
+// natural order before quantizing.
+
+LSE_TARGET("sse4.1") void ForwardDctSse41(const uint8_t *pixels, size_t stride, const float *scales,
+                                          int16_t *coefficients) {
+  // Left (columns 0-3) and right (4-7) halves of each row.
+  __m128 left[8];
+  __m128 right[8];
+  const __m128 bias = _mm_set1_ps(128.0f);
+  for (int y = 0; y < 8; y++) {
+    __m128i row = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixels + y * stride));
+    left[y] = _mm_sub_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(row)), bias);
+    right[y] = _mm_sub_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(row, 4))), bias);
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    LSE_FDCT8(__m128, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_set1_ps, left);
+    LSE_FDCT8(__m128, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_set1_ps, right);
+    // 8x8 transpose from 4x4 quadrants: the top right and bottom left swap.
+    _MM_TRANSPOSE4_PS(left[0], left[1], left[2], left[3]);
+    _MM_TRANSPOSE4_PS(right[0], right[1], right[2], right[3]);
+    _MM_TRANSPOSE4_PS(left[4], left[5], left[6], left[7]);
+    _MM_TRANSPOSE4_PS(right[4], right[5], right[6], right[7]);
+    for (int i = 0; i < 4; i++) {
+      std::swap(right[i], left[i + 4]);
+    }
+  }
+  for (int y = 0; y < 8; y++) {
+    __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(left[y], _mm_loadu_ps(scales + y * 8)));
+    __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(right[y], _mm_loadu_ps(scales + y * 8 + 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(coefficients + y * 8), _mm_packs_epi32(lo, hi));
+  }
+}
+
+LSE_TARGET("avx2") void Transpose8x8Avx2(__m256 *r) {
+  __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+  __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+  __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+  __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+  __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+  __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+  __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+  __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+  __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+  r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+  r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+  r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+  r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+  r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+  r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+  r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+  r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+LSE_TARGET("avx2") void ForwardDctAvx2(const uint8_t *pixels, size_t stride, const float *scales,
+                                       int16_t *coefficients) {
+  __m256 rows[8];
+  const __m256 bias = _mm256_set1_ps(128.0f);
+  for (int y = 0; y < 8; y++) {
+    __m128i row = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixels + y * stride));
+    rows[y] = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(row)), bias);
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    LSE_FDCT8(__m256, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_set1_ps, rows);
+    Transpose8x8Avx2(rows);
+  }
+  for (int y = 0; y < 8; y += 2) {
+    __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(rows[y], _mm256_loadu_ps(scales + y * 8)));
+    __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(rows[y + 1], _mm256_loadu_ps(scales + y * 8 + 8)));
+    // packs interleaves the 128-bit lanes of a and b; restore a0-7, b0-7.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(coefficients + y * 8), packed);
+  }
+}
+
+// Block moments: one 16-pixel block row per vector. Blocks whose left or right
+// neighbour column falls outside the image take the scalar path, which clamps.
+
+LSE_TARGET("sse4.1") int32_t SumEpi32Sse41(__m128i v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+// Block sums fit the low 32 bits of each 64-bit lane.
+LSE_TARGET("sse4.1") int32_t SumEpi64Sse41(__m128i v) {
+  return _mm_cvtsi128_si32(_mm_add_epi64(v, _mm_srli_si128(v, 8)));
+}
+
+LSE_TARGET("sse4.1") void BrightSse41(const uint8_t *pixels, int width, int x0, int y0, BlockMoments *m) {
+  const int threshold = (m->sum >> 8) + 1;
+  if (threshold > 255) {
+    return;
+  }
+  const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i sums = zero;
+  __m128i counts = zero;
+  for (int y = y0; y < y0 + kMomentBlock; y++) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + static_cast<size_t>(y) * width + x0));
+    __m128i bright = _mm_cmpeq_epi8(_mm_max_epu8(p, limit), p);
+    sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_and_si128(p, bright), zero));
+    counts = _mm_add_epi64(counts, _mm_sad_epu8(_mm_and_si128(one, bright), zero));
+  }
+  m->brightSum = SumEpi64Sse41(sums);
+  m->brightCount = SumEpi64Sse41(counts);
+}
+
+LSE_TARGET("sse4.1") void MomentsSse41(const uint8_t *pixels, int width, int height, int x0, int y0,
+                                       BlockMoments *m) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;
+  __m128i squares = zero;
+  __m128i gxx = zero;
+  __m128i gyy = zero;
+  __m128i gxy = zero;
+  for (int y = y0; y < y0 + kMomentBlock; y++) {
+    const uint8_t *row = pixels + static_cast<size_t>(y) * width + x0;
+    const uint8_t *up = ClampedRow(pixels, width, height, y - 1) + x0;
+    const uint8_t *down = ClampedRow(pixels, width, height, y + 1) + x0;
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row));
+    __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row - 1));
+    __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + 1));
+    __m128i above = _mm_loadu_si128(reinterpret_cast<const __m128i *>(up));
+    __m128i below = _mm_loadu_si128(reinterpret_cast<const __m128i *>(down));
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(p, zero));
+    __m128i pLo = _mm_cvtepu8_epi16(p);
+    __m128i pHi = _mm_unpackhi_epi8(p, zero);
+    __m128i gxLo = _mm_sub_epi16(_mm_cvtepu8_epi16(right), _mm_cvtepu8_epi16(left));
+    __m128i gxHi = _mm_sub_epi16(_mm_unpackhi_epi8(right, zero), _mm_unpackhi_epi8(left, zero));
+    __m128i gyLo = _mm_sub_epi16(_mm_cvtepu8_epi16(below), _mm_cvtepu8_epi16(above));
+    __m128i gyHi = _mm_sub_epi16(_mm_unpackhi_epi8(below, zero), _mm_unpackhi_epi8(above, zero));
+    squares = _mm_add_epi32(squares, _mm_add_epi32(_mm_madd_epi16(pLo, pLo), _mm_madd_epi16(pHi, pHi)));
+    gxx = _mm_add_epi32(gxx, _mm_add_epi32(_mm_madd_epi16(gxLo, gxLo), _mm_madd_epi16(gxHi, gxHi)));
+    gyy = _mm_add_epi32(gyy, _mm_add_epi32(_mm_madd_epi16(gyLo, gyLo), _mm_madd_epi16(gyHi, gyHi)));
+    gxy = _mm_add_epi32(gxy, _mm_add_epi32(_mm_madd_epi16(gxLo, gyLo), _mm_madd_epi16(gxHi, gyHi)));
+  }
+  *m = BlockMoments();
+  m->sum = SumEpi64Sse41(sum);
+  m->squares = SumEpi32Sse41(squares);
+  m->gxx = SumEpi32Sse41(gxx);
+  m->gyy = SumEpi32Sse41(gyy);
+  m->gxy = SumEpi32Sse41(gxy);
+  BrightSse41(pixels, width, x0, y0, m);
+}
+
+// AVX2 widens a whole block row to one vector of 16-bit lanes.
+LSE_TARGET("avx2") __m256i WidenAvx2(const uint8_t *p) {
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+LSE_TARGET("avx2") int32_t SumEpi32Avx2(__m256i v) {
+  return SumEpi32Sse41(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+LSE_TARGET("avx2") void MomentsAvx2(const uint8_t *pixels, int width, int height, int x0, int y0,
+                                    BlockMoments *m) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sum = zero;
+  __m256i squares = zero;
+  __m256i gxx = zero;
+  __m256i gyy = zero;
+  __m256i gxy = zero;
+  const __m256i ones = _mm256_set1_epi16(1);
+  for (int y = y0; y < y0 + kMomentBlock; y++) {
+    const uint8_t *row = pixels + static_cast<size_t>(y) * width + x0;
+    __m256i p = WidenAvx2(row);
+    __m256i gx = _mm256_sub_epi16(WidenAvx2(row + 1), WidenAvx2(row - 1));
+    __m256i gy = _mm256_sub_epi16(WidenAvx2(ClampedRow(pixels, width, height, y + 1) + x0),
+                                  WidenAvx2(ClampedRow(pixels, width, height, y - 1) + x0));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(p, ones));
+    squares = _mm256_add_epi32(squares, _mm256_madd_epi16(p, p));
+    gxx = _mm256_add_epi32(gxx, _mm256_madd_epi16(gx, gx));
+    gyy = _mm256_add_epi32(gyy, _mm256_madd_epi16(gy, gy));
+    gxy = _mm256_add_epi32(gxy, _mm256_madd_epi16(gx, gy));
+  }
+  *m = BlockMoments();
+  m->sum = SumEpi32Avx2(sum);
+  m->squares = SumEpi32Avx2(squares);
+  m->gxx = SumEpi32Avx2(gxx);
+  m->gyy = SumEpi32Avx2(gyy);
+  m->gxy = SumEpi32Avx2(gxy);
+  BrightSse41(pixels, width, x0, y0, m);
+}
+
+// Dark rows: the mask of pixels at or below the limit, summed with SAD against
+// the byte offsets and their squares (225 at most, so they fit a byte).
+
+LSE_TARGET("sse4.1") void DarkBlockSse41(const uint8_t *pixels, size_t stride, int threshold, DarkRow *rows) {
+  const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold - 1));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i offsets = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i squares = _mm_setr_epi8(0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, static_cast<char>(144),
+                                        static_cast<char>(169), static_cast<char>(196), static_cast<char>(225));
+  for (int y = 0; y < kMomentBlock; y++) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + y * stride));
+    __m128i dark = _mm_cmpeq_epi8(_mm_min_epu8(p, limit), p);
+    rows[y].count = SumEpi64Sse41(_mm_sad_epu8(_mm_and_si128(one, dark), zero));
+    rows[y].offsets = SumEpi64Sse41(_mm_sad_epu8(_mm_and_si128(offsets, dark), zero));
+    rows[y].squares = SumEpi64Sse41(_mm_sad_epu8(_mm_and_si128(squares, dark), zero));
+  }
+}
+
+// Two rows per vector, one in each 128-bit lane.
+LSE_TARGET("avx2") void DarkBlockAvx2(const uint8_t *pixels, size_t stride, int threshold, DarkRow *rows) {
+  const __m256i limit = _mm256_set1_epi8(static_cast<char>(threshold - 1));
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m128i offsetRow = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i squareRow = _mm_setr_epi8(0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, static_cast<char>(144),
+                                          static_cast<char>(169), static_cast<char>(196), static_cast<char>(225));
+  const __m256i offsets = _mm256_broadcastsi128_si256(offsetRow);
+  const __m256i squares = _mm256_broadcastsi128_si256(squareRow);
+  for (int y = 0; y < kMomentBlock; y += 2) {
+    __m256i p = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + y * stride))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + (y + 1) * stride)), 1);
+    __m256i dark = _mm256_cmpeq_epi8(_mm256_min_epu8(p, limit), p);
+    __m256i count = _mm256_sad_epu8(_mm256_and_si256(one, dark), zero);
+    __m256i offset = _mm256_sad_epu8(_mm256_and_si256(offsets, dark), zero);
+    __m256i square = _mm256_sad_epu8(_mm256_and_si256(squares, dark), zero);
+    rows[y].count = SumEpi64Sse41(_mm256_castsi256_si128(count));
+    rows[y].offsets = SumEpi64Sse41(_mm256_castsi256_si128(offset));
+    rows[y].squares = SumEpi64Sse41(_mm256_castsi256_si128(square));
+    rows[y + 1].count = SumEpi64Sse41(_mm256_extracti128_si256(count, 1));
+    rows[y + 1].offsets = SumEpi64Sse41(_mm256_extracti128_si256(offset, 1));
+    rows[y + 1].squares = SumEpi64Sse41(_mm256_extracti128_si256(square, 1));
+  }
+}
+
+#endif  // LSE_X86
+
+void DarkBlockScalar(const uint8_t *pixels, size_t stride, int threshold, DarkRow *rows) {
+  for (int y = 0; y < kMomentBlock; y++) {
+    const uint8_t *row = pixels + y * stride;
+    DarkRow sums;
+    for (int i = 0; i < kMomentBlock; i++) {
+      const int dark = row[i] < threshold;
+      sums.count += dark;
+      sums.offsets += dark * i;
+      sums.squares += dark * i * i;
+    }
+    rows[y] = sums;
+  }
+}
+
+void FlipScalar(uint8_t *pixels, int width, int height) {
+  for (int y = 0; y < height / 2; y++) {
+    SwapRowsScalar(pixels + static_cast<size_t>(y) * width, pixels + static_cast<size_t>(height - 1 - y) * width,
+                   0, width);
+  }
+}
+
+void DownscaleScalar(const uint8_t *source, int width, int height, int factor, uint8_t *target) {
+  const int outWidth = width / factor;
+  for (int oy = 0; oy < height / factor; oy++) {
+    DownscaleRowScalar(source + static_cast<size_t>(oy) * factor * width, width, factor, 0, outWidth,
+                       target + static_cast<size_t>(oy) * outWidth);
+  }
+}
+
+}  // namespace
+
+SimdLevel DetectedSimdLevel() {
+  static const SimdLevel detected = Detect();
+  return detected;
+}
+
+SimdLevel ActiveSimdLevel() {
+  return Level();
+}
+
+SimdLevel SetSimdLevel(SimdLevel level) {
+  SimdLevel effective = std::min(level, DetectedSimdLevel());
+  g_level.store(static_cast<int>(effective), std::memory_order_relaxed);
+  return effective;
+}
+
+const char *SimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kAvx2:
+      return "avx2";
+    case SimdLevel::kSse41:
+      return "sse4.1";
+    default:
+      return "scalar";
+  }
+}
+
+void FlipVertical(uint8_t *pixels, int width, int height) {
+  switch (Level()) {
+#if LSE_X86
+    case SimdLevel::kAvx2:
+      FlipAvx2(pixels, width, height);
+      return;
+    case SimdLevel::kSse41:
+      FlipSse41(pixels, width, height);
+      return;
+#endif
+    default:
+      FlipScalar(pixels, width, height);
+      return;
+  }
+}
+
+void Crop(const uint8_t *source, int sourceWidth, int x, int y, int width, int height, uint8_t *target) {
+  // Row copies: memcpy is already vectorized by the C library.
+  for (int row = 0; row < height; row++) {
+    memcpy(target + static_cast<size_t>(row) * width, source + static_cast<size_t>(y + row) * sourceWidth + x,
+           static_cast<size_t>(width));
+  }
+}
+
+void Downscale(const uint8_t *source, int width, int height, int factor, uint8_t *target) {
+  switch (Level()) {
+#if LSE_X86
+    case SimdLevel::kAvx2:
+      factor == 2 ? Downscale2Avx2(source, width, height, target) : Downscale4Avx2(source, width, height, target);
+      return;
+    case SimdLevel::kSse41:
+      factor == 2 ? Downscale2Sse41(source, width, height, target) : Downscale4Sse41(source, width, height, target);
+      return;
+#endif
+    default:
+      DownscaleScalar(source, width, height, factor, target);
+      return;
+  }
+}
+
+namespace {
+
+void BlendRows(const uint8_t *a, const uint8_t *b, int weight, int width, uint8_t *out) {
+  switch (Level()) {
+#if LSE_X86
+    case SimdLevel::kAvx2:
+      BlendRowsAvx2(a, b, weight, width, out);
+      return;
+    case SimdLevel::kSse41:
+      BlendRowsSse41(a, b, weight, width, out);
+      return;
+#endif
+    default:
+      BlendRowsScalar(a, b, weight, 0, width, out);
+      return;
+  }
+}
+
+/// Source position of target pixel @p t (pixel centres aligned) in 24.8 fixed
+/// point, clamped to the source.
+int SourcePosition(int t, int source, int target) {
+  double position = (t + 0.5) * source / target - 0.5;
+  position = std::min(std::max(position, 0.0), static_cast<double>(source - 1));
+  return static_cast<int>(std::lround(position * 256));
+}
+
+}  // namespace
+
+void Resize(const uint8_t *source, int width, int height, uint8_t *target, int targetWidth, int targetHeight,
+            int targetStride) {
+  // Scratch per thread: the compositor resizes on several pool threads at once.
+  static thread_local std::vector<uint8_t> shrunk[2];
+  static thread_local std::vector<uint8_t> blended;
+  static thread_local std::vector<int> lefts;
+  static thread_local std::vector<int> weights;
+
+  int which = 0;
+  while (width >= 2 * targetWidth && height >= 2 * targetHeight) {
+    const int factor = width >= 4 * targetWidth && height >= 4 * targetHeight ? 4 : 2;
+    std::vector<uint8_t> &next = shrunk[which];
+    which ^= 1;
+    next.resize(static_cast<size_t>(width / factor) * (height / factor));
+    Downscale(source, width, height, factor, next.data());
+    source = next.data();
+    width /= factor;
+    height /= factor;
+  }
+
+  // Per target column: left source column and the weight of its right neighbour.
+  lefts.resize(static_cast<size_t>(targetWidth));
+  weights.resize(static_cast<size_t>(targetWidth));
+  for (int x = 0; x < targetWidth; x++) {
+    int position = SourcePosition(x, width, targetWidth);
+    lefts[x] = position >> 8;
+    weights[x] = position & 255;
+  }
+  // Columns whose 4-byte gather stays inside the row (lefts only grow).
+  int gathered = targetWidth;
+  while (gathered > 0 && lefts[gathered - 1] + 4 > width) {
+    gathered--;
+  }
+  blended.resize(static_cast<size_t>(width));
+  for (int y = 0; y < targetHeight; y++) {
+    int position = SourcePosition(y, height, targetHeight);
+    int y0 = position >> 8;
+    int weight = position & 255;
+    const uint8_t *row = source + static_cast<size_t>(y0) * width;
+    if (weight != 0) {
+      BlendRows(row, row + width, weight, width, blended.data());
+      row = blended.data();
+    }
+    uint8_t *out = target + static_cast<size_t>(y) * targetStride;
+    if (width == targetWidth) {
+      memcpy(out, row, static_cast<size_t>(width));
+      continue;
+    }
+    switch (Level()) {
+#if LSE_X86
+      case SimdLevel::kAvx2:
+        InterpolateRowAvx2(row, lefts.data(), weights.data(), gathered, targetWidth, out);
+        break;
+#endif
+      default:
+        // SSE4.1 has no gather; the scalar loop is as fast as inserting lanes.
+        InterpolateRowScalar(row, lefts.data(), weights.data(), 0, targetWidth, out);
+        break;
+    }
+  }
+}
+
+void GrayToRgba(const uint8_t *gray, size_t count, uint8_t *rgba) {
+  switch (Level()) {
+#if LSE_X86
+    case SimdLevel::kAvx2:
+      GrayToRgbaAvx2(gray, count, rgba);
+      return;
+    case SimdLevel::kSse41:
+      GrayToRgbaSse41(gray, count, rgba);
+      return;
+#endif
+    default:
+      GrayToRgbaScalar(gray, 0, count, rgba);
+      return;
+  }
+}
+
+void BlendSpan(uint8_t *pixels, size_t count, int channels, const uint8_t *color, int alpha) {
+  if (alpha <= 0 || count == 0) {
+    return;
+  }
+  if (alpha >= 255) {
+    // Plain fills: the compiler vectorizes these loops at every level.
+    if (channels == 1) {
+      memset(pixels, color[0], count);
+      return;
+    }
+    uint32_t value;
+    memcpy(&value, color, sizeof(value));
+    for (size_t i = 0; i < count; i++) {
+      memcpy(pixels + 4 * i, &value, sizeof(value));
+    }
+    return;
+  }
+  const size_t bytes = count * channels;
+  switch (Level()) {
+#if LSE_X86
+    case SimdLevel::kAvx2:
+      BlendBytesAvx2(pixels, bytes, channels, color, alpha);
+      return;
+    case SimdLevel::kSse41:
+      BlendBytesSse41(pixels, bytes, channels, color, alpha);
+      return;
+#endif
+    default:
+      BlendBytesScalar(pixels, 0, bytes, channels, color, alpha);
+      return;
+  }
+}
+
+void ForwardDct(const uint8_t *pixels, size_t stride, const float *scales, int16_t *coefficients) {
+  switch (Level()) {
+#if LSE_X86
+    case SimdLevel::kAvx2:
+      ForwardDctAvx2(pixels, stride, scales, coefficients);
+      return;
+    case SimdLevel::kSse41:
+      ForwardDctSse41(pixels, stride, scales, coefficients);
+      return;
+#endif
+    default:
+      ForwardDctScalar(pixels, stride, scales, coefficients);
+      return;
+  }
+}
+
+void ComputeBlockMoments(const uint8_t *pixels, int width, int height, int blockY, BlockMoments *moments) {
+  const int blocks = width / kMomentBlock;
+  const int y0 = blockY * kMomentBlock;
+  const SimdLevel level = Level();
+  for (int b = 0; b < blocks; b++) {
+    const int x0 = b * kMomentBlock;
+    const bool interior = x0 > 0 && x0 + kMomentBlock < width;
+#if LSE_X86
+    if (interior && level == SimdLevel::kAvx2) {
+      MomentsAvx2(pixels, width, height, x0, y0, moments + b);
+      continue;
+    }
+    if (interior && level == SimdLevel::kSse41) {
+      MomentsSse41(pixels, width, height, x0, y0, moments + b);
+      continue;
+    }
+#else
+    (void)interior;
+    (void)level;
+#endif
+    MomentsScalar(pixels, width, height, x0, y0, moments + b);
+  }
+}
+
+void CountDarkBlock(const uint8_t *pixels, size_t stride, int threshold, DarkRow *rows) {
+  threshold = std::min(256, std::max(1, threshold));
+  switch (Level()) {
+#if LSE_X86
+    case SimdLevel::kAvx2:
+      DarkBlockAvx2(pixels, stride, threshold, rows);
+      return;
+    case SimdLevel::kSse41:
+      DarkBlockSse41(pixels, stride, threshold, rows);
+      return;
+#endif
+    default:
+      DarkBlockScalar(pixels, stride, threshold, rows);
+      return;
+  }
+}
+
+void ComputeStats(const uint8_t *pixels, size_t count, ImageStats *stats) {
+  // Byte scatter does not vectorize (x86 has no conflict-free gather/scatter
+  // increment below AVX-512), so every level counts into four interleaved
+  // tables instead: consecutive equal pixels then update different counters
+  // and do not wait on each other's store.
+  static thread_local uint32_t banks[4][256];
+  memset(banks, 0, sizeof(banks));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32_t quad;
+    memcpy(&quad, pixels + i, sizeof(quad));
+    banks[0][quad & 0xff]++;
+    banks[1][(quad >> 8) & 0xff]++;
+    banks[2][(quad >> 16) & 0xff]++;
+    banks[3][quad >> 24]++;
+  }
+  for (; i < count; i++) {
+    banks[0][pixels[i]]++;
+  }
+
+  *stats = ImageStats();
+  stats->count = count;
+  double sum = 0;
+  double squares = 0;
+  for (int v = 0; v < 256; v++) {
+    uint32_t n = banks[0][v] + banks[1][v] + banks[2][v] + banks[3][v];
+    stats->histogram[v] = n;
+    sum += static_cast<double>(n) * v;
+    squares += static_cast<double>(n) * v * v;
+  }
+  if (count == 0) {
+    return;
+  }
+  stats->mean = sum / count;
+  stats->stdDev = std::sqrt(std::max(0.0, squares / count - stats->mean * stats->mean));
+
+  // Percentile p: smallest value with at least ceil(p * count) pixels at or below it.
+  const uint64_t p1 = std::max<uint64_t>(1, (count + 99) / 100);
+  const uint64_t p50 = std::max<uint64_t>(1, (count + 1) / 2);
+  const uint64_t p99 = std::max<uint64_t>(1, (count * 99 + 99) / 100);
+  uint64_t seen = 0;
+  stats->min = -1;
+  for (int v = 0; v < 256; v++) {
+    if (stats->histogram[v] == 0) {
+      continue;
+    }
+    uint64_t before = seen;
+    seen += stats->histogram[v];
+    if (stats->min < 0) {
+      stats->min = v;
+    }
+    stats->max = v;
+    if (before < p1 && seen >= p1) {
+      stats->p1 = v;
+    }
+    if (before < p50 && seen >= p50) {
+      stats->p50 = v;
+    }
+    if (before < p99 && seen >= p99) {
+      stats->p99 = v;
+    }
+  }
+}
+
+}  // namespace lse
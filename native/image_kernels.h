@@ -0,0 +1,124 @@
+/// Host-side transforms of 8-bit grayscale images (the SDK's preview and result
+/// format): vertical flip, crop, 2:1/4:1 box downscale, bilinear resize and
+/// histogram statistics, plus the gray-to-RGBA expansion and span blending the
+/// preview compositor (compositor.h) draws with, the block DCT of the JPEG
+/// encoder (jpeg_encoder.h) and the block moments of the quality map
+/// (quality_map.h).
+///
+/// Each kernel has a portable scalar implementation and, on x86, SSE4.1 and AVX2
+/// variants compiled with per-function target attributes, so the addon itself
+/// needs no special compiler flags and still loads on CPUs without AVX2. The
+/// variant is picked once from the CPU's features; SetSimdLevel() can lower it
+/// (benchmarks, or to rule out a kernel when chasing an image defect). All
+/// variants produce identical output.
+///
+/// Images are tightly packed: row y starts at pixels + y * width.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lse {
+
+enum class SimdLevel : int {
+  kScalar,
+  kSse41,
+  kAvx2,
+};
+
+/// Highest level the CPU (and OS) supports.
+SimdLevel DetectedSimdLevel();
+
+/// Level the kernels currently use.
+SimdLevel ActiveSimdLevel();
+
+/// Use @p level, clamped to DetectedSimdLevel(); returns the level in effect.
+/// Not synchronized with kernels running on other threads.
+SimdLevel SetSimdLevel(SimdLevel level);
+
+const char *SimdLevelName(SimdLevel level);
+
+/// Mirror @p pixels top to bottom, in place.
+void FlipVertical(uint8_t *pixels, int width, int height);
+
+/// Copy the @p width x @p height rectangle at (@p x, @p y) of a @p sourceWidth wide
+/// image into @p target. The caller checks that the rectangle lies inside the source.
+void Crop(const uint8_t *source, int sourceWidth, int x, int y, int width, int height, uint8_t *target);
+
+/// Box-filter @p source down by @p factor (2 or 4) in both directions into
+/// @p target, which holds (width / factor) x (height / factor) pixels. Each
+/// target pixel is the rounded mean of its factor x factor source block;
+/// leftover columns and rows are dropped.
+void Downscale(const uint8_t *source, int width, int height, int factor, uint8_t *target);
+
+/// Bilinear resize of @p source to @p targetWidth x @p targetHeight into
+/// @p target, whose rows are @p targetStride bytes apart. Sizes of half the
+/// source or less are box-filtered with Downscale() first, so every source pixel
+/// contributes and fine ridges do not alias.
+void Resize(const uint8_t *source, int width, int height, uint8_t *target, int targetWidth, int targetHeight,
+            int targetStride);
+
+/// Expand @p count gray pixels to opaque RGBA (R = G = B = gray, A = 255).
+void GrayToRgba(const uint8_t *gray, size_t count, uint8_t *rgba);
+
+/// Blend @p count pixels of @p channels (1 or 4) bytes each towards @p color
+/// (one byte per channel) by @p alpha / 255, rounded. An alpha of 255 fills.
+void BlendSpan(uint8_t *pixels, size_t count, int channels, const uint8_t *color, int alpha);
+
+/// Forward DCT of the 8x8 block at @p pixels (rows @p stride bytes apart, values
+/// level-shifted by -128) in the scaled AAN form: coefficient i is multiplied by
+/// @p scales[i], which must fold in the AAN factors, and rounded to nearest with
+/// ties to even. @p scales and @p coefficients are in row-major order.
+void ForwardDct(const uint8_t *pixels, size_t stride, const float *scales, int16_t *coefficients);
+
+/// Integer sums over one kMomentBlock x kMomentBlock block, from which the
+/// quality map derives contrast, ridge orientation and coherence, and ridge
+/// clarity. Gradients are central differences, gx = p(x + 1, y) - p(x - 1, y)
+/// and gy = p(x, y + 1) - p(x, y - 1), with coordinates clamped to the image.
+struct BlockMoments {
+  int32_t sum = 0;          ///< Sum of pixels
+  int32_t squares = 0;      ///< Sum of squared pixels
+  int32_t gxx = 0;          ///< Sum of gx * gx
+  int32_t gyy = 0;          ///< Sum of gy * gy
+  int32_t gxy = 0;          ///< Sum of gx * gy
+  int32_t brightSum = 0;    ///< Sum of the pixels above the block mean
+  int32_t brightCount = 0;  ///< and their number
+};
+
+constexpr int kMomentBlock = 16;
+
+/// Moments of the width / kMomentBlock blocks in block row @p blockY of a
+/// @p width x @p height image into @p moments; the row must lie inside the
+/// image. Leftover columns are not covered.
+void ComputeBlockMoments(const uint8_t *pixels, int width, int height, int blockY, BlockMoments *moments);
+
+/// Pixels darker than a threshold in one kMomentBlock-pixel row of a block,
+/// with the sums of their offsets i (0-15) from the start of the row: the
+/// segmentation's centroid and principal axis come from these.
+struct DarkRow {
+  int32_t count = 0;
+  int32_t offsets = 0;  ///< Sum of i
+  int32_t squares = 0;  ///< Sum of i * i
+};
+
+/// DarkRow of each of the kMomentBlock rows of the block at @p pixels, rows
+/// @p stride bytes apart, counting pixels below @p threshold (1-256) into @p rows.
+void CountDarkBlock(const uint8_t *pixels, size_t stride, int threshold, DarkRow *rows);
+
+struct ImageStats {
+  uint32_t histogram[256];
+  uint64_t count = 0;
+  int min = 0;
+  int max = 0;
+  double mean = 0;
+  double stdDev = 0;
+  int p1 = 0;   ///< 1st percentile: a noise-robust black point
+  int p50 = 0;  ///< Median
+  int p99 = 0;  ///< 99th percentile: a noise-robust white point
+};
+
+/// Histogram and contrast statistics of @p count pixels.
+void ComputeStats(const uint8_t *pixels, size_t count, ImageStats *stats);
+
+}  // namespace lse
@@ -0,0 +1,437 @@
+#include "jpeg_encoder.h"
+
+#include "image_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace lse {
+
+namespace {
+
+/// Index of the lowest set bit of a non-zero @p value.
+int LowestBit(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+/// Magnitude category of @p value: the number of bits of |value|.
+int Category(int value) {
+  unsigned magnitude = static_cast<unsigned>(value < 0 ? -value : value);
+  if (magnitude == 0) {
+    return 0;
+  }
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanReverse(&index, magnitude);
+  return static_cast<int>(index) + 1;
+#else
+  return 32 - __builtin_clz(magnitude);
+#endif
+}
+
+/// Row-major index of the i-th coefficient in zigzag order.
+const uint8_t kZigzag[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// Annex K quantization tables, row-major.
+const uint8_t kLumaQuant[64] = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,  14, 13, 16, 24,  40,  57,
+    69, 56, 14, 17, 22,  29,  51,  87,  80, 62, 18, 22, 37,  56,  68,  109, 103, 77, 24, 35,  55,  64,
+    81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+};
+const uint8_t kChromaQuant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99,
+    99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+/// Output scale of the AAN DCT per frequency: cos(k * pi / 16) * sqrt(2), 1 for k = 0.
+const float kAanScale[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                            1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+
+// Annex K Huffman tables: code counts per length 1-16, then the symbols.
+const uint8_t kDcLumaCounts[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+const uint8_t kDcChromaCounts[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+const uint8_t kDcSymbols[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+const uint8_t kAcLumaCounts[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+const uint8_t kAcLumaSymbols[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+    0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+const uint8_t kAcChromaCounts[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+const uint8_t kAcChromaSymbols[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+    0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+    0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36,
+    0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+    0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+    0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+struct HuffmanSpec {
+  const uint8_t *counts;
+  const uint8_t *symbols;
+  int symbolCount;
+};
+
+const HuffmanSpec kDcLuma = {kDcLumaCounts, kDcSymbols, 12};
+const HuffmanSpec kAcLuma = {kAcLumaCounts, kAcLumaSymbols, 162};
+const HuffmanSpec kDcChroma = {kDcChromaCounts, kDcSymbols, 12};
+const HuffmanSpec kAcChroma = {kAcChromaCounts, kAcChromaSymbols, 162};
+
+/// Code and length per symbol, the canonical assignment of Annex C.
+struct HuffmanTable {
+  uint16_t code[256];
+  uint8_t length[256];
+
+  explicit HuffmanTable(const HuffmanSpec &spec) {
+    memset(length, 0, sizeof(length));
+    int next = 0;
+    int k = 0;
+    for (int bits = 1; bits <= 16; bits++) {
+      for (int i = 0; i < spec.counts[bits - 1]; i++, k++) {
+        code[spec.symbols[k]] = static_cast<uint16_t>(next++);
+        length[spec.symbols[k]] = static_cast<uint8_t>(bits);
+      }
+      next <<= 1;
+    }
+  }
+};
+
+struct Tables {
+  HuffmanTable dcLuma{kDcLuma};
+  HuffmanTable acLuma{kAcLuma};
+  HuffmanTable dcChroma{kDcChroma};
+  HuffmanTable acChroma{kAcChroma};
+};
+
+const Tables &HuffmanTables() {
+  static const Tables tables;
+  return tables;
+}
+
+/// Quantization table for a quality: the bytes for DQT (zigzag order) and the
+/// ForwardDct() scales (row-major), which fold in the AAN factors.
+struct Quantizer {
+  uint8_t table[64];
+  float scales[64];
+
+  Quantizer(const uint8_t *base, int quality) {
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    uint8_t values[64];
+    for (int i = 0; i < 64; i++) {
+      values[i] = static_cast<uint8_t>(std::min(std::max((base[i] * scale + 50) / 100, 1), 255));
+      scales[i] = 1.0f / (values[i] * kAanScale[i / 8] * kAanScale[i % 8] * 8.0f);
+    }
+    for (int i = 0; i < 64; i++) {
+      table[i] = values[kZigzag[i]];
+    }
+  }
+};
+
+/// Entropy-coded segment writer: MSB-first bits with 0xFF byte stuffing,
+/// appended to a byte vector that Reserve() grows ahead of each block.
+class BitWriter {
+ public:
+  /// Bytes one block can take at most: 64 codes of 16 + 11 bits, all stuffed.
+  static constexpr size_t kMaxBlockBytes = 64 * 27 / 8 * 2 + 8;
+
+  explicit BitWriter(std::vector<uint8_t> *out) : out_(out), used_(out->size()) {}
+
+  void Reserve(size_t bytes) {
+    if (out_->size() - used_ < bytes) {
+      out_->resize(std::max(out_->size() * 2, used_ + bytes));
+    }
+    cursor_ = out_->data() + used_;
+  }
+
+  void Put(uint32_t bits, int length) {
+    bits_ = (bits_ << length) | bits;
+    count_ += length;
+    while (count_ >= 8) {
+      count_ -= 8;
+      uint8_t byte = static_cast<uint8_t>(bits_ >> count_);
+      *cursor_++ = byte;
+      if (byte == 0xff) {
+        *cursor_++ = 0;
+      }
+    }
+  }
+
+  /// End the block: record how far the vector is filled.
+  void Commit() { used_ = static_cast<size_t>(cursor_ - out_->data()); }
+
+  /// Pad the last byte with one bits and trim the vector to the data.
+  void Finish() {
+    Reserve(2);
+    if (count_ > 0) {
+      Put((1u << (8 - count_)) - 1, 8 - count_);
+    }
+    Commit();
+    out_->resize(used_);
+  }
+
+ private:
+  std::vector<uint8_t> *out_;
+  size_t used_;
+  uint8_t *cursor_ = nullptr;
+  uint64_t bits_ = 0;
+  int count_ = 0;
+};
+
+void PutValue(BitWriter *writer, const HuffmanTable &table, int run, int value) {
+  int category = Category(value);
+  int symbol = (run << 4) | category;
+  writer->Put(table.code[symbol], table.length[symbol]);
+  if (category > 0) {
+    // Negative values are sent as value - 1 in category bits (one's complement).
+    int bits = value < 0 ? value - 1 : value;
+    writer->Put(static_cast<uint32_t>(bits) & ((1u << category) - 1), category);
+  }
+}
+
+/// Transform, quantize and entropy-code the 8x8 block at @p pixels.
+void EncodeBlock(BitWriter *writer, const uint8_t *pixels, size_t stride, const Quantizer &quantizer,
+                 const HuffmanTable &dc, const HuffmanTable &ac, int *previousDc) {
+  int16_t coefficients[64];
+  ForwardDct(pixels, stride, quantizer.scales, coefficients);
+  // Zigzag order plus a mask of the non-zero AC coefficients, so runs of zeros
+  // (most of a block) are skipped a word at a time.
+  int16_t ordered[64];
+  uint64_t nonzero = 0;
+  for (int i = 1; i < 64; i++) {
+    ordered[i] = coefficients[kZigzag[i]];
+    nonzero |= static_cast<uint64_t>(ordered[i] != 0) << i;
+  }
+  writer->Reserve(BitWriter::kMaxBlockBytes);
+  PutValue(writer, dc, 0, coefficients[0] - *previousDc);
+  *previousDc = coefficients[0];
+  int last = 0;
+  while (nonzero != 0) {
+    int i = LowestBit(nonzero);
+    nonzero &= nonzero - 1;
+    int run = i - last - 1;
+    for (; run >= 16; run -= 16) {
+      writer->Put(ac.code[0xf0], ac.length[0xf0]);  // ZRL: sixteen zeros
+    }
+    PutValue(writer, ac, run, ordered[i]);
+    last = i;
+  }
+  if (last < 63) {
+    writer->Put(ac.code[0x00], ac.length[0x00]);  // EOB
+  }
+  writer->Commit();
+}
+
+void PutU16(std::vector<uint8_t> *out, int value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void PutMarker(std::vector<uint8_t> *out, uint8_t marker, int length) {
+  out->push_back(0xff);
+  out->push_back(marker);
+  if (length > 0) {
+    PutU16(out, length);
+  }
+}
+
+void PutHuffmanTable(std::vector<uint8_t> *out, int tableClass, int id, const HuffmanSpec &spec) {
+  out->push_back(static_cast<uint8_t>(tableClass << 4 | id));
+  out->insert(out->end(), spec.counts, spec.counts + 16);
+  out->insert(out->end(), spec.symbols, spec.symbols + spec.symbolCount);
+}
+
+/// SOI through SOS for @p components (1: gray, 3: YCbCr 4:2:0).
+void PutHeaders(std::vector<uint8_t> *out, int width, int height, int components, const Quantizer &luma,
+                const Quantizer &chroma) {
+  PutMarker(out, 0xd8, 0);  // SOI
+  // APP0 JFIF 1.01, no density, no thumbnail.
+  static const uint8_t kJfif[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+  PutMarker(out, 0xe0, 2 + sizeof(kJfif));
+  out->insert(out->end(), kJfif, kJfif + sizeof(kJfif));
+
+  const bool color = components == 3;
+  PutMarker(out, 0xdb, 2 + (color ? 2 : 1) * 65);  // DQT
+  out->push_back(0);
+  out->insert(out->end(), luma.table, luma.table + 64);
+  if (color) {
+    out->push_back(1);
+    out->insert(out->end(), chroma.table, chroma.table + 64);
+  }
+
+  PutMarker(out, 0xc0, 8 + 3 * components);  // SOF0
+  out->push_back(8);
+  PutU16(out, height);
+  PutU16(out, width);
+  out->push_back(static_cast<uint8_t>(components));
+  for (int c = 0; c < components; c++) {
+    out->push_back(static_cast<uint8_t>(c + 1));
+    out->push_back(c == 0 && color ? 0x22 : 0x11);  // Luma sampled 2x2 against chroma
+    out->push_back(c == 0 ? 0 : 1);
+  }
+
+  int tablesLength = 2 + 2 * (17 + 12) + 2 * (17 + 162);
+  PutMarker(out, 0xc4, color ? tablesLength : 2 + 17 + 12 + 17 + 162);  // DHT
+  PutHuffmanTable(out, 0, 0, kDcLuma);
+  PutHuffmanTable(out, 1, 0, kAcLuma);
+  if (color) {
+    PutHuffmanTable(out, 0, 1, kDcChroma);
+    PutHuffmanTable(out, 1, 1, kAcChroma);
+  }
+
+  PutMarker(out, 0xda, 6 + 2 * components);  // SOS
+  out->push_back(static_cast<uint8_t>(components));
+  for (int c = 0; c < components; c++) {
+    out->push_back(static_cast<uint8_t>(c + 1));
+    out->push_back(c == 0 ? 0x00 : 0x11);
+  }
+  out->push_back(0);   // Spectral selection 0-63
+  out->push_back(63);
+  out->push_back(0);   // No successive approximation
+}
+
+/// Copy @p pixels into @p plane, @p paddedWidth x @p paddedHeight, repeating the
+/// last column and row into the padding.
+void PadPlane(const uint8_t *pixels, int width, int height, int paddedWidth, int paddedHeight,
+              std::vector<uint8_t> *plane) {
+  plane->resize(static_cast<size_t>(paddedWidth) * paddedHeight);
+  for (int y = 0; y < paddedHeight; y++) {
+    const uint8_t *source = pixels + static_cast<size_t>(std::min(y, height - 1)) * width;
+    uint8_t *target = plane->data() + static_cast<size_t>(y) * paddedWidth;
+    memcpy(target, source, static_cast<size_t>(width));
+    memset(target + width, source[width - 1], static_cast<size_t>(paddedWidth - width));
+  }
+}
+
+/// JFIF YCbCr planes of RGBA @p pixels: full-size luma and 2x2-averaged chroma,
+/// padded to whole 16x16 MCUs by edge repetition. 16.16 fixed point.
+void SplitYCbCr(const uint8_t *pixels, int width, int height, int paddedWidth, int paddedHeight,
+                std::vector<uint8_t> *luma, std::vector<uint8_t> *cb, std::vector<uint8_t> *cr) {
+  luma->resize(static_cast<size_t>(paddedWidth) * paddedHeight);
+  cb->resize(luma->size() / 4);
+  cr->resize(luma->size() / 4);
+  const size_t stride = static_cast<size_t>(width) * 4;
+  for (int y = 0; y < paddedHeight; y++) {
+    const uint8_t *p = pixels + std::min(y, height - 1) * stride;
+    uint8_t *row = luma->data() + static_cast<size_t>(y) * paddedWidth;
+    for (int x = 0; x < width; x++, p += 4) {
+      row[x] = static_cast<uint8_t>((19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768) >> 16);
+    }
+    memset(row + width, row[width - 1], static_cast<size_t>(paddedWidth - width));
+  }
+  // Mean of four plus 128, rounded; a half less one keeps 255.5 at 255.
+  const int offset = (514 << 16) - 1;
+  const int chromaWidth = paddedWidth / 2;
+  for (int y = 0; y < paddedHeight / 2; y++) {
+    const uint8_t *rows[2] = {pixels + std::min(2 * y, height - 1) * stride,
+                              pixels + std::min(2 * y + 1, height - 1) * stride};
+    uint8_t *rowB = cb->data() + static_cast<size_t>(y) * chromaWidth;
+    uint8_t *rowR = cr->data() + static_cast<size_t>(y) * chromaWidth;
+    for (int x = 0; x < chromaWidth; x++) {
+      const int left = std::min(2 * x, width - 1) * 4;
+      const int right = std::min(2 * x + 1, width - 1) * 4;
+      int r = 0;
+      int g = 0;
+      int b = 0;
+      for (const uint8_t *row : rows) {
+        r += row[left] + row[right];
+        g += row[left + 1] + row[right + 1];
+        b += row[left + 2] + row[right + 2];
+      }
+      rowB[x] = static_cast<uint8_t>((-11059 * r - 21709 * g + 32768 * b + offset) >> 18);
+      rowR[x] = static_cast<uint8_t>((32768 * r - 27439 * g - 5329 * b + offset) >> 18);
+    }
+  }
+}
+
+}  // namespace
+
+FrameBlockPtr EncodeJpeg(const uint8_t *pixels, int width, int height, int channels, const JpegOptions &options) {
+  if (pixels == nullptr || width <= 0 || height <= 0 || width > 65535 || height > 65535 ||
+      (channels != 1 && channels != 4) || options.quality < JpegOptions::kMinQuality ||
+      options.quality > JpegOptions::kMaxQuality) {
+    return nullptr;
+  }
+  // Scratch per thread: compositors encode on several pool threads at once.
+  static thread_local std::vector<uint8_t> out;
+  static thread_local std::vector<uint8_t> planes[3];
+  const Tables &tables = HuffmanTables();
+  const Quantizer luma(kLumaQuant, options.quality);
+  const Quantizer chroma(kChromaQuant, options.quality);
+  const bool color = channels == 4;
+
+  out.clear();
+  PutHeaders(&out, width, height, color ? 3 : 1, luma, chroma);
+  BitWriter writer(&out);
+  int previousDc[3] = {0, 0, 0};
+  if (!color) {
+    const int paddedWidth = (width + 7) & ~7;
+    const int paddedHeight = (height + 7) & ~7;
+    const uint8_t *plane = pixels;
+    if (paddedWidth != width || paddedHeight != height) {
+      PadPlane(pixels, width, height, paddedWidth, paddedHeight, &planes[0]);
+      plane = planes[0].data();
+    }
+    for (int y = 0; y < paddedHeight; y += 8) {
+      for (int x = 0; x < paddedWidth; x += 8) {
+        EncodeBlock(&writer, plane + static_cast<size_t>(y) * paddedWidth + x, paddedWidth, luma, tables.dcLuma,
+                    tables.acLuma, &previousDc[0]);
+      }
+    }
+  } else {
+    const int paddedWidth = (width + 15) & ~15;
+    const int paddedHeight = (height + 15) & ~15;
+    SplitYCbCr(pixels, width, height, paddedWidth, paddedHeight, &planes[0], &planes[1], &planes[2]);
+    const int chromaWidth = paddedWidth / 2;
+    for (int y = 0; y < paddedHeight; y += 16) {
+      for (int x = 0; x < paddedWidth; x += 16) {
+        // Four luma blocks, then one each of Cb and Cr.
+        for (int k = 0; k < 4; k++) {
+          size_t offset = static_cast<size_t>(y + (k >> 1) * 8) * paddedWidth + x + (k & 1) * 8;
+          EncodeBlock(&writer, planes[0].data() + offset, paddedWidth, luma, tables.dcLuma, tables.acLuma,
+                      &previousDc[0]);
+        }
+        size_t offset = static_cast<size_t>(y / 2) * chromaWidth + x / 2;
+        EncodeBlock(&writer, planes[1].data() + offset, chromaWidth, chroma, tables.dcChroma, tables.acChroma,
+                    &previousDc[1]);
+        EncodeBlock(&writer, planes[2].data() + offset, chromaWidth, chroma, tables.dcChroma, tables.acChroma,
+                    &previousDc[2]);
+      }
+    }
+  }
+  writer.Finish();
+  PutMarker(&out, 0xd9, 0);  // EOI
+
+  FrameBlockPtr block(SharedFramePool().Acquire(out.size()));
+  if (block) {
+    memcpy(block->data, out.data(), out.size());
+  }
+  return block;
+}
+
+}  // namespace lse
@@ -0,0 +1,31 @@
+/// Baseline JPEG encoder for preview frames.
+///
+/// Written for the preview broadcast (compositor.h), which encodes each frame
+/// once for any number of viewers, so it favours speed over size: fixed Annex K
+/// Huffman tables (no optimization pass), the float AAN DCT with SIMD variants
+/// (ForwardDct() in image_kernels.h) and 4:2:0 chroma. Gray input becomes a
+/// single-component JPEG, which fingerprint previews nearly always are; RGBA
+/// input (alpha ignored) becomes YCbCr. Adds no dependency.
+
+#pragma once
+
+#include "frame_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lse {
+
+struct JpegOptions {
+  static constexpr int kMinQuality = 1;
+  static constexpr int kMaxQuality = 100;
+
+  int quality = 75;  ///< IJG quality scale: 50 uses the Annex K tables as they are
+};
+
+/// Encode @p pixels (@p width x @p height, tightly packed, @p channels 1 or 4)
+/// into a pooled block. Returns nullptr on bad arguments or out of memory.
+/// Callable from any thread.
+FrameBlockPtr EncodeJpeg(const uint8_t *pixels, int width, int height, int channels, const JpegOptions &options);
+
+}  // namespace lse
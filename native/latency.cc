@@ -0,0 +1,397 @@
+#include "latency.h"
+
+#include "clock.h"
+#include "preview_channel.h"
+
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace lse {
+
+namespace {
+
+int HighestBit(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanReverse64(&index, value);
+  return static_cast<int>(index);
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+void StoreMin(std::atomic<uint64_t> *target, uint64_t value) {
+  uint64_t current = target->load(std::memory_order_relaxed);
+  while (value < current && !target->compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+void StoreMax(std::atomic<uint64_t> *target, uint64_t value) {
+  uint64_t current = target->load(std::memory_order_relaxed);
+  while (value > current && !target->compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+// Preview frames further apart than this end the frame rate estimate.
+constexpr uint64_t kPreviewIdleNs = 1000000000;
+
+// Bucket boundaries of the Prometheus export, in seconds.
+constexpr double kExportBounds[] = {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                    0.05,    0.1,    0.25,    0.5,    1,     2.5,    5,     10};
+
+}  // namespace
+
+int LatencyHistogram::BucketOf(uint64_t ns) {
+  if (ns < static_cast<uint64_t>(kSubBucketCount)) {
+    return static_cast<int>(ns);
+  }
+  int shift = HighestBit(ns) - (kSubBucketBits - 1);
+  if (shift > kMagnitudes) {
+    return kBucketCount - 1;
+  }
+  int sub = static_cast<int>(ns >> shift);
+  return kSubBucketCount + (shift - 1) * kSubBucketHalf + (sub - kSubBucketHalf);
+}
+
+uint64_t LatencyHistogram::UpperBound(int bucket) {
+  if (bucket < kSubBucketCount) {
+    return static_cast<uint64_t>(bucket);
+  }
+  int index = bucket - kSubBucketCount;
+  int shift = index / kSubBucketHalf + 1;
+  uint64_t sub = static_cast<uint64_t>(index % kSubBucketHalf + kSubBucketHalf);
+  return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t ns) {
+  counts_[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(ns, std::memory_order_relaxed);
+  StoreMin(&min_, ns);
+  StoreMax(&max_, ns);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Read() const {
+  Snapshot snapshot;
+  snapshot.counts.resize(kBucketCount);
+  for (int i = 0; i < kBucketCount; i++) {
+    snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+    snapshot.count += snapshot.counts[i];
+  }
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  snapshot.min = snapshot.count > 0 ? min_.load(std::memory_order_relaxed) : 0;
+  return snapshot;
+}
+
+void LatencyHistogram::Reset() {
+  for (std::atomic<uint64_t> &count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  min_.store(UINT64_MAX, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::Quantile(double quantile) const {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(count) + 0.5);
+  rank = rank < 1 ? 1 : rank > count ? count : rank;
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketCount; i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      uint64_t bound = UpperBound(i);
+      return bound < max ? bound : max;
+    }
+  }
+  return max;
+}
+
+uint64_t LatencyHistogram::Snapshot::CountAtOrBelow(uint64_t ns) const {
+  uint64_t total = 0;
+  for (int i = 0; i < kBucketCount && UpperBound(i) <= ns; i++) {
+    total += counts[i];
+  }
+  return total;
+}
+
+const char *LatencyStageName(LatencyStage stage) {
+  switch (stage) {
+    case LatencyStage::kDevice:
+      return "device";
+    case LatencyStage::kProcessing:
+      return "processing";
+    case LatencyStage::kBridge:
+      return "bridge";
+    case LatencyStage::kHandler:
+      return "handler";
+    case LatencyStage::kCapture:
+      return "capture";
+    case LatencyStage::kPreview:
+      return "preview";
+    case LatencyStage::kStartup:
+      return "startup";
+  }
+  return "unknown";
+}
+
+struct LatencyMonitor::HandleLatency {
+  LatencyHistogram stages[kLatencyStageCount];
+  std::atomic<uint64_t> taking{0};
+  std::atomic<uint64_t> acquired{0};
+  std::atomic<uint64_t> result{0};
+  std::atomic<uint64_t> delivered{0};
+  std::atomic<uint64_t> captures{0};
+  std::atomic<uint64_t> lastFrame{0};      // SDK preview thread only, read by Read()
+  std::atomic<uint64_t> frameInterval{0};  // Moving average, ns
+  std::atomic<uint64_t> pendingStart{0};   // Start waiting for its first preview frame
+  std::atomic<uint64_t> lastStart{0};
+  std::atomic<uint64_t> firstPreview{0};
+
+  LatencyHistogram &stage(LatencyStage stage) { return stages[static_cast<int>(stage)]; }
+};
+
+namespace {
+
+std::mutex g_latency_mutex;
+std::map<int, std::unique_ptr<LatencyMonitor::HandleLatency>> g_latency;
+
+}  // namespace
+
+LatencyMonitor::HandleLatency *LatencyMonitor::For(int handle) {
+  // Each SDK thread serves one device, so a one-entry cache skips the lock
+  // almost always. Entries are never destroyed.
+  thread_local int cached_handle = INT_MIN;
+  thread_local HandleLatency *cached = nullptr;
+  if (cached_handle == handle) {
+    return cached;
+  }
+  std::lock_guard<std::mutex> lock(g_latency_mutex);
+  std::unique_ptr<HandleLatency> &entry = g_latency[handle];
+  if (!entry) {
+    entry.reset(new HandleLatency());
+  }
+  cached_handle = handle;
+  cached = entry.get();
+  return cached;
+}
+
+void LatencyMonitor::OnCallback(CallbackKind kind, int handle, uint64_t timestamp) {
+  switch (kind) {
+    case CallbackKind::kTakingResultImage: {
+      HandleLatency *latency = For(handle);
+      latency->acquired.store(0, std::memory_order_relaxed);
+      latency->result.store(0, std::memory_order_relaxed);
+      latency->delivered.store(0, std::memory_order_relaxed);
+      latency->taking.store(timestamp, std::memory_order_relaxed);
+      break;
+    }
+    case CallbackKind::kAcquisitionComplete: {
+      HandleLatency *latency = For(handle);
+      latency->acquired.store(timestamp, std::memory_order_relaxed);
+      uint64_t taking = latency->taking.load(std::memory_order_relaxed);
+      if (taking != 0 && timestamp >= taking) {
+        latency->stage(LatencyStage::kDevice).Record(timestamp - taking);
+      }
+      break;
+    }
+    case CallbackKind::kResultImage: {
+      HandleLatency *latency = For(handle);
+      latency->pendingStart.store(0, std::memory_order_relaxed);  // A capture without preview
+      latency->result.store(timestamp, std::memory_order_relaxed);
+      uint64_t acquired = latency->acquired.load(std::memory_order_relaxed);
+      if (acquired != 0 && timestamp >= acquired) {
+        latency->stage(LatencyStage::kProcessing).Record(timestamp - acquired);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void LatencyMonitor::OnStart(int handle, uint64_t timestamp) {
+  uint64_t none = 0;
+  For(handle)->pendingStart.compare_exchange_strong(none, timestamp, std::memory_order_relaxed);
+}
+
+void LatencyMonitor::MarkStart(int handle, uint64_t timestamp) {
+  For(handle)->pendingStart.store(timestamp, std::memory_order_relaxed);
+}
+
+void LatencyMonitor::OnStop(int handle) {
+  For(handle)->pendingStart.store(0, std::memory_order_relaxed);
+}
+
+void LatencyMonitor::OnPreviewFrame(int handle, uint64_t timestamp) {
+  HandleLatency *latency = For(handle);
+  uint64_t start = latency->pendingStart.load(std::memory_order_relaxed);
+  if (start != 0 && latency->pendingStart.compare_exchange_strong(start, 0, std::memory_order_relaxed) &&
+      timestamp >= start) {
+    latency->stage(LatencyStage::kStartup).Record(timestamp - start);
+    latency->firstPreview.store(0, std::memory_order_relaxed);  // Never a pair of two different starts
+    latency->lastStart.store(start, std::memory_order_relaxed);
+    latency->firstPreview.store(timestamp, std::memory_order_relaxed);
+  }
+  uint64_t last = latency->lastFrame.exchange(timestamp, std::memory_order_relaxed);
+  if (last == 0 || timestamp <= last || timestamp - last > kPreviewIdleNs) {
+    return;
+  }
+  uint64_t interval = timestamp - last;
+  latency->stage(LatencyStage::kPreview).Record(interval);
+  uint64_t average = latency->frameInterval.load(std::memory_order_relaxed);
+  latency->frameInterval.store(average == 0 ? interval : average - average / 8 + interval / 8,
+                               std::memory_order_relaxed);
+}
+
+void LatencyMonitor::OnDelivered(CallbackKind kind, int handle, uint64_t timestamp, uint64_t now) {
+  if (kind == CallbackKind::kProgress || kind == CallbackKind::kDeviceCount || kind == CallbackKind::kCompletion) {
+    return;  // Not per handle
+  }
+  HandleLatency *latency = For(handle);
+  if (now >= timestamp) {
+    latency->stage(LatencyStage::kBridge).Record(now - timestamp);
+  }
+  if (kind == CallbackKind::kResultImage) {
+    latency->delivered.store(now, std::memory_order_relaxed);
+    latency->captures.fetch_add(1, std::memory_order_relaxed);
+    uint64_t taking = latency->taking.load(std::memory_order_relaxed);
+    if (taking != 0 && now >= taking) {
+      latency->stage(LatencyStage::kCapture).Record(now - taking);
+    }
+  }
+}
+
+void LatencyMonitor::OnHandled(int handle, uint64_t ns) {
+  For(handle)->stage(LatencyStage::kHandler).Record(ns);
+}
+
+std::vector<int> LatencyMonitor::Handles() {
+  std::lock_guard<std::mutex> lock(g_latency_mutex);
+  std::vector<int> handles;
+  for (const auto &entry : g_latency) {
+    handles.push_back(entry.first);
+  }
+  return handles;
+}
+
+LatencySnapshot LatencyMonitor::Read(int handle) {
+  HandleLatency *latency = For(handle);
+  LatencySnapshot snapshot;
+  snapshot.captures = latency->captures.load(std::memory_order_relaxed);
+  snapshot.last.taking = latency->taking.load(std::memory_order_relaxed);
+  snapshot.last.acquired = latency->acquired.load(std::memory_order_relaxed);
+  snapshot.last.result = latency->result.load(std::memory_order_relaxed);
+  snapshot.last.delivered = latency->delivered.load(std::memory_order_relaxed);
+  snapshot.lastStart.start = latency->lastStart.load(std::memory_order_relaxed);
+  snapshot.lastStart.firstPreview = latency->firstPreview.load(std::memory_order_relaxed);
+  uint64_t interval = latency->frameInterval.load(std::memory_order_relaxed);
+  uint64_t lastFrame = latency->lastFrame.load(std::memory_order_relaxed);
+  if (interval > 0 && NowNs() - lastFrame <= kPreviewIdleNs) {
+    snapshot.fps = 1e9 / static_cast<double>(interval);
+  }
+  for (int i = 0; i < kLatencyStageCount; i++) {
+    snapshot.stages[i] = latency->stages[i].Read();
+  }
+  return snapshot;
+}
+
+void LatencyMonitor::Reset(int handle) {
+  std::vector<int> handles;
+  if (handle >= 0) {
+    handles.push_back(handle);
+  } else {
+    handles = Handles();
+  }
+  for (int each : handles) {
+    HandleLatency *latency = For(each);
+    for (LatencyHistogram &histogram : latency->stages) {
+      histogram.Reset();
+    }
+    latency->captures.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::string LatencyMonitor::Prometheus() {
+  std::string text;
+  char line[256];
+  auto append = [&](const char *format, auto... values) {
+    snprintf(line, sizeof(line), format, values...);
+    text += line;
+  };
+
+  std::vector<int> handles = Handles();
+  std::vector<LatencySnapshot> snapshots;
+  std::vector<PreviewStats> previews;
+  for (int handle : handles) {
+    snapshots.push_back(Read(handle));
+    previews.push_back(GetPreviewChannel(handle)->Stats());
+  }
+
+  text +=
+      "# HELP lse_capture_stage_seconds Capture stage latency per device handle.\n"
+      "# TYPE lse_capture_stage_seconds histogram\n";
+  for (size_t h = 0; h < handles.size(); h++) {
+    for (int s = 0; s < kLatencyStageCount; s++) {
+      const LatencyHistogram::Snapshot &stage = snapshots[h].stages[s];
+      const char *name = LatencyStageName(static_cast<LatencyStage>(s));
+      for (double bound : kExportBounds) {
+        append("lse_capture_stage_seconds_bucket{handle=\"%d\",stage=\"%s\",le=\"%g\"} %llu\n", handles[h], name,
+               bound, static_cast<unsigned long long>(stage.CountAtOrBelow(static_cast<uint64_t>(bound * 1e9))));
+      }
+      append("lse_capture_stage_seconds_bucket{handle=\"%d\",stage=\"%s\",le=\"+Inf\"} %llu\n", handles[h], name,
+             static_cast<unsigned long long>(stage.count));
+      append("lse_capture_stage_seconds_sum{handle=\"%d\",stage=\"%s\"} %.9f\n", handles[h], name,
+             static_cast<double>(stage.sum) / 1e9);
+      append("lse_capture_stage_seconds_count{handle=\"%d\",stage=\"%s\"} %llu\n", handles[h], name,
+             static_cast<unsigned long long>(stage.count));
+    }
+  }
+
+  text +=
+      "# HELP lse_captures_total Result images delivered to JS.\n"
+      "# TYPE lse_captures_total counter\n";
+  for (size_t h = 0; h < handles.size(); h++) {
+    append("lse_captures_total{handle=\"%d\"} %llu\n", handles[h],
+           static_cast<unsigned long long>(snapshots[h].captures));
+  }
+  text +=
+      "# HELP lse_preview_frames_total Preview frames received from the SDK.\n"
+      "# TYPE lse_preview_frames_total counter\n";
+  for (size_t h = 0; h < handles.size(); h++) {
+    append("lse_preview_frames_total{handle=\"%d\"} %llu\n", handles[h],
+           static_cast<unsigned long long>(previews[h].received));
+  }
+  text +=
+      "# HELP lse_preview_frames_dropped_total Preview frames dropped by the backpressure policy.\n"
+      "# TYPE lse_preview_frames_dropped_total counter\n";
+  for (size_t h = 0; h < handles.size(); h++) {
+    append("lse_preview_frames_dropped_total{handle=\"%d\"} %llu\n", handles[h],
+           static_cast<unsigned long long>(previews[h].dropped));
+  }
+  text +=
+      "# HELP lse_preview_fps Current preview frame rate.\n"
+      "# TYPE lse_preview_fps gauge\n";
+  for (size_t h = 0; h < handles.size(); h++) {
+    append("lse_preview_fps{handle=\"%d\"} %.2f\n", handles[h], snapshots[h].fps);
+  }
+  return text;
+}
+
+LatencyMonitor &SharedLatencyMonitor() {
+  static LatencyMonitor monitor;
+  return monitor;
+}
+
+}  // namespace lse
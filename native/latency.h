@@ -0,0 +1,146 @@
+/// Always-on per-handle capture latency instrumentation.
+///
+/// Every capture is cut into stages by timestamps the addon already takes:
+///
+///   device      TakingResultImage -> AcquisitionComplete (scanner acquisition)
+///   processing  AcquisitionComplete -> ResultImage (SDK post-processing)
+///   bridge      SDK callback -> JS call, for every callback kind
+///   handler     time spent in the JS handler (callbacks) or batch (capture())
+///   capture     TakingResultImage -> result image handed to JS
+///   preview     interval between preview frames, which gives the frame rate
+///   startup     LSCAN_Capture_Start (or an earlier MarkStart) -> first preview frame
+///
+/// Each stage feeds a LatencyHistogram: HDR-style log-linear buckets, precise to
+/// 1.6% from 1 ns to over two hours, recorded with relaxed atomic adds so
+/// SDK threads and the JS thread never wait for each other or for readers. The
+/// SDK only fires callbacks that something is registered for, so the device and
+/// processing stages need those callbacks registered (capture() registers all).
+
+#pragma once
+
+#include "callbacks.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lse {
+
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 7;
+  static constexpr int kSubBucketCount = 1 << kSubBucketBits;  // Linear steps per power of two
+  static constexpr int kSubBucketHalf = kSubBucketCount / 2;
+  static constexpr int kMagnitudes = 36;                       // Up to 2^43 ns, about 2.4 hours
+  static constexpr int kBucketCount = kSubBucketCount + kMagnitudes * kSubBucketHalf;
+
+  /// Any thread. Values beyond the range land in the last bucket.
+  void Record(uint64_t ns);
+
+  /// Consistent enough for monitoring; concurrent Record()s may be half visible.
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> counts;  ///< kBucketCount entries
+
+    /// Upper bound of the bucket holding the @p quantile (0..1) value, capped at max.
+    uint64_t Quantile(double quantile) const;
+    /// Number of values <= @p ns, at bucket precision.
+    uint64_t CountAtOrBelow(uint64_t ns) const;
+  };
+  Snapshot Read() const;
+
+  void Reset();
+
+  static int BucketOf(uint64_t ns);
+  static uint64_t UpperBound(int bucket);
+
+ private:
+  std::atomic<uint64_t> counts_[kBucketCount] = {};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> min_{UINT64_MAX};
+  std::atomic<uint64_t> max_{0};
+};
+
+enum class LatencyStage : int {
+  kDevice,
+  kProcessing,
+  kBridge,
+  kHandler,
+  kCapture,
+  kPreview,
+  kStartup,
+};
+
+constexpr int kLatencyStageCount = 7;
+
+/// Name of @p stage in stats and exports.
+const char *LatencyStageName(LatencyStage stage);
+
+/// Timestamps (NowNs(), 0 if not reached) of the most recent capture.
+struct CaptureTimes {
+  uint64_t taking = 0;
+  uint64_t acquired = 0;
+  uint64_t result = 0;
+  uint64_t delivered = 0;
+};
+
+/// Timestamps of the most recent start that reached its first preview frame.
+struct StartTimes {
+  uint64_t start = 0;
+  uint64_t firstPreview = 0;
+};
+
+struct LatencySnapshot {
+  uint64_t captures = 0;  ///< Result images handed to JS
+  double fps = 0;         ///< Preview frame rate, smoothed over the last frames
+  CaptureTimes last;
+  StartTimes lastStart;
+  LatencyHistogram::Snapshot stages[kLatencyStageCount];
+};
+
+class LatencyMonitor {
+ public:
+  /// SDK thread, from the trampolines.
+  void OnCallback(CallbackKind kind, int handle, uint64_t timestamp);
+  void OnPreviewFrame(int handle, uint64_t timestamp);
+
+  /// Any thread, before LSCAN_Capture_Start(): the next preview frame ends a
+  /// startup measured from @p timestamp. Keeps an earlier pending MarkStart().
+  void OnStart(int handle, uint64_t timestamp);
+  /// Any thread: measure the next startup from @p timestamp, e.g. from before
+  /// the LSCAN_Capture_SetMode() that precedes the start.
+  void MarkStart(int handle, uint64_t timestamp);
+  /// Any thread: drop a pending startup (failed start, abort).
+  void OnStop(int handle);
+
+  /// JS thread: an event of @p kind, captured at @p timestamp, reached JS at @p now.
+  void OnDelivered(CallbackKind kind, int handle, uint64_t timestamp, uint64_t now);
+  /// JS thread: a handler of @p handle ran for @p ns.
+  void OnHandled(int handle, uint64_t ns);
+
+  /// Handles that have recorded anything, ascending.
+  std::vector<int> Handles();
+  LatencySnapshot Read(int handle);
+
+  /// Clear the histograms and counters of @p handle, or of all handles if -1.
+  void Reset(int handle);
+
+  /// Every handle's histograms, frame and drop counters in Prometheus text format.
+  std::string Prometheus();
+
+  /// Per-handle state; defined in latency.cc.
+  struct HandleLatency;
+
+ private:
+  HandleLatency *For(int handle);
+};
+
+LatencyMonitor &SharedLatencyMonitor();
+
+}  // namespace lse
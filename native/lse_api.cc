@@ -0,0 +1,118 @@
+#include "lse_api.h"
+
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace lse {
+
+namespace {
+
+std::mutex g_mutex;
+Api g_api;
+StubApi g_stub_api;
+std::string g_path;
+std::atomic<bool> g_loaded{false};
+
+#ifdef _WIN32
+using LibraryHandle = HMODULE;
+
+LibraryHandle OpenLibrary(const std::string &path, bool /*eager*/, std::string *error) {
+  HMODULE module = LoadLibraryA(path.c_str());
+  if (module == nullptr) {
+    *error = "LoadLibrary failed for " + path + " (error " + std::to_string(GetLastError()) + ")";
+  }
+  return module;
+}
+
+void *FindSymbol(LibraryHandle library, const char *name, int argBytes) {
+  void *symbol = reinterpret_cast<void *>(GetProcAddress(library, name));
+#ifndef _WIN64
+  if (symbol == nullptr) {
+    // 32-bit stdcall exports are decorated: _Name@ArgBytes
+    std::string decorated = std::string("_") + name + "@" + std::to_string(argBytes);
+    symbol = reinterpret_cast<void *>(GetProcAddress(library, decorated.c_str()));
+  }
+#else
+  (void)argBytes;
+#endif
+  return symbol;
+}
+#else
+using LibraryHandle = void *;
+
+LibraryHandle OpenLibrary(const std::string &path, bool eager, std::string *error) {
+  void *library = dlopen(path.c_str(), (eager ? RTLD_NOW : RTLD_LAZY) | RTLD_LOCAL);
+  if (library == nullptr) {
+    const char *reason = dlerror();
+    *error = reason != nullptr ? reason : "dlopen failed for " + path;
+  }
+  return library;
+}
+
+void *FindSymbol(LibraryHandle library, const char *name, int /*argBytes*/) {
+  return dlsym(library, name);
+}
+#endif
+
+LibraryHandle g_library = nullptr;  // Set once, before g_loaded
+
+}  // namespace
+
+void *FindApiSymbol(const char *name, int argBytes, bool *loaded) {
+  *loaded = g_loaded.load(std::memory_order_acquire);
+  return *loaded ? FindSymbol(g_library, name, argBytes) : nullptr;
+}
+
+bool LoadApi(const std::string &path, bool eager, std::string *error) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (g_loaded.load(std::memory_order_relaxed)) {
+    if (path == g_path) {
+      return true;
+    }
+    *error = "LScanEssentials already loaded from " + g_path;
+    return false;
+  }
+
+  LibraryHandle library = OpenLibrary(path, eager, error);
+  if (library == nullptr) {
+    return false;
+  }
+
+  // The library stays loaded for the lifetime of the process: SDK threads may
+  // still be running callbacks into us when the addon is torn down.
+  g_library = library;
+  g_path = path;
+  g_loaded.store(true, std::memory_order_release);
+  if (eager) {
+#define LSE_API_RESOLVE(name, argBytes) g_api.name.get();
+    LSE_API_FUNCTIONS(LSE_API_RESOLVE)
+#undef LSE_API_RESOLVE
+#define LSE_STUB_RESOLVE(name) g_stub_api.name.get();
+    LSE_STUB_FUNCTIONS(LSE_STUB_RESOLVE)
+#undef LSE_STUB_RESOLVE
+  }
+  return true;
+}
+
+bool IsApiLoaded() {
+  return g_loaded.load(std::memory_order_acquire);
+}
+
+const std::string &LoadedApiPath() {
+  return g_path;
+}
+
+const Api &GetApi() {
+  return g_api;
+}
+
+const StubApi &GetStubApi() {
+  return g_stub_api;
+}
+
+}  // namespace lse
@@ -0,0 +1,173 @@
+/// Runtime binding of the LScanEssentials library.
+///
+/// The library is loaded with dlopen()/LoadLibrary() instead of being linked so that
+/// the addon can be pointed at the vendor DLL on Windows or at the Linux stub library
+/// (native/stub) without rebuilding. Every function of
+/// resources/reference/LScanEssentialsApi.h is listed once in LSE_API_FUNCTIONS; the
+/// function pointer types are taken from the header itself via decltype so a signature
+/// mismatch is a compile error rather than a stack corruption.
+///
+/// Entry points are looked up on first use rather than at load, and the library is
+/// opened with lazy binding, so loading costs the same however many functions a
+/// process ends up calling. An eager load resolves everything up front instead.
+
+#pragma once
+
+#include "LScanEssentialsApi.h"
+#include "stub/lscan_stub.h"
+
+#include <atomic>
+#include <string>
+
+/// X(name, stdcallArgBytes) for every exported API function.
+/// The byte count is needed for the decorated 32-bit stdcall symbol names
+/// (e.g. _LSCAN_Main_GetDeviceCount@4) exported by LScanEssentials-x86.dll.
+#define LSE_API_FUNCTIONS(X)                            \
+  X(LSCAN_Main_GetAPIVersion, 4)                        \
+  X(LSCAN_Main_GetDeviceCount, 4)                       \
+  X(LSCAN_Main_GetDeviceInfo, 8)                        \
+  X(LSCAN_Main_RegisterCallbackProgress, 8)             \
+  X(LSCAN_Main_RegisterCallbackDeviceCount, 8)          \
+  X(LSCAN_Main_ImageQualityInfieldTest, 8)              \
+  X(LSCAN_Main_InstallLicenseFile, 8)                   \
+  X(LSCAN_Main_Initialize, 12)                          \
+  X(LSCAN_Main_Initialize_ExternalVisualization, 16)    \
+  X(LSCAN_Main_Release, 8)                              \
+  X(LSCAN_Main_ReleaseAll, 4)                           \
+  X(LSCAN_Main_IsInitialized, 4)                        \
+  X(LSCAN_Main_GetProperty, 12)                         \
+  X(LSCAN_Main_SetProperty, 12)                         \
+  X(LSCAN_Main_CheckCleanliness, 4)                     \
+  X(LSCAN_Main_ForceReadjustment, 4)                    \
+  X(LSCAN_Main_RegisterCallbackCommunicationBreak, 12)  \
+  X(LSCAN_Capture_IsModeAvailable, 16)                  \
+  X(LSCAN_Capture_SetMode, 36)                          \
+  X(LSCAN_Capture_Start, 8)                             \
+  X(LSCAN_Capture_Abort, 4)                             \
+  X(LSCAN_Capture_IsActive, 8)                          \
+  X(LSCAN_Capture_TakeResultImage, 4)                   \
+  X(LSCAN_Capture_OptimizeContrast, 4)                  \
+  X(LSCAN_Capture_GetContrast, 8)                       \
+  X(LSCAN_Capture_SetContrast, 8)                       \
+  X(LSCAN_Capture_SetActiveArea, 20)                    \
+  X(LSCAN_Capture_RegisterCallbackPreviewImage, 12)     \
+  X(LSCAN_Capture_RegisterCallbackObjectCount, 12)      \
+  X(LSCAN_Capture_RegisterCallbackObjectQuality, 12)    \
+  X(LSCAN_Capture_RegisterCallbackTakingResultImage, 12) \
+  X(LSCAN_Capture_RegisterCallbackAcquisitionComplete, 12) \
+  X(LSCAN_Capture_RegisterCallbackResultImage, 12)      \
+  X(LSCAN_Capture_RegisterCallbackClearObjectsFromPlaten, 12) \
+  X(LSCAN_Controls_GetAvailableBeeper, 8)               \
+  X(LSCAN_Controls_Beeper, 12)                          \
+  X(LSCAN_Controls_GetAvailableKeys, 16)                \
+  X(LSCAN_Controls_SetActiveKeys, 8)                    \
+  X(LSCAN_Controls_GetAvailableLEDs, 16)                \
+  X(LSCAN_Controls_SetActiveLEDs, 8)                    \
+  X(LSCAN_Controls_GetActiveLEDs, 8)                    \
+  X(LSCAN_Controls_RegisterCallbackKeys, 12)            \
+  X(LSCAN_Controls_DisplayShowLogoScreen, 12)           \
+  X(LSCAN_Controls_DisplayShowModeSelectScreen, 4)      \
+  X(LSCAN_Controls_DisplayShowResolutionSelectScreen, 4) \
+  X(LSCAN_Controls_DisplayShowFingerSelectionScreen, 84) \
+  X(LSCAN_Controls_DisplayShowNextFingerSelection, 8)   \
+  X(LSCAN_Controls_DisplayShowCaptureProgressScreen, 92) \
+  X(LSCAN_Visualization_Create, 0)                      \
+  X(LSCAN_Visualization_Destroy, 4)                     \
+  X(LSCAN_Visualization_SetMode, 12)                    \
+  X(LSCAN_Visualization_SetWindow, 24)                  \
+  X(LSCAN_Visualization_GetScaleFactor, 8)              \
+  X(LSCAN_Visualization_SetBackgroundColor, 8)          \
+  X(LSCAN_Visualization_RemoveOverlay, 8)               \
+  X(LSCAN_Visualization_RemoveAllOverlays, 4)           \
+  X(LSCAN_Visualization_ShowOverlay, 12)                \
+  X(LSCAN_Visualization_ShowAllOverlays, 8)             \
+  X(LSCAN_Visualization_AddOverlayText, 36)             \
+  X(LSCAN_Visualization_ModifyOverlayText, 20)          \
+  X(LSCAN_Visualization_AddOverlayQuadrangle, 52)       \
+  X(LSCAN_Visualization_ModifyOverlayQuadrangle, 40)    \
+  X(LSCAN_Visualization_AddOverlayLine, 36)             \
+  X(LSCAN_Visualization_ModifyOverlayLine, 24)
+
+/// X(name) for the optional control functions of the stub library.
+#define LSE_STUB_FUNCTIONS(X)  \
+  X(LScanStub_FireCallbacks)   \
+  X(LScanStub_SetDeviceCount)  \
+  X(LScanStub_SetPreview)      \
+  X(LScanStub_SetResultImages) \
+  X(LScanStub_InjectError)     \
+  X(LScanStub_SetLatency)      \
+  X(LScanStub_Disconnect)      \
+  X(LScanStub_Unplug)
+
+namespace lse {
+
+/// Address of @p name (decorated for @p argBytes where the platform needs it) in
+/// the loaded library, or nullptr. Sets @p loaded if a library is loaded at all.
+void *FindApiSymbol(const char *name, int argBytes, bool *loaded);
+
+/// One entry point, looked up on first use and kept from then on. Converts to
+/// the function pointer, so it is called and compared with nullptr like one.
+template <typename Function>
+class ApiEntry {
+ public:
+  ApiEntry(const char *name, int argBytes) : name_(name), argBytes_(argBytes) {}
+  ApiEntry(const ApiEntry &) = delete;
+  ApiEntry &operator=(const ApiEntry &) = delete;
+
+  /// Any thread. The entry point, or nullptr if the library does not export it.
+  Function get() const {
+    if (resolved_.load(std::memory_order_acquire)) {
+      return function_.load(std::memory_order_relaxed);
+    }
+    bool loaded = false;
+    Function function = reinterpret_cast<Function>(FindApiSymbol(name_, argBytes_, &loaded));
+    if (loaded) {  // Before load() there is nothing to remember
+      function_.store(function, std::memory_order_relaxed);
+      resolved_.store(true, std::memory_order_release);
+    }
+    return function;
+  }
+
+  operator Function() const { return get(); }
+
+ private:
+  const char *const name_;
+  const int argBytes_;
+  mutable std::atomic<Function> function_{nullptr};
+  mutable std::atomic<bool> resolved_{false};
+};
+
+/// Entry points of the loaded library. A member is null if the library does not
+/// export the symbol (e.g. an older SDK release).
+struct Api {
+#define LSE_API_MEMBER(name, argBytes) ApiEntry<decltype(&::name)> name{#name, argBytes};
+  LSE_API_FUNCTIONS(LSE_API_MEMBER)
+#undef LSE_API_MEMBER
+};
+
+/// Stub control entry points; all null unless the stub library is loaded.
+struct StubApi {
+#define LSE_STUB_MEMBER(name) ApiEntry<decltype(&::name)> name{#name, 0};
+  LSE_STUB_FUNCTIONS(LSE_STUB_MEMBER)
+#undef LSE_STUB_MEMBER
+};
+
+/// Load the library at @p path. Entry points resolve on first use, or all at once
+/// with @p eager (which also binds the library's own imports immediately).
+/// Returns false and fills @p error if the library cannot be opened.
+/// Loading the same path again is a no-op; loading a different path is rejected.
+bool LoadApi(const std::string &path, bool eager, std::string *error);
+
+/// True once LoadApi() succeeded.
+bool IsApiLoaded();
+
+/// Path of the loaded library (empty if none).
+const std::string &LoadedApiPath();
+
+/// The entry points; all null until LoadApi() succeeded.
+const Api &GetApi();
+
+/// The resolved stub control entry points.
+const StubApi &GetStubApi();
+
+}  // namespace lse
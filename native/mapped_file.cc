@@ -0,0 +1,217 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace lse {
+
+MappedFile::~MappedFile() {
+  Close(size_);
+}
+
+#ifdef _WIN32
+
+namespace {
+
+std::string LastError(const char *what, const std::string &path) {
+  return std::string(what) + " failed for " + path + " (error " + std::to_string(GetLastError()) + ")";
+}
+
+}  // namespace
+
+bool MappedFile::OpenRead(const std::string &path, std::string *error) {
+  Close();
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    *error = LastError("CreateFile", path);
+    return false;
+  }
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  file_ = file;
+  path_ = path;
+  size_ = static_cast<size_t>(size.QuadPart);
+  writable_ = false;
+  if (!Map(error)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::Create(const std::string &path, size_t capacity, std::string *error) {
+  Close();
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    *error = LastError("CreateFile", path);
+    return false;
+  }
+  file_ = file;
+  path_ = path;
+  writable_ = true;
+  size_ = capacity;
+  if (!Map(error)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::Map(std::string *error) {
+  if (size_ == 0) {
+    *error = "Cannot map an empty file";
+    return false;
+  }
+  // A writable mapping larger than the file extends it.
+  ULARGE_INTEGER size;
+  size.QuadPart = size_;
+  mapping_ = CreateFileMappingA(file_, nullptr, writable_ ? PAGE_READWRITE : PAGE_READONLY, size.HighPart,
+                                size.LowPart, nullptr);
+  if (mapping_ == nullptr) {
+    *error = LastError("CreateFileMapping", path_);
+    return false;
+  }
+  data_ = static_cast<uint8_t *>(MapViewOfFile(mapping_, writable_ ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size_));
+  if (data_ == nullptr) {
+    *error = LastError("MapViewOfFile", path_);
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+}
+
+bool MappedFile::Grow(size_t capacity, std::string *error) {
+  Unmap();
+  size_ = capacity;
+  return Map(error);
+}
+
+void MappedFile::Close(size_t length) {
+  Unmap();
+  if (file_ != nullptr) {
+    if (writable_) {
+      LARGE_INTEGER end;
+      end.QuadPart = static_cast<LONGLONG>(length);
+      SetFilePointerEx(file_, end, nullptr, FILE_BEGIN);
+      SetEndOfFile(file_);
+    }
+    CloseHandle(file_);
+    file_ = nullptr;
+  }
+  size_ = 0;
+}
+
+#else
+
+namespace {
+
+std::string LastError(const char *what, const std::string &path) {
+  return std::string(what) + " failed for " + path + ": " + strerror(errno);
+}
+
+}  // namespace
+
+bool MappedFile::OpenRead(const std::string &path, std::string *error) {
+  Close();
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat info;
+  if (fd_ < 0 || fstat(fd_, &info) != 0) {
+    *error = LastError("open", path);
+    Close();
+    return false;
+  }
+  path_ = path;
+  size_ = static_cast<size_t>(info.st_size);
+  writable_ = false;
+  if (!Map(error)) {
+    Close();
+    return false;
+  }
+  // Replay reads front to back; let the kernel read ahead aggressively.
+  madvise(data_, size_, MADV_SEQUENTIAL);
+  return true;
+}
+
+bool MappedFile::Create(const std::string &path, size_t capacity, std::string *error) {
+  Close();
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    *error = LastError("open", path);
+    return false;
+  }
+  path_ = path;
+  writable_ = true;
+  if (!Grow(capacity, error)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::Map(std::string *error) {
+  if (size_ == 0) {
+    *error = "Cannot map an empty file";
+    return false;
+  }
+  void *data = mmap(nullptr, size_, writable_ ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {
+    *error = LastError("mmap", path_);
+    return false;
+  }
+  data_ = static_cast<uint8_t *>(data);
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+  }
+}
+
+bool MappedFile::Grow(size_t capacity, std::string *error) {
+  Unmap();
+  if (ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+    *error = LastError("ftruncate", path_);
+    return false;
+  }
+  size_ = capacity;
+  return Map(error);
+}
+
+void MappedFile::Close(size_t length) {
+  Unmap();
+  if (fd_ >= 0) {
+    if (writable_ && ftruncate(fd_, static_cast<off_t>(length)) != 0) {
+      // Nothing to report to; the file keeps its zero-filled tail, which readers skip.
+    }
+    close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+}
+
+#endif
+
+}  // namespace lse
@@ -0,0 +1,54 @@
+/// A file mapped into memory, for the session recorder and its replay.
+///
+/// Writable files grow in place: Grow() extends the file and maps it again, so
+/// pointers into data() are only valid until the next Grow(). Read-only files
+/// are mapped once, whole.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lse {
+
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  /// Map the existing file at @p path read-only.
+  bool OpenRead(const std::string &path, std::string *error);
+
+  /// Create (or truncate) the file at @p path, @p capacity bytes long, zero filled.
+  bool Create(const std::string &path, size_t capacity, std::string *error);
+
+  /// Writable files: extend the file to @p capacity bytes and remap it.
+  bool Grow(size_t capacity, std::string *error);
+
+  /// Unmap and close. Writable files are first cut to @p length bytes.
+  void Close(size_t length = 0);
+
+  bool is_open() const { return data_ != nullptr; }
+  uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  bool Map(std::string *error);
+  void Unmap();
+
+  uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  bool writable_ = false;
+  std::string path_;  // For error messages
+#ifdef _WIN32
+  void *file_ = nullptr;     // HANDLE
+  void *mapping_ = nullptr;  // HANDLE
+#else
+  int fd_ = -1;
+#endif
+};
+
+}  // namespace lse
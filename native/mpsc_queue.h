@@ -0,0 +1,66 @@
+/// Intrusive lock-free multi-producer/single-consumer queue (Vyukov).
+///
+/// Push() is wait-free: one atomic exchange plus one store, so SDK threads never
+/// block on a lock held by the JS thread. Pop() is only called by the single
+/// consumer. A producer preempted between its exchange and its link makes Pop()
+/// report empty until the link is published; callers must re-check after the
+/// producer signals (see Dispatcher).
+///
+/// T must have a member `std::atomic<T *> next`.
+
+#pragma once
+
+#include <atomic>
+
+namespace lse {
+
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) { stub_.next.store(nullptr, std::memory_order_relaxed); }
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  /// Any thread.
+  void Push(T *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    T *previous = head_.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  /// Consumer thread only. Returns nullptr if empty (or a push is mid-flight).
+  T *Pop() {
+    T *tail = tail_;
+    T *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    // Last real node: re-insert the stub so it can be detached.
+    Push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+ private:
+  std::atomic<T *> head_;
+  T *tail_;
+  T stub_;
+};
+
+}  // namespace lse
@@ -0,0 +1,233 @@
+#include "napi_util.h"
+
+#include <cstdio>
+
+namespace lse {
+
+void ThrowLastError(napi_env env) {
+  bool pending = false;
+  napi_is_exception_pending(env, &pending);
+  if (pending) {
+    return;
+  }
+  const napi_extended_error_info *info = nullptr;
+  napi_get_last_error_info(env, &info);
+  const char *message = (info != nullptr && info->error_message != nullptr) ? info->error_message
+                                                                            : "N-API call failed";
+  napi_throw_error(env, nullptr, message);
+}
+
+Args::Args(napi_env env, napi_callback_info info) : env_(env) {
+  if (napi_get_cb_info(env, info, &argc_, argv_, &this_, &data_) != napi_ok) {
+    ThrowLastError(env);
+    ok_ = false;
+    argc_ = 0;
+  }
+  if (argc_ > kMaxArgs) {
+    argc_ = kMaxArgs;
+  }
+}
+
+void Args::Fail(size_t i, const char *expected) {
+  if (!ok_) {
+    return;
+  }
+  char message[96];
+  snprintf(message, sizeof(message), "Argument %zu: expected %s", i, expected);
+  napi_throw_type_error(env_, nullptr, message);
+  ok_ = false;
+}
+
+int32_t Args::Int(size_t i) {
+  int32_t value = 0;
+  if (ok_ && (i >= argc_ || napi_get_value_int32(env_, argv_[i], &value) != napi_ok)) {
+    Fail(i, "a number");
+  }
+  return value;
+}
+
+uint32_t Args::Dword(size_t i) {
+  uint32_t value = 0;
+  if (ok_ && (i >= argc_ || napi_get_value_uint32(env_, argv_[i], &value) != napi_ok)) {
+    Fail(i, "a number");
+  }
+  return value;
+}
+
+double Args::Double(size_t i) {
+  double value = 0;
+  if (ok_ && (i >= argc_ || napi_get_value_double(env_, argv_[i], &value) != napi_ok)) {
+    Fail(i, "a number");
+  }
+  return value;
+}
+
+int Args::Bool(size_t i) {
+  if (!ok_ || i >= argc_) {
+    Fail(i, "a boolean");
+    return 0;
+  }
+  bool value = false;
+  if (napi_get_value_bool(env_, argv_[i], &value) == napi_ok) {
+    return value ? 1 : 0;
+  }
+  // The SDK's BOOL is an int; accept numbers as well.
+  int32_t number = 0;
+  if (napi_get_value_int32(env_, argv_[i], &number) == napi_ok) {
+    return number != 0 ? 1 : 0;
+  }
+  Fail(i, "a boolean");
+  return 0;
+}
+
+const char *Args::String(size_t i) {
+  if (!ok_) {
+    return "";
+  }
+  if (strings_used_ == kMaxStrings) {
+    Fail(i, "fewer string arguments");
+    return "";
+  }
+  char *storage = strings_[strings_used_];
+  size_t length = 0;
+  if (i >= argc_ ||
+      napi_get_value_string_utf8(env_, argv_[i], storage, kMaxStringLength, &length) != napi_ok) {
+    Fail(i, "a string");
+    return "";
+  }
+  if (length == kMaxStringLength - 1) {
+    Fail(i, "a string shorter than 1023 bytes");
+    return "";
+  }
+  strings_used_++;
+  return storage;
+}
+
+bool Args::IsNullish(size_t i) const {
+  if (i >= argc_) {
+    return true;
+  }
+  napi_valuetype type = napi_undefined;
+  napi_typeof(env_, argv_[i], &type);
+  return type == napi_undefined || type == napi_null;
+}
+
+napi_value Args::FunctionOrNull(size_t i) {
+  if (!ok_ || IsNullish(i)) {
+    return nullptr;
+  }
+  napi_valuetype type = napi_undefined;
+  napi_typeof(env_, argv_[i], &type);
+  if (type != napi_function) {
+    Fail(i, "a function or null");
+    return nullptr;
+  }
+  return argv_[i];
+}
+
+uint8_t *Args::Bytes(size_t i, size_t *length) {
+  *length = 0;
+  if (!ok_) {
+    return nullptr;
+  }
+  napi_typedarray_type type = napi_int8_array;
+  void *data = nullptr;
+  bool isTypedArray = false;
+  if (i >= argc_ || napi_is_typedarray(env_, argv_[i], &isTypedArray) != napi_ok || !isTypedArray ||
+      napi_get_typedarray_info(env_, argv_[i], &type, length, &data, nullptr, nullptr) != napi_ok ||
+      (type != napi_uint8_array && type != napi_uint8_clamped_array)) {
+    *length = 0;
+    Fail(i, "a Buffer or Uint8Array");
+    return nullptr;
+  }
+  return static_cast<uint8_t *>(data);
+}
+
+namespace {
+
+double *g_outputs = nullptr;
+napi_ref g_outputs_ref = nullptr;
+
+}  // namespace
+
+napi_value CreateOutputs(napi_env env) {
+  napi_value buffer = nullptr;
+  napi_value array = nullptr;
+  void *data = nullptr;
+  NAPI_CHECK(env, napi_create_arraybuffer(env, kOutputSlots * sizeof(double), &data, &buffer));
+  NAPI_CHECK(env, napi_create_typedarray(env, napi_float64_array, kOutputSlots, buffer, 0, &array));
+  NAPI_CHECK(env, napi_create_reference(env, buffer, 1, &g_outputs_ref));
+  g_outputs = static_cast<double *>(data);
+  return array;
+}
+
+double *Outputs() {
+  return g_outputs;
+}
+
+napi_value MakeInt(napi_env env, int32_t value) {
+  napi_value result = nullptr;
+  napi_create_int32(env, value, &result);
+  return result;
+}
+
+napi_value MakeUint(napi_env env, uint32_t value) {
+  napi_value result = nullptr;
+  napi_create_uint32(env, value, &result);
+  return result;
+}
+
+napi_value MakeDouble(napi_env env, double value) {
+  napi_value result = nullptr;
+  napi_create_double(env, value, &result);
+  return result;
+}
+
+napi_value MakeBool(napi_env env, bool value) {
+  napi_value result = nullptr;
+  napi_get_boolean(env, value, &result);
+  return result;
+}
+
+napi_value MakeString(napi_env env, const char *value) {
+  napi_value result = nullptr;
+  napi_create_string_utf8(env, value != nullptr ? value : "", NAPI_AUTO_LENGTH, &result);
+  return result;
+}
+
+ResultObject &ResultObject::Set(const char *name, napi_value value) {
+  if (count_ < kMaxProperties) {
+    properties_[count_++] = {name, nullptr, nullptr, nullptr, nullptr, value,
+                             static_cast<napi_property_attributes>(napi_writable | napi_enumerable | napi_configurable),
+                             nullptr};
+  }
+  return *this;
+}
+
+napi_value ResultObject::value() {
+  if (object_ == nullptr) {
+    napi_create_object(env_, &object_);
+    napi_define_properties(env_, object_, count_, properties_);
+  }
+  return object_;
+}
+
+void MethodTable::Add(const char *name, napi_callback callback, void *data) {
+  if (count == kMaxMethods) {
+    return;
+  }
+  entries[count++] = {name, nullptr, callback, nullptr, nullptr, nullptr, napi_enumerable, data};
+}
+
+void MethodTable::AddValue(const char *name, napi_value value) {
+  if (count == kMaxMethods) {
+    return;
+  }
+  entries[count++] = {name, nullptr, nullptr, nullptr, nullptr, value, napi_enumerable, nullptr};
+}
+
+napi_status MethodTable::Define(napi_env env, napi_value target) const {
+  return napi_define_properties(env, target, count, entries);
+}
+
+}  // namespace lse
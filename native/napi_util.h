@@ -0,0 +1,127 @@
+/// Small helpers around the N-API C interface shared by the binding sources.
+
+#pragma once
+
+#include <node_api.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace lse {
+
+/// Evaluate an N-API call; on failure throw a JS error (unless one is pending)
+/// and return @p ret from the enclosing function.
+#define NAPI_CHECK_RETURN(env, call, ret)                                   \
+  do {                                                                      \
+    if ((call) != napi_ok) {                                                \
+      ::lse::ThrowLastError(env);                                           \
+      return ret;                                                           \
+    }                                                                       \
+  } while (0)
+
+#define NAPI_CHECK(env, call) NAPI_CHECK_RETURN(env, call, nullptr)
+
+void ThrowLastError(napi_env env);
+
+/// Argument accessor for a binding call. Conversions never allocate: strings are
+/// copied into fixed storage inside the object, which lives on the caller's stack.
+/// A failed conversion throws a TypeError and flips ok() to false; bindings check
+/// ok() once after reading all arguments.
+class Args {
+ public:
+  static constexpr size_t kMaxArgs = 24;
+  static constexpr size_t kMaxStrings = 2;
+  static constexpr size_t kMaxStringLength = 1024;
+
+  Args(napi_env env, napi_callback_info info);
+
+  napi_env env() const { return env_; }
+  size_t count() const { return argc_; }
+  bool ok() const { return ok_; }
+  napi_value operator[](size_t i) const { return i < argc_ ? argv_[i] : nullptr; }
+  napi_value This() const { return this_; }
+  void *Data() const { return data_; }
+
+  int32_t Int(size_t i);
+  uint32_t Dword(size_t i);
+  double Double(size_t i);
+  int Bool(size_t i);
+  const char *String(size_t i);
+  /// True if argument @p i is missing, undefined or null.
+  bool IsNullish(size_t i) const;
+  /// Argument @p i as a function; nullptr (without error) if nullish.
+  napi_value FunctionOrNull(size_t i);
+  /// Contents of argument @p i, a Buffer or Uint8Array; not copied.
+  uint8_t *Bytes(size_t i, size_t *length);
+
+  /// Throw a TypeError mentioning argument @p i and mark the call failed.
+  void Fail(size_t i, const char *expected);
+
+ private:
+  napi_env env_;
+  size_t argc_ = kMaxArgs;
+  napi_value argv_[kMaxArgs];
+  napi_value this_ = nullptr;
+  void *data_ = nullptr;
+  bool ok_ = true;
+  size_t strings_used_ = 0;
+  char strings_[kMaxStrings][kMaxStringLength];
+};
+
+napi_value MakeInt(napi_env env, int32_t value);
+napi_value MakeUint(napi_env env, uint32_t value);
+napi_value MakeDouble(napi_env env, double value);
+napi_value MakeBool(napi_env env, bool value);
+napi_value MakeString(napi_env env, const char *value);
+
+/// Builder for plain result objects: ResultObject(env).Set("status", ...).value()
+/// Properties are collected and defined in one napi_define_properties() call,
+/// which is several times cheaper than one napi_set_named_property() per field.
+class ResultObject {
+ public:
+  static constexpr size_t kMaxProperties = 16;
+
+  explicit ResultObject(napi_env env) : env_(env) {}
+  ResultObject &Set(const char *name, napi_value value);
+  ResultObject &Int(const char *name, int32_t value) { return Set(name, MakeInt(env_, value)); }
+  ResultObject &Uint(const char *name, uint32_t value) { return Set(name, MakeUint(env_, value)); }
+  ResultObject &Double(const char *name, double value) { return Set(name, MakeDouble(env_, value)); }
+  ResultObject &Bool(const char *name, bool value) { return Set(name, MakeBool(env_, value)); }
+  ResultObject &String(const char *name, const char *value) { return Set(name, MakeString(env_, value)); }
+  napi_value value();
+
+ private:
+  napi_env env_;
+  napi_value object_ = nullptr;
+  size_t count_ = 0;
+  napi_property_descriptor properties_[kMaxProperties];
+};
+
+/// Shared slots for numeric [out] parameters.
+///
+/// Building a result object from native code costs far more than the SDK call
+/// itself, so bindings write numeric outputs into this Float64Array (exported as
+/// `outputs`) and return only the status; src/lse-binding.js assembles the
+/// { status, ...outputs } objects in JS. The array is owned by the JS heap and
+/// valid until the next binding call on the same thread.
+constexpr size_t kOutputSlots = 8;
+
+/// Allocate the slots for @p env; returns the Float64Array to export.
+napi_value CreateOutputs(napi_env env);
+
+/// The slot array; writes are visible through the exported Float64Array.
+double *Outputs();
+
+/// Append one method to an export table.
+struct MethodTable {
+  static constexpr size_t kMaxMethods = 192;
+  napi_property_descriptor entries[kMaxMethods];
+  size_t count = 0;
+
+  void Add(const char *name, napi_callback callback, void *data = nullptr);
+  void AddValue(const char *name, napi_value value);
+  napi_status Define(napi_env env, napi_value target) const;
+};
+
+}  // namespace lse
@@ -0,0 +1,203 @@
+#include "overlay_raster.h"
+
+#include "image_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lse {
+
+namespace {
+
+/// 5x7 glyphs of ASCII 32..126, one byte per column, bit 0 at the top; bit 7
+/// is the descender row.
+const uint8_t kFont[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00},
+    {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E},
+    {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40},
+    {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, {0x38, 0x44, 0x44, 0x28, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00},
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0xFC, 0x18, 0x24, 0x24, 0x18},
+    {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24},
+    {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x77, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},
+};
+
+constexpr int kCellWidth = 6;
+constexpr int kCellHeight = 8;
+
+struct Pen {
+  const Canvas &canvas;
+  uint8_t color[4];
+  int alpha;
+
+  /// Pixels [x0, x1) of row @p y.
+  void Span(int y, int x0, int x1) const {
+    if (y < 0 || y >= canvas.height) {
+      return;
+    }
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, canvas.width);
+    if (x0 >= x1) {
+      return;
+    }
+    size_t offset = (static_cast<size_t>(y) * canvas.width + x0) * canvas.channels;
+    BlendSpan(canvas.pixels + offset, static_cast<size_t>(x1 - x0), canvas.channels, color, alpha);
+  }
+
+  /// Convex polygon of @p count corners, sampled at pixel centres.
+  void Polygon(const double *xs, const double *ys, int count) const {
+    double top = *std::min_element(ys, ys + count);
+    double bottom = *std::max_element(ys, ys + count);
+    int y0 = std::max(0, static_cast<int>(std::ceil(top - 0.5)));
+    int y1 = std::min(canvas.height, static_cast<int>(std::ceil(bottom - 0.5)));
+    for (int y = y0; y < y1; y++) {
+      double center = y + 0.5;
+      double left = 1e300;
+      double right = -1e300;
+      for (int i = 0; i < count; i++) {
+        int j = (i + 1) % count;
+        double ya = ys[i];
+        double yb = ys[j];
+        if ((center < ya && center < yb) || (center >= ya && center >= yb)) {
+          continue;
+        }
+        double x = xs[i] + (center - ya) * (xs[j] - xs[i]) / (yb - ya);
+        left = std::min(left, x);
+        right = std::max(right, x);
+      }
+      if (left <= right) {
+        Span(y, static_cast<int>(std::ceil(left - 0.5)), static_cast<int>(std::ceil(right - 0.5)));
+      }
+    }
+  }
+
+  void Line(double xa, double ya, double xb, double yb, int width) const {
+    double dx = xb - xa;
+    double dy = yb - ya;
+    double length = std::sqrt(dx * dx + dy * dy);
+    double half = std::max(width, 1) / 2.0;
+    // Unit direction (any for a zero-length line, which becomes a square).
+    double ux = length > 0 ? dx / length : 1;
+    double uy = length > 0 ? dy / length : 0;
+    double ax = ux * half;
+    double ay = uy * half;
+    double xs[4] = {xa - ax + ay, xb + ax + ay, xb + ax - ay, xa - ax - ay};
+    double ys[4] = {ya - ay - ax, yb + ay - ax, yb + ay + ax, ya - ay + ax};
+    Polygon(xs, ys, 4);
+  }
+
+  void Text(const std::string &text, int x, int y, int scale) const {
+    int column = 0;
+    int line = 0;
+    for (char c : text) {
+      if (c == '\n') {
+        column = 0;
+        line++;
+        continue;
+      }
+      unsigned index = static_cast<unsigned char>(c) - 32u;
+      const uint8_t *glyph = kFont[index < 95 ? index : '?' - 32];
+      int left = x + column * kCellWidth * scale;
+      int top = y + line * kCellHeight * scale;
+      column++;
+      if (left >= canvas.width || top >= canvas.height) {
+        continue;
+      }
+      for (int row = 0; row < kCellHeight; row++) {
+        // Runs of set pixels in this glyph row, one span per run and pixel row.
+        for (int col = 0; col < 5;) {
+          if (((glyph[col] >> row) & 1) == 0) {
+            col++;
+            continue;
+          }
+          int end = col + 1;
+          while (end < 5 && ((glyph[end] >> row) & 1) != 0) {
+            end++;
+          }
+          for (int dy = 0; dy < scale; dy++) {
+            Span(top + row * scale + dy, left + col * scale, left + end * scale);
+          }
+          col = end;
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
+void CanvasColor(COLORREF color, int channels, uint8_t *bytes) {
+  int r = color & 0xff;
+  int g = (color >> 8) & 0xff;
+  int b = (color >> 16) & 0xff;
+  if (channels == 1) {
+    bytes[0] = static_cast<uint8_t>((r * 77 + g * 150 + b * 29 + 128) >> 8);
+    return;
+  }
+  bytes[0] = static_cast<uint8_t>(r);
+  bytes[1] = static_cast<uint8_t>(g);
+  bytes[2] = static_cast<uint8_t>(b);
+  bytes[3] = 255;
+}
+
+void DrawOverlay(const Canvas &canvas, const ImagePlacement &placement, const OverlaySpec &overlay) {
+  int alpha = 255 - static_cast<int>((overlay.color >> 24) & 0xff);
+  if (!overlay.visible || alpha == 0) {
+    return;
+  }
+  Pen pen{canvas, {}, alpha};
+  CanvasColor(overlay.color, canvas.channels, pen.color);
+
+  double xs[4];
+  double ys[4];
+  for (int i = 0; i < 4; i++) {
+    xs[i] = overlay.points[2 * i];
+    ys[i] = overlay.points[2 * i + 1];
+    if (overlay.belongsToImage) {
+      xs[i] = placement.x + xs[i] * placement.scaleX;
+      ys[i] = placement.y + ys[i] * placement.scaleY;
+    }
+  }
+  switch (overlay.kind) {
+    case OverlayKind::kText: {
+      int scale = std::max(1, (overlay.fontSize + 4) / kCellHeight);
+      pen.Text(overlay.text, static_cast<int>(std::lround(xs[0])), static_cast<int>(std::lround(ys[0])), scale);
+      return;
+    }
+    case OverlayKind::kLine:
+      pen.Line(xs[0], ys[0], xs[1], ys[1], overlay.lineWidth);
+      return;
+    case OverlayKind::kQuadrangle:
+      for (int i = 0; i < 4; i++) {
+        int j = (i + 1) % 4;
+        pen.Line(xs[i], ys[i], xs[j], ys[j], overlay.lineWidth);
+      }
+      return;
+  }
+}
+
+}  // namespace lse
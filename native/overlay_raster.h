@@ -0,0 +1,45 @@
+/// Software rendering of the LSCAN_Visualization_* overlay model (overlay_scene.h)
+/// into 8-bit gray or RGBA pixels, for the preview compositor.
+///
+/// Lines are drawn as rectangles @e lineWidth pixels wide with square caps, so
+/// the four edges of a quadrangle join without gaps. Text uses a built-in 5x7
+/// ASCII font in 6x8 cells, magnified by an integer factor derived from
+/// @e fontSize (12 gives 16 pixel lines); the font name is ignored. Text is
+/// anchored at its top left corner and '\n' starts a new line.
+///
+/// The SDK ignores the top byte of a COLORREF; here it is the overlay's
+/// transparency (0 = opaque, as every SDK colour is), so overlays can be
+/// blended over the preview.
+
+#pragma once
+
+#include "overlay_scene.h"
+
+#include <cstdint>
+
+namespace lse {
+
+/// Pixels to draw into; rows are tightly packed.
+struct Canvas {
+  uint8_t *pixels = nullptr;
+  int width = 0;
+  int height = 0;
+  int channels = 1;  ///< 1 (gray) or 4 (RGBA)
+};
+
+/// Placement of the preview image on the canvas; belongsToImage overlays are
+/// given in image pixels and follow it, others are given in canvas pixels.
+struct ImagePlacement {
+  double x = 0;
+  double y = 0;
+  double scaleX = 1;
+  double scaleY = 1;
+};
+
+/// @p color as the canvas' channel bytes: R G B A, or its luma for gray.
+void CanvasColor(COLORREF color, int channels, uint8_t *bytes);
+
+/// Draw @p overlay (if visible), clipped to @p canvas.
+void DrawOverlay(const Canvas &canvas, const ImagePlacement &placement, const OverlaySpec &overlay);
+
+}  // namespace lse
@@ -0,0 +1,229 @@
+#include "overlay_scene.h"
+
+#include <cstring>
+#include <memory>
+#include <set>
+
+namespace lse {
+
+namespace {
+
+int PointCount(OverlayKind kind) {
+  switch (kind) {
+    case OverlayKind::kText:
+      return 2;
+    case OverlayKind::kLine:
+      return 4;
+    case OverlayKind::kQuadrangle:
+      return 8;
+  }
+  return 0;
+}
+
+/// Attributes only an Add can set.
+bool SameFixed(const OverlaySpec &a, const OverlaySpec &b) {
+  if (a.kind != b.kind || a.color != b.color || a.belongsToImage != b.belongsToImage) {
+    return false;
+  }
+  if (a.kind == OverlayKind::kText) {
+    return a.fontSize == b.fontSize && a.fontName == b.fontName;
+  }
+  return a.lineWidth == b.lineWidth;
+}
+
+/// Attributes a Modify sets.
+bool SameShape(const OverlaySpec &a, const OverlaySpec &b) {
+  if (memcmp(a.points, b.points, PointCount(a.kind) * sizeof(int)) != 0) {
+    return false;
+  }
+  return a.kind != OverlayKind::kText || a.text == b.text;
+}
+
+void Remember(int status, int *first) {
+  if (status < 0 && *first >= 0) {
+    *first = status;
+  }
+}
+
+}  // namespace
+
+int OverlayScene::Modify(const OverlaySpec &spec, DWORD overlay, OverlayCalls *calls) {
+  const Api &api = GetApi();
+  const int *p = spec.points;
+  calls->modifies++;
+  switch (spec.kind) {
+    case OverlayKind::kText:
+      return api.LSCAN_Visualization_ModifyOverlayText(handle_, overlay, spec.text.c_str(), p[0], p[1]);
+    case OverlayKind::kQuadrangle:
+      return api.LSCAN_Visualization_ModifyOverlayQuadrangle(handle_, overlay, p[0], p[1], p[2], p[3], p[4], p[5],
+                                                             p[6], p[7]);
+    case OverlayKind::kLine:
+      return api.LSCAN_Visualization_ModifyOverlayLine(handle_, overlay, p[0], p[1], p[2], p[3]);
+  }
+  return LSCAN_ERR_INVALID_PARAM_VALUE;
+}
+
+int OverlayScene::Show(DWORD overlay, bool visible, OverlayCalls *calls) {
+  calls->shows++;
+  return GetApi().LSCAN_Visualization_ShowOverlay(handle_, overlay, visible ? TRUE : FALSE);
+}
+
+int OverlayScene::Place(const OverlaySpec &spec, Entry *entry, OverlayCalls *calls) {
+  entry->spec = spec;
+  for (auto it = parked_.begin(); it != parked_.end(); ++it) {
+    if (!SameFixed(it->spec, spec)) {
+      continue;
+    }
+    entry->overlay = it->overlay;
+    bool sameShape = SameShape(it->spec, spec);
+    parked_.erase(it);
+    calls->reused++;
+    int status = sameShape ? LSCAN_STATUS_OK : Modify(spec, entry->overlay, calls);
+    if (status >= 0 && spec.visible) {
+      status = Show(entry->overlay, true, calls);
+    }
+    if (status != LSCAN_ERR_INVALID_PARAM_VALUE) {
+      return status;
+    }
+    break;  // The parked overlay is gone; add a new one
+  }
+
+  const Api &api = GetApi();
+  const int *p = spec.points;
+  BOOL belongs = spec.belongsToImage ? TRUE : FALSE;
+  int status = LSCAN_ERR_INVALID_PARAM_VALUE;
+  calls->adds++;
+  switch (spec.kind) {
+    case OverlayKind::kText:
+      status = api.LSCAN_Visualization_AddOverlayText(handle_, spec.text.c_str(), p[0], p[1], spec.color,
+                                                      spec.fontName.c_str(), spec.fontSize, belongs, &entry->overlay);
+      break;
+    case OverlayKind::kQuadrangle:
+      status = api.LSCAN_Visualization_AddOverlayQuadrangle(handle_, p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7],
+                                                            spec.color, spec.lineWidth, belongs, &entry->overlay);
+      break;
+    case OverlayKind::kLine:
+      status = api.LSCAN_Visualization_AddOverlayLine(handle_, p[0], p[1], p[2], p[3], spec.color, spec.lineWidth,
+                                                      belongs, &entry->overlay);
+      break;
+  }
+  if (status >= 0 && !spec.visible) {
+    status = Show(entry->overlay, false, calls);
+  }
+  return status;
+}
+
+int OverlayScene::Update(const OverlaySpec &spec, Entry *entry, OverlayCalls *calls) {
+  int status = LSCAN_STATUS_OK;
+  if (!SameShape(entry->spec, spec)) {
+    status = Modify(spec, entry->overlay, calls);
+  }
+  if (status >= 0 && entry->spec.visible != spec.visible) {
+    status = Show(entry->overlay, spec.visible, calls);
+  }
+  if (status == LSCAN_ERR_INVALID_PARAM_VALUE) {
+    // The overlay is gone (e.g. RemoveAllOverlays); add it again.
+    return Place(spec, entry, calls);
+  }
+  entry->spec = spec;
+  return status;
+}
+
+void OverlayScene::Park(Entry *entry, OverlayCalls *calls) {
+  if (parked_.size() >= kMaxParked) {
+    calls->removes++;
+    GetApi().LSCAN_Visualization_RemoveOverlay(handle_, entry->overlay);
+    return;
+  }
+  if (entry->spec.visible && Show(entry->overlay, false, calls) < 0) {
+    return;  // Unusable; forget it
+  }
+  entry->spec.visible = false;
+  parked_.push_back(*entry);
+}
+
+int OverlayScene::Commit(const std::vector<OverlaySpec> &frame, OverlayCalls *calls) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *calls = OverlayCalls();
+  int status = LSCAN_STATUS_OK;
+  std::set<int> ids;
+
+  for (const OverlaySpec &spec : frame) {
+    ids.insert(spec.id);
+    auto it = entries_.find(spec.id);
+    if (it != entries_.end() && SameFixed(it->second.spec, spec)) {
+      Remember(Update(spec, &it->second, calls), &status);
+      continue;
+    }
+    if (it != entries_.end()) {
+      Park(&it->second, calls);
+      entries_.erase(it);
+    }
+    Entry entry;
+    int placed = Place(spec, &entry, calls);
+    Remember(placed, &status);
+    if (placed >= 0) {
+      entries_[spec.id] = entry;
+    }
+  }
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (ids.count(it->first) == 0) {
+      Park(&it->second, calls);
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  stats_.frames++;
+  stats_.calls.adds += calls->adds;
+  stats_.calls.modifies += calls->modifies;
+  stats_.calls.shows += calls->shows;
+  stats_.calls.removes += calls->removes;
+  stats_.calls.reused += calls->reused;
+  stats_.lastFrameCalls = calls->total();
+  stats_.redrawCalls += 1 + frame.size();
+  return status;
+}
+
+int OverlayScene::Reset(bool remove) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int status = LSCAN_STATUS_OK;
+  if (remove) {
+    for (const auto &entry : entries_) {
+      Remember(GetApi().LSCAN_Visualization_RemoveOverlay(handle_, entry.second.overlay), &status);
+    }
+    for (const Entry &entry : parked_) {
+      Remember(GetApi().LSCAN_Visualization_RemoveOverlay(handle_, entry.overlay), &status);
+    }
+  }
+  entries_.clear();
+  parked_.clear();
+  return status;
+}
+
+OverlaySceneStats OverlayScene::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  OverlaySceneStats stats = stats_;
+  stats.overlays = entries_.size();
+  stats.parked = parked_.size();
+  return stats;
+}
+
+namespace {
+
+std::mutex g_scenes_mutex;
+std::map<int, std::unique_ptr<OverlayScene>> g_scenes;
+
+}  // namespace
+
+OverlayScene *GetOverlayScene(int handle) {
+  std::lock_guard<std::mutex> lock(g_scenes_mutex);
+  std::unique_ptr<OverlayScene> &scene = g_scenes[handle];
+  if (!scene) {
+    scene.reset(new OverlayScene(handle));
+  }
+  return scene.get();
+}
+
+}  // namespace lse
@@ -0,0 +1,103 @@
+/// Retained overlay scene per device handle.
+///
+/// JS declares the complete overlay set of a frame; Commit() compares it with
+/// the previous frame and issues only the LSCAN_Visualization_* calls that
+/// differ: Modify for moved quadrangles, lines and changed texts, ShowOverlay
+/// for visibility changes, Add for new overlays. Overlays that leave the scene
+/// are hidden and parked instead of removed, and a later overlay with the same
+/// fixed attributes (kind, color, line width, font, belongsToImage), which the
+/// Modify calls cannot change, takes the parked SDK overlay over with a Modify
+/// and a ShowOverlay. Overlays are matched between frames by a caller-chosen id.
+///
+/// The scene assumes it owns every overlay it created: RemoveAllOverlays() or
+/// ShowAllOverlays() behind its back must be followed by Reset().
+
+#pragma once
+
+#include "lse_api.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lse {
+
+enum class OverlayKind : int {
+  kText = 0,
+  kQuadrangle = 1,
+  kLine = 2,
+};
+
+/// One overlay of a frame, as declared by JS.
+struct OverlaySpec {
+  int id = 0;
+  OverlayKind kind = OverlayKind::kText;
+  bool visible = true;
+  COLORREF color = 0;
+  int lineWidth = 1;
+  int fontSize = 0;
+  bool belongsToImage = false;
+  int points[8] = {};  ///< Text: x, y; line: x1, y1, x2, y2; quadrangle: four corners
+  std::string text;
+  std::string fontName;
+};
+
+struct OverlayCalls {
+  uint64_t adds = 0;
+  uint64_t modifies = 0;
+  uint64_t shows = 0;     ///< ShowOverlay calls, hiding included
+  uint64_t removes = 0;
+  uint64_t reused = 0;    ///< Parked overlays taken over instead of added
+
+  uint64_t total() const { return adds + modifies + shows + removes; }
+};
+
+struct OverlaySceneStats {
+  uint64_t frames = 0;
+  OverlayCalls calls;        ///< SDK calls issued over all frames
+  uint64_t lastFrameCalls = 0;
+  uint64_t redrawCalls = 0;  ///< What RemoveAllOverlays plus one Add per overlay would have cost
+  uint64_t overlays = 0;     ///< Overlays in the current frame
+  uint64_t parked = 0;       ///< Hidden overlays kept for reuse
+};
+
+class OverlayScene {
+ public:
+  static constexpr size_t kMaxParked = 64;
+
+  explicit OverlayScene(int handle) : handle_(handle) {}
+
+  /// Make the device show @p frame. Returns the first failing SDK status, or
+  /// LSCAN_STATUS_OK; @p calls receives the calls this frame took.
+  int Commit(const std::vector<OverlaySpec> &frame, OverlayCalls *calls);
+
+  /// Forget the scene. With @p remove, delete its overlays (parked included) first.
+  int Reset(bool remove);
+
+  OverlaySceneStats Stats();
+
+ private:
+  struct Entry {
+    OverlaySpec spec;
+    DWORD overlay = 0;
+  };
+
+  int Place(const OverlaySpec &spec, Entry *entry, OverlayCalls *calls);
+  int Update(const OverlaySpec &spec, Entry *entry, OverlayCalls *calls);
+  int Modify(const OverlaySpec &spec, DWORD overlay, OverlayCalls *calls);
+  int Show(DWORD overlay, bool visible, OverlayCalls *calls);
+  void Park(Entry *entry, OverlayCalls *calls);
+
+  const int handle_;
+  std::mutex mutex_;
+  std::map<int, Entry> entries_;
+  std::vector<Entry> parked_;
+  OverlaySceneStats stats_;
+};
+
+/// Scene of @p handle; created on first use and never destroyed.
+OverlayScene *GetOverlayScene(int handle);
+
+}  // namespace lse
@@ -0,0 +1,174 @@
+#include "png_encoder.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace lse {
+
+namespace {
+
+constexpr int kSliceRows = 32;
+const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+void PutU32(uint8_t *out, uint32_t value) {
+  out[0] = static_cast<uint8_t>(value >> 24);
+  out[1] = static_cast<uint8_t>(value >> 16);
+  out[2] = static_cast<uint8_t>(value >> 8);
+  out[3] = static_cast<uint8_t>(value);
+}
+
+/// Write a complete chunk at @p out; returns the bytes written.
+size_t PutChunk(uint8_t *out, const char *type, const uint8_t *data, uint32_t length) {
+  PutU32(out, length);
+  memcpy(out + 4, type, 4);
+  if (length > 0) {
+    memcpy(out + 8, data, length);
+  }
+  uLong crc = crc32(0L, out + 4, 4 + length);
+  PutU32(out + 8 + length, static_cast<uint32_t>(crc));
+  return 12 + length;
+}
+
+/// Filter one row into @p out (filter type byte first). @p previous is nullptr
+/// for the first row, which PNG treats as following a row of zeros.
+void FilterRow(PngFilter filter, const uint8_t *row, const uint8_t *previous, int width, uint8_t *out) {
+  // Filter type codes of the PNG spec; 3 (Average) is not offered.
+  out[0] = filter == PngFilter::kPaeth ? 4 : static_cast<uint8_t>(filter);
+  uint8_t *target = out + 1;
+  switch (filter) {
+    case PngFilter::kNone:
+      memcpy(target, row, static_cast<size_t>(width));
+      break;
+    case PngFilter::kSub:
+      target[0] = row[0];
+      for (int x = 1; x < width; x++) {
+        target[x] = static_cast<uint8_t>(row[x] - row[x - 1]);
+      }
+      break;
+    case PngFilter::kUp:
+      if (previous == nullptr) {
+        memcpy(target, row, static_cast<size_t>(width));
+      } else {
+        for (int x = 0; x < width; x++) {
+          target[x] = static_cast<uint8_t>(row[x] - previous[x]);
+        }
+      }
+      break;
+    case PngFilter::kPaeth:
+      for (int x = 0; x < width; x++) {
+        int a = x > 0 ? row[x - 1] : 0;
+        int b = previous != nullptr ? previous[x] : 0;
+        int c = x > 0 && previous != nullptr ? previous[x - 1] : 0;
+        int pa = std::abs(b - c);
+        int pb = std::abs(a - c);
+        int pc = std::abs(a + b - 2 * c);
+        int predictor = pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+        target[x] = static_cast<uint8_t>(row[x] - predictor);
+      }
+      break;
+  }
+}
+
+}  // namespace
+
+FrameBlockPtr EncodePng(const uint8_t *pixels, int width, int height, int resolution, const PngOptions &options) {
+  if (pixels == nullptr || width <= 0 || height <= 0 || options.level < 0 || options.level > 9) {
+    return nullptr;
+  }
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // Filtered data has many small values: Z_FILTERED favours Huffman coding over
+  // short matches, as libpng does.
+  int strategy = options.filter == PngFilter::kNone ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+  if (deflateInit2(&stream, options.level, Z_DEFLATED, 15, 8, strategy) != Z_OK) {
+    return nullptr;
+  }
+  const size_t stride = static_cast<size_t>(width) + 1;
+  const uLong raw = static_cast<uLong>(stride * height);
+  // Signature, IHDR (25), pHYs (21), IDAT framing (12), IEND (12).
+  const size_t capacity = sizeof(kSignature) + 25 + 21 + 12 + deflateBound(&stream, raw) + 12;
+  FrameBlockPtr block(SharedFramePool().Acquire(capacity));
+  if (!block) {
+    deflateEnd(&stream);
+    return nullptr;
+  }
+
+  uint8_t *out = block->data;
+  memcpy(out, kSignature, sizeof(kSignature));
+  out += sizeof(kSignature);
+  uint8_t header[13];
+  PutU32(header, static_cast<uint32_t>(width));
+  PutU32(header + 4, static_cast<uint32_t>(height));
+  header[8] = 8;   // bit depth
+  header[9] = 0;   // grayscale
+  header[10] = 0;  // deflate
+  header[11] = 0;  // adaptive filtering (filter type per row)
+  header[12] = 0;  // no interlace
+  out += PutChunk(out, "IHDR", header, sizeof(header));
+  if (resolution > 0) {
+    uint8_t physical[9];
+    uint32_t perMeter = static_cast<uint32_t>(std::lround(resolution / 0.0254));
+    PutU32(physical, perMeter);
+    PutU32(physical + 4, perMeter);
+    physical[8] = 1;  // unit: meter
+    out += PutChunk(out, "pHYs", physical, sizeof(physical));
+  }
+
+  // IDAT: length is patched once the stream is finished.
+  uint8_t *idat = out;
+  memcpy(idat + 4, "IDAT", 4);
+  uint8_t *data = idat + 8;
+  const uint8_t *end = block->data + capacity - 4 - 12;
+  stream.next_out = data;
+  stream.avail_out = static_cast<uInt>(end - data);
+
+  thread_local std::vector<uint8_t> slice;
+  slice.resize(stride * kSliceRows);
+  int status = Z_OK;
+  for (int y = 0; y < height && status == Z_OK; y += kSliceRows) {
+    int rows = std::min(kSliceRows, height - y);
+    for (int r = 0; r < rows; r++) {
+      const uint8_t *row = pixels + static_cast<size_t>(y + r) * width;
+      const uint8_t *previous = y + r > 0 ? row - width : nullptr;
+      FilterRow(options.filter, row, previous, width, slice.data() + r * stride);
+    }
+    stream.next_in = slice.data();
+    stream.avail_in = static_cast<uInt>(rows * stride);
+    bool last = y + rows >= height;
+    status = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+    // deflateBound() guarantees room, so the stream ends with the last slice.
+    if (last) {
+      status = status == Z_STREAM_END ? Z_OK : Z_BUF_ERROR;
+    } else if (status == Z_OK && stream.avail_in != 0) {
+      status = Z_BUF_ERROR;
+    }
+  }
+  size_t compressed = static_cast<size_t>(stream.next_out - data);
+  deflateEnd(&stream);
+  if (status != Z_OK) {
+    return nullptr;
+  }
+  PutU32(idat, static_cast<uint32_t>(compressed));
+  PutU32(data + compressed, static_cast<uint32_t>(crc32(0L, idat + 4, static_cast<uInt>(compressed + 4))));
+  out = data + compressed + 4;
+  out += PutChunk(out, "IEND", nullptr, 0);
+  block->size = static_cast<size_t>(out - block->data);
+
+  // The bound assumes incompressible data; move typical (2-4x smaller) output to
+  // a fitting block so stored PNGs do not pin frame-sized blocks.
+  if (block->size < block->capacity / 2) {
+    FrameBlockPtr fitted(SharedFramePool().Acquire(block->size));
+    if (fitted) {
+      memcpy(fitted->data, block->data, block->size);
+      return fitted;
+    }
+  }
+  return block;
+}
+
+}  // namespace lse
@@ -0,0 +1,36 @@
+/// 8-bit grayscale PNG encoder for preview and result images.
+///
+/// Uses the zlib that Node.js exports to addons, so it adds no dependency. Rows
+/// are filtered and deflated in slices of kSliceRows, which keeps the working set
+/// in cache instead of filtering the whole frame into a second buffer first.
+
+#pragma once
+
+#include "frame_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lse {
+
+/// PNG row filter applied to every row. kUp suits fingerprint images well (ridges
+/// run across rows) and is nearly free; kPaeth compresses a few percent better at
+/// a higher CPU cost.
+enum class PngFilter : int {
+  kNone,
+  kSub,
+  kUp,
+  kPaeth,
+};
+
+struct PngOptions {
+  int level = 1;  ///< zlib level, 0 (store) to 9; 1 is the fast setting
+  PngFilter filter = PngFilter::kUp;
+};
+
+/// Encode @p pixels (@p width x @p height, tightly packed) into a pooled block;
+/// @p resolution, in ppi, goes into a pHYs chunk when positive. Returns nullptr
+/// on bad arguments, out of memory or a zlib error. Callable from any thread.
+FrameBlockPtr EncodePng(const uint8_t *pixels, int width, int height, int resolution, const PngOptions &options);
+
+}  // namespace lse
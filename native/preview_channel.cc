@@ -0,0 +1,100 @@
+#include "preview_channel.h"
+
+#include <chrono>
+#include <utility>
+
+namespace lse {
+
+bool PreviewChannel::Configure(PreviewPolicy policy, int capacity, int timeoutMs) {
+  if (policy == PreviewPolicy::kLatest) {
+    capacity = 1;
+  }
+  if (capacity < 1 || capacity > kMaxCapacity || timeoutMs < 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.policy = policy;
+  stats_.capacity = capacity;
+  stats_.timeoutMs = timeoutMs;
+  while (frames_.size() > static_cast<size_t>(capacity)) {
+    frames_.pop_front();
+    stats_.dropped++;
+  }
+  room_.notify_all();
+  return true;
+}
+
+bool PreviewChannel::Offer(int handle, const LScanImageData &image, uint64_t timestamp) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats_.received++;
+  const size_t capacity = static_cast<size_t>(stats_.capacity);
+
+  PreviewFrame frame;
+  if (frames_.size() >= capacity) {
+    if (stats_.policy == PreviewPolicy::kBlock) {
+      bool room = room_.wait_for(lock, std::chrono::milliseconds(stats_.timeoutMs),
+                                 [&] { return frames_.size() < static_cast<size_t>(stats_.capacity); });
+      if (!room) {
+        stats_.dropped++;
+        return false;
+      }
+    } else {
+      // kLatest and kRing: recycle the oldest frame's block for the new frame.
+      frame = std::move(frames_.front());
+      frames_.pop_front();
+      stats_.dropped++;
+    }
+  }
+
+  // Copy outside the lock so a slow copy does not stall the JS thread's Take().
+  // Frames from one SDK thread stay in order; the SDK delivers previews of a
+  // handle from a single thread.
+  lock.unlock();
+  CopyImage(image, &frame.image, handle);
+  frame.timestamp = timestamp;
+  lock.lock();
+  while (frames_.size() >= static_cast<size_t>(stats_.capacity)) {
+    // Another thread filled the channel while we copied.
+    frames_.pop_front();
+    stats_.dropped++;
+  }
+  frames_.push_back(std::move(frame));
+  if (drain_queued_) {
+    return false;
+  }
+  drain_queued_ = true;
+  return true;
+}
+
+void PreviewChannel::Take(std::vector<PreviewFrame> *frames) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  drain_queued_ = false;
+  for (PreviewFrame &frame : frames_) {
+    frames->push_back(std::move(frame));
+  }
+  frames_.clear();
+  room_.notify_all();
+}
+
+void PreviewChannel::Account(uint64_t delivered, uint64_t dropped) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.delivered += delivered;
+  stats_.dropped += dropped;
+}
+
+void PreviewChannel::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.dropped += frames_.size();
+  frames_.clear();
+  drain_queued_ = false;
+  room_.notify_all();
+}
+
+PreviewStats PreviewChannel::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PreviewStats stats = stats_;
+  stats.queued = frames_.size();
+  return stats;
+}
+
+}  // namespace lse
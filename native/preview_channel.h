@@ -0,0 +1,80 @@
+/// Backpressure between the SDK's preview callback and the JS handler.
+///
+/// Preview frames do not go through the dispatcher queue one by one. They are
+/// parked in a small per-handle channel, and a single drain event is queued for
+/// the channel while it holds frames. When the JS handler is slower than the
+/// scanner, the policy decides what happens to the extra frames:
+///
+///  - kLatest: keep only the newest frame; a new frame replaces the pending one.
+///  - kRing:   keep the newest @e capacity frames; the oldest is overwritten.
+///  - kBlock:  the SDK thread waits up to @e timeoutMs for room, then drops the
+///             new frame.
+///
+/// Replaced frames reuse the pooled block of the frame they replace, so a
+/// stalled consumer costs neither allocations nor memory beyond @e capacity frames.
+
+#pragma once
+
+#include "callbacks.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace lse {
+
+enum class PreviewPolicy : int {
+  kLatest = 0,
+  kRing = 1,
+  kBlock = 2,
+};
+
+struct PreviewStats {
+  PreviewPolicy policy = PreviewPolicy::kLatest;
+  int capacity = 1;
+  int timeoutMs = 0;
+  uint64_t received = 0;   ///< Frames the SDK delivered
+  uint64_t delivered = 0;  ///< Frames handed to the JS handler
+  uint64_t dropped = 0;    ///< Frames replaced, overwritten or timed out
+  uint64_t queued = 0;     ///< Frames waiting for the JS handler
+};
+
+struct PreviewFrame {
+  ImageFrame image;
+  uint64_t timestamp = 0;
+};
+
+class PreviewChannel {
+ public:
+  static constexpr int kMaxCapacity = 64;
+
+  /// Returns false if @p capacity or @p timeoutMs is out of range.
+  /// kLatest always uses a capacity of 1.
+  bool Configure(PreviewPolicy policy, int capacity, int timeoutMs);
+
+  /// SDK thread. Queue a copy of @p image, a preview frame of @p handle, according
+  /// to the policy. Returns true if the caller must queue a drain event for this channel.
+  bool Offer(int handle, const LScanImageData &image, uint64_t timestamp);
+
+  /// JS thread, from the drain event: move all queued frames to @p frames.
+  void Take(std::vector<PreviewFrame> *frames);
+
+  /// JS thread: account for frames handed to JS or discarded after Take().
+  void Account(uint64_t delivered, uint64_t dropped);
+
+  /// Drop all queued frames, e.g. when the handler is unregistered.
+  void Clear();
+
+  PreviewStats Stats();
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable room_;
+  std::deque<PreviewFrame> frames_;
+  bool drain_queued_ = false;
+  PreviewStats stats_;
+};
+
+}  // namespace lse
@@ -0,0 +1,195 @@
+#include "property_cache.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace lse {
+
+namespace {
+
+enum class PropertyClass {
+  kImmutable,
+  kSettable,
+  kVolatile,
+};
+
+PropertyClass ClassOf(LScanPropertyId id) {
+  switch (id) {
+    case LSCAN_PROPERTY_SERIAL_NUMBER:
+    case LSCAN_PROPERTY_PRODUCT_NAME:
+    case LSCAN_PROPERTY_FIRMWARE_VERSION:
+    case LSCAN_PROPERTY_HARDWARE_VERSION:
+      return PropertyClass::kImmutable;
+    case LSCAN_PROPERTY_AUTOMATIC_ADJUSTMENT:
+    case LSCAN_PROPERTY_ROLL_ALLOW_RESTART:
+    case LSCAN_PROPERTY_ROLL_MODE:
+    case LSCAN_PROPERTY_LICENSES:
+      return PropertyClass::kSettable;
+    default:
+      // Temperature, platen state and anything newer than this list.
+      return PropertyClass::kVolatile;
+  }
+}
+
+struct HandleProperties {
+  uint64_t generation = 0;  // Bumped by every invalidation
+  std::map<int, std::string> values;
+};
+
+std::mutex g_mutex;
+std::map<int, HandleProperties> g_handles;
+PropertyCacheStats g_stats;
+
+bool g_has_version = false;
+LScanApiVersion g_version = {};
+uint64_t g_device_generation = 0;  // Bumped whenever the attached devices may have changed
+int g_device_count = -1;
+std::map<int, LScanDeviceInfo> g_device_infos;
+
+void Invalidate(HandleProperties *properties, PropertyScope scope) {
+  properties->generation++;
+  if (scope == PropertyScope::kAll) {
+    properties->values.clear();
+    return;
+  }
+  for (auto it = properties->values.begin(); it != properties->values.end();) {
+    if (ClassOf(static_cast<LScanPropertyId>(it->first)) == PropertyClass::kSettable) {
+      it = properties->values.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace
+
+int GetCachedProperty(int handle, LScanPropertyId id, char *value, bool *hit) {
+  PropertyClass propertyClass = ClassOf(id);
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    HandleProperties &properties = g_handles[handle];
+    auto it = properties.values.find(id);
+    if (it != properties.values.end()) {
+      g_stats.hits++;
+      memcpy(value, it->second.c_str(), it->second.size() + 1);
+      if (hit != nullptr) {
+        *hit = true;
+      }
+      return LSCAN_STATUS_OK;
+    }
+    g_stats.misses++;
+    generation = properties.generation;
+  }
+  if (hit != nullptr) {
+    *hit = false;
+  }
+  memset(value, 0, LSCAN_MAX_STR_LEN);
+  int status = GetApi().LSCAN_Main_GetProperty(handle, id, value);
+  value[LSCAN_MAX_STR_LEN - 1] = '\0';
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  HandleProperties &properties = g_handles[handle];
+  if (status == LSCAN_ERR_DEVICE_IO) {
+    // The device is probably gone; it may come back as a different one.
+    Invalidate(&properties, PropertyScope::kAll);
+  } else if (status == LSCAN_STATUS_OK && propertyClass != PropertyClass::kVolatile &&
+             properties.generation == generation) {
+    properties.values[id] = value;
+  }
+  return status;
+}
+
+int SetCachedProperty(int handle, LScanPropertyId id, const char *value) {
+  int status = GetApi().LSCAN_Main_SetProperty(handle, id, value);
+  // Also on failure: a failed set may have changed the device state partly.
+  InvalidateProperties(handle, PropertyScope::kSettable);
+  return status;
+}
+
+void InvalidateProperties(int handle, PropertyScope scope) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_stats.invalidations++;
+  if (handle >= 0) {
+    Invalidate(&g_handles[handle], scope);
+    return;
+  }
+  for (auto &entry : g_handles) {
+    Invalidate(&entry.second, scope);
+  }
+}
+
+int GetCachedApiVersion(LScanApiVersion *version) {
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_has_version) {
+      *version = g_version;
+      return LSCAN_STATUS_OK;
+    }
+  }
+  int status = GetApi().LSCAN_Main_GetAPIVersion(version);
+  if (status == LSCAN_STATUS_OK) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_version = *version;
+    g_has_version = true;
+  }
+  return status;
+}
+
+int GetCachedDeviceInfo(int deviceIndex, LScanDeviceInfo *info, bool *hit) {
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_device_infos.find(deviceIndex);
+    if (it != g_device_infos.end()) {
+      g_stats.deviceInfoHits++;
+      *info = it->second;
+      if (hit != nullptr) {
+        *hit = true;
+      }
+      return LSCAN_STATUS_OK;
+    }
+    g_stats.deviceInfoMisses++;
+    generation = g_device_generation;
+  }
+  if (hit != nullptr) {
+    *hit = false;
+  }
+  memset(info, 0, sizeof(*info));
+  int status = GetApi().LSCAN_Main_GetDeviceInfo(deviceIndex, info);
+  if (status == LSCAN_STATUS_OK) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_device_generation == generation) {
+      g_device_infos[deviceIndex] = *info;
+    }
+  }
+  return status;
+}
+
+void NoteDeviceCount(int deviceCount) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (deviceCount != g_device_count) {
+    g_device_count = deviceCount;
+    g_device_generation++;
+    g_device_infos.clear();
+  }
+}
+
+void InvalidateDeviceInfo() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_device_generation++;
+  g_device_infos.clear();
+}
+
+PropertyCacheStats GetPropertyCacheStats() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  PropertyCacheStats stats = g_stats;
+  stats.entries = 0;
+  for (const auto &entry : g_handles) {
+    stats.entries += entry.second.values.size();
+  }
+  return stats;
+}
+
+}  // namespace lse
@@ -0,0 +1,75 @@
+/// Cache in front of LSCAN_Main_GetProperty().
+///
+/// Every property read is a synchronous device round trip, yet most properties
+/// never change while a handle is open. Properties fall into three classes:
+///
+///  - immutable (serial number, product name, firmware and hardware version):
+///    cached until the handle is released, re-initialized or loses its device;
+///  - settable (automatic adjustment, roll options, licenses): cached until
+///    SetProperty(), SetMode(), a license installation or a communication break;
+///  - volatile (temperature, platen state): always read from the device.
+///
+/// The bindings that change device state (Initialize, Release, SetMode,
+/// SetProperty, InstallLicenseFile, session calls) and the communication break
+/// trampoline invalidate entries; a read racing with an invalidation never
+/// stores its possibly stale value.
+///
+/// The same module keeps the answers startup asks for before any handle exists:
+/// the API version, read once per loaded library, and the identity part of
+/// LSCAN_Main_GetDeviceInfo() per device index. Identity can only change when
+/// devices come or go, which the device count callback, a changed
+/// LSCAN_Main_GetDeviceCount() result or a communication break reveal, so those
+/// drop it; validating a cached entry costs a lock, not a device round trip.
+
+#pragma once
+
+#include "lse_api.h"
+
+#include <cstdint>
+#include <string>
+
+namespace lse {
+
+enum class PropertyScope {
+  kSettable,  ///< Settable properties only
+  kAll,       ///< Every property, e.g. when the handle goes away
+};
+
+struct PropertyCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;         ///< Reads that went to the device, volatile ones included
+  uint64_t invalidations = 0;  ///< InvalidateProperties() calls
+  uint64_t entries = 0;        ///< Values currently cached
+  uint64_t deviceInfoHits = 0;
+  uint64_t deviceInfoMisses = 0;
+};
+
+/// Any thread. Read @p id of @p handle into @p value (LSCAN_MAX_STR_LEN bytes),
+/// from the cache if possible. Returns the SDK status; sets @p hit if cached.
+int GetCachedProperty(int handle, LScanPropertyId id, char *value, bool *hit = nullptr);
+
+/// Any thread. LSCAN_Main_SetProperty() plus invalidation of the handle's
+/// settable properties.
+int SetCachedProperty(int handle, LScanPropertyId id, const char *value);
+
+/// Any thread. Drop cached properties of @p handle, or of every handle if -1.
+void InvalidateProperties(int handle, PropertyScope scope);
+
+/// Any thread. LSCAN_Main_GetAPIVersion(), from the device only the first time.
+int GetCachedApiVersion(LScanApiVersion *version);
+
+/// Any thread. LSCAN_Main_GetDeviceInfo() of @p deviceIndex, from the cache if
+/// possible. IsInitialized is as of the read that filled the entry; ask
+/// LSCAN_Main_IsInitialized() for the current state.
+int GetCachedDeviceInfo(int deviceIndex, LScanDeviceInfo *info, bool *hit = nullptr);
+
+/// Any thread. @p deviceCount devices are attached; a change from the last count
+/// seen drops every cached device info.
+void NoteDeviceCount(int deviceCount);
+
+/// Any thread. Drop cached device infos: the attached devices may have changed.
+void InvalidateDeviceInfo();
+
+PropertyCacheStats GetPropertyCacheStats();
+
+}  // namespace lse
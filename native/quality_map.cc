@@ -0,0 +1,482 @@
+#include "quality_map.h"
+
+#include "clock.h"
+#include "dispatcher.h"
+#include "image_kernels.h"
+#include "napi_util.h"
+#include "task_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+
+namespace lse {
+
+namespace {
+
+std::atomic<int> g_open{0};
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kBlockPixels = kMomentBlock * kMomentBlock;
+
+/// Scores of one block, derived from its BlockMoments.
+QualityBlock Score(const BlockMoments &m, const QualityMapConfig &config) {
+  QualityBlock score;
+  const double mean = static_cast<double>(m.sum) / kBlockPixels;
+  const double variance = std::max(0.0, static_cast<double>(m.squares) / kBlockPixels - mean * mean);
+  const double deviation = std::sqrt(variance);
+  score.mean = static_cast<float>(mean);
+  score.finger = deviation >= config.minContrast;
+  score.contrast = static_cast<float>(std::min(1.0, deviation / QualityMapConfig::kFullContrast));
+
+  const double gxx = m.gxx;
+  const double gyy = m.gyy;
+  const double gxy = m.gxy;
+  const double energy = gxx + gyy;
+  if (energy > 0) {
+    score.coherence = static_cast<float>(std::sqrt((gxx - gyy) * (gxx - gyy) + 4 * gxy * gxy) / energy);
+  }
+  // The dominant gradient direction is across the ridges; ridges run at a right angle to it.
+  double angle = 0.5 * std::atan2(2 * gxy, gxx - gyy) + kPi / 2;
+  score.angle = static_cast<float>(angle >= kPi ? angle - kPi : angle);
+
+  const int bright = m.brightCount;
+  const int dark = kBlockPixels - bright;
+  if (bright > 0 && dark > 0 && variance > 0) {
+    const double brightMean = static_cast<double>(m.brightSum) / bright;
+    const double darkMean = static_cast<double>(m.sum - m.brightSum) / dark;
+    const double between = static_cast<double>(bright) * dark / (kBlockPixels * kBlockPixels) *
+                           (brightMean - darkMean) * (brightMean - darkMean);
+    const double ratio = between / variance;
+    score.clarity = static_cast<float>(
+        std::min(1.0, std::max(0.0, (ratio - QualityMapConfig::kBlurredClarity) /
+                                        (QualityMapConfig::kClearClarity - QualityMapConfig::kBlurredClarity))));
+  }
+  if (score.finger) {
+    score.quality = score.coherence * score.contrast * score.clarity;
+  }
+  return score;
+}
+
+uint8_t ToByte(double unit) {
+  return static_cast<uint8_t>(std::lround(std::min(1.0, std::max(0.0, unit)) * 255));
+}
+
+}  // namespace
+
+void ScoreQualityBlocks(const uint8_t *pixels, int width, int height, const QualityMapConfig &config,
+                        std::vector<QualityBlock> *blocks) {
+  const int blocksWide = width / kMomentBlock;
+  const int blocksHigh = height / kMomentBlock;
+  static thread_local std::vector<BlockMoments> moments;
+  moments.resize(static_cast<size_t>(blocksWide) * blocksHigh);
+  blocks->resize(moments.size());
+  BlockMoments *momentRows = moments.data();
+  QualityBlock *scoreRows = blocks->data();
+  const int threads = config.threads > 0 ? std::min(config.threads, TaskPool::kMaxThreads) : HardwareThreads();
+  SharedTaskPool().ParallelFor(blocksHigh, threads, [=, &config](int blockY) {
+    const size_t first = static_cast<size_t>(blockY) * blocksWide;
+    ComputeBlockMoments(pixels, width, height, blockY, momentRows + first);
+    for (int bx = 0; bx < blocksWide; bx++) {
+      scoreRows[first + bx] = Score(momentRows[first + bx], config);
+    }
+  });
+}
+
+void FindQualityObjects(const std::vector<QualityBlock> &scores, int blocksWide, int blocksHigh,
+                        const QualityMapConfig &config, std::vector<QualityObject> *objects,
+                        std::vector<int> *labels) {
+  objects->clear();
+  std::vector<int> own;
+  std::vector<int> &label = labels != nullptr ? *labels : own;
+  label.assign(scores.size(), -1);
+  std::vector<int> stack;
+  for (size_t seed = 0; seed < scores.size(); seed++) {
+    if (!scores[seed].finger || label[seed] >= 0) {
+      continue;
+    }
+    const int id = static_cast<int>(objects->size());
+    int left = blocksWide;
+    int top = blocksHigh;
+    int right = -1;
+    int bottom = -1;
+    double quality = 0;
+    double coherence = 0;
+    double contrast = 0;
+    double clarity = 0;
+    double mean = 0;
+    double cos2 = 0;  // Orientation as a doubled-angle vector, weighted by coherence
+    double sin2 = 0;
+    int blocks = 0;
+    label[seed] = id;
+    stack.assign(1, static_cast<int>(seed));
+    while (!stack.empty()) {
+      const int index = stack.back();
+      stack.pop_back();
+      const int bx = index % blocksWide;
+      const int by = index / blocksWide;
+      const QualityBlock &score = scores[index];
+      left = std::min(left, bx);
+      right = std::max(right, bx);
+      top = std::min(top, by);
+      bottom = std::max(bottom, by);
+      quality += score.quality;
+      coherence += score.coherence;
+      contrast += score.contrast;
+      clarity += score.clarity;
+      mean += score.mean;
+      cos2 += score.coherence * std::cos(2 * score.angle);
+      sin2 += score.coherence * std::sin(2 * score.angle);
+      blocks++;
+      for (int ny = std::max(0, by - 1); ny <= std::min(blocksHigh - 1, by + 1); ny++) {
+        for (int nx = std::max(0, bx - 1); nx <= std::min(blocksWide - 1, bx + 1); nx++) {
+          const int neighbour = ny * blocksWide + nx;
+          if (scores[neighbour].finger && label[neighbour] < 0) {
+            label[neighbour] = id;
+            stack.push_back(neighbour);
+          }
+        }
+      }
+    }
+    QualityObject object;
+    object.component = id;
+    object.x = left * kMomentBlock;
+    object.y = top * kMomentBlock;
+    object.width = (right - left + 1) * kMomentBlock;
+    object.height = (bottom - top + 1) * kMomentBlock;
+    object.blocks = blocks;
+    object.quality = quality / blocks;
+    object.coherence = coherence / blocks;
+    object.contrast = contrast / blocks;
+    object.clarity = clarity / blocks;
+    object.mean = mean / blocks;
+    double degrees = 0.5 * std::atan2(sin2, cos2) * 180 / kPi;
+    object.orientation = degrees < 0 ? degrees + 180 : degrees;
+    // Components below minBlocks keep their label so they are not revisited.
+    objects->push_back(object);
+  }
+  std::stable_sort(objects->begin(), objects->end(),
+                   [](const QualityObject &a, const QualityObject &b) { return a.blocks > b.blocks; });
+  size_t keep = 0;
+  while (keep < objects->size() && (*objects)[keep].blocks >= config.minBlocks) {
+    keep++;
+  }
+  objects->resize(keep);
+}
+
+bool AnalyzeQuality(const uint8_t *pixels, int width, int height, const QualityMapConfig &config,
+                    QualityFrame *frame) {
+  const uint64_t start = NowNs();
+  frame->width = width;
+  frame->height = height;
+  frame->blocksWide = width / kMomentBlock;
+  frame->blocksHigh = height / kMomentBlock;
+  frame->objects.clear();
+  frame->quality = 0;
+  const int blocksWide = frame->blocksWide;
+  const int blocksHigh = frame->blocksHigh;
+  const size_t count = static_cast<size_t>(blocksWide) * blocksHigh;
+
+  static thread_local std::vector<QualityBlock> scores;
+  ScoreQualityBlocks(pixels, width, height, config, &scores);
+
+  if (config.maps) {
+    frame->maps.reset(SharedFramePool().Acquire(count * static_cast<size_t>(QualityPlane::kCount)));
+    if (!frame->maps) {
+      return false;
+    }
+    uint8_t *planes = frame->maps->data;
+    for (size_t i = 0; i < count; i++) {
+      const QualityBlock &score = scores[i];
+      planes[i + count * static_cast<int>(QualityPlane::kQuality)] = ToByte(score.quality);
+      planes[i + count * static_cast<int>(QualityPlane::kCoherence)] = ToByte(score.coherence);
+      planes[i + count * static_cast<int>(QualityPlane::kContrast)] = ToByte(score.contrast);
+      planes[i + count * static_cast<int>(QualityPlane::kClarity)] = ToByte(score.clarity);
+      planes[i + count * static_cast<int>(QualityPlane::kOrientation)] =
+          static_cast<uint8_t>(static_cast<int>(std::lround(score.angle * 180 / kPi)) % 180);
+    }
+  } else {
+    frame->maps.reset();
+  }
+
+  FindQualityObjects(scores, blocksWide, blocksHigh, config, &frame->objects);
+  const size_t limit = config.objects > 0 ? std::min(config.objects, LSCAN_MAX_OBJECTS) : LSCAN_MAX_OBJECTS;
+  if (frame->objects.size() > limit) {
+    frame->objects.resize(limit);
+  }
+  std::sort(frame->objects.begin(), frame->objects.end(),
+            [](const QualityObject &a, const QualityObject &b) { return a.x < b.x; });
+  for (size_t i = 0; i < frame->objects.size(); i++) {
+    frame->quality = i == 0 ? frame->objects[i].quality : std::min(frame->quality, frame->objects[i].quality);
+  }
+  frame->analyzeNs = NowNs() - start;
+  return true;
+}
+
+napi_value QualityFrameToJs(napi_env env, QualityFrame *frame, int stable, bool trigger) {
+  napi_value objects = nullptr;
+  napi_create_array_with_length(env, frame->objects.size(), &objects);
+  for (size_t i = 0; i < frame->objects.size(); i++) {
+    const QualityObject &object = frame->objects[i];
+    napi_value item = ResultObject(env)
+                          .Int("x", object.x)
+                          .Int("y", object.y)
+                          .Int("width", object.width)
+                          .Int("height", object.height)
+                          .Int("blocks", object.blocks)
+                          .Double("quality", object.quality)
+                          .Double("coherence", object.coherence)
+                          .Double("contrast", object.contrast)
+                          .Double("clarity", object.clarity)
+                          .Double("orientation", object.orientation)
+                          .Double("mean", object.mean)
+                          .value();
+    napi_set_element(env, objects, static_cast<uint32_t>(i), item);
+  }
+  napi_value maps = nullptr;
+  if (frame->maps) {
+    maps = BlockToJs(env, std::move(frame->maps));
+  } else {
+    napi_get_null(env, &maps);
+  }
+  return ResultObject(env)
+      .Int("width", frame->width)
+      .Int("height", frame->height)
+      .Int("blocksWide", frame->blocksWide)
+      .Int("blocksHigh", frame->blocksHigh)
+      .Set("maps", maps)
+      .Set("objects", objects)
+      .Double("quality", frame->quality)
+      .Int("stable", stable)
+      .Bool("trigger", trigger)
+      .Double("analyzeNs", static_cast<double>(frame->analyzeNs))
+      .value();
+}
+
+/// An analyzed frame on its way to the JS thread.
+struct QualityMap::Output {
+  QualityFrame frame;
+  uint64_t timestamp = 0;
+  uint64_t generation = 0;
+  int stable = 0;
+  bool trigger = false;
+};
+
+int QualityMap::Open(napi_env env, const QualityMapConfig &config, napi_value function) {
+  napi_ref created = nullptr;
+  NAPI_CHECK_RETURN(env, napi_create_reference(env, function, 1, &created), LSCAN_ERR_GENERAL);
+  if (function_ != nullptr) {
+    napi_delete_reference(env, function_);
+  } else {
+    SharedDispatcher().AddListener();
+  }
+  function_ = created;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    config_ = config;
+    stats_ = QualityMapStats();
+    next_due_ = 0;
+    last_offered_ = 0;
+    stable_ = 0;
+    triggered_ = false;
+  }
+  if (!open_.exchange(true, std::memory_order_acq_rel)) {
+    g_open.fetch_add(1, std::memory_order_relaxed);
+  }
+  int status = RefreshPreviewCallback(handle_);
+  if (status < 0) {
+    Close(env);
+  }
+  return status;
+}
+
+int QualityMap::Close(napi_env env) {
+  if (open_.exchange(false, std::memory_order_acq_rel)) {
+    g_open.fetch_sub(1, std::memory_order_relaxed);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    has_pending_ = false;
+    pending_.pixels.reset();
+  }
+  int status = RefreshPreviewCallback(handle_);
+  if (function_ != nullptr) {
+    napi_delete_reference(env, function_);
+    function_ = nullptr;
+    SharedDispatcher().RemoveListener();
+  }
+  return status;
+}
+
+void QualityMap::Rearm() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stable_ = 0;
+  triggered_ = false;
+}
+
+void QualityMap::Offer(const LScanImageData &image, uint64_t timestamp) {
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open()) {
+      return;
+    }
+    stats_.received++;
+    if (last_offered_ != 0 && timestamp > last_offered_) {
+      const uint64_t interval = timestamp - last_offered_;
+      stats_.intervalNs = stats_.intervalNs > 0 ? (stats_.intervalNs * 7 + interval) / 8 : interval;
+    }
+    last_offered_ = timestamp;
+    if (config_.maxFps > 0) {
+      // A quarter interval of slack, as in Compositor::Offer().
+      const uint64_t interval = static_cast<uint64_t>(1e9 / config_.maxFps);
+      if (timestamp + interval / 4 < next_due_) {
+        stats_.skipped++;
+        return;
+      }
+      next_due_ = std::max(next_due_, timestamp) + interval;
+    }
+    if (image.bitsPerPixel != 8 || image.buffer == nullptr ||
+        static_cast<int64_t>(image.bufferSize) < static_cast<int64_t>(image.width) * image.height ||
+        image.width <= 0 || image.height <= 0) {
+      stats_.dropped++;
+      return;
+    }
+    if (has_pending_) {
+      stats_.dropped++;
+    }
+    CopyImage(image, &pending_, handle_);
+    pending_timestamp_ = timestamp;
+    has_pending_ = pending_.pixels != nullptr;
+    if (busy_ || !has_pending_) {
+      return;
+    }
+    busy_ = true;
+    generation = generation_;
+  }
+  SharedTaskPool().Post([this, generation] { Analyze(generation); });
+}
+
+void QualityMap::Analyze(uint64_t generation) {
+  ImageFrame image;
+  uint64_t timestamp = 0;
+  QualityMapConfig config;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (generation != generation_ || !has_pending_) {
+      busy_ = false;
+      return;
+    }
+    image = std::move(pending_);
+    has_pending_ = false;
+    timestamp = pending_timestamp_;
+    config = config_;
+  }
+
+  std::unique_ptr<Output> output(new Output());
+  const bool analyzed = AnalyzeQuality(image.pixels->data, image.width, image.height, config, &output->frame);
+  const uint64_t elapsed = output->frame.analyzeNs;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Hand the source block back for the next Offer() to copy into.
+    if (!pending_.pixels && generation == generation_) {
+      pending_.pixels = std::move(image.pixels);
+    }
+    if (analyzed) {
+      stats_.analyzed++;
+      stats_.analyzeNs += elapsed;
+      stats_.lastAnalyzeNs = elapsed;
+      stats_.maxAnalyzeNs = std::max(stats_.maxAnalyzeNs, elapsed);
+      if (stats_.intervalNs > 0 && elapsed > stats_.intervalNs) {
+        stats_.overBudget++;
+      }
+      const QualityFrame &frame = output->frame;
+      const size_t expected = config.objects > 0 ? static_cast<size_t>(config.objects) : 1;
+      const bool met = frame.objects.size() >= expected && frame.quality >= config.threshold;
+      stable_ = met ? stable_ + 1 : 0;
+      if (generation == generation_ && !triggered_ && stable_ >= config.stableFrames) {
+        triggered_ = true;
+        output->trigger = true;
+        stats_.triggers++;
+      }
+      output->stable = stable_;
+    } else {
+      stats_.dropped++;
+    }
+  }
+  output->timestamp = timestamp;
+  output->generation = generation;
+  Output *posted = output.release();
+  SharedDispatcher().PostCompletion([this, posted](napi_env env) { Deliver(env, posted); });
+}
+
+void QualityMap::Deliver(napi_env env, Output *posted) {
+  std::unique_ptr<Output> output(posted);
+  bool current = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current = output->generation == generation_;
+  }
+  napi_value function = nullptr;
+  if (current && output->frame.width > 0 && function_ != nullptr &&
+      napi_get_reference_value(env, function_, &function) == napi_ok && function != nullptr) {
+    napi_value frame = QualityFrameToJs(env, &output->frame, output->stable, output->trigger);
+    napi_value argv[3] = {MakeInt(env, handle_), frame, MakeDouble(env, static_cast<double>(output->timestamp))};
+    napi_value undefined = nullptr;
+    napi_get_undefined(env, &undefined);
+    napi_call_function(env, undefined, function, 3, argv, nullptr);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.delivered++;
+  }
+
+  // Analyze the newest frame that arrived meanwhile, if any.
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_pending_ || !open()) {
+      busy_ = false;
+      return;
+    }
+    generation = generation_;
+  }
+  SharedTaskPool().Post([this, generation] { Analyze(generation); });
+}
+
+QualityMapStats QualityMap::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+namespace {
+
+std::mutex g_maps_mutex;
+std::map<int, std::unique_ptr<QualityMap>> g_maps;
+
+}  // namespace
+
+QualityMap *GetQualityMap(int handle) {
+  std::lock_guard<std::mutex> lock(g_maps_mutex);
+  std::unique_ptr<QualityMap> &map = g_maps[handle];
+  if (!map) {
+    map.reset(new QualityMap(handle));
+  }
+  return map.get();
+}
+
+bool QualityMapsOpen() {
+  return g_open.load(std::memory_order_relaxed) > 0;
+}
+
+bool QualityMapOpen(int handle) {
+  if (!QualityMapsOpen()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(g_maps_mutex);
+  auto it = g_maps.find(handle);
+  return it != g_maps.end() && it->second->open();
+}
+
+}  // namespace lse
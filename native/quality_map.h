@@ -0,0 +1,205 @@
+/// Fingerprint quality of preview frames, computed on the host.
+///
+/// LSCAN_CallbackObjectQuality reports one coarse state per fingertip and only
+/// with the auto-capture licence. A quality map analyzes every preview frame of
+/// its handle itself, in kMomentBlock x kMomentBlock blocks:
+///
+///   contrast   standard deviation of the block, scored against kFullContrast
+///   coherence  how consistently the block's gradients share one orientation,
+///              |(gxx - gyy, 2 gxy)| / (gxx + gyy): 1 for parallel ridges, near
+///              0 for noise, smudges and blank platen
+///   clarity    how cleanly the pixels split into ridges and valleys: the share
+///              of the block variance between the pixels above and below the
+///              block mean (Otsu's ratio), about 0.64 for noise, 0.81 for clean
+///              sinusoidal ridges and 1 for binary ones; scored from 0 at
+///              kBlurredClarity to 1 at kClearClarity
+///
+/// and a block quality, the product of the three scores. Blocks with at least
+/// minContrast are finger; connected finger blocks of at least minBlocks form
+/// the objects, ordered left to right, each with its bounding box and mean
+/// scores. The frame quality is that of the worst object.
+///
+/// The trigger suggests LSCAN_Capture_TakeResultImage(): it fires on the frame
+/// that completes stableFrames consecutive frames with the expected number of
+/// objects all at threshold, once until Rearm(). With `objects` set, only that
+/// many of the largest objects are reported and judged.
+///
+/// Block rows are split over the TaskPool with ParallelFor(), and the block sums
+/// use the SIMD kernels of image_kernels.h. Like the compositor, each map has at
+/// most one frame analyzing or waiting for JS; frames arriving meanwhile replace
+/// each other, so a slow consumer lowers the analysis rate rather than building
+/// a backlog. While a map is open the preview callback stays registered with the
+/// SDK, with or without a JS preview handler.
+
+#pragma once
+
+#include "callbacks.h"
+
+#include <node_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace lse {
+
+struct QualityMapConfig {
+  static constexpr double kFullContrast = 40;     ///< Standard deviation scored 1
+  static constexpr double kBlurredClarity = 0.6;  ///< Clarity ratio scored 0
+  static constexpr double kClearClarity = 0.8;    ///< Clarity ratio scored 1
+
+  int objects = 0;          ///< Objects the trigger waits for; 0 for at least one
+  double threshold = 0.6;   ///< Quality every object needs for the trigger
+  int stableFrames = 3;     ///< Consecutive frames at threshold before it fires
+  int minContrast = 10;     ///< Standard deviation of a finger block
+  int minBlocks = 6;        ///< Blocks of the smallest object
+  int threads = 0;          ///< Analysis threads; 0 for HardwareThreads()
+  bool maps = true;         ///< Deliver the per-block maps
+  double maxFps = 0;        ///< Analysis rate cap; 0 analyzes every frame it can
+};
+
+/// Planes of QualityFrame::maps, blocksWide x blocksHigh bytes each.
+enum class QualityPlane : int {
+  kQuality = 0,      ///< Block quality * 255
+  kCoherence = 1,    ///< * 255
+  kContrast = 2,     ///< Contrast score * 255
+  kClarity = 3,      ///< Clarity score * 255
+  kOrientation = 4,  ///< Ridge direction in degrees, 0-179, from the x axis towards y (image rows)
+  kCount = 5,
+};
+
+/// Scores of one block.
+struct QualityBlock {
+  float quality = 0;
+  float coherence = 0;
+  float contrast = 0;
+  float clarity = 0;
+  float angle = 0;  ///< Ridge direction in radians, [0, pi)
+  float mean = 0;   ///< Mean gray level
+  bool finger = false;
+};
+
+struct QualityObject {
+  int component = -1;  ///< Label of its blocks in FindQualityObjects()
+  int x = 0;  ///< Bounding box of the object's blocks, in image pixels
+  int y = 0;
+  int width = 0;
+  int height = 0;
+  int blocks = 0;
+  double quality = 0;      ///< Means over the object's blocks
+  double coherence = 0;
+  double contrast = 0;
+  double clarity = 0;
+  double orientation = 0;  ///< Dominant ridge direction in degrees
+  double mean = 0;         ///< Mean gray level: low is dark, high light
+};
+
+struct QualityFrame {
+  int width = 0;
+  int height = 0;
+  int blocksWide = 0;
+  int blocksHigh = 0;
+  FrameBlockPtr maps;  ///< QualityPlane::kCount planes, when requested
+  std::vector<QualityObject> objects;
+  double quality = 0;  ///< Quality of the worst object; 0 without objects
+  uint64_t analyzeNs = 0;
+};
+
+/// Scores of the (width / kMomentBlock) x (height / kMomentBlock) blocks of
+/// the 8-bit image at @p pixels into @p blocks, row by row; block rows are
+/// split over config.threads. Any thread.
+void ScoreQualityBlocks(const uint8_t *pixels, int width, int height, const QualityMapConfig &config,
+                        std::vector<QualityBlock> *blocks);
+
+/// Connected finger blocks (8-neighbourhood) of at least minBlocks into
+/// @p objects, largest first. @p labels, if given, receives the component of
+/// every block, -1 for none.
+void FindQualityObjects(const std::vector<QualityBlock> &blocks, int blocksWide, int blocksHigh,
+                        const QualityMapConfig &config, std::vector<QualityObject> *objects,
+                        std::vector<int> *labels = nullptr);
+
+/// Analyze the 8-bit @p width x @p height image at @p pixels; any thread.
+/// Returns false if the maps could not be allocated.
+bool AnalyzeQuality(const uint8_t *pixels, int width, int height, const QualityMapConfig &config,
+                    QualityFrame *frame);
+
+/// { width, height, blocksWide, blocksHigh, maps, objects, quality, stable,
+/// trigger, analyzeNs }: maps is a Buffer over the pooled planes (null when not
+/// requested), objects an array of { x, y, width, height, blocks, quality,
+/// coherence, contrast, clarity, orientation, mean }. @p stable counts the
+/// frames that met the trigger condition in a row, @p trigger is set on the
+/// frame that fired.
+napi_value QualityFrameToJs(napi_env env, QualityFrame *frame, int stable, bool trigger);
+
+struct QualityMapStats {
+  uint64_t received = 0;   ///< Preview frames offered by the SDK
+  uint64_t analyzed = 0;
+  uint64_t delivered = 0;  ///< Frames handed to the JS function
+  uint64_t dropped = 0;    ///< Frames replaced by a newer one before analysis
+  uint64_t skipped = 0;    ///< Frames over the maxFps rate, never copied
+  uint64_t triggers = 0;
+  uint64_t analyzeNs = 0;  ///< Total analysis time
+  uint64_t maxAnalyzeNs = 0;
+  uint64_t lastAnalyzeNs = 0;
+  uint64_t intervalNs = 0;  ///< Smoothed interval between offered frames: the budget
+  uint64_t overBudget = 0;  ///< Analyses that took longer than that interval
+};
+
+class QualityMap {
+ public:
+  explicit QualityMap(int handle) : handle_(handle) {}
+
+  /// JS thread. Start (or reconfigure) analysis into @p function, called as
+  /// (handle, frame, timestamp) with the frame of QualityFrameToJs(). Resets
+  /// the statistics and rearms the trigger. Returns the SDK status of
+  /// registering the preview callback.
+  int Open(napi_env env, const QualityMapConfig &config, napi_value function);
+
+  /// JS thread. Stop; a frame being analyzed is discarded.
+  int Close(napi_env env);
+
+  /// Any thread. Let the trigger fire again, counting stable frames from zero;
+  /// call when a capture starts.
+  void Rearm();
+
+  /// SDK thread: keep a copy of @p image as the next frame to analyze.
+  void Offer(const LScanImageData &image, uint64_t timestamp);
+
+  QualityMapStats Stats();
+  bool open() const { return open_.load(std::memory_order_acquire); }
+
+ private:
+  struct Output;
+
+  void Analyze(uint64_t generation);
+  void Deliver(napi_env env, Output *output);
+
+  const int handle_;
+  std::atomic<bool> open_{false};
+  napi_ref function_ = nullptr;  // JS thread only
+
+  std::mutex mutex_;
+  uint64_t generation_ = 0;  // Bumped by Open and Close; stale analyses are discarded
+  QualityMapConfig config_;
+  ImageFrame pending_;
+  uint64_t pending_timestamp_ = 0;
+  bool has_pending_ = false;
+  bool busy_ = false;  // A frame is analyzing or waiting for JS
+  uint64_t next_due_ = 0;  // Earliest timestamp maxFps lets through
+  uint64_t last_offered_ = 0;
+  int stable_ = 0;  // Consecutive frames meeting the trigger condition
+  bool triggered_ = false;
+  QualityMapStats stats_;
+};
+
+/// Quality map of @p handle; created on first use and never destroyed.
+QualityMap *GetQualityMap(int handle);
+
+/// Whether any quality map is open; cheap enough for every preview frame.
+bool QualityMapsOpen();
+
+/// Whether the preview callback of @p handle must stay registered for a quality map.
+bool QualityMapOpen(int handle);
+
+}  // namespace lse
@@ -0,0 +1,334 @@
+#include "recorder.h"
+
+#include "capture_stream.h"
+#include "clock.h"
+#include "dispatcher.h"
+#include "mapped_file.h"
+#include "napi_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace lse {
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'S', 'E', 'R', 'E', 'C', '0', '1'};
+constexpr size_t kInitialCapacity = size_t(64) << 20;
+constexpr size_t kMaxGrowth = size_t(1) << 30;
+
+size_t Align8(size_t size) {
+  return (size + 7) & ~size_t(7);
+}
+
+// ---------------------------------------------------------------------------
+// Recording
+
+std::atomic<bool> g_recording{false};
+std::mutex g_record_mutex;
+MappedFile g_file;        // guarded by g_record_mutex
+size_t g_used = 0;        // guarded by g_record_mutex
+int g_handle = -1;        // guarded by g_record_mutex
+RecorderStats g_stats;    // guarded by g_record_mutex
+
+/// Append one record. Call with g_record_mutex held.
+void Append(RecordHeader header, const void *payload, size_t payloadSize) {
+  if (!g_file.is_open() || (g_handle >= 0 && header.handle != g_handle && header.handle != -1)) {
+    return;
+  }
+  const size_t size = Align8(sizeof(RecordHeader) + payloadSize);
+  // Keep room for the zero size that ends the recording.
+  if (g_used + size + sizeof(uint32_t) > g_file.size()) {
+    size_t capacity = g_file.size() + std::min(g_file.size(), kMaxGrowth);
+    capacity = std::max(capacity, g_used + size + kInitialCapacity);
+    std::string error;
+    if (!g_file.Grow(capacity, &error)) {
+      g_stats.failed++;
+      return;
+    }
+  }
+  header.size = static_cast<uint32_t>(size);
+  header.payloadSize = static_cast<uint32_t>(payloadSize);
+  uint8_t *target = g_file.data() + g_used;
+  if (payloadSize > 0) {
+    memcpy(target + sizeof(RecordHeader), payload, payloadSize);
+  }
+  memcpy(target, &header, sizeof(header));
+  g_used += size;
+  g_stats.events++;
+  g_stats.bytes = g_used;
+}
+
+RecordHeader NewHeader(CallbackKind kind, int handle, int value, uint64_t timestamp) {
+  RecordHeader header;
+  memset(&header, 0, sizeof(header));
+  header.kind = static_cast<uint8_t>(kind);
+  header.handle = handle;
+  header.value = value;
+  header.timestamp = timestamp;
+  return header;
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+
+/// The receiver JS currently has for @p kind on @p handle: the handle's
+/// capture() stream while one is open, otherwise its callback slot.
+EventSink *ReplaySink(CallbackKind kind, int handle) {
+  switch (kind) {
+    case CallbackKind::kProgress:
+    case CallbackKind::kDeviceCount:
+      return SlotSink(GetCallbackSlot(kind, -1));
+    case CallbackKind::kCommunicationBreak:
+      return SlotSink(GetCallbackSlot(kind, handle));
+    default: {
+      CaptureStream *stream = GetCaptureStream(handle);
+      return stream->open() ? static_cast<EventSink *>(stream) : SlotSink(GetCallbackSlot(kind, handle));
+    }
+  }
+}
+
+/// Fire the callback of @p record as the SDK would.
+void Fire(const RecordHeader &record, const uint8_t *payload, int handle) {
+  const CallbackKind kind = static_cast<CallbackKind>(record.kind);
+  EventSink *sink = ReplaySink(kind, handle);
+  // The SDK hands out mutable image memory; receivers only copy from it.
+  LScanImageData image = {record.width, record.height, record.resolution, record.bitsPerPixel,
+                          static_cast<int>(record.payloadSize), const_cast<unsigned char *>(payload)};
+  switch (kind) {
+    case CallbackKind::kProgress:
+      OnProgress(handle, record.value, sink);
+      break;
+    case CallbackKind::kDeviceCount:
+      OnDeviceCount(record.value, sink);
+      break;
+    case CallbackKind::kCommunicationBreak:
+      OnCommunicationBreak(handle, sink);
+      break;
+    case CallbackKind::kPreviewImage:
+      OnPreviewImage(handle, image, sink);
+      break;
+    case CallbackKind::kObjectCount:
+      OnObjectCount(handle, static_cast<LScanObjectCountState>(record.value), sink);
+      break;
+    case CallbackKind::kObjectQuality: {
+      LScanObjectQualityState qualities[LSCAN_MAX_OBJECTS] = {};
+      int count = std::min<int>(record.value, LSCAN_MAX_OBJECTS);
+      count = std::min<int>(count, static_cast<int>(record.payloadSize / sizeof(int32_t)));
+      for (int i = 0; i < count; i++) {
+        int32_t quality = 0;
+        memcpy(&quality, payload + i * sizeof(int32_t), sizeof(quality));
+        qualities[i] = static_cast<LScanObjectQualityState>(quality);
+      }
+      OnObjectQuality(handle, qualities, count, sink);
+      break;
+    }
+    case CallbackKind::kTakingResultImage:
+      OnTakingResultImage(handle, sink);
+      break;
+    case CallbackKind::kAcquisitionComplete:
+      OnAcquisitionComplete(handle, sink);
+      break;
+    case CallbackKind::kResultImage:
+      OnResultImage(handle, image, static_cast<DWORD>(record.value), sink);
+      break;
+    case CallbackKind::kClearObjectsFromPlaten:
+      OnClearObjectsFromPlaten(handle, static_cast<LScanClearPlatenState>(record.value), sink);
+      break;
+    case CallbackKind::kKeys:
+      OnKeys(handle, static_cast<DWORD>(record.value), sink);
+      break;
+    case CallbackKind::kCompletion:
+      break;
+  }
+}
+
+class ReplayJob {
+ public:
+  explicit ReplayJob(const ReplayOptions &options) : options_(options) {}
+
+  MappedFile &file() { return file_; }
+  void set_deferred(napi_deferred deferred) { deferred_ = deferred; }
+  void Stop() { stop_.store(true, std::memory_order_release); }
+
+  void Run();
+
+ private:
+  const ReplayOptions options_;
+  napi_deferred deferred_ = nullptr;
+  MappedFile file_;
+  std::atomic<bool> stop_{false};
+};
+
+std::mutex g_replay_mutex;
+std::set<ReplayJob *> g_replays;  // guarded by g_replay_mutex
+
+void ReplayJob::Run() {
+  const RecordingHeader *header = reinterpret_cast<const RecordingHeader *>(file_.data());
+  const uint8_t *end = file_.data() + file_.size();
+  const uint8_t *cursor = file_.data() + header->headerSize;
+  const uint64_t start = NowNs();
+  uint64_t first = 0;
+  uint64_t events = 0;
+  while (cursor + sizeof(RecordHeader) <= end && !stop_.load(std::memory_order_acquire)) {
+    RecordHeader record;
+    memcpy(&record, cursor, sizeof(record));
+    if (record.size < sizeof(RecordHeader) || record.size > static_cast<size_t>(end - cursor) ||
+        record.payloadSize > record.size - sizeof(RecordHeader) ||
+        static_cast<uint64_t>(record.width) * static_cast<uint32_t>(record.height) > record.payloadSize) {
+      break;  // end of the recording, or a truncated record
+    }
+    if (options_.speed > 0) {
+      first = events == 0 ? record.timestamp : first;
+      // Threads of the SDK may record slightly out of timestamp order.
+      const uint64_t offset = record.timestamp > first ? record.timestamp - first : 0;
+      const uint64_t due = start + static_cast<uint64_t>(offset / options_.speed);
+      const uint64_t now = NowNs();
+      if (due > now) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+      }
+    }
+    Fire(record, cursor + sizeof(RecordHeader), options_.handle >= 0 ? options_.handle : record.handle);
+    events++;
+    cursor += record.size;
+  }
+  const uint64_t duration = NowNs() - start;
+  const uint64_t bytes = static_cast<uint64_t>(cursor - file_.data());
+  const bool stopped = stop_.load(std::memory_order_acquire);
+  {
+    std::lock_guard<std::mutex> lock(g_replay_mutex);
+    g_replays.erase(this);
+  }
+  napi_deferred deferred = deferred_;
+  delete this;
+  // Queued behind the replayed events, so the promise settles after JS saw them.
+  SharedDispatcher().PostCompletion([deferred, events, bytes, duration, stopped](napi_env env) {
+    SharedDispatcher().RemoveListener();
+    napi_resolve_deferred(env, deferred,
+                          ResultObject(env)
+                              .Double("events", static_cast<double>(events))
+                              .Double("bytes", static_cast<double>(bytes))
+                              .Double("durationNs", static_cast<double>(duration))
+                              .Bool("stopped", stopped)
+                              .value());
+  });
+}
+
+}  // namespace
+
+bool StartRecording(const std::string &path, int handle, std::string *error) {
+  StopRecording();
+  std::lock_guard<std::mutex> lock(g_record_mutex);
+  if (!g_file.Create(path, kInitialCapacity, error)) {
+    return false;
+  }
+  RecordingHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.headerSize = sizeof(RecordingHeader);
+  header.recordHeaderSize = sizeof(RecordHeader);
+  header.startNs = NowNs();
+  memcpy(g_file.data(), &header, sizeof(header));
+  g_used = Align8(sizeof(header));
+  g_handle = handle;
+  g_stats = RecorderStats();
+  g_stats.active = true;
+  g_stats.bytes = g_used;
+  g_recording.store(true, std::memory_order_release);
+  return true;
+}
+
+RecorderStats StopRecording() {
+  g_recording.store(false, std::memory_order_release);
+  std::lock_guard<std::mutex> lock(g_record_mutex);
+  if (g_file.is_open()) {
+    g_file.Close(g_used);
+  }
+  g_stats.active = false;
+  return g_stats;
+}
+
+RecorderStats GetRecorderStats() {
+  std::lock_guard<std::mutex> lock(g_record_mutex);
+  return g_stats;
+}
+
+bool IsRecording() {
+  return g_recording.load(std::memory_order_acquire);
+}
+
+void RecordEvent(const CallbackEvent &event) {
+  if (event.kind == CallbackKind::kPreviewImage || event.kind == CallbackKind::kResultImage) {
+    return;
+  }
+  RecordHeader header = NewHeader(event.kind, event.handle, event.value, event.timestamp);
+  int32_t qualities[LSCAN_MAX_OBJECTS];
+  size_t payloadSize = 0;
+  if (event.kind == CallbackKind::kObjectQuality) {
+    header.value = event.qualityCount;
+    for (int i = 0; i < event.qualityCount; i++) {
+      qualities[i] = static_cast<int32_t>(event.qualities[i]);
+    }
+    payloadSize = event.qualityCount * sizeof(int32_t);
+  }
+  std::lock_guard<std::mutex> lock(g_record_mutex);
+  Append(header, qualities, payloadSize);
+}
+
+void RecordImage(CallbackKind kind, int handle, int value, uint64_t timestamp, const LScanImageData &image) {
+  RecordHeader header = NewHeader(kind, handle, value, timestamp);
+  size_t payloadSize = image.buffer != nullptr && image.bufferSize > 0 ? static_cast<size_t>(image.bufferSize) : 0;
+  if (payloadSize > 0) {
+    header.width = image.width;
+    header.height = image.height;
+  }
+  header.resolution = image.resolution;
+  header.bitsPerPixel = image.bitsPerPixel;
+  std::lock_guard<std::mutex> lock(g_record_mutex);
+  Append(header, image.buffer, payloadSize);
+}
+
+napi_value StartReplay(napi_env env, const std::string &path, const ReplayOptions &options) {
+  std::unique_ptr<ReplayJob> job(new ReplayJob(options));
+  std::string error;
+  if (!job->file().OpenRead(path, &error)) {
+    napi_throw_error(env, "ERR_LSE_REPLAY", error.c_str());
+    return nullptr;
+  }
+  const RecordingHeader *header = reinterpret_cast<const RecordingHeader *>(job->file().data());
+  if (job->file().size() < sizeof(RecordingHeader) || memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->recordHeaderSize != sizeof(RecordHeader) || header->headerSize > job->file().size()) {
+    napi_throw_error(env, "ERR_LSE_REPLAY", ("Not a session recording: " + path).c_str());
+    return nullptr;
+  }
+  napi_deferred deferred = nullptr;
+  napi_value promise = nullptr;
+  NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+  job->set_deferred(deferred);
+  ReplayJob *running = job.release();  // deletes itself when done
+  {
+    std::lock_guard<std::mutex> lock(g_replay_mutex);
+    g_replays.insert(running);
+  }
+  // Keep the event loop alive until the replay settles its promise.
+  SharedDispatcher().AddListener();
+  // A thread of its own: a paced replay sleeps between records, which would hold
+  // a shared pool thread that encoding and segmentation jobs wait for.
+  std::thread([running] { running->Run(); }).detach();
+  return promise;
+}
+
+int StopReplays() {
+  std::lock_guard<std::mutex> lock(g_replay_mutex);
+  for (ReplayJob *job : g_replays) {
+    job->Stop();
+  }
+  return static_cast<int>(g_replays.size());
+}
+
+}  // namespace lse
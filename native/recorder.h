@@ -0,0 +1,96 @@
+/// Session recorder and replay.
+///
+/// The recorder appends every SDK callback, optionally of one handle only, to a
+/// memory-mapped file. It records in the trampolines, on the SDK thread and
+/// before preview backpressure or JS delivery, so a recording holds what the
+/// SDK produced, with the NowNs() time it arrived. Like the SDK, it only sees
+/// the callbacks something is registered for.
+///
+/// Replay maps a recording read-only and fires its callbacks through the same
+/// trampolines, to whatever JS registered for them (callbacks or a capture()
+/// stream), at the recorded pace scaled by a speed factor, or back to back.
+/// Image pixels go from the mapping straight into the frame pool, exactly like
+/// SDK frames; nothing is read() into intermediate buffers.
+///
+/// File layout, host byte order, records 8-byte aligned:
+///   RecordingHeader
+///   RecordHeader + payload, repeated. The payload holds the image pixels or
+///   the object qualities as int32. A record size of 0 ends the recording: the
+///   file grows in zero-filled steps and is cut to length when recording stops,
+///   so a recording that was not stopped (crash) still replays up to the last
+///   complete record.
+
+#pragma once
+
+#include "callbacks.h"
+
+#include <node_api.h>
+
+#include <cstdint>
+#include <string>
+
+namespace lse {
+
+struct RecordingHeader {
+  char magic[8];              ///< "LSEREC01"
+  uint32_t headerSize;        ///< sizeof(RecordingHeader)
+  uint32_t recordHeaderSize;  ///< sizeof(RecordHeader)
+  uint64_t startNs;           ///< NowNs() when recording started
+};
+
+struct RecordHeader {
+  uint32_t size;         ///< Whole record including header and padding; 0 ends the file
+  uint8_t kind;          ///< CallbackKind
+  uint8_t reserved[3];
+  uint64_t timestamp;    ///< NowNs() when the SDK invoked the trampoline
+  int32_t handle;
+  int32_t value;         ///< As CallbackEvent::value; the quality count for kObjectQuality
+  int32_t width;         ///< Image geometry; 0 for events without an image
+  int32_t height;
+  int32_t resolution;
+  int32_t bitsPerPixel;
+  uint32_t payloadSize;
+  uint32_t reserved2;
+};
+
+static_assert(sizeof(RecordHeader) == 48, "RecordHeader layout is part of the file format");
+
+struct RecorderStats {
+  bool active = false;
+  uint64_t events = 0;   ///< Records written
+  uint64_t bytes = 0;    ///< File length, headers included
+  uint64_t failed = 0;   ///< Events lost because the file could not grow
+};
+
+/// Start recording the callbacks of @p handle (-1: all handles) to a new file at
+/// @p path, replacing any recording in progress.
+bool StartRecording(const std::string &path, int handle, std::string *error);
+
+/// Stop recording and close the file. Returns the final statistics.
+RecorderStats StopRecording();
+
+RecorderStats GetRecorderStats();
+
+/// Cheap check for the trampolines.
+bool IsRecording();
+
+/// Record @p event; image events go through RecordImage() instead.
+void RecordEvent(const CallbackEvent &event);
+
+/// Record an image callback with the SDK's pixel memory.
+void RecordImage(CallbackKind kind, int handle, int value, uint64_t timestamp, const LScanImageData &image);
+
+struct ReplayOptions {
+  double speed = 1;  ///< Multiple of the recorded pace; 0 = no pacing
+  int handle = -1;   ///< Fire every event for this handle instead of the recorded one (-1: keep)
+};
+
+/// JS thread. Replay the recording at @p path on a thread of its own. Returns a promise
+/// for { events, bytes, durationNs, stopped }, or nullptr after throwing.
+napi_value StartReplay(napi_env env, const std::string &path, const ReplayOptions &options);
+
+/// Stop every replay in progress; their promises resolve with stopped: true.
+/// Returns how many were running.
+int StopReplays();
+
+}  // namespace lse
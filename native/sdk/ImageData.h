@@ -0,0 +1,25 @@
+/// Image data exchanged with LScanEssentials callbacks.
+/// @file     ImageData.h
+///
+/// Reconstructed companion of resources/reference/LScanEssentialsApi.h,
+/// see LScanEssentialsApi_defs.h.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// 8-bit grayscale image, row major, @e width bytes per line.
+typedef struct LScanImageData {
+  int            width;         ///< Image width in pixels
+  int            height;        ///< Image height in pixels
+  int            resolution;    ///< Image resolution in ppi
+  int            bitsPerPixel;  ///< Color depth; always 8 for fingerprint images
+  int            bufferSize;    ///< Size of @e buffer in bytes
+  unsigned char *buffer;        ///< Pixel data; owned by the SDK
+} LScanImageData;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
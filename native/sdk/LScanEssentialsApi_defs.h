@@ -0,0 +1,273 @@
+/// LScanEssentials API type definitions.
+/// @file     LScanEssentialsApi_defs.h
+///
+/// The vendor SDK ships this header next to LScanEssentialsApi.h, but only the
+/// API header itself is kept in resources/reference. This is a reconstruction of
+/// the types and constants referenced by that header so that the native addon and
+/// the Linux stub library can compile against resources/reference/LScanEssentialsApi.h
+/// unmodified. When building against the real SDK on Windows, put the vendor's
+/// include directory in front of this one.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdint.h>
+
+#define WINAPI
+#define CALLBACK
+
+typedef int            BOOL;
+typedef uint32_t       DWORD;
+typedef uint32_t       COLORREF;
+typedef const char    *LPCSTR;
+typedef char          *LPSTR;
+typedef void          *HWND;
+
+typedef struct tagRECT {
+  int32_t left;
+  int32_t top;
+  int32_t right;
+  int32_t bottom;
+} RECT;
+
+#ifndef TRUE
+#define TRUE  1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+#endif // _WIN32
+
+#include "ImageData.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Maximum length of strings exchanged with the API (including terminating zero).
+#define LSCAN_MAX_STR_LEN        128
+
+/// Upper bound for contrast values (see LSCAN_Capture_SetContrast()).
+#define LSCAN_MAX_CONTRAST_VALUE 255
+
+/// Maximum number of objects (fingertips/palm areas) reported per capture.
+#define LSCAN_MAX_OBJECTS        4
+
+/// API version information.
+typedef struct LScanApiVersion {
+  int MajorVersion;
+  int MinorVersion;
+  int PatchVersion;
+  int BuildVersion;
+} LScanApiVersion;
+
+/// Basic device information.
+typedef struct LScanDeviceInfo {
+  char DeviceSerialNumber[LSCAN_MAX_STR_LEN];
+  char ProductName[LSCAN_MAX_STR_LEN];
+  char InterfaceType[LSCAN_MAX_STR_LEN];
+  char FirmwareVersion[LSCAN_MAX_STR_LEN];
+  char HardwareVersion[LSCAN_MAX_STR_LEN];
+  BOOL IsInitialized;
+} LScanDeviceInfo;
+
+/// Device property identifiers (see LSCAN_Main_GetProperty()).
+typedef enum LScanPropertyId {
+  LSCAN_PROPERTY_SERIAL_NUMBER          = 0,
+  LSCAN_PROPERTY_PRODUCT_NAME           = 1,
+  LSCAN_PROPERTY_FIRMWARE_VERSION       = 2,
+  LSCAN_PROPERTY_HARDWARE_VERSION       = 3,
+  LSCAN_PROPERTY_AUTOMATIC_ADJUSTMENT   = 4,
+  LSCAN_PROPERTY_ROLL_ALLOW_RESTART     = 5,
+  LSCAN_PROPERTY_ROLL_MODE              = 6,
+  LSCAN_PROPERTY_LICENSES               = 7,
+  LSCAN_PROPERTY_TEMPERATURE            = 8,
+  LSCAN_PROPERTY_PLATEN_STATE           = 9,
+} LScanPropertyId;
+
+/// @anchor ImageTypes
+typedef enum LScanImageType {
+  LSCAN_TYPE_NONE                       = 0,
+  LSCAN_FLAT_SINGLE_FINGER              = 1,
+  LSCAN_ROLL_SINGLE_FINGER              = 2,
+  LSCAN_FLAT_TWO_FINGERS                = 3,
+  LSCAN_FLAT_FOUR_FINGERS               = 4,
+  LSCAN_FLAT_THUMBS                     = 5,
+  LSCAN_FLAT_PALM                       = 6,
+  LSCAN_FLAT_WRITERS_PALM               = 7,
+} LScanImageType;
+
+typedef enum LScanImageResolution {
+  LSCAN_RES_500                         = 500,
+  LSCAN_RES_1000                        = 1000,
+} LScanImageResolution;
+
+typedef enum LScanImageOrientation {
+  LSCAN_ORIENTATION_TOP_DOWN            = 0,
+  LSCAN_ORIENTATION_BOTTOM_UP           = 1,
+} LScanImageOrientation;
+
+/// @anchor CaptureOptions
+#define LSCAN_OPTION_AUTO_CAPTURE       0x0001
+#define LSCAN_OPTION_AUTO_CONTRAST      0x0002
+#define LSCAN_OPTION_FLAT_SEGMENTATION  0x0004
+#define LSCAN_OPTION_ROLL_SHIFT_CHECK   0x0008
+
+/// @anchor VisualizationOptions
+#define LSCAN_OPTION_VIS_FULL_IMAGE     0x0001
+#define LSCAN_OPTION_VIS_FINGER_MARKERS 0x0002
+
+typedef enum LScanVisMode {
+  LSCAN_VIS_NONE                        = 0,
+  LSCAN_VIS_PREVIEW                     = 1,
+  LSCAN_VIS_RESULT                      = 2,
+  LSCAN_VIS_PREVIEW_AND_RESULT          = 3,
+} LScanVisMode;
+
+typedef enum LScanBeeperType {
+  LSCAN_BEEPER_NONE                     = 0,
+  LSCAN_BEEPER_STANDARD                 = 1,
+  LSCAN_BEEPER_VOLUME                   = 2,
+} LScanBeeperType;
+
+typedef enum LScanKeypadType {
+  LSCAN_KEYPAD_NONE                     = 0,
+  LSCAN_KEYPAD_TWO_KEYS                 = 1,
+  LSCAN_KEYPAD_FOUR_KEYS                = 2,
+  LSCAN_KEYPAD_DISPLAY                  = 3,
+} LScanKeypadType;
+
+typedef enum LScanLedType {
+  LSCAN_LED_NONE                        = 0,
+  LSCAN_LED_STATUS                      = 1,
+  LSCAN_LED_FINGER                      = 2,
+} LScanLedType;
+
+/// @anchor Keys
+#define LSCAN_KEY_LEFT                  0x0001
+#define LSCAN_KEY_RIGHT                 0x0002
+#define LSCAN_KEY_UP                    0x0004
+#define LSCAN_KEY_DOWN                  0x0008
+#define LSCAN_KEY_FOOT_SWITCH           0x0100
+
+/// @anchor DisplayLogoOptions
+typedef enum LScanDisplayLogoOption {
+  LSCAN_DISPLAY_LOGO_PLAIN              = 0,
+  LSCAN_DISPLAY_LOGO_PROGRESS           = 1,
+} LScanDisplayLogoOption;
+
+/// @anchor DisplaySelectionCtrl
+typedef enum LScanDisplaySelectionCtrl {
+  LSCAN_DISPLAY_SELECTION_NONE          = 0,
+  LSCAN_DISPLAY_SELECTION_BANDAGED      = 1,
+  LSCAN_DISPLAY_SELECTION_MISSING       = 2,
+  LSCAN_DISPLAY_SELECTION_RESTRICTED    = 3,
+  LSCAN_DISPLAY_SELECTION_UNRESTRICTED  = 4,
+} LScanDisplaySelectionCtrl;
+
+/// @anchor DisplayCommonCtrl
+typedef enum LScanDisplayCommonCtrl {
+  LSCAN_DISPLAY_CTRL_NONE               = 0,
+  LSCAN_DISPLAY_CTRL_OK                 = 1,
+  LSCAN_DISPLAY_CTRL_CANCEL             = 2,
+  LSCAN_DISPLAY_CTRL_REPEAT             = 3,
+  LSCAN_DISPLAY_CTRL_NEXT               = 4,
+} LScanDisplayCommonCtrl;
+
+/// @anchor DisplayStatTop
+typedef enum LScanDisplayStatTop {
+  LSCAN_DISPLAY_STAT_TOP_NONE           = 0,
+  LSCAN_DISPLAY_STAT_TOP_ROLL_LEFT      = 1,
+  LSCAN_DISPLAY_STAT_TOP_ROLL_RIGHT     = 2,
+  LSCAN_DISPLAY_STAT_TOP_SCANNING       = 3,
+} LScanDisplayStatTop;
+
+/// @anchor DisplayStatBottom
+typedef enum LScanDisplayStatBottom {
+  LSCAN_DISPLAY_STAT_BOTTOM_NONE        = 0,
+  LSCAN_DISPLAY_STAT_BOTTOM_OK          = 1,
+  LSCAN_DISPLAY_STAT_BOTTOM_ROLL_ERROR  = 2,
+  LSCAN_DISPLAY_STAT_BOTTOM_QUALITY_BAD = 3,
+} LScanDisplayStatBottom;
+
+/// @anchor DisplayObjectColor
+typedef enum LScanDisplayObjectColor {
+  LSCAN_DISPLAY_COLOR_NONE              = 0,
+  LSCAN_DISPLAY_COLOR_GRAY              = 1,
+  LSCAN_DISPLAY_COLOR_GREEN             = 2,
+  LSCAN_DISPLAY_COLOR_YELLOW            = 3,
+  LSCAN_DISPLAY_COLOR_RED               = 4,
+  LSCAN_DISPLAY_COLOR_BLINK_GREEN       = 5,
+} LScanDisplayObjectColor;
+
+/// Object count state reported by LSCAN_CallbackObjectCount.
+typedef enum LScanObjectCountState {
+  LSCAN_OBJECT_COUNT_OK                 = 0,
+  LSCAN_OBJECT_COUNT_TOO_FEW            = 1,
+  LSCAN_OBJECT_COUNT_TOO_MANY           = 2,
+} LScanObjectCountState;
+
+/// Per-object quality reported by LSCAN_CallbackObjectQuality.
+typedef enum LScanObjectQualityState {
+  LSCAN_QUALITY_GOOD                    = 0,
+  LSCAN_QUALITY_NOT_PRESENT             = 1,
+  LSCAN_QUALITY_TOO_LIGHT               = 2,
+  LSCAN_QUALITY_TOO_DARK                = 3,
+  LSCAN_QUALITY_BAD_SHAPE               = 4,
+  LSCAN_QUALITY_WRONG_SLAP              = 5,
+  LSCAN_QUALITY_BAD_POSITION            = 6,
+  LSCAN_QUALITY_ROLL_SHIFTED            = 7,
+} LScanObjectQualityState;
+
+/// Platen state reported by LSCAN_CallbackClearObjectsFromPlaten.
+typedef enum LScanClearPlatenState {
+  LSCAN_CLEAR_OBJECT_FROM_PLATEN        = 0,
+  LSCAN_PLATED_CLEARED                  = 1,
+} LScanClearPlatenState;
+
+/// Result image status flags reported by LSCAN_CallbackResultImage.
+#define LSCAN_IMAGE_STATUS_OK           0x0000
+#define LSCAN_IMAGE_STATUS_QUALITY_LOW  0x0001
+#define LSCAN_IMAGE_STATUS_ROLL_SHIFTED 0x0002
+#define LSCAN_IMAGE_STATUS_ABORTED      0x0004
+
+///@name Callback Signatures
+/// All callbacks are invoked on an SDK-internal thread.
+///@{
+
+/// Generic device notification (taking result image, acquisition complete, communication break).
+typedef void (CALLBACK *LSCAN_Callback)(int handle, void *context);
+
+/// Operation progress (initialization, infield test) in percent.
+typedef void (CALLBACK *LSCAN_CallbackProgress)(int deviceIndex, int progressValue, void *context);
+
+/// Change of number of connected devices.
+typedef void (CALLBACK *LSCAN_CallbackDeviceCount)(int deviceCount, void *context);
+
+/// Preview image; image memory is only valid for the duration of the call.
+typedef void (CALLBACK *LSCAN_CallbackPreviewImage)(int handle, const LScanImageData imageData, void *context);
+
+/// Result image; image memory is only valid for the duration of the call.
+typedef void (CALLBACK *LSCAN_CallbackResultImage)(int handle, const LScanImageData imageData,
+                                                   const DWORD imageStatus, void *context);
+
+/// Object count state change.
+typedef void (CALLBACK *LSCAN_CallbackObjectCount)(int handle, const LScanObjectCountState state, void *context);
+
+/// Object quality change; @e qualities holds @e qualityCount entries.
+typedef void (CALLBACK *LSCAN_CallbackObjectQuality)(int handle, const LScanObjectQualityState *qualities,
+                                                     const int qualityCount, void *context);
+
+/// Request to clear platen / platen cleared.
+typedef void (CALLBACK *LSCAN_CallbackClearObjectsFromPlaten)(int handle, const LScanClearPlatenState state,
+                                                              void *context);
+
+/// Key state change; @e pressedKeys is the bit pattern of currently pressed keys (see @ref Keys).
+typedef void (CALLBACK *LSCAN_CallbackKeys)(int handle, const DWORD pressedKeys, void *context);
+///@}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
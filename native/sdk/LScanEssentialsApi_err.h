@@ -0,0 +1,29 @@
+/// LScanEssentials API status codes.
+/// @file     LScanEssentialsApi_err.h
+///
+/// Reconstructed companion of resources/reference/LScanEssentialsApi.h,
+/// see LScanEssentialsApi_defs.h. Warnings are positive, errors negative.
+
+#pragma once
+
+#define LSCAN_STATUS_OK                          0
+
+#define LSCAN_WRN_ALREADY_INITIALIZED            1
+#define LSCAN_WRN_OPTICS_SURFACE_DIRTY           2
+
+#define LSCAN_ERR_GENERAL                       -1
+#define LSCAN_ERR_API_NOT_INITIALIZED           -2
+#define LSCAN_ERR_INVALID_PARAM_VALUE           -3
+#define LSCAN_ERR_NOT_INITIALIZED               -4
+#define LSCAN_ERR_DEVICE_IO                     -5
+#define LSCAN_ERR_RESOURCE_LOCKED               -6
+#define LSCAN_ERR_NOT_SUPPORTED                 -7
+#define LSCAN_ERR_NO_HARDWARE_SUPPORT           -8
+#define LSCAN_ERR_CAPTURE_IN_PROGRESS           -9
+#define LSCAN_ERR_NOT_CAPTURING                -10
+#define LSCAN_ERR_CHANNEL_INVALID_CAPTURE_MODE -11
+#define LSCAN_ERR_CHANNEL_NOT_ACTIVE           -12
+#define LSCAN_ERR_NO_HAND_FINGER               -13
+#define LSCAN_ERR_INVALID_DEVICE_INDEX         -14
+#define LSCAN_ERR_TIMEOUT                      -15
+#define LSCAN_ERR_LICENSE                      -16
@@ -0,0 +1,442 @@
+#include "segmentation.h"
+
+#include "clock.h"
+#include "image_kernels.h"
+#include "napi_util.h"
+#include "task_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+namespace lse {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// Narrowest component, in blocks, that may be split into two fingers.
+constexpr int kMinSplitColumns = 4;
+
+std::mutex g_configs_mutex;
+std::map<int, SegmentationConfig> g_configs;
+
+std::mutex g_stats_mutex;
+SegmentationStats g_stats;
+
+/// A finger on the block grid: the blocks labelled @e component.
+struct Part {
+  int component = -1;
+  int left = 0;  ///< Block bounding box, inclusive
+  int top = 0;
+  int right = 0;
+  int bottom = 0;
+  int blocks = 0;
+};
+
+/// Fingers an image of @p imageType holds; 0 if it does not say.
+int ExpectedFingers(int imageType) {
+  switch (imageType) {
+    case LSCAN_FLAT_SINGLE_FINGER:
+    case LSCAN_ROLL_SINGLE_FINGER:
+      return 1;
+    case LSCAN_FLAT_TWO_FINGERS:
+    case LSCAN_FLAT_THUMBS:
+      return 2;
+    case LSCAN_FLAT_FOUR_FINGERS:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+const char *HandName(Hand hand) {
+  switch (hand) {
+    case Hand::kRight:
+      return "right";
+    case Hand::kLeft:
+      return "left";
+    default:
+      return "unknown";
+  }
+}
+
+/// Recompute the bounding box and block count of @p part within its current box.
+void Measure(const std::vector<int> &labels, int blocksWide, Part *part) {
+  int left = part->right;
+  int top = part->bottom;
+  int right = part->left;
+  int bottom = part->top;
+  int blocks = 0;
+  for (int by = part->top; by <= part->bottom; by++) {
+    for (int bx = part->left; bx <= part->right; bx++) {
+      if (labels[static_cast<size_t>(by) * blocksWide + bx] == part->component) {
+        left = std::min(left, bx);
+        right = std::max(right, bx);
+        top = std::min(top, by);
+        bottom = std::max(bottom, by);
+        blocks++;
+      }
+    }
+  }
+  part->left = left;
+  part->top = top;
+  part->right = right;
+  part->bottom = bottom;
+  part->blocks = blocks;
+}
+
+/// Split the widest part at the block column with the fewest of its blocks,
+/// away from its outer quarters; the blocks right of that column become
+/// @p component. False if no part is wide enough.
+bool SplitWidest(std::vector<int> *labels, int blocksWide, int component, std::vector<Part> *parts) {
+  Part *widest = nullptr;
+  for (Part &part : *parts) {
+    const int columns = part.right - part.left + 1;
+    if (columns >= kMinSplitColumns && (widest == nullptr || columns > widest->right - widest->left + 1)) {
+      widest = &part;
+    }
+  }
+  if (widest == nullptr) {
+    return false;
+  }
+  const int columns = widest->right - widest->left + 1;
+  std::vector<int> counts(columns, 0);
+  for (int by = widest->top; by <= widest->bottom; by++) {
+    for (int bx = widest->left; bx <= widest->right; bx++) {
+      if ((*labels)[static_cast<size_t>(by) * blocksWide + bx] == widest->component) {
+        counts[bx - widest->left]++;
+      }
+    }
+  }
+  const int margin = std::max(1, columns / 4);
+  const int middle = columns / 2;
+  int cut = margin;
+  for (int column = margin; column < columns - margin; column++) {
+    // Ties go to the column nearest the middle.
+    if (counts[column] < counts[cut] ||
+        (counts[column] == counts[cut] && std::abs(column - middle) < std::abs(cut - middle))) {
+      cut = column;
+    }
+  }
+  Part right = *widest;
+  right.component = component;
+  right.left = widest->left + cut + 1;
+  for (int by = widest->top; by <= widest->bottom; by++) {
+    for (int bx = right.left; bx <= widest->right; bx++) {
+      int &label = (*labels)[static_cast<size_t>(by) * blocksWide + bx];
+      if (label == widest->component) {
+        label = component;
+      }
+    }
+  }
+  widest->right = right.left - 1;
+  Measure(*labels, blocksWide, widest);
+  Measure(*labels, blocksWide, &right);
+  parts->push_back(right);
+  return true;
+}
+
+/// Whether block (@p bx, @p by) belongs to @p component or is a finger-free
+/// block next to it, which may still hold the finger's edge.
+bool InFinger(const std::vector<int> &labels, int blocksWide, int blocksHigh, int bx, int by, int component) {
+  const int label = labels[static_cast<size_t>(by) * blocksWide + bx];
+  if (label == component) {
+    return true;
+  }
+  if (label >= 0) {
+    return false;
+  }
+  for (int ny = std::max(0, by - 1); ny <= std::min(blocksHigh - 1, by + 1); ny++) {
+    for (int nx = std::max(0, bx - 1); nx <= std::min(blocksWide - 1, bx + 1); nx++) {
+      if (labels[static_cast<size_t>(ny) * blocksWide + nx] == component) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/// Pixel pass over the blocks of @p part: pixels below @p threshold give the
+/// finger's box, centroid and principal axis; its blocks give the quality.
+void MeasureFinger(const uint8_t *pixels, int width, const std::vector<QualityBlock> &scores,
+                   const std::vector<int> &labels, int blocksWide, int blocksHigh, const Part &part, int threshold,
+                   FingerSegment *finger) {
+  int left = width;
+  int top = -1;
+  int right = -1;
+  int bottom = -1;
+  int64_t count = 0;
+  // Sums relative to the part's corner keep the second moments exact in doubles.
+  const int originX = part.left * kMomentBlock;
+  const int originY = part.top * kMomentBlock;
+  double sumX = 0;
+  double sumY = 0;
+  double sumXX = 0;
+  double sumYY = 0;
+  double sumXY = 0;
+  double quality = 0;
+  for (int by = std::max(0, part.top - 1); by <= std::min(blocksHigh - 1, part.bottom + 1); by++) {
+    for (int bx = std::max(0, part.left - 1); bx <= std::min(blocksWide - 1, part.right + 1); bx++) {
+      if (!InFinger(labels, blocksWide, blocksHigh, bx, by, part.component)) {
+        continue;
+      }
+      const size_t index = static_cast<size_t>(by) * blocksWide + bx;
+      if (labels[index] == part.component) {
+        quality += scores[index].quality;
+      }
+      const int x0 = bx * kMomentBlock;
+      const int y0 = by * kMomentBlock;
+      DarkRow rows[kMomentBlock];
+      CountDarkBlock(pixels + static_cast<size_t>(y0) * width + x0, width, threshold, rows);
+      // Offsets from the block's left edge, moved to the part's corner.
+      const double base = x0 - originX;
+      for (int r = 0; r < kMomentBlock; r++) {
+        const DarkRow &dark = rows[r];
+        if (dark.count == 0) {
+          continue;
+        }
+        const uint8_t *row = pixels + static_cast<size_t>(y0 + r) * width + x0;
+        int first = 0;
+        while (row[first] >= threshold) {
+          first++;
+        }
+        int last = kMomentBlock - 1;
+        while (row[last] >= threshold) {
+          last--;
+        }
+        const double dy = y0 + r - originY;
+        const double sum = base * dark.count + dark.offsets;
+        left = std::min(left, x0 + first);
+        right = std::max(right, x0 + last);
+        top = top < 0 ? y0 + r : std::min(top, y0 + r);
+        bottom = std::max(bottom, y0 + r);
+        count += dark.count;
+        sumX += sum;
+        sumY += dy * dark.count;
+        sumXX += base * base * dark.count + 2 * base * dark.offsets + dark.squares;
+        sumYY += dy * dy * dark.count;
+        sumXY += dy * sum;
+      }
+    }
+  }
+  finger->quality = part.blocks > 0 ? quality / part.blocks : 0;
+  if (count == 0) {
+    // Ridges too faint for the platen threshold: fall back to the blocks.
+    finger->x = part.left * kMomentBlock;
+    finger->y = part.top * kMomentBlock;
+    finger->width = (part.right - part.left + 1) * kMomentBlock;
+    finger->height = (part.bottom - part.top + 1) * kMomentBlock;
+    finger->centerX = finger->x + finger->width / 2.0;
+    finger->centerY = finger->y + finger->height / 2.0;
+    finger->orientation = 90;
+    return;
+  }
+  const double n = static_cast<double>(count);
+  const double meanX = sumX / n;
+  const double meanY = sumY / n;
+  const double xx = sumXX / n - meanX * meanX;
+  const double yy = sumYY / n - meanY * meanY;
+  const double xy = sumXY / n - meanX * meanY;
+  finger->x = left;
+  finger->y = top;
+  finger->width = right - left + 1;
+  finger->height = bottom - top + 1;
+  finger->pixels = static_cast<int>(count);
+  finger->centerX = originX + meanX;
+  finger->centerY = originY + meanY;
+  const double degrees = 0.5 * std::atan2(2 * xy, xx - yy) * 180 / kPi;
+  finger->orientation = degrees < 0 ? degrees + 180 : degrees;
+}
+
+/// Hand and finger positions of @p result, whose fingers are sorted left to right.
+void AssignPositions(const SegmentationConfig &config, SlapSegmentation *result) {
+  std::vector<FingerSegment> &fingers = result->fingers;
+  result->hand = config.hand;
+  if (config.imageType == LSCAN_FLAT_THUMBS) {
+    // Left thumb on the left, right thumb on the right; a single one by its side of the image.
+    for (FingerSegment &finger : fingers) {
+      bool left = fingers.size() == 2 ? &finger == &fingers[0] : finger.centerX < result->width / 2.0;
+      finger.hand = left ? Hand::kLeft : Hand::kRight;
+      finger.position = left ? 6 : 1;
+    }
+    result->hand = Hand::kUnknown;
+    return;
+  }
+  if (config.imageType == LSCAN_FLAT_FOUR_FINGERS && result->complete && result->hand == Hand::kUnknown) {
+    result->hand = fingers.front().pixels < fingers.back().pixels ? Hand::kLeft : Hand::kRight;
+    result->handInferred = true;
+  }
+  for (size_t i = 0; i < fingers.size(); i++) {
+    fingers[i].hand = result->hand;
+    if (config.imageType == LSCAN_FLAT_FOUR_FINGERS && result->complete && result->hand != Hand::kUnknown) {
+      // Index to little finger from the thumb side: 2-5 on the right hand, 7-10 on the left.
+      fingers[i].position = result->hand == Hand::kRight ? 2 + static_cast<int>(i) : 10 - static_cast<int>(i);
+    }
+  }
+}
+
+}  // namespace
+
+void SegmentSlap(const uint8_t *pixels, int width, int height, const SegmentationConfig &config,
+                 SlapSegmentation *result) {
+  const uint64_t start = NowNs();
+  *result = SlapSegmentation();
+  result->width = width;
+  result->height = height;
+  result->expected = config.fingers > 0 ? config.fingers : ExpectedFingers(config.imageType);
+  const int blocksWide = width / kMomentBlock;
+  const int blocksHigh = height / kMomentBlock;
+  const int threads = config.threads > 0 ? std::min(config.threads, TaskPool::kMaxThreads) : HardwareThreads();
+
+  QualityMapConfig blockConfig;
+  blockConfig.minContrast = config.minContrast;
+  blockConfig.minBlocks = config.minBlocks;
+  blockConfig.threads = threads;
+  static thread_local std::vector<QualityBlock> scores;
+  static thread_local std::vector<QualityObject> objects;
+  static thread_local std::vector<int> labels;
+  ScoreQualityBlocks(pixels, width, height, blockConfig, &scores);
+  FindQualityObjects(scores, blocksWide, blocksHigh, blockConfig, &objects, &labels);
+
+  std::vector<Part> parts;
+  for (const QualityObject &object : objects) {
+    Part part;
+    part.component = object.component;
+    part.left = object.x / kMomentBlock;
+    part.top = object.y / kMomentBlock;
+    part.right = part.left + object.width / kMomentBlock - 1;
+    part.bottom = part.top + object.height / kMomentBlock - 1;
+    part.blocks = object.blocks;
+    parts.push_back(part);
+  }
+  // Labels past the block count are free for the parts split off.
+  int nextComponent = blocksWide * blocksHigh;
+  while (static_cast<int>(parts.size()) < result->expected &&
+         SplitWidest(&labels, blocksWide, nextComponent, &parts)) {
+    nextComponent++;
+    result->splits++;
+  }
+  std::stable_sort(parts.begin(), parts.end(), [](const Part &a, const Part &b) { return a.blocks > b.blocks; });
+  const int limit = result->expected > 0 ? result->expected : LSCAN_MAX_OBJECTS;
+  if (static_cast<int>(parts.size()) > limit) {
+    parts.resize(limit);
+  }
+  std::sort(parts.begin(), parts.end(),
+            [](const Part &a, const Part &b) { return a.left + a.right < b.left + b.right; });
+
+  // The platen: the median gray level of the blocks without finger.
+  std::vector<uint8_t> background;
+  for (const QualityBlock &score : scores) {
+    if (!score.finger) {
+      background.push_back(static_cast<uint8_t>(score.mean));
+    }
+  }
+  int platen = 255;
+  if (!background.empty()) {
+    std::nth_element(background.begin(), background.begin() + background.size() / 2, background.end());
+    platen = background[background.size() / 2];
+  }
+  const int threshold = std::max(1, platen - SegmentationConfig::kDarkMargin);
+
+  result->fingers.resize(parts.size());
+  FingerSegment *fingers = result->fingers.data();
+  const Part *partList = parts.data();
+  const std::vector<QualityBlock> &blockScores = scores;
+  const std::vector<int> &blockLabels = labels;
+  SharedTaskPool().ParallelFor(static_cast<int>(parts.size()), threads, [&, fingers, partList](int i) {
+    MeasureFinger(pixels, width, blockScores, blockLabels, blocksWide, blocksHigh, partList[i], threshold,
+                  &fingers[i]);
+  });
+  result->complete = result->expected > 0 && static_cast<int>(parts.size()) == result->expected;
+  AssignPositions(config, result);
+  result->segmentNs = NowNs() - start;
+
+  std::lock_guard<std::mutex> lock(g_stats_mutex);
+  g_stats.images++;
+  g_stats.fingers += result->fingers.size();
+  g_stats.incomplete += result->expected > 0 && !result->complete ? 1 : 0;
+  g_stats.splits += result->splits;
+  g_stats.segmentNs += result->segmentNs;
+  g_stats.maxSegmentNs = std::max(g_stats.maxSegmentNs, result->segmentNs);
+}
+
+napi_value SegmentationToJs(napi_env env, const SlapSegmentation &result, napi_value image) {
+  napi_value buffer = nullptr;
+  size_t length = 0;
+  size_t byteOffset = 0;
+  if (image != nullptr) {
+    napi_typedarray_type type;
+    void *data = nullptr;
+    if (napi_get_typedarray_info(env, image, &type, &length, &data, &buffer, &byteOffset) != napi_ok) {
+      buffer = nullptr;
+    }
+  }
+  napi_value fingers = nullptr;
+  napi_create_array_with_length(env, result.fingers.size(), &fingers);
+  for (size_t i = 0; i < result.fingers.size(); i++) {
+    const FingerSegment &finger = result.fingers[i];
+    // From the finger's first pixel to its last, in the image's own memory.
+    const size_t offset = static_cast<size_t>(finger.y) * result.width + finger.x;
+    const size_t span = static_cast<size_t>(finger.height - 1) * result.width + finger.width;
+    napi_value view = nullptr;
+    if (buffer == nullptr || offset + span > length ||
+        napi_create_typedarray(env, napi_uint8_array, span, buffer, byteOffset + offset, &view) != napi_ok) {
+      napi_get_null(env, &view);
+    }
+    napi_set_element(env, fingers, static_cast<uint32_t>(i),
+                     ResultObject(env)
+                         .Int("x", finger.x)
+                         .Int("y", finger.y)
+                         .Int("width", finger.width)
+                         .Int("height", finger.height)
+                         .Int("stride", result.width)
+                         .Int("position", finger.position)
+                         .String("hand", HandName(finger.hand))
+                         .Int("pixels", finger.pixels)
+                         .Double("centerX", finger.centerX)
+                         .Double("centerY", finger.centerY)
+                         .Double("orientation", finger.orientation)
+                         .Double("quality", finger.quality)
+                         .Set("data", view)
+                         .value());
+  }
+  return ResultObject(env)
+      .Int("width", result.width)
+      .Int("height", result.height)
+      .Int("expected", result.expected)
+      .Bool("complete", result.complete)
+      .String("hand", HandName(result.hand))
+      .Bool("handInferred", result.handInferred)
+      .Int("splits", result.splits)
+      .Set("fingers", fingers)
+      .Double("segmentNs", static_cast<double>(result.segmentNs))
+      .value();
+}
+
+void SetResultSegmentation(int handle, bool enabled, const SegmentationConfig &config) {
+  std::lock_guard<std::mutex> lock(g_configs_mutex);
+  if (enabled) {
+    g_configs[handle] = config;
+  } else {
+    g_configs.erase(handle);
+  }
+}
+
+bool ResultSegmentation(int handle, SegmentationConfig *config) {
+  std::lock_guard<std::mutex> lock(g_configs_mutex);
+  auto found = g_configs.find(handle);
+  if (found == g_configs.end()) {
+    return false;
+  }
+  *config = found->second;
+  return true;
+}
+
+SegmentationStats GetSegmentationStats() {
+  std::lock_guard<std::mutex> lock(g_stats_mutex);
+  return g_stats;
+}
+
+}  // namespace lse
@@ -0,0 +1,112 @@
+/// Segmentation of slap result images into single fingers, on the host.
+///
+/// With setResultImageSegmentation(handle, ...) configured, the result image
+/// callback hands the copied frame to the TaskPool to segment, so the SDK
+/// thread does not wait. A placeholder keeps the image's place among the
+/// callbacks (DeferredEvent), and JS receives the image with its fingers: per
+/// finger a tight bounding box, position, principal axis orientation and
+/// quality, and the pixels as a view into the image's own buffer, without a
+/// copy.
+///
+/// Fingers are found on the block grid of quality_map.h: the finger blocks of
+/// ScoreQualityBlocks(), connected by FindQualityObjects(). Fingers pressed
+/// together merge into one component; while there are fewer components than
+/// the image type holds, the widest is split at the block column with the
+/// fewest finger blocks, the gap between two fingers. Each finger then gets a
+/// pixel pass over its own blocks and their rim, one finger per TaskPool
+/// thread: pixels darker than the platen (the median of the blocks without
+/// finger, less kDarkMargin) give the bounding box, centre and orientation.
+///
+/// Finger positions are the ANSI/NIST-ITL codes, assigned left to right as
+/// the fingers appear in the image: 2-5 for a right and 10-7 for a left
+/// four-finger slap, 6 and 1 for the thumbs. The SDK does not know the hand;
+/// unless configured, it is taken to be the one whose little finger, the
+/// smaller end finger, is on that side. Positions stay 0 when the fingers
+/// found do not match the image type.
+
+#pragma once
+
+#include "callbacks.h"
+#include "quality_map.h"
+
+#include <node_api.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace lse {
+
+enum class Hand : int {
+  kUnknown = 0,
+  kRight = 1,
+  kLeft = 2,
+};
+
+struct SegmentationConfig {
+  static constexpr int kDarkMargin = 32;  ///< Gray levels below the platen that count as finger
+
+  int imageType = LSCAN_FLAT_FOUR_FINGERS;  ///< LScanImageType: the fingers expected and their positions
+  Hand hand = Hand::kUnknown;               ///< Hand of four-finger slaps; kUnknown infers it
+  int fingers = 0;                          ///< Fingers expected; 0 for those of imageType
+  int minContrast = 10;                     ///< As QualityMapConfig
+  int minBlocks = 6;
+  int threads = 0;                          ///< 0 for HardwareThreads()
+};
+
+struct FingerSegment {
+  int x = 0;  ///< Bounding box of the finger's pixels
+  int y = 0;
+  int width = 0;
+  int height = 0;
+  int position = 0;  ///< ANSI/NIST-ITL finger position; 0 if unknown
+  Hand hand = Hand::kUnknown;
+  int pixels = 0;           ///< Finger pixels counted
+  double centerX = 0;       ///< Centroid of those pixels
+  double centerY = 0;
+  double orientation = 0;   ///< Principal axis in degrees, 0-179, from the x axis towards y; 90 is upright
+  double quality = 0;       ///< Mean block quality, as QualityObject::quality
+};
+
+struct SlapSegmentation {
+  int width = 0;
+  int height = 0;
+  int expected = 0;       ///< Fingers the image type holds; 0 if it does not say
+  bool complete = false;  ///< As many fingers found as expected
+  Hand hand = Hand::kUnknown;
+  bool handInferred = false;
+  int splits = 0;         ///< Merged components split apart
+  std::vector<FingerSegment> fingers;  ///< Left to right
+  uint64_t segmentNs = 0;
+};
+
+struct SegmentationStats {
+  uint64_t images = 0;
+  uint64_t fingers = 0;
+  uint64_t incomplete = 0;  ///< Images with fewer or more fingers than expected
+  uint64_t splits = 0;
+  uint64_t segmentNs = 0;   ///< Wall time, summed over images
+  uint64_t maxSegmentNs = 0;
+};
+
+/// Segment the 8-bit @p width x @p height image at @p pixels into @p result;
+/// any thread.
+void SegmentSlap(const uint8_t *pixels, int width, int height, const SegmentationConfig &config,
+                 SlapSegmentation *result);
+
+/// { width, height, expected, complete, hand, handInferred, splits, fingers,
+/// segmentNs }, fingers an array of { x, y, width, height, stride, position,
+/// hand, pixels, centerX, centerY, orientation, quality, data }. With @p image,
+/// the Buffer holding the segmented pixels, data is a Uint8Array over it from
+/// the finger's first pixel to its last: rows are `stride` (the image width)
+/// apart. Without it, data is null.
+napi_value SegmentationToJs(napi_env env, const SlapSegmentation &result, napi_value image);
+
+/// Segmentation applied to result images of @p handle; @p enabled false turns it off.
+void SetResultSegmentation(int handle, bool enabled, const SegmentationConfig &config);
+
+/// The segmentation of @p handle's result images; false if there is none.
+bool ResultSegmentation(int handle, SegmentationConfig *config);
+
+SegmentationStats GetSegmentationStats();
+
+}  // namespace lse
@@ -0,0 +1,41 @@
+#include "session.h"
+
+namespace lse {
+
+SessionDevice *Session::Open(int deviceIndex) {
+  std::unique_ptr<SessionDevice> &device = devices_[deviceIndex];
+  if (!device) {
+    device.reset(new SessionDevice(deviceIndex));
+  }
+  return device.get();
+}
+
+SessionDevice *Session::Find(int deviceIndex) {
+  auto it = devices_.find(deviceIndex);
+  return it != devices_.end() ? it->second.get() : nullptr;
+}
+
+std::unique_ptr<SessionDevice> Session::Detach(int deviceIndex) {
+  std::unique_ptr<SessionDevice> device;
+  auto it = devices_.find(deviceIndex);
+  if (it != devices_.end()) {
+    device = std::move(it->second);
+    devices_.erase(it);
+  }
+  return device;
+}
+
+std::vector<int> Session::DeviceIndices() const {
+  std::vector<int> indices;
+  for (const auto &entry : devices_) {
+    indices.push_back(entry.first);
+  }
+  return indices;
+}
+
+Session &SharedSession() {
+  static Session *session = new Session();
+  return *session;
+}
+
+}  // namespace lse
@@ -0,0 +1,46 @@
+/// Devices opened through the session manager, each with its own DeviceWorker.
+///
+/// The session is owned by the JS thread: devices are opened, looked up and
+/// closed there. A device's @e handle is written and read on its worker only,
+/// since every SDK call for the device runs there.
+
+#pragma once
+
+#include "device_worker.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace lse {
+
+struct SessionDevice {
+  explicit SessionDevice(int index) : deviceIndex(index), worker(new DeviceWorker(index)) {}
+
+  const int deviceIndex;
+  int handle = -1;  ///< Worker thread only
+  std::unique_ptr<DeviceWorker> worker;
+};
+
+class Session {
+ public:
+  /// Device @p deviceIndex, creating it (and its worker thread) if needed.
+  SessionDevice *Open(int deviceIndex);
+
+  /// Open device @p deviceIndex, or nullptr.
+  SessionDevice *Find(int deviceIndex);
+
+  /// Remove @p deviceIndex from the session and return it; the caller destroys
+  /// it once its pending work has completed.
+  std::unique_ptr<SessionDevice> Detach(int deviceIndex);
+
+  std::vector<int> DeviceIndices() const;
+
+ private:
+  std::map<int, std::unique_ptr<SessionDevice>> devices_;
+};
+
+/// Session of the main JS thread.
+Session &SharedSession();
+
+}  // namespace lse
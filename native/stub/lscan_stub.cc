@@ -0,0 +1,1812 @@
+/// Linux stand-in for LScanEssentials-x86.dll.
+///
+/// Implements every function of resources/reference/LScanEssentialsApi.h against an
+/// in-memory model of up to 256 virtual scanners so that the addon can be built,
+/// exercised and load tested without hardware. The environment sets the initial
+/// behaviour; the LScanStub_* functions of lscan_stub.h change it at run time.
+///
+///   LSCAN_STUB_DEVICES          attached devices (default 1)
+///   LSCAN_STUB_INIT_MS          duration of LSCAN_Main_Initialize(); a comma-separated list
+///                               sets it per device index, the last value repeating
+///   LSCAN_STUB_ACQUIRE_MS       acquisition time of LSCAN_Capture_TakeResultImage()
+///   LSCAN_STUB_ADJUST_MS        duration of contrast optimization, cleanliness check,
+///                               readjustment and infield test
+///   LSCAN_STUB_CALL_US          latency added to every SDK call
+///   LSCAN_STUB_MODE_MS          duration of LSCAN_Capture_SetMode() when the mode changes
+///   LSCAN_STUB_WARMUP_MS        time from a mode change until the sensor streams: the first
+///                               preview frame of a capture waits for it. Setting
+///                               LSCAN_TYPE_NONE stops the stream.
+///   LSCAN_STUB_PREVIEW_FPS      preview frames per second while capturing (default 0)
+///   LSCAN_STUB_PREVIEW_DIVISOR  preview geometry divisor: 1, 2 (default) or 4
+///   LSCAN_STUB_SETTLE_FRAMES    preview frames over which the fingers settle on the platen:
+///                               ridge contrast rises from faint to full (default 0)
+///   LSCAN_STUB_IMAGES           PGM file or directory of result images
+///   LSCAN_STUB_ERRORS           injected errors, "function:status[:count],..."
+///
+/// Without result image files, preview and result images are synthetic ridge
+/// patterns with one finger-shaped area per captured object.
+
+#include "LScanEssentialsApi.h"
+#include "lscan_stub.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+constexpr int kMaxDevices = 256;
+
+struct Overlay {
+  bool visible = true;
+};
+
+struct Device {
+  bool initialized = false;
+  bool capturing = false;
+  bool adjusting = false;       ///< A simulated long-running operation is in progress
+  bool abortRequested = false;  ///< LSCAN_Capture_Abort() during the operation
+  LScanImageType imageType = LSCAN_TYPE_NONE;
+  LScanImageResolution resolution = LSCAN_RES_500;
+  int width = 0;
+  int height = 0;
+  int objects = 1;              ///< numberOfObjects of the last LSCAN_Capture_Start()
+  std::chrono::steady_clock::time_point streamReady;  ///< When the sensor of the current mode streams
+  int contrast = 128;
+  DWORD activeKeys = 0;
+  DWORD activeLEDs = 0;
+  LScanDisplaySelectionCtrl selection = LSCAN_DISPLAY_SELECTION_NONE;
+  COLORREF background = 0xe0e0e0;
+  std::map<LScanPropertyId, std::string> properties;
+  std::map<DWORD, Overlay> overlays;
+  DWORD nextOverlay = 1;
+
+  LSCAN_CallbackPreviewImage preview = nullptr;
+  void *previewContext = nullptr;
+  LSCAN_CallbackObjectCount objectCount = nullptr;
+  void *objectCountContext = nullptr;
+  LSCAN_CallbackObjectQuality objectQuality = nullptr;
+  void *objectQualityContext = nullptr;
+  LSCAN_Callback takingResult = nullptr;
+  void *takingResultContext = nullptr;
+  LSCAN_Callback acquisitionComplete = nullptr;
+  void *acquisitionCompleteContext = nullptr;
+  LSCAN_CallbackResultImage resultImage = nullptr;
+  void *resultImageContext = nullptr;
+  LSCAN_CallbackClearObjectsFromPlaten clearPlaten = nullptr;
+  void *clearPlatenContext = nullptr;
+  LSCAN_CallbackKeys keys = nullptr;
+  void *keysContext = nullptr;
+  LSCAN_Callback communicationBreak = nullptr;
+  void *communicationBreakContext = nullptr;
+};
+
+/// Result images read from PGM files, delivered round robin.
+struct ImageSet {
+  struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+  };
+  std::vector<Image> images;
+  std::atomic<size_t> next{0};
+};
+
+/// Per-device behaviour set through the LScanStub_* functions. Unlike Device, it
+/// survives LSCAN_Main_Release() and re-initialization.
+struct Setup {
+  int previewFps = 0;
+  int previewDivisor = 2;
+  std::shared_ptr<ImageSet> images;  ///< null: synthetic images
+};
+
+/// Preview thread of one device, running from LSCAN_Capture_Start() until the
+/// capture ends.
+struct PreviewStream {
+  std::mutex control;  ///< Serializes StartPreview() and StopPreview()
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stop = false;   ///< Guarded by mutex
+};
+
+/// An LScanStub_InjectError() or LScanStub_SetLatency() rule.
+struct Rule {
+  std::string function;  ///< Empty: every function
+  int handle = LSCAN_STUB_ALL_DEVICES;
+  int status = LSCAN_STATUS_OK;
+  int count = -1;
+  int microseconds = 0;
+};
+
+struct Rules {
+  std::mutex mutex;
+  std::vector<Rule> errors;     ///< Guarded by mutex
+  std::vector<Rule> latencies;  ///< Guarded by mutex
+  std::atomic<bool> active{false};
+};
+
+std::mutex g_mutex;
+Device g_devices[kMaxDevices];
+Setup g_setups[kMaxDevices];  // guarded by g_mutex
+std::atomic<bool> g_disconnected[kMaxDevices];
+std::atomic<bool> g_unplugged[kMaxDevices];  ///< Off the bus for LScanStub_Unplug()
+LSCAN_CallbackProgress g_progress = nullptr;
+void *g_progressContext = nullptr;
+LSCAN_CallbackDeviceCount g_deviceCount = nullptr;
+void *g_deviceCountContext = nullptr;
+
+/// Non-negative integer from environment variable @p name, or @p fallback.
+int EnvInt(const char *name, int fallback = 0) {
+  const char *value = getenv(name);
+  int parsed = value != nullptr && *value != '\0' ? atoi(value) : fallback;
+  return parsed < 0 ? 0 : parsed;
+}
+
+std::atomic<int> &AttachedDevices() {
+  static std::atomic<int> count{std::min(EnvInt("LSCAN_STUB_DEVICES", 1), kMaxDevices)};
+  return count;
+}
+
+int DeviceCount() {
+  return AttachedDevices().load(std::memory_order_acquire);
+}
+
+/// Simulated duration of LSCAN_Main_Initialize() for @p deviceIndex, from LSCAN_STUB_INIT_MS.
+int InitMs(int deviceIndex) {
+  static const std::vector<int> ms = [] {
+    std::vector<int> values;
+    const char *item = getenv("LSCAN_STUB_INIT_MS");
+    while (item != nullptr && *item != '\0') {
+      values.push_back(std::max(0, atoi(item)));
+      item = strchr(item, ',');
+      if (item != nullptr) {
+        item++;
+      }
+    }
+    return values;
+  }();
+  return ms.empty() ? 0 : ms[std::min(static_cast<size_t>(deviceIndex), ms.size() - 1)];
+}
+
+/// Simulated acquisition time of LSCAN_Capture_TakeResultImage(), from LSCAN_STUB_ACQUIRE_MS.
+int AcquireMs() {
+  static const int ms = EnvInt("LSCAN_STUB_ACQUIRE_MS");
+  return ms;
+}
+
+/// Simulated duration of contrast optimization, cleanliness check, readjustment
+/// and infield test, from LSCAN_STUB_ADJUST_MS.
+int AdjustMs() {
+  static const int ms = EnvInt("LSCAN_STUB_ADJUST_MS");
+  return ms;
+}
+
+/// Latency of every SDK call, from LSCAN_STUB_CALL_US.
+int CallUs() {
+  static const int us = EnvInt("LSCAN_STUB_CALL_US");
+  return us;
+}
+
+/// Simulated duration of a mode change, from LSCAN_STUB_MODE_MS.
+int ModeMs() {
+  static const int ms = EnvInt("LSCAN_STUB_MODE_MS");
+  return ms;
+}
+
+/// Simulated sensor stream spin-up after a mode change, from LSCAN_STUB_WARMUP_MS.
+int WarmupMs() {
+  static const int ms = EnvInt("LSCAN_STUB_WARMUP_MS");
+  return ms;
+}
+
+/// Preview frames until the ridges reach full contrast, from LSCAN_STUB_SETTLE_FRAMES.
+int SettleFrames() {
+  static const int frames = EnvInt("LSCAN_STUB_SETTLE_FRAMES");
+  return frames;
+}
+
+/// Device for an initialized handle (handles equal device indices), or nullptr.
+Device *Lookup(int handle) {
+  if (handle < 0 || handle >= DeviceCount() || !g_devices[handle].initialized) {
+    return nullptr;
+  }
+  return &g_devices[handle];
+}
+
+void CopyString(char *target, const std::string &value) {
+  strncpy(target, value.c_str(), LSCAN_MAX_STR_LEN - 1);
+  target[LSCAN_MAX_STR_LEN - 1] = '\0';
+}
+
+std::string SerialNumber(int deviceIndex) {
+  char serial[32];
+  snprintf(serial, sizeof(serial), "STUB%06d", deviceIndex);
+  return serial;
+}
+
+/// Result image geometry for a capture mode at 500 ppi; doubled for 1000 ppi.
+void ModeGeometry(LScanImageType type, int *width, int *height) {
+  switch (type) {
+    case LSCAN_FLAT_SINGLE_FINGER:
+    case LSCAN_ROLL_SINGLE_FINGER:
+      *width = 800;
+      *height = 750;
+      break;
+    case LSCAN_FLAT_TWO_FINGERS:
+    case LSCAN_FLAT_THUMBS:
+      *width = 1600;
+      *height = 1000;
+      break;
+    case LSCAN_FLAT_FOUR_FINGERS:
+      *width = 1600;
+      *height = 1500;
+      break;
+    case LSCAN_FLAT_PALM:
+    case LSCAN_FLAT_WRITERS_PALM:
+      *width = 2304;
+      *height = 2700;
+      break;
+    default:
+      *width = 0;
+      *height = 0;
+      break;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Images
+
+using Pixels = std::shared_ptr<const std::vector<unsigned char>>;
+
+/// Synthetic @p width x @p height image: a white platen with @p objects slanted
+/// ridge patterns side by side, plus sensor noise. Generated once per geometry
+/// and shared, so that benchmarks measure the binding rather than the stub.
+Pixels SyntheticImage(int width, int height, int objects) {
+  static std::mutex mutex;
+  static std::map<std::tuple<int, int, int>, Pixels> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  Pixels &cached = cache[std::make_tuple(width, height, objects)];
+  if (cached) {
+    return cached;
+  }
+  auto pixels = std::make_shared<std::vector<unsigned char>>(static_cast<size_t>(width) * height, 255);
+  // Ridge period of about 9 pixels at 500 ppi for a 1600 pixel wide slap.
+  const double period = std::max(3.0, width / 180.0);
+  const double slotWidth = static_cast<double>(width) / objects;
+  uint32_t seed = 1;
+  for (int object = 0; object < objects; object++) {
+    const double cx = (object + 0.5) * slotWidth;
+    const double cy = height * (object == 0 || object == objects - 1 ? 0.55 : 0.45);
+    const double rx = slotWidth * 0.38;
+    const double ry = height * 0.38;
+    const double angle = 0.3 + 0.25 * object;
+    const double kx = std::cos(angle) * 2 * M_PI / period;
+    const double ky = std::sin(angle) * 2 * M_PI / period;
+    const int x0 = std::max(0, static_cast<int>(cx - rx));
+    const int x1 = std::min(width, static_cast<int>(cx + rx) + 1);
+    for (int y = std::max(0, static_cast<int>(cy - ry)); y < std::min(height, static_cast<int>(cy + ry) + 1); y++) {
+      unsigned char *row = pixels->data() + static_cast<size_t>(y) * width;
+      const double dy = (y - cy) / ry;
+      for (int x = x0; x < x1; x++) {
+        const double dx = (x - cx) / rx;
+        if (dx * dx + dy * dy > 1) {
+          continue;
+        }
+        seed = seed * 1103515245 + 12345;
+        int noise = static_cast<int>((seed >> 16) % 17) - 8;
+        int value = 120 + static_cast<int>(90 * std::sin(x * kx + y * ky)) + noise;
+        row[x] = static_cast<unsigned char>(std::min(255, std::max(0, value)));
+      }
+    }
+  }
+  cached = pixels;
+  return cached;
+}
+
+/// Read an 8-bit binary PGM file into @p image.
+bool ReadPgm(const std::string &path, ImageSet::Image *image) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  int width = 0;
+  int height = 0;
+  int maxValue = 0;
+  // "P5 <width> <height> <maxval>" followed by one whitespace character; '#'
+  // comments may appear between the header fields.
+  bool ok = fgetc(file) == 'P' && fgetc(file) == '5';
+  for (int *field : {&width, &height, &maxValue}) {
+    int c = ok ? fgetc(file) : EOF;
+    while (c == '#' || isspace(c)) {
+      if (c == '#') {
+        while ((c = fgetc(file)) != '\n' && c != EOF) {
+        }
+      }
+      c = fgetc(file);
+    }
+    ok = ok && c != EOF && ungetc(c, file) != EOF && fscanf(file, "%d", field) == 1;
+  }
+  ok = ok && fgetc(file) != EOF && width > 0 && height > 0 && maxValue > 0 && maxValue < 256;
+  if (ok) {
+    image->width = width;
+    image->height = height;
+    image->pixels.resize(static_cast<size_t>(width) * height);
+    ok = fread(image->pixels.data(), 1, image->pixels.size(), file) == image->pixels.size();
+  }
+  fclose(file);
+  return ok;
+}
+
+/// Images of the PGM file or the directory of PGM files at @p path, or null.
+std::shared_ptr<ImageSet> LoadImages(const std::string &path) {
+  std::vector<std::string> files;
+  if (DIR *directory = opendir(path.c_str())) {
+    while (dirent *entry = readdir(directory)) {
+      std::string name = entry->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".pgm") == 0) {
+        files.push_back(path + "/" + name);
+      }
+    }
+    closedir(directory);
+    std::sort(files.begin(), files.end());
+  } else {
+    files.push_back(path);
+  }
+  auto set = std::make_shared<ImageSet>();
+  for (const std::string &file : files) {
+    ImageSet::Image image;
+    if (ReadPgm(file, &image)) {
+      set->images.push_back(std::move(image));
+    } else {
+      fprintf(stderr, "LScanEssentials stub: cannot read PGM image %s\n", file.c_str());
+    }
+  }
+  return set->images.empty() ? nullptr : set;
+}
+
+/// Copy @p source centred into a @p width x @p height image, cropping or
+/// padding with white.
+void FitImage(const ImageSet::Image &source, int width, int height, std::vector<unsigned char> *target) {
+  target->assign(static_cast<size_t>(width) * height, 255);
+  const int copyWidth = std::min(width, source.width);
+  const int copyHeight = std::min(height, source.height);
+  const int sourceX = (source.width - copyWidth) / 2;
+  const int sourceY = (source.height - copyHeight) / 2;
+  const int targetX = (width - copyWidth) / 2;
+  const int targetY = (height - copyHeight) / 2;
+  for (int y = 0; y < copyHeight; y++) {
+    memcpy(target->data() + static_cast<size_t>(targetY + y) * width + targetX,
+           source.pixels.data() + static_cast<size_t>(sourceY + y) * source.width + sourceX, copyWidth);
+  }
+}
+
+/// Per-device setup, with the defaults taken from the environment on first use.
+/// Call with g_mutex held.
+Setup &DeviceSetup(int deviceIndex) {
+  static const bool initialized = [] {
+    Setup defaults;
+    defaults.previewFps = std::min(EnvInt("LSCAN_STUB_PREVIEW_FPS"), 1000);
+    int divisor = EnvInt("LSCAN_STUB_PREVIEW_DIVISOR", 2);
+    defaults.previewDivisor = divisor == 1 || divisor == 4 ? divisor : 2;
+    const char *images = getenv("LSCAN_STUB_IMAGES");
+    if (images != nullptr && *images != '\0') {
+      defaults.images = LoadImages(images);
+    }
+    for (Setup &setup : g_setups) {
+      setup = defaults;
+    }
+    return true;
+  }();
+  (void)initialized;
+  return g_setups[deviceIndex];
+}
+
+/// Deliver a result image for @p handle; called without g_mutex held.
+void DeliverResult(int handle, const Device &snapshot, const std::shared_ptr<ImageSet> &images) {
+  Pixels synthetic;
+  thread_local std::vector<unsigned char> fitted;
+  unsigned char *pixels = nullptr;
+  if (images) {
+    ImageSet::Image &source = images->images[images->next++ % images->images.size()];
+    if (source.width == snapshot.width && source.height == snapshot.height) {
+      pixels = source.pixels.data();
+    } else {
+      FitImage(source, snapshot.width, snapshot.height, &fitted);
+      pixels = fitted.data();
+    }
+  } else {
+    synthetic = SyntheticImage(snapshot.width, snapshot.height, snapshot.objects);
+    // The SDK hands out a non-const buffer; receivers only read it.
+    pixels = const_cast<unsigned char *>(synthetic->data());
+  }
+  LScanImageData image = {snapshot.width, snapshot.height, snapshot.resolution, 8,
+                          snapshot.width * snapshot.height, pixels};
+  if (snapshot.takingResult != nullptr) {
+    snapshot.takingResult(handle, snapshot.takingResultContext);
+  }
+  if (snapshot.acquisitionComplete != nullptr) {
+    snapshot.acquisitionComplete(handle, snapshot.acquisitionCompleteContext);
+  }
+  if (snapshot.resultImage != nullptr) {
+    snapshot.resultImage(handle, image, LSCAN_IMAGE_STATUS_OK, snapshot.resultImageContext);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Preview
+
+PreviewStream *Streams() {
+  // Never destroyed: a joinable std::thread must not be destructed at exit.
+  static PreviewStream *streams = new PreviewStream[kMaxDevices];
+  return streams;
+}
+
+/// Body of a preview thread: @p fps frames per second until the capture of
+/// @p handle ends or the stream is stopped. A late frame is skipped rather than
+/// sent in a burst, like a sensor that cannot wait for its reader. The first
+/// frame waits until the sensor streams at @p ready.
+void PreviewLoop(int handle, PreviewStream *stream, int fps, int width, int height, int resolution, int objects,
+                 std::chrono::steady_clock::time_point ready) {
+  Pixels pattern = SyntheticImage(width, height, objects);
+  std::vector<unsigned char> pixels(*pattern);
+  const int settle = SettleFrames();
+  LScanImageData image = {width, height, resolution, 8, static_cast<int>(pixels.size()), pixels.data()};
+  const auto period = std::chrono::nanoseconds(1000000000 / fps);
+  auto next = std::chrono::steady_clock::now();
+  if (ready > next) {
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    if (stream->wake.wait_until(lock, ready, [stream] { return stream->stop; })) {
+      return;
+    }
+    next = ready;
+  }
+  for (uint32_t sequence = 0;; sequence++) {
+    LSCAN_CallbackPreviewImage callback = nullptr;
+    void *context = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      if (!g_devices[handle].capturing) {
+        break;
+      }
+      callback = g_devices[handle].preview;
+      context = g_devices[handle].previewContext;
+    }
+    if (callback != nullptr && pixels.size() >= sizeof(sequence)) {
+      if (sequence < static_cast<uint32_t>(settle)) {
+        // Fingers pressing down: the ridges darken from the white platen.
+        const int level = static_cast<int>(256 * (sequence + 1) / (settle + 1));
+        for (size_t i = 0; i < pixels.size(); i++) {
+          pixels[i] = static_cast<unsigned char>(255 - (((255 - (*pattern)[i]) * level) >> 8));
+        }
+      } else if (sequence == static_cast<uint32_t>(settle) && settle > 0) {
+        std::copy(pattern->begin(), pattern->end(), pixels.begin());
+      }
+      for (size_t i = 0; i < sizeof(sequence); i++) {
+        pixels[i] = static_cast<unsigned char>(sequence >> (8 * i));
+      }
+      callback(handle, image, context);
+    }
+    next += period;
+    auto now = std::chrono::steady_clock::now();
+    if (next < now) {
+      next = now;
+    }
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    if (stream->wake.wait_until(lock, next, [stream] { return stream->stop; })) {
+      break;
+    }
+  }
+}
+
+/// Stop the preview thread of @p stream; call with stream.control held.
+void StopStream(PreviewStream &stream) {
+  if (!stream.thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    stream.stop = true;
+  }
+  stream.wake.notify_all();
+  if (stream.thread.get_id() == std::this_thread::get_id()) {
+    stream.thread.detach();  // called from the preview callback
+  } else {
+    stream.thread.join();
+  }
+}
+
+/// Start the preview thread of @p handle for the capture described by @p snapshot.
+/// Call without g_mutex held.
+void StartPreview(int handle, const Device &snapshot, int fps, int divisor) {
+  PreviewStream &stream = Streams()[handle];
+  std::lock_guard<std::mutex> control(stream.control);
+  StopStream(stream);
+  if (fps <= 0) {
+    return;
+  }
+  stream.stop = false;
+  stream.thread = std::thread(PreviewLoop, handle, &stream, fps, std::max(1, snapshot.width / divisor),
+                              std::max(1, snapshot.height / divisor), snapshot.resolution / divisor,
+                              snapshot.objects, snapshot.streamReady);
+}
+
+/// Wait for the preview thread of @p handle to end. The capture must already be
+/// over (Device::capturing false). Call without g_mutex held.
+void StopPreview(int handle) {
+  PreviewStream &stream = Streams()[handle];
+  std::lock_guard<std::mutex> control(stream.control);
+  StopStream(stream);
+}
+
+// ---------------------------------------------------------------------------
+// Fault injection
+
+bool Matches(const Rule &rule, const char *function, int handle) {
+  return (rule.handle == LSCAN_STUB_ALL_DEVICES || rule.handle == handle) &&
+         (rule.function.empty() || rule.function == function);
+}
+
+/// Adds or, for @p count / @p microseconds 0, removes the rule for
+/// (@p rule.function, @p rule.handle) in @p rules. Call with Rules::mutex held.
+void SetRule(std::vector<Rule> *rules, const Rule &rule, bool remove) {
+  rules->erase(std::remove_if(rules->begin(), rules->end(),
+                              [&rule](const Rule &existing) {
+                                return existing.function == rule.function && existing.handle == rule.handle;
+                              }),
+               rules->end());
+  if (!remove) {
+    rules->push_back(rule);
+  }
+}
+
+Rules &GetRules() {
+  static Rules *rules = [] {
+    Rules *parsed = new Rules();
+    const char *spec = getenv("LSCAN_STUB_ERRORS");
+    std::string list = spec != nullptr ? spec : "";
+    for (size_t start = 0; start < list.size();) {
+      size_t end = list.find(',', start);
+      std::string entry = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+      start = end == std::string::npos ? list.size() : end + 1;
+      char function[128] = {};
+      Rule rule;
+      if (sscanf(entry.c_str(), "%127[^:]:%d:%d", function, &rule.status, &rule.count) >= 2 && rule.count != 0) {
+        rule.function = function;
+        SetRule(&parsed->errors, rule, false);
+      } else if (!entry.empty()) {
+        fprintf(stderr, "LScanEssentials stub: ignoring LSCAN_STUB_ERRORS entry \"%s\"\n", entry.c_str());
+      }
+    }
+    parsed->active = !parsed->errors.empty();
+    return parsed;
+  }();
+  return *rules;
+}
+
+/// Entry check of every SDK function: applies the latency and error rules for
+/// @p function and @p handle, and fails calls to disconnected devices.
+/// @return LSCAN_STATUS_OK to go ahead, or the status to return instead.
+int Intercept(const char *function, int handle) {
+  int microseconds = CallUs();
+  int status = LSCAN_STATUS_OK;
+  Rules &rules = GetRules();
+  if (rules.active.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(rules.mutex);
+    for (const Rule &rule : rules.latencies) {
+      if (Matches(rule, function, handle)) {
+        microseconds += rule.microseconds;
+      }
+    }
+    for (auto it = rules.errors.begin(); it != rules.errors.end(); ++it) {
+      if (Matches(*it, function, handle)) {
+        status = it->status;
+        if (it->count > 0 && --it->count == 0) {
+          rules.errors.erase(it);
+          rules.active = !rules.errors.empty() || !rules.latencies.empty();
+        }
+        break;
+      }
+    }
+  }
+  if (status == LSCAN_STATUS_OK && handle >= 0 && handle < kMaxDevices &&
+      g_disconnected[handle].load(std::memory_order_acquire) && strcmp(function, "LSCAN_Main_Initialize") != 0 &&
+      strcmp(function, "LSCAN_Main_Initialize_ExternalVisualization") != 0 &&
+      strcmp(function, "LSCAN_Main_Release") != 0 && strcmp(function, "LSCAN_Main_GetDeviceInfo") != 0) {
+    status = LSCAN_ERR_DEVICE_IO;
+  }
+  if (microseconds > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+  }
+  return status;
+}
+
+/// First statement of every SDK function; @p handle is the handle or device
+/// index argument, LSCAN_STUB_ALL_DEVICES for functions without one.
+#define STUB_INTERCEPT(handle)                              \
+  do {                                                      \
+    int intercepted = Intercept(__func__, handle);          \
+    if (intercepted != LSCAN_STATUS_OK) {                   \
+      return intercepted;                                   \
+    }                                                       \
+  } while (0)
+
+/// Body of one LScanStub_FireCallbacks() thread.
+void FireLoop(int handle, int kind, int count, int intervalUs, Device snapshot) {
+  std::vector<unsigned char> pixels;
+  LScanImageData image = {};
+  if (kind == LSCAN_STUB_FIRE_PREVIEW) {
+    int width = snapshot.width > 0 ? snapshot.width : 800;
+    int height = snapshot.height > 0 ? snapshot.height : 750;
+    pixels.assign(static_cast<size_t>(width) * height, 128);
+    image = {width, height, snapshot.resolution, 8, static_cast<int>(pixels.size()), pixels.data()};
+  }
+  LScanObjectQualityState qualities[LSCAN_MAX_OBJECTS] = {LSCAN_QUALITY_GOOD, LSCAN_QUALITY_TOO_LIGHT,
+                                                         LSCAN_QUALITY_GOOD, LSCAN_QUALITY_BAD_SHAPE};
+  for (int i = 0; i < count; i++) {
+    switch (kind) {
+      case LSCAN_STUB_FIRE_KEYS:
+        snapshot.keys(handle, static_cast<DWORD>(i), snapshot.keysContext);
+        break;
+      case LSCAN_STUB_FIRE_OBJECT_QUALITY:
+        snapshot.objectQuality(handle, qualities, LSCAN_MAX_OBJECTS, snapshot.objectQualityContext);
+        break;
+      case LSCAN_STUB_FIRE_PREVIEW:
+        snapshot.preview(handle, image, snapshot.previewContext);
+        break;
+    }
+    if (intervalUs > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+    }
+  }
+}
+
+/// Simulate a long-running operation of device @p deviceIndex: AdjustMs() in ten
+/// steps, each reported through the progress callback. If @p abortable, the
+/// device must be initialized and LSCAN_Capture_Abort() ends the operation early.
+/// @return LSCAN_STATUS_OK, LSCAN_ERR_GENERAL if aborted, or
+///   LSCAN_ERR_CAPTURE_IN_PROGRESS if the device is busy.
+int RunAdjustment(int deviceIndex, bool abortable) {
+  LSCAN_CallbackProgress progress = nullptr;
+  void *progressContext = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (abortable) {
+      Device &device = g_devices[deviceIndex];
+      if (device.capturing || device.adjusting) {
+        return LSCAN_ERR_CAPTURE_IN_PROGRESS;
+      }
+      device.adjusting = true;
+      device.abortRequested = false;
+    }
+    progress = g_progress;
+    progressContext = g_progressContext;
+  }
+  int status = LSCAN_STATUS_OK;
+  for (int step = 1; step <= 10 && AdjustMs() > 0; step++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(AdjustMs()) / 10);
+    if (abortable) {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      if (g_devices[deviceIndex].abortRequested) {
+        status = LSCAN_ERR_GENERAL;
+        break;
+      }
+    }
+    if (progress != nullptr) {
+      progress(deviceIndex, step * 10, progressContext);
+    }
+  }
+  if (abortable) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_devices[deviceIndex].adjusting = false;
+    g_devices[deviceIndex].abortRequested = false;
+  }
+  return status;
+}
+
+/// Callbacks to fire after a device went away, outside g_mutex.
+struct BrokenConnection {
+  int handle;
+  LSCAN_Callback callback;
+  void *context;
+};
+
+/// Take @p handle off line: end its capture or adjustment and return its
+/// communication break callback. Call with g_mutex held.
+BrokenConnection BreakConnection(int handle) {
+  Device &device = g_devices[handle];
+  BrokenConnection broken = {handle, device.communicationBreak, device.communicationBreakContext};
+  device.capturing = false;
+  if (device.adjusting) {
+    device.abortRequested = true;
+  }
+  return broken;
+}
+
+void FireBroken(const BrokenConnection &broken) {
+  StopPreview(broken.handle);
+  if (broken.callback != nullptr) {
+    broken.callback(broken.handle, broken.context);
+  }
+}
+
+/// Attached devices less those unplugged by LScanStub_Unplug(): the device count.
+int PresentDevices() {
+  int count = DeviceCount();
+  int present = count;
+  for (int i = 0; i < count; i++) {
+    if (g_unplugged[i].load()) {
+      present--;
+    }
+  }
+  return present;
+}
+
+/// Fire the device count callback with PresentDevices().
+void FireDeviceCount() {
+  LSCAN_CallbackDeviceCount deviceCount = nullptr;
+  void *deviceCountContext = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    deviceCount = g_deviceCount;
+    deviceCountContext = g_deviceCountContext;
+  }
+  if (deviceCount != nullptr) {
+    deviceCount(PresentDevices(), deviceCountContext);
+  }
+}
+
+/// LSCAN_Main_Initialize() without the entry check, shared with the external
+/// visualization variant.
+int Initialize(int deviceIndex, int *handle) {
+  if (handle == nullptr || deviceIndex < 0 || deviceIndex >= DeviceCount() || g_unplugged[deviceIndex].load()) {
+    return LSCAN_ERR_INVALID_DEVICE_INDEX;
+  }
+  LSCAN_CallbackProgress progress = nullptr;
+  void *progressContext = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    progress = g_progress;
+    progressContext = g_progressContext;
+  }
+  // Devices initialize independently; only the state update below is serialized.
+  if (InitMs(deviceIndex) > 0) {
+    for (int step = 0; step < 4; step++) {
+      if (progress != nullptr) {
+        progress(deviceIndex, step * 25, progressContext);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(InitMs(deviceIndex)) / 4);
+    }
+  }
+  int status = LSCAN_STATUS_OK;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (deviceIndex >= DeviceCount() || g_unplugged[deviceIndex].load()) {
+      return LSCAN_ERR_INVALID_DEVICE_INDEX;  // unplugged meanwhile
+    }
+    Device &device = g_devices[deviceIndex];
+    if (device.initialized && !g_disconnected[deviceIndex].load()) {
+      status = LSCAN_WRN_ALREADY_INITIALIZED;
+    }
+    device = Device();
+    device.initialized = true;
+    device.properties[LSCAN_PROPERTY_SERIAL_NUMBER] = SerialNumber(deviceIndex);
+    device.properties[LSCAN_PROPERTY_PRODUCT_NAME] = "L SCAN Stub";
+    device.properties[LSCAN_PROPERTY_FIRMWARE_VERSION] = "1.0.0";
+    device.properties[LSCAN_PROPERTY_HARDWARE_VERSION] = "A";
+    device.properties[LSCAN_PROPERTY_AUTOMATIC_ADJUSTMENT] = "1";
+    device.properties[LSCAN_PROPERTY_ROLL_ALLOW_RESTART] = "0";
+    g_disconnected[deviceIndex] = false;
+  }
+  StopPreview(deviceIndex);
+  if (progress != nullptr) {
+    progress(deviceIndex, 100, progressContext);
+  }
+  *handle = deviceIndex;
+  return status;
+}
+
+}  // namespace
+
+extern "C" {
+
+int LScanStub_FireCallbacks(int handle, int kind, int threads, int perThread, int intervalUs) {
+  if (threads <= 0 || perThread < 0 || intervalUs < 0) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  Device snapshot;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Device *device = Lookup(handle);
+    if (device == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    snapshot = *device;
+  }
+  bool registered = (kind == LSCAN_STUB_FIRE_KEYS && snapshot.keys != nullptr) ||
+                    (kind == LSCAN_STUB_FIRE_OBJECT_QUALITY && snapshot.objectQuality != nullptr) ||
+                    (kind == LSCAN_STUB_FIRE_PREVIEW && snapshot.preview != nullptr);
+  if (!registered) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  for (int i = 0; i < threads; i++) {
+    std::thread(FireLoop, handle, kind, perThread, intervalUs, snapshot).detach();
+  }
+  return LSCAN_STATUS_OK;
+}
+
+int LScanStub_SetDeviceCount(int count) {
+  if (count < 0 || count > kMaxDevices) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::vector<BrokenConnection> broken;
+  LSCAN_CallbackDeviceCount deviceCount = nullptr;
+  void *deviceCountContext = nullptr;
+  int previous = 0;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    previous = AttachedDevices().exchange(count);
+    for (int i = count; i < previous; i++) {
+      if (g_devices[i].initialized) {
+        broken.push_back(BreakConnection(i));
+      }
+      g_devices[i] = Device();
+    }
+    deviceCount = g_deviceCount;
+    deviceCountContext = g_deviceCountContext;
+  }
+  for (const BrokenConnection &connection : broken) {
+    FireBroken(connection);
+  }
+  if (count != previous && deviceCount != nullptr) {
+    deviceCount(count, deviceCountContext);
+  }
+  return LSCAN_STATUS_OK;
+}
+
+int LScanStub_SetPreview(int handle, int fps, int divisor) {
+  if (handle < LSCAN_STUB_ALL_DEVICES || handle >= kMaxDevices || fps < 0 || fps > 1000 ||
+      (divisor != 1 && divisor != 2 && divisor != 4)) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  for (int i = 0; i < kMaxDevices; i++) {
+    if (handle == LSCAN_STUB_ALL_DEVICES || handle == i) {
+      DeviceSetup(i).previewFps = fps;
+      DeviceSetup(i).previewDivisor = divisor;
+    }
+  }
+  return LSCAN_STATUS_OK;
+}
+
+int LScanStub_SetResultImages(int handle, const char *path) {
+  if (handle < LSCAN_STUB_ALL_DEVICES || handle >= kMaxDevices) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::shared_ptr<ImageSet> images;
+  if (path != nullptr && *path != '\0') {
+    images = LoadImages(path);
+    if (!images) {
+      return LSCAN_ERR_INVALID_PARAM_VALUE;
+    }
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  for (int i = 0; i < kMaxDevices; i++) {
+    if (handle == LSCAN_STUB_ALL_DEVICES || handle == i) {
+      DeviceSetup(i).images = images;
+    }
+  }
+  return LSCAN_STATUS_OK;
+}
+
+int LScanStub_InjectError(const char *function, int handle, int status, int count) {
+  if (function == nullptr || *function == '\0' || handle < LSCAN_STUB_ALL_DEVICES || count < -1) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  Rule rule;
+  rule.function = function;
+  rule.handle = handle;
+  rule.status = status;
+  rule.count = count;
+  Rules &rules = GetRules();
+  std::lock_guard<std::mutex> lock(rules.mutex);
+  SetRule(&rules.errors, rule, count == 0 || status == LSCAN_STATUS_OK);
+  rules.active = !rules.errors.empty() || !rules.latencies.empty();
+  return LSCAN_STATUS_OK;
+}
+
+int LScanStub_SetLatency(const char *function, int handle, int microseconds) {
+  if (handle < LSCAN_STUB_ALL_DEVICES || microseconds < 0) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  Rule rule;
+  rule.function = function != nullptr ? function : "";
+  rule.handle = handle;
+  rule.microseconds = microseconds;
+  Rules &rules = GetRules();
+  std::lock_guard<std::mutex> lock(rules.mutex);
+  SetRule(&rules.latencies, rule, microseconds == 0);
+  rules.active = !rules.errors.empty() || !rules.latencies.empty();
+  return LSCAN_STATUS_OK;
+}
+
+int LScanStub_Disconnect(int handle) {
+  BrokenConnection broken;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup(handle) == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    if (g_disconnected[handle].exchange(true)) {
+      return LSCAN_STATUS_OK;
+    }
+    broken = BreakConnection(handle);
+  }
+  FireBroken(broken);
+  return LSCAN_STATUS_OK;
+}
+
+int LScanStub_Unplug(int deviceIndex, int milliseconds) {
+  if (deviceIndex < 0 || deviceIndex >= DeviceCount() || milliseconds < 0) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  BrokenConnection broken = {deviceIndex, nullptr, nullptr};
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_unplugged[deviceIndex].exchange(true)) {
+      return LSCAN_STATUS_OK;
+    }
+    if (g_devices[deviceIndex].initialized && !g_disconnected[deviceIndex].exchange(true)) {
+      broken = BreakConnection(deviceIndex);
+    }
+  }
+  FireBroken(broken);
+  FireDeviceCount();
+  std::thread([deviceIndex, milliseconds] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    g_unplugged[deviceIndex] = false;
+    FireDeviceCount();
+  }).detach();
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_GetAPIVersion(LScanApiVersion *info) {
+  STUB_INTERCEPT(LSCAN_STUB_ALL_DEVICES);
+  if (info == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  info->MajorVersion = 1;
+  info->MinorVersion = 105;
+  info->PatchVersion = 2;
+  info->BuildVersion = 1;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_GetDeviceCount(int *deviceCount) {
+  STUB_INTERCEPT(LSCAN_STUB_ALL_DEVICES);
+  if (deviceCount == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  *deviceCount = PresentDevices();
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_GetDeviceInfo(const int deviceIndex, LScanDeviceInfo *deviceInfo) {
+  STUB_INTERCEPT(deviceIndex);
+  if (deviceInfo == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  if (deviceIndex < 0 || deviceIndex >= DeviceCount() || g_unplugged[deviceIndex].load()) {
+    return LSCAN_ERR_INVALID_DEVICE_INDEX;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  memset(deviceInfo, 0, sizeof(*deviceInfo));
+  CopyString(deviceInfo->DeviceSerialNumber, SerialNumber(deviceIndex));
+  CopyString(deviceInfo->ProductName, "L SCAN Stub");
+  CopyString(deviceInfo->InterfaceType, "virtual");
+  CopyString(deviceInfo->FirmwareVersion, "1.0.0");
+  CopyString(deviceInfo->HardwareVersion, "A");
+  deviceInfo->IsInitialized = g_devices[deviceIndex].initialized ? TRUE : FALSE;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_RegisterCallbackProgress(LSCAN_CallbackProgress callback, void *context) {
+  STUB_INTERCEPT(LSCAN_STUB_ALL_DEVICES);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_progress = callback;
+  g_progressContext = context;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_RegisterCallbackDeviceCount(LSCAN_CallbackDeviceCount callback, void *context) {
+  STUB_INTERCEPT(LSCAN_STUB_ALL_DEVICES);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_deviceCount = callback;
+  g_deviceCountContext = context;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_ImageQualityInfieldTest(const int deviceIndex, LPCSTR logFilePath) {
+  STUB_INTERCEPT(deviceIndex);
+  if (deviceIndex < 0 || deviceIndex >= DeviceCount() || logFilePath == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  return RunAdjustment(deviceIndex, false);
+}
+
+int WINAPI LSCAN_Main_InstallLicenseFile(const int deviceIndex, const char *LicenseFileName) {
+  STUB_INTERCEPT(deviceIndex);
+  if (deviceIndex < 0 || deviceIndex >= DeviceCount() || LicenseFileName == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return g_devices[deviceIndex].initialized ? LSCAN_ERR_RESOURCE_LOCKED : LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_Initialize(const int deviceIndex, const BOOL reset, int *handle) {
+  STUB_INTERCEPT(deviceIndex);
+  (void)reset;
+  return Initialize(deviceIndex, handle);
+}
+
+int WINAPI LSCAN_Main_Initialize_ExternalVisualization(const int deviceIndex, const BOOL reset, int *handle,
+                                                       const char *pipeName) {
+  STUB_INTERCEPT(deviceIndex);
+  (void)reset;
+  if (pipeName == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  return Initialize(deviceIndex, handle);
+}
+
+int WINAPI LSCAN_Main_Release(const int handle, const BOOL sendToStandby) {
+  STUB_INTERCEPT(handle);
+  (void)sendToStandby;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Device *device = Lookup(handle);
+    if (device == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    *device = Device();
+    g_disconnected[handle] = false;
+  }
+  StopPreview(handle);
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_ReleaseAll(const BOOL sendToStandby) {
+  STUB_INTERCEPT(LSCAN_STUB_ALL_DEVICES);
+  (void)sendToStandby;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (int i = 0; i < kMaxDevices; i++) {
+      g_devices[i] = Device();
+      g_disconnected[i] = false;
+    }
+  }
+  for (int i = 0; i < kMaxDevices; i++) {
+    StopPreview(i);
+  }
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_IsInitialized(const int handle) {
+  STUB_INTERCEPT(handle);
+  if (handle < 0 || handle >= kMaxDevices) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+int WINAPI LSCAN_Main_GetProperty(const int handle, const LScanPropertyId propertyId, LPSTR propertyValue) {
+  STUB_INTERCEPT(handle);
+  if (propertyValue == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  auto it = device->properties.find(propertyId);
+  if (it == device->properties.end()) {
+    return LSCAN_ERR_NOT_SUPPORTED;
+  }
+  CopyString(propertyValue, it->second);
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_SetProperty(const int handle, const LScanPropertyId propertyId, LPCSTR propertyValue) {
+  STUB_INTERCEPT(handle);
+  if (propertyValue == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  if (propertyId != LSCAN_PROPERTY_AUTOMATIC_ADJUSTMENT && propertyId != LSCAN_PROPERTY_ROLL_ALLOW_RESTART &&
+      propertyId != LSCAN_PROPERTY_ROLL_MODE) {
+    return LSCAN_ERR_NOT_SUPPORTED;
+  }
+  device->properties[propertyId] = propertyValue;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Main_CheckCleanliness(const int handle) {
+  STUB_INTERCEPT(handle);
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup(handle) == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+  }
+  return RunAdjustment(handle, true);
+}
+
+int WINAPI LSCAN_Main_ForceReadjustment(const int handle) {
+  STUB_INTERCEPT(handle);
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup(handle) == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+  }
+  return RunAdjustment(handle, true);
+}
+
+int WINAPI LSCAN_Main_RegisterCallbackCommunicationBreak(const int handle, LSCAN_Callback callback, void *context) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  device->communicationBreak = callback;
+  device->communicationBreakContext = context;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_IsModeAvailable(const int handle, const LScanImageType imageType,
+                                         const LScanImageResolution imageResolution, BOOL *isAvailable) {
+  STUB_INTERCEPT(handle);
+  if (isAvailable == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (Lookup(handle) == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  int width = 0;
+  int height = 0;
+  ModeGeometry(imageType, &width, &height);
+  *isAvailable = (width > 0 && (imageResolution == LSCAN_RES_500 || imageResolution == LSCAN_RES_1000)) ? TRUE
+                                                                                                         : FALSE;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_SetMode(const int handle, const LScanImageType imageType,
+                                 const LScanImageResolution imageResolution, const LScanImageOrientation lineOrder,
+                                 const DWORD captureOptions, int *resultWidth, int *resultHeight,
+                                 int *baseResolutionX, int *baseResolutionY) {
+  STUB_INTERCEPT(handle);
+  (void)lineOrder;
+  (void)captureOptions;
+  int width = 0;
+  int height = 0;
+  ModeGeometry(imageType, &width, &height);
+  if (imageType != LSCAN_TYPE_NONE && width == 0) {
+    return LSCAN_ERR_CHANNEL_INVALID_CAPTURE_MODE;
+  }
+  bool changed = false;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Device *device = Lookup(handle);
+    if (device == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    if (device->capturing) {
+      return LSCAN_ERR_CAPTURE_IN_PROGRESS;
+    }
+    changed = device->imageType != imageType || device->resolution != imageResolution;
+  }
+  // Reconfiguring the sensor takes time; setting the current mode again does not.
+  if (changed && ModeMs() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ModeMs()));
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  if (device->capturing) {
+    return LSCAN_ERR_CAPTURE_IN_PROGRESS;
+  }
+  if (changed) {
+    device->streamReady = imageType == LSCAN_TYPE_NONE
+                              ? std::chrono::steady_clock::time_point()
+                              : std::chrono::steady_clock::now() + std::chrono::milliseconds(WarmupMs());
+  }
+  int scale = imageResolution == LSCAN_RES_1000 ? 2 : 1;
+  device->imageType = imageType;
+  device->resolution = imageResolution;
+  device->width = width * scale;
+  device->height = height * scale;
+  // All [out] parameters are optional.
+  if (resultWidth != nullptr) {
+    *resultWidth = device->width;
+  }
+  if (resultHeight != nullptr) {
+    *resultHeight = device->height;
+  }
+  if (baseResolutionX != nullptr) {
+    *baseResolutionX = imageResolution;
+  }
+  if (baseResolutionY != nullptr) {
+    *baseResolutionY = imageResolution;
+  }
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_Start(const int handle, const int numberOfObjects) {
+  STUB_INTERCEPT(handle);
+  LSCAN_CallbackObjectCount objectCount = nullptr;
+  void *objectCountContext = nullptr;
+  LSCAN_CallbackObjectQuality objectQuality = nullptr;
+  void *objectQualityContext = nullptr;
+  Device snapshot;
+  int previewFps = 0;
+  int previewDivisor = 1;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Device *device = Lookup(handle);
+    if (device == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    if (numberOfObjects < 1 || numberOfObjects > LSCAN_MAX_OBJECTS) {
+      return LSCAN_ERR_INVALID_PARAM_VALUE;
+    }
+    if (device->imageType == LSCAN_TYPE_NONE) {
+      return LSCAN_ERR_CHANNEL_INVALID_CAPTURE_MODE;
+    }
+    if (device->capturing) {
+      return LSCAN_ERR_CAPTURE_IN_PROGRESS;
+    }
+    device->capturing = true;
+    device->objects = numberOfObjects;
+    snapshot = *device;
+    previewFps = DeviceSetup(handle).previewFps;
+    previewDivisor = DeviceSetup(handle).previewDivisor;
+    objectCount = device->objectCount;
+    objectCountContext = device->objectCountContext;
+    objectQuality = device->objectQuality;
+    objectQualityContext = device->objectQualityContext;
+  }
+  // The virtual fingers are on the platen right away and of good quality.
+  if (objectCount != nullptr) {
+    objectCount(handle, LSCAN_OBJECT_COUNT_OK, objectCountContext);
+  }
+  if (objectQuality != nullptr) {
+    LScanObjectQualityState qualities[LSCAN_MAX_OBJECTS] = {};
+    objectQuality(handle, qualities, numberOfObjects, objectQualityContext);
+  }
+  StartPreview(handle, snapshot, previewFps, previewDivisor);
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_Abort(const int handle) {
+  STUB_INTERCEPT(handle);
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Device *device = Lookup(handle);
+    if (device == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    if (device->adjusting) {
+      device->abortRequested = true;
+      return LSCAN_STATUS_OK;
+    }
+    if (!device->capturing) {
+      return LSCAN_ERR_NOT_CAPTURING;
+    }
+    device->capturing = false;
+  }
+  StopPreview(handle);
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_IsActive(const int handle, BOOL *isActive) {
+  STUB_INTERCEPT(handle);
+  if (isActive == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  *isActive = device->capturing ? TRUE : FALSE;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_TakeResultImage(const int handle) {
+  STUB_INTERCEPT(handle);
+  Device snapshot;
+  std::shared_ptr<ImageSet> images;
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Device *device = Lookup(handle);
+    if (device == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    if (!device->capturing) {
+      return LSCAN_ERR_NOT_CAPTURING;
+    }
+    device->capturing = false;
+    snapshot = *device;
+    images = DeviceSetup(handle).images;
+  }
+  // The sensor stops streaming before the result image is acquired.
+  StopPreview(handle);
+  if (AcquireMs() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(AcquireMs()));
+  }
+  DeliverResult(handle, snapshot, images);
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_OptimizeContrast(const int handle) {
+  STUB_INTERCEPT(handle);
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Device *device = Lookup(handle);
+    if (device == nullptr) {
+      return LSCAN_ERR_NOT_INITIALIZED;
+    }
+    if (device->imageType == LSCAN_TYPE_NONE) {
+      return LSCAN_ERR_CHANNEL_NOT_ACTIVE;
+    }
+  }
+  int status = RunAdjustment(handle, true);
+  if (status == LSCAN_STATUS_OK) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_devices[handle].contrast = 140;
+  }
+  return status;
+}
+
+int WINAPI LSCAN_Capture_GetContrast(const int handle, int *contrastValue) {
+  STUB_INTERCEPT(handle);
+  if (contrastValue == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  if (device->imageType == LSCAN_TYPE_NONE) {
+    return LSCAN_ERR_CHANNEL_NOT_ACTIVE;
+  }
+  *contrastValue = device->contrast;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_SetContrast(const int handle, const int contrastValue) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  if (device->imageType == LSCAN_TYPE_NONE) {
+    return LSCAN_ERR_CHANNEL_NOT_ACTIVE;
+  }
+  if (contrastValue < 0 || contrastValue > LSCAN_MAX_CONTRAST_VALUE) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  device->contrast = contrastValue;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Capture_SetActiveArea(const int handle, const int x, const int y, const int width,
+                                       const int height) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  if (device->capturing) {
+    return LSCAN_ERR_CAPTURE_IN_PROGRESS;
+  }
+  if (device->imageType == LSCAN_TYPE_NONE) {
+    return LSCAN_ERR_CHANNEL_INVALID_CAPTURE_MODE;
+  }
+  if (x >= 0 && y >= 0 && width > 0 && height > 0 &&
+      (x + width > device->width || y + height > device->height)) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  return LSCAN_STATUS_OK;
+}
+
+#define STUB_REGISTER_CALLBACK(function, type, member)                            \
+  int WINAPI function(const int handle, type callback, void *context) {          \
+    STUB_INTERCEPT(handle);                                                       \
+    std::lock_guard<std::mutex> lock(g_mutex);                                    \
+    Device *device = Lookup(handle);                                              \
+    if (device == nullptr) {                                                      \
+      return LSCAN_ERR_NOT_INITIALIZED;                                           \
+    }                                                                             \
+    device->member = callback;                                                    \
+    device->member##Context = context;                                            \
+    return LSCAN_STATUS_OK;                                                       \
+  }
+
+STUB_REGISTER_CALLBACK(LSCAN_Capture_RegisterCallbackPreviewImage, LSCAN_CallbackPreviewImage, preview)
+STUB_REGISTER_CALLBACK(LSCAN_Capture_RegisterCallbackObjectCount, LSCAN_CallbackObjectCount, objectCount)
+STUB_REGISTER_CALLBACK(LSCAN_Capture_RegisterCallbackObjectQuality, LSCAN_CallbackObjectQuality, objectQuality)
+STUB_REGISTER_CALLBACK(LSCAN_Capture_RegisterCallbackTakingResultImage, LSCAN_Callback, takingResult)
+STUB_REGISTER_CALLBACK(LSCAN_Capture_RegisterCallbackAcquisitionComplete, LSCAN_Callback, acquisitionComplete)
+STUB_REGISTER_CALLBACK(LSCAN_Capture_RegisterCallbackResultImage, LSCAN_CallbackResultImage, resultImage)
+STUB_REGISTER_CALLBACK(LSCAN_Capture_RegisterCallbackClearObjectsFromPlaten, LSCAN_CallbackClearObjectsFromPlaten,
+                       clearPlaten)
+STUB_REGISTER_CALLBACK(LSCAN_Controls_RegisterCallbackKeys, LSCAN_CallbackKeys, keys)
+
+int WINAPI LSCAN_Controls_GetAvailableBeeper(const int handle, LScanBeeperType *beeperType) {
+  STUB_INTERCEPT(handle);
+  if (beeperType == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (Lookup(handle) == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  *beeperType = LSCAN_BEEPER_VOLUME;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_Beeper(const int handle, const int pattern, const int volume) {
+  STUB_INTERCEPT(handle);
+  if (pattern < 0 || pattern > 7 || volume < 0) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+int WINAPI LSCAN_Controls_GetAvailableKeys(const int handle, LScanKeypadType *keypadType, int *keyCount,
+                                           DWORD *availableKeys) {
+  STUB_INTERCEPT(handle);
+  if (keypadType == nullptr || keyCount == nullptr || availableKeys == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (Lookup(handle) == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  *keypadType = LSCAN_KEYPAD_FOUR_KEYS;
+  *keyCount = 4;
+  *availableKeys = LSCAN_KEY_LEFT | LSCAN_KEY_RIGHT | LSCAN_KEY_UP | LSCAN_KEY_DOWN | LSCAN_KEY_FOOT_SWITCH;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_SetActiveKeys(const int handle, const DWORD activeKeys) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  const DWORD available = LSCAN_KEY_LEFT | LSCAN_KEY_RIGHT | LSCAN_KEY_UP | LSCAN_KEY_DOWN | LSCAN_KEY_FOOT_SWITCH;
+  if ((activeKeys & ~available) != 0) {
+    return LSCAN_ERR_NO_HARDWARE_SUPPORT;
+  }
+  device->activeKeys = activeKeys;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_GetAvailableLEDs(const int handle, LScanLedType *ledType, int *ledCount,
+                                           DWORD *availableLEDs) {
+  STUB_INTERCEPT(handle);
+  if (ledType == nullptr || ledCount == nullptr || availableLEDs == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (Lookup(handle) == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  *ledType = LSCAN_LED_STATUS;
+  *ledCount = 4;
+  *availableLEDs = 0x0f;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_SetActiveLEDs(const int handle, const DWORD activeLEDs) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  if ((activeLEDs & ~0x0fu) != 0) {
+    return LSCAN_ERR_NO_HARDWARE_SUPPORT;
+  }
+  device->activeLEDs = activeLEDs;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_GetActiveLEDs(const int handle, DWORD *activeLEDs) {
+  STUB_INTERCEPT(handle);
+  if (activeLEDs == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  *activeLEDs = device->activeLEDs;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_DisplayShowLogoScreen(const int handle, const LScanDisplayLogoOption logoOption,
+                                                const int progressBarPercent) {
+  STUB_INTERCEPT(handle);
+  (void)logoOption;
+  if (progressBarPercent < 0 || progressBarPercent > 100) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+int WINAPI LSCAN_Controls_DisplayShowModeSelectScreen(const int handle) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+int WINAPI LSCAN_Controls_DisplayShowResolutionSelectScreen(const int handle) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+int WINAPI LSCAN_Controls_DisplayShowFingerSelectionScreen(
+    const int handle, const LScanDisplaySelectionCtrl ctrlLeft, const LScanDisplayCommonCtrl, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  device->selection = ctrlLeft;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_DisplayShowNextFingerSelection(const int handle, LScanDisplaySelectionCtrl *pNextCtrlLeft) {
+  STUB_INTERCEPT(handle);
+  if (pNextCtrlLeft == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  // Cycle bandaged -> missing -> restricted -> unrestricted -> bandaged.
+  int next = device->selection % LSCAN_DISPLAY_SELECTION_UNRESTRICTED + 1;
+  device->selection = static_cast<LScanDisplaySelectionCtrl>(next);
+  *pNextCtrlLeft = device->selection;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Controls_DisplayShowCaptureProgressScreen(
+    const int handle, const LScanDisplayCommonCtrl, const LScanDisplayCommonCtrl, const LScanDisplayStatTop,
+    const LScanDisplayStatBottom, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor, const LScanDisplayObjectColor, const LScanDisplayObjectColor,
+    const LScanDisplayObjectColor) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+const char *WINAPI LSCAN_Visualization_Create() {
+  return "lscan-stub-visualization";
+}
+
+void WINAPI LSCAN_Visualization_Destroy(const char *visPipeName) {
+  (void)visPipeName;
+}
+
+int WINAPI LSCAN_Visualization_SetMode(const int handle, const LScanVisMode mode, const DWORD options) {
+  STUB_INTERCEPT(handle);
+  (void)mode;
+  (void)options;
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+int WINAPI LSCAN_Visualization_SetWindow(const int handle, const HWND hWnd, const RECT drawRect) {
+  STUB_INTERCEPT(handle);
+  (void)hWnd;
+  (void)drawRect;
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return Lookup(handle) != nullptr ? LSCAN_STATUS_OK : LSCAN_ERR_NOT_INITIALIZED;
+}
+
+int WINAPI LSCAN_Visualization_GetScaleFactor(const int handle, double *scaleFactor) {
+  STUB_INTERCEPT(handle);
+  if (scaleFactor == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (Lookup(handle) == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  *scaleFactor = 1.0;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Visualization_SetBackgroundColor(const int handle, const COLORREF color) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  device->background = color;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Visualization_RemoveOverlay(const int handle, const DWORD overlayHandle) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  return device->overlays.erase(overlayHandle) == 1 ? LSCAN_STATUS_OK : LSCAN_ERR_INVALID_PARAM_VALUE;
+}
+
+int WINAPI LSCAN_Visualization_RemoveAllOverlays(const int handle) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  device->overlays.clear();
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Visualization_ShowOverlay(const int handle, const DWORD overlayHandle, const BOOL show) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  auto it = device->overlays.find(overlayHandle);
+  if (it == device->overlays.end()) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  it->second.visible = show != FALSE;
+  return LSCAN_STATUS_OK;
+}
+
+int WINAPI LSCAN_Visualization_ShowAllOverlays(const int handle, const BOOL show) {
+  STUB_INTERCEPT(handle);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  for (auto &entry : device->overlays) {
+    entry.second.visible = show != FALSE;
+  }
+  return LSCAN_STATUS_OK;
+}
+
+namespace {
+
+int AddOverlay(int handle, DWORD *overlayHandle) {
+  if (overlayHandle == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  *overlayHandle = device->nextOverlay++;
+  device->overlays[*overlayHandle] = Overlay();
+  return LSCAN_STATUS_OK;
+}
+
+int ModifyOverlay(int handle, DWORD overlayHandle) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  Device *device = Lookup(handle);
+  if (device == nullptr) {
+    return LSCAN_ERR_NOT_INITIALIZED;
+  }
+  return device->overlays.count(overlayHandle) == 1 ? LSCAN_STATUS_OK : LSCAN_ERR_INVALID_PARAM_VALUE;
+}
+
+}  // namespace
+
+int WINAPI LSCAN_Visualization_AddOverlayText(const int handle, const char *text, const int, const int,
+                                              const COLORREF, const char *, const int, const BOOL,
+                                              DWORD *overlayHandle) {
+  STUB_INTERCEPT(handle);
+  if (text == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  return AddOverlay(handle, overlayHandle);
+}
+
+int WINAPI LSCAN_Visualization_ModifyOverlayText(const int handle, const DWORD overlayHandle, const char *text,
+                                                 const int, const int) {
+  STUB_INTERCEPT(handle);
+  if (text == nullptr) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  return ModifyOverlay(handle, overlayHandle);
+}
+
+int WINAPI LSCAN_Visualization_AddOverlayQuadrangle(const int handle, const int, const int, const int, const int,
+                                                    const int, const int, const int, const int, const COLORREF,
+                                                    const int, const BOOL, DWORD *overlayHandle) {
+  STUB_INTERCEPT(handle);
+  return AddOverlay(handle, overlayHandle);
+}
+
+int WINAPI LSCAN_Visualization_ModifyOverlayQuadrangle(const int handle, const DWORD overlayHandle, const int,
+                                                       const int, const int, const int, const int, const int,
+                                                       const int, const int) {
+  STUB_INTERCEPT(handle);
+  return ModifyOverlay(handle, overlayHandle);
+}
+
+int WINAPI LSCAN_Visualization_AddOverlayLine(const int handle, const int, const int, const int, const int,
+                                              const COLORREF, const int, const BOOL, DWORD *overlayHandle) {
+  STUB_INTERCEPT(handle);
+  return AddOverlay(handle, overlayHandle);
+}
+
+int WINAPI LSCAN_Visualization_ModifyOverlayLine(const int handle, const DWORD overlayHandle, const int, const int,
+                                                 const int, const int) {
+  STUB_INTERCEPT(handle);
+  return ModifyOverlay(handle, overlayHandle);
+}
+
+}  // extern "C"
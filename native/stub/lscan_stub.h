@@ -0,0 +1,75 @@
+/// Control interface of the stub library (LScanEssentials.so).
+///
+/// These functions are not part of the SDK; they let benchmarks and tests drive
+/// the virtual devices. The addon resolves them optionally and exposes them as
+/// `stub*` functions when the loaded library provides them.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Callback kinds for LScanStub_FireCallbacks().
+#define LSCAN_STUB_FIRE_KEYS           0
+#define LSCAN_STUB_FIRE_OBJECT_QUALITY 1
+#define LSCAN_STUB_FIRE_PREVIEW        2
+
+/// Handle argument of the functions below that applies to every device, including
+/// devices initialized later.
+#define LSCAN_STUB_ALL_DEVICES -1
+
+/// Fire the callback of @p kind registered for @p handle from @p threads new
+/// threads, @p perThread times each, sleeping @p intervalUs between calls
+/// (0 = back to back). Returns immediately; the threads run detached.
+/// @return LSCAN_STATUS_OK, or an error if the handle or callback is missing.
+int LScanStub_FireCallbacks(int handle, int kind, int threads, int perThread, int intervalUs);
+
+/// Attach or detach virtual devices so that @p count are present, like a USB
+/// hotplug. Initialized devices beyond the new count lose their handle and fire
+/// their communication break callback; the device count callback then fires with
+/// the new count.
+int LScanStub_SetDeviceCount(int count);
+
+/// While capturing, deliver @p fps preview frames per second (0 = none) at the
+/// result geometry divided by @p divisor (1, 2 or 4). Takes effect with the next
+/// LSCAN_Capture_Start(). The first four bytes of every frame hold its sequence
+/// number (little endian) so that drops can be counted on the receiving side.
+int LScanStub_SetPreview(int handle, int fps, int divisor);
+
+/// Take result images from @p path: an 8-bit binary PGM (P5) file, or a directory
+/// whose .pgm files are delivered in name order, cycling. Images are centred in the
+/// geometry of the capture mode, cropped or padded with white. nullptr or "" goes
+/// back to synthetic images.
+/// @return LSCAN_ERR_INVALID_PARAM_VALUE if no image could be read.
+int LScanStub_SetResultImages(int handle, const char *path);
+
+/// Make the next @p count calls of the SDK function named @p function (e.g.
+/// "LSCAN_Capture_Start") for @p handle fail with @p status, without any effect.
+/// @p count -1 fails every call until the rule is replaced with count 0.
+/// Device-index functions match on the device index; functions without a
+/// handle match LSCAN_STUB_ALL_DEVICES rules only.
+int LScanStub_InjectError(const char *function, int handle, int status, int count);
+
+/// Delay every call of @p function (nullptr or "" = every SDK function) for
+/// @p handle by @p microseconds, on top of the LSCAN_STUB_*_MS latencies.
+/// 0 removes the rule.
+int LScanStub_SetLatency(const char *function, int handle, int microseconds);
+
+/// Simulate a broken connection to @p handle: a capture in progress stops, the
+/// communication break callback fires, and every call but LSCAN_Main_Initialize(),
+/// LSCAN_Main_Release() and LSCAN_Main_GetDeviceInfo() (the device is still on the
+/// bus) fails with LSCAN_ERR_DEVICE_IO until the device is initialized again.
+int LScanStub_Disconnect(int handle);
+
+/// Unplug device @p deviceIndex for @p milliseconds, like a USB re-enumeration
+/// after a fault: an initialized device breaks its connection as with
+/// LScanStub_Disconnect(), the device count callback fires with one device
+/// less, and LSCAN_Main_Initialize() and LSCAN_Main_GetDeviceInfo() fail with
+/// LSCAN_ERR_INVALID_DEVICE_INDEX for it. Then the device is back and the
+/// callback fires with the full count. The other devices keep their indices.
+int LScanStub_Unplug(int deviceIndex, int milliseconds);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,98 @@
+#include "task_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace lse {
+
+void TaskPool::Post(std::function<void()> task) {
+  bool start = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    if (idle_ < static_cast<int>(tasks_.size()) && threads_ < kMaxThreads) {
+      threads_++;
+      start = true;
+    }
+  }
+  if (start) {
+    // Pool threads live as long as the process, like the pool itself.
+    std::thread(&TaskPool::Run, this).detach();
+  } else {
+    wake_.notify_one();
+  }
+}
+
+void TaskPool::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    idle_++;
+    wake_.wait(lock, [this] { return !tasks_.empty(); });
+    idle_--;
+    std::function<void()> task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+
+void TaskPool::ParallelFor(int count, int workers, const std::function<void(int)> &body) {
+  workers = std::min(workers, count);
+  if (workers <= 1) {
+    for (int i = 0; i < count; i++) {
+      body(i);
+    }
+    return;
+  }
+  // Helpers may start after the loop is over; they only touch @p body while
+  // counted in active, which the caller waits to drop to zero.
+  struct Loop {
+    std::atomic<int> next{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    int active = 0;
+  };
+  auto loop = std::make_shared<Loop>();
+  auto drain = [count](Loop *state, const std::function<void(int)> &fn) {
+    for (int i = state->next.fetch_add(1, std::memory_order_relaxed); i < count;
+         i = state->next.fetch_add(1, std::memory_order_relaxed)) {
+      fn(i);
+    }
+  };
+  const std::function<void(int)> *shared = &body;
+  for (int w = 1; w < workers; w++) {
+    Post([loop, count, shared, drain] {
+      {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        if (loop->next.load(std::memory_order_relaxed) >= count) {
+          return;
+        }
+        loop->active++;
+      }
+      drain(loop.get(), *shared);
+      std::lock_guard<std::mutex> lock(loop->mutex);
+      if (--loop->active == 0) {
+        loop->done.notify_all();
+      }
+    });
+  }
+  drain(loop.get(), body);
+  std::unique_lock<std::mutex> lock(loop->mutex);
+  loop->done.wait(lock, [&loop] { return loop->active == 0; });
+}
+
+TaskPool &SharedTaskPool() {
+  static TaskPool *pool = new TaskPool();
+  return *pool;
+}
+
+int HardwareThreads() {
+  static const int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  return threads;
+}
+
+}  // namespace lse
@@ -0,0 +1,50 @@
+/// Threads for blocking SDK calls issued by the *Async bindings.
+///
+/// The calls block for seconds while the device works, so they are kept off
+/// libuv's small shared pool (which also serves fs and dns). Threads are started
+/// on demand, up to kMaxThreads, and then kept for reuse.
+///
+/// Image work running on the pool (rendering, encoding, quality analysis) can
+/// split itself further with ParallelFor().
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace lse {
+
+class TaskPool {
+ public:
+  static constexpr int kMaxThreads = 16;
+
+  /// Any thread. Runs @p task on an idle pool thread, starting one if none is
+  /// idle and the limit allows; otherwise the task waits for a free thread.
+  void Post(std::function<void()> task);
+
+  /// Any thread. Runs @p body(i) for every i in [0, @p count) on the calling
+  /// thread and up to @p workers - 1 pool threads, and returns once all calls
+  /// are done. Indices are handed out one at a time, so uneven items balance
+  /// out. The calling thread works through whatever helpers have not picked
+  /// up, so a busy pool slows the loop down but never blocks it.
+  void ParallelFor(int count, int workers, const std::function<void(int)> &body);
+
+ private:
+  void Run();
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::function<void()>> tasks_;
+  int threads_ = 0;
+  int idle_ = 0;
+};
+
+/// Process-wide pool.
+TaskPool &SharedTaskPool();
+
+/// Worker count for ParallelFor(): the hardware threads, at least 1.
+int HardwareThreads();
+
+}  // namespace lse
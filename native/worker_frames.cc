@@ -0,0 +1,283 @@
+#include "worker_frames.h"
+
+#include "dispatcher.h"
+#include "lse_api.h"
+#include "napi_util.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace lse {
+
+namespace {
+
+/// Preview frames or result images of one handle for one worker. Like the
+/// callback slots, sinks are never destroyed: the SDK thread may still hold one
+/// after its worker let go of it.
+class WorkerFrameSink : public EventSink {
+ public:
+  WorkerFrameSink(napi_env env, Dispatcher *dispatcher) : env_(env), dispatcher_(dispatcher) {}
+
+  napi_env env() const { return env_; }
+
+  /// Worker JS thread.
+  bool Assign(napi_value function) {
+    napi_ref created = nullptr;
+    if (function != nullptr) {
+      NAPI_CHECK_RETURN(env_, napi_create_reference(env_, function, 1, &created), false);
+    }
+    bool had_function = function_ != nullptr;
+    if (had_function) {
+      napi_delete_reference(env_, function_);
+    }
+    function_ = created;
+    if (created == nullptr) {
+      preview_.Clear();
+    }
+    if (!had_function && created != nullptr) {
+      dispatcher_->AddListener();
+    } else if (had_function && created == nullptr) {
+      dispatcher_->RemoveListener();
+    }
+    active_.store(created != nullptr, std::memory_order_release);
+    return true;
+  }
+
+  bool active() const override { return active_.load(std::memory_order_acquire); }
+
+  void Post(std::unique_ptr<CallbackEvent> event) override {
+    if (!active_.load(std::memory_order_acquire)) {
+      return;
+    }
+    results_.fetch_add(1, std::memory_order_relaxed);
+    event->sink = this;
+    dispatcher_->Push(event.release());
+  }
+
+  /// Queues a drain event only if the preview channel has none.
+  void PostPreview(int handle, const LScanImageData &image, uint64_t timestamp) override {
+    if (!active_.load(std::memory_order_acquire) || !preview_.Offer(handle, image, timestamp)) {
+      return;
+    }
+    std::unique_ptr<CallbackEvent> event(new CallbackEvent());
+    event->kind = CallbackKind::kPreviewImage;
+    event->handle = handle;
+    event->timestamp = timestamp;
+    event->sink = this;
+    dispatcher_->Push(event.release());
+  }
+
+  PreviewChannel &preview() { return preview_; }
+  uint64_t results() const { return results_.load(std::memory_order_relaxed); }
+
+  /// Worker JS thread: preview handlers get (handle, image, timestamp), result
+  /// handlers (handle, image, imageStatus, timestamp), as on the main thread.
+  bool Deliver(napi_env env, CallbackEvent &event) override {
+    napi_value function = nullptr;
+    if (function_ == nullptr || napi_get_reference_value(env, function_, &function) != napi_ok ||
+        function == nullptr) {
+      return false;
+    }
+    napi_value undefined = nullptr;
+    napi_get_undefined(env, &undefined);
+    if (event.kind != CallbackKind::kPreviewImage) {
+      napi_value argv[4] = {MakeInt(env, event.handle), ImageToJs(env, &event.image), MakeInt(env, event.value),
+                            MakeDouble(env, static_cast<double>(event.timestamp))};
+      napi_call_function(env, undefined, function, 4, argv, nullptr);
+      return true;
+    }
+    std::vector<PreviewFrame> frames;
+    preview_.Take(&frames);
+    size_t delivered = 0;
+    for (PreviewFrame &frame : frames) {
+      napi_value argv[3] = {MakeInt(env, event.handle), ImageToJs(env, &frame.image),
+                            MakeDouble(env, static_cast<double>(frame.timestamp))};
+      napi_call_function(env, undefined, function, 3, argv, nullptr);
+      delivered++;
+      bool pending = false;
+      napi_is_exception_pending(env, &pending);
+      if (pending) {
+        break;
+      }
+    }
+    preview_.Account(delivered, frames.size() - delivered);
+    return true;
+  }
+
+ private:
+  const napi_env env_;
+  Dispatcher *const dispatcher_;
+  std::atomic<bool> active_{false};
+  std::atomic<uint64_t> results_{0};
+  napi_ref function_ = nullptr;  // Worker JS thread only
+  PreviewChannel preview_;       // Preview sinks only
+};
+
+/// Instance data of a worker env. Left behind when the worker exits, with its
+/// Dispatcher and sinks, for SDK threads that may still reach them.
+struct WorkerEnv {
+  napi_env env = nullptr;
+  Dispatcher *dispatcher = nullptr;
+  std::map<std::pair<CallbackKind, int>, WorkerFrameSink *> sinks;  // Worker JS thread only
+};
+
+/// The worker sinks taking the images of a handle, if any.
+struct Route {
+  std::atomic<WorkerFrameSink *> preview{nullptr};
+  std::atomic<WorkerFrameSink *> result{nullptr};
+
+  std::atomic<WorkerFrameSink *> &For(CallbackKind kind) {
+    return kind == CallbackKind::kPreviewImage ? preview : result;
+  }
+};
+
+std::mutex g_routes_mutex;
+std::map<int, std::unique_ptr<Route>> g_routes;
+std::atomic<int> g_open{0};
+
+Route *GetRoute(int handle) {
+  std::lock_guard<std::mutex> lock(g_routes_mutex);
+  std::unique_ptr<Route> &route = g_routes[handle];
+  if (!route) {
+    route.reset(new Route());
+  }
+  return route.get();
+}
+
+WorkerFrameSink *RouteSink(CallbackKind kind, int handle) {
+  if (!WorkerFramesOpen()) {
+    return nullptr;
+  }
+  return GetRoute(handle)->For(kind).load(std::memory_order_acquire);
+}
+
+int RefreshCallback(CallbackKind kind, int handle) {
+  return kind == CallbackKind::kPreviewImage ? RefreshPreviewCallback(handle) : RefreshResultCallback(handle);
+}
+
+/// Cleanup hook of a worker env; runs before its Dispatcher's. Hands back every
+/// route the worker still holds so the callbacks fall back to the main thread's.
+void CloseWorkerEnv(void *data) {
+  WorkerEnv *worker = static_cast<WorkerEnv *>(data);
+  std::vector<std::pair<CallbackKind, int>> closed;
+  for (auto &entry : worker->sinks) {
+    WorkerFrameSink *sink = entry.second;
+    if (!sink->active()) {
+      continue;
+    }
+    sink->Assign(nullptr);
+    WorkerFrameSink *expected = sink;
+    if (GetRoute(entry.first.second)->For(entry.first.first).compare_exchange_strong(expected, nullptr)) {
+      g_open.fetch_sub(1, std::memory_order_relaxed);
+      closed.push_back(entry.first);
+    }
+  }
+  for (const auto &route : closed) {
+    RefreshCallback(route.first, route.second);
+  }
+}
+
+}  // namespace
+
+bool StartWorkerEnv(napi_env env) {
+  WorkerEnv *worker = new WorkerEnv();
+  worker->env = env;
+  worker->dispatcher = new Dispatcher();
+  if (!worker->dispatcher->Start(env)) {
+    return false;
+  }
+  NAPI_CHECK_RETURN(env, napi_set_instance_data(env, worker, nullptr, nullptr), false);
+  // Cleanup hooks run in reverse order, so this one sees the dispatcher still open.
+  NAPI_CHECK_RETURN(env, napi_add_env_cleanup_hook(env, CloseWorkerEnv, worker), false);
+  return true;
+}
+
+int OpenWorkerFrames(napi_env env, CallbackKind kind, int handle, napi_value function, PreviewPolicy policy,
+                     int capacity, int timeoutMs) {
+  void *data = nullptr;
+  if (napi_get_instance_data(env, &data) != napi_ok || data == nullptr) {
+    return LSCAN_ERR_NOT_SUPPORTED;
+  }
+  if (kind != CallbackKind::kPreviewImage && kind != CallbackKind::kResultImage) {
+    return LSCAN_ERR_INVALID_PARAM_VALUE;
+  }
+  WorkerEnv *worker = static_cast<WorkerEnv *>(data);
+  WorkerFrameSink *&sink = worker->sinks[std::make_pair(kind, handle)];
+  if (sink == nullptr) {
+    sink = new WorkerFrameSink(env, worker->dispatcher);
+  }
+  {
+    std::lock_guard<std::mutex> lock(g_routes_mutex);
+    std::unique_ptr<Route> &route = g_routes[handle];
+    if (!route) {
+      route.reset(new Route());
+    }
+    std::atomic<WorkerFrameSink *> &current = route->For(kind);
+    WorkerFrameSink *owner = current.load(std::memory_order_acquire);
+    if (owner != nullptr && owner != sink) {
+      return LSCAN_ERR_RESOURCE_LOCKED;
+    }
+    if (function != nullptr && kind == CallbackKind::kPreviewImage &&
+        !sink->preview().Configure(policy, capacity, timeoutMs)) {
+      return LSCAN_ERR_INVALID_PARAM_VALUE;
+    }
+    if (!sink->Assign(function)) {
+      return LSCAN_ERR_GENERAL;
+    }
+    WorkerFrameSink *next = function != nullptr ? sink : nullptr;
+    if (owner == nullptr && next != nullptr) {
+      g_open.fetch_add(1, std::memory_order_relaxed);
+    } else if (owner != nullptr && next == nullptr) {
+      g_open.fetch_sub(1, std::memory_order_relaxed);
+    }
+    current.store(next, std::memory_order_release);
+  }
+  return RefreshCallback(kind, handle);
+}
+
+bool WorkerFramesOpen() {
+  return g_open.load(std::memory_order_relaxed) > 0;
+}
+
+bool WorkerFramesOpen(CallbackKind kind, int handle) {
+  return RouteSink(kind, handle) != nullptr;
+}
+
+void OfferWorkerPreview(int handle, const LScanImageData &image, uint64_t timestamp) {
+  if (WorkerFrameSink *sink = RouteSink(CallbackKind::kPreviewImage, handle)) {
+    sink->PostPreview(handle, image, timestamp);
+  }
+}
+
+void OfferWorkerResult(int handle, const LScanImageData &image, int imageStatus, uint64_t timestamp) {
+  WorkerFrameSink *sink = RouteSink(CallbackKind::kResultImage, handle);
+  if (sink == nullptr || !sink->active()) {
+    return;
+  }
+  // A copy of its own: the main thread's result event, if anyone takes it
+  // there, may be encoded or segmented in place and lives in another isolate.
+  std::unique_ptr<CallbackEvent> event = NewEvent(CallbackKind::kResultImage, handle, imageStatus);
+  event->timestamp = timestamp;
+  CopyImage(image, &event->image, handle);
+  sink->Post(std::move(event));
+}
+
+WorkerFrameStats GetWorkerFrameStats(int handle) {
+  WorkerFrameStats stats;
+  Route *route = GetRoute(handle);
+  if (WorkerFrameSink *sink = route->preview.load(std::memory_order_acquire)) {
+    stats.preview = true;
+    stats.previewStats = sink->preview().Stats();
+  }
+  if (WorkerFrameSink *sink = route->result.load(std::memory_order_acquire)) {
+    stats.result = true;
+    stats.results = sink->results();
+  }
+  return stats;
+}
+
+}  // namespace lse
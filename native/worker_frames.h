@@ -0,0 +1,67 @@
+/// Preview and result images of a handle delivered straight to a worker thread.
+///
+/// The SDK functions and callbacks of the addon belong to the isolate that
+/// loaded it first, normally the main thread. Node worker threads that load it
+/// afterwards get a frame consumer's share instead (see Init() in addon.cc): a
+/// Dispatcher of their own, the image kernels, and workerFramesOpen(), which
+/// takes the preview frames or result images of a handle off the SDK thread:
+///
+///   SDK thread -> copy into a pooled block -> worker's dispatcher -> worker's handler
+///
+/// The main thread is not involved per frame. The image data reach the worker
+/// as external Buffers over the pooled native memory, created in the worker's
+/// isolate, so nothing is serialised, transferred or copied again; a block
+/// returns to its pool when the worker's Buffer is collected. Preview frames
+/// wait in a PreviewChannel of the worker with the policies of
+/// setPreviewPolicy(). One worker at a time takes each kind of image of a
+/// handle; the main thread's own callbacks keep working alongside.
+
+#pragma once
+
+#include "callbacks.h"
+#include "preview_channel.h"
+
+#include <node_api.h>
+
+#include <cstdint>
+
+namespace lse {
+
+class Dispatcher;
+
+/// Set up @p env, a worker isolate, as a frame consumer: its Dispatcher and a
+/// cleanup hook that hands its images back when the worker exits. Returns
+/// false with a pending JS exception on failure.
+bool StartWorkerEnv(napi_env env);
+
+/// Worker JS thread. Deliver images of @p kind (kPreviewImage or
+/// kResultImage) of @p handle to @p function in the worker of @p env, or stop
+/// if @p function is null. Preview frames are queued per @p policy, @p capacity
+/// and @p timeoutMs. Returns the SDK status of (un)registering the callback;
+/// LSCAN_ERR_INVALID_PARAM_VALUE for a bad policy, LSCAN_ERR_RESOURCE_LOCKED if
+/// another worker takes them and LSCAN_ERR_NOT_SUPPORTED if @p env is not a
+/// worker's.
+int OpenWorkerFrames(napi_env env, CallbackKind kind, int handle, napi_value function, PreviewPolicy policy,
+                     int capacity, int timeoutMs);
+
+/// Any thread; lock-free. Whether any worker takes images.
+bool WorkerFramesOpen();
+
+/// Any thread. Whether a worker takes images of @p kind of @p handle.
+bool WorkerFramesOpen(CallbackKind kind, int handle);
+
+/// SDK thread: hand a preview frame or a result image of @p handle to the
+/// worker taking it, if any.
+void OfferWorkerPreview(int handle, const LScanImageData &image, uint64_t timestamp);
+void OfferWorkerResult(int handle, const LScanImageData &image, int imageStatus, uint64_t timestamp);
+
+struct WorkerFrameStats {
+  bool preview = false;  ///< A worker takes the preview frames
+  bool result = false;   ///< A worker takes the result images
+  PreviewStats previewStats;
+  uint64_t results = 0;  ///< Result images handed to a worker
+};
+
+WorkerFrameStats GetWorkerFrameStats(int handle);
+
+}  // namespace lse
@@ -0,0 +1,96 @@
+import lseBinding from "../lse-binding"
+
+// Event-loop lag while the long-running SDK calls are in progress, blocking
+// (sync binding) versus the *Async variants. The stub simulates the call
+// durations (see the npm script):
+//   npm run bench:async
+const { constants } = lseBinding
+const { deviceCount } = lseBinding.LSCAN_Main_GetDeviceCount()
+const devices = Array.from({ length: deviceCount }, (_, i) => i)
+
+// Lag probe: a setImmediate chain records the gap between consecutive
+// event-loop turns, i.e. how long any callback had to wait for the loop. Gaps
+// go into 1 us buckets so that the probe itself allocates nothing.
+const bucketCount = 100000
+
+function startProbe() {
+    const buckets = new Uint32Array(bucketCount + 1)
+    let max = 0
+    let last = lseBinding.now()
+    let running = true
+    const record = (now) => {
+        const gap = now - last
+        buckets[Math.min(bucketCount, Math.floor(gap / 1000))]++
+        if (gap > max) max = gap
+        last = now
+    }
+    const turn = () => {
+        record(lseBinding.now())
+        if (running) setImmediate(turn)
+    }
+    setImmediate(turn)
+    return () => {
+        running = false
+        record(lseBinding.now())
+        let total = 0
+        for (const count of buckets) total += count
+        const percentile = (p) => {
+            let seen = 0
+            for (let us = 0; us <= bucketCount; us++) {
+                seen += buckets[us]
+                if (seen >= total * p) return us === bucketCount ? max : us * 1000
+            }
+            return max
+        }
+        return { percentile, max }
+    }
+}
+
+async function measure(name, body) {
+    const stopProbe = startProbe()
+    const start = lseBinding.now()
+    await body()
+    const ms = (lseBinding.now() - start) / 1e6
+    const { percentile, max } = stopProbe()
+    const lag = (ns) => (ns / 1e6).toFixed(3).padStart(9)
+    console.log(name.padEnd(34), ms.toFixed(0).padStart(8), lag(percentile(0.5)), lag(percentile(0.99)),
+        lag(percentile(0.999)), lag(max))
+}
+
+async function sync() {
+    const handles = devices.map((index) => lseBinding.LSCAN_Main_Initialize(index, false).handle)
+    for (const handle of handles) {
+        lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_SINGLE_FINGER, constants.LSCAN_RES_500,
+            constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+        lseBinding.LSCAN_Capture_OptimizeContrast(handle)
+        lseBinding.LSCAN_Main_CheckCleanliness(handle)
+        lseBinding.LSCAN_Main_ForceReadjustment(handle)
+        lseBinding.LSCAN_Main_Release(handle, false)
+    }
+}
+
+async function async() {
+    let progress = 0
+    const onProgress = () => progress++
+    await Promise.all(devices.map(async (index) => {
+        const { handle } = await lseBinding.LSCAN_Main_InitializeAsync(index, false, { onProgress })
+        lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_SINGLE_FINGER, constants.LSCAN_RES_500,
+            constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+        await lseBinding.LSCAN_Capture_OptimizeContrastAsync(handle, { onProgress })
+        await lseBinding.LSCAN_Main_CheckCleanlinessAsync(handle, { onProgress })
+        await lseBinding.LSCAN_Main_ForceReadjustmentAsync(handle, { onProgress })
+        lseBinding.LSCAN_Main_Release(handle, false)
+    }))
+}
+
+async function main() {
+    console.log(`${deviceCount} devices: Initialize, OptimizeContrast, CheckCleanliness, ForceReadjustment`)
+    console.log("lag in ms".padEnd(34), "total ms".padStart(8), "p50".padStart(9), "p99".padStart(9),
+        "p99.9".padStart(9), "max".padStart(9))
+    // Baseline: what the host alone does to the loop (scheduling, timers, GC).
+    await measure("idle", () => new Promise((resolve) => setTimeout(resolve, 1000)))
+    await measure("sync binding (event loop blocked)", sync)
+    await measure("async binding", async)
+}
+
+main()
@@ -0,0 +1,53 @@
+import lseBinding from "../lse-binding"
+import ffiBinding from "./ffi-binding"
+
+// Calls per second through the native addon versus the node-ffi binding for a
+// few representative signatures. Run against the stub library so the numbers
+// reflect binding overhead rather than device I/O:
+//   npm run bench:calls [-- <durationMs>]
+const durationMs = Number(process.argv[2]) || 1000
+
+const cases = [
+    ["GetDeviceCount (out int)", (b) => b.LSCAN_Main_GetDeviceCount()],
+    ["IsInitialized (int)", (b, handle) => b.LSCAN_Main_IsInitialized(handle)],
+    ["GetContrast (int, out int)", (b, handle) => b.LSCAN_Capture_GetContrast(handle)],
+    ["SetActiveLEDs (int, dword)", (b, handle) => b.LSCAN_Controls_SetActiveLEDs(handle, 0x5)],
+]
+
+function callsPerSecond(fn) {
+    // Warm up so both paths are measured with optimized JS.
+    for (let i = 0; i < 10000; i++) fn()
+
+    let calls = 0
+    const start = process.hrtime.bigint()
+    const end = start + BigInt(durationMs) * 1000000n
+    let now = start
+    while (now < end) {
+        for (let i = 0; i < 1000; i++) fn()
+        calls += 1000
+        now = process.hrtime.bigint()
+    }
+    return calls / (Number(now - start) / 1e9)
+}
+
+const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+lseBinding.LSCAN_Capture_SetMode(handle, lseBinding.constants.LSCAN_FLAT_SINGLE_FINGER,
+    lseBinding.constants.LSCAN_RES_500, lseBinding.constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+
+const results = cases.map(([name, call]) => {
+    const native = callsPerSecond(() => call(lseBinding, handle))
+    const ffi = ffiBinding ? callsPerSecond(() => call(ffiBinding, handle)) : null
+    return { name, native, ffi }
+})
+
+const format = (n) => n === null ? "n/a" : Math.round(n).toLocaleString("en-US")
+console.log("call".padEnd(30), "native calls/s".padStart(16), "ffi calls/s".padStart(16), "speedup".padStart(9))
+for (const { name, native, ffi } of results) {
+    const speedup = ffi ? (native / ffi).toFixed(1) + "x" : "n/a"
+    console.log(name.padEnd(30), format(native).padStart(16), format(ffi).padStart(16), speedup.padStart(9))
+}
+if (!ffiBinding) {
+    console.log("\nffi/ref not installed; only the native path was measured.")
+}
+
+lseBinding.LSCAN_Main_Release(handle, false)
@@ -0,0 +1,77 @@
+import lseBinding from "../lse-binding"
+
+// Callback bridge stress test: stub threads fire SDK callbacks as fast as they
+// can (or at a fixed interval) and the JS side records the latency from the SDK
+// invoking the trampoline to the JS function running. Run against the stub
+// library:
+//   npm run bench:callbacks [-- <threads> <perThread> <keys|quality|preview> <intervalUs>]
+const threads = Number(process.argv[2]) || 4
+const perThread = Number(process.argv[3]) || 50000
+const kindName = process.argv[4] || "keys"
+const intervalUs = Number(process.argv[5]) || 0
+
+const { constants } = lseBinding
+const kinds = {
+    keys: [constants.LSCAN_STUB_FIRE_KEYS, lseBinding.LSCAN_Controls_RegisterCallbackKeys],
+    quality: [constants.LSCAN_STUB_FIRE_OBJECT_QUALITY, lseBinding.LSCAN_Capture_RegisterCallbackObjectQuality],
+    preview: [constants.LSCAN_STUB_FIRE_PREVIEW, lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage],
+}
+if (!kinds[kindName]) {
+    console.error(`unknown callback kind "${kindName}"; expected one of ${Object.keys(kinds).join(", ")}`)
+    process.exit(1)
+}
+const [kind, register] = kinds[kindName]
+
+const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_SINGLE_FINGER,
+    constants.LSCAN_RES_500, constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+
+const expected = threads * perThread
+const latencies = new Float64Array(expected)
+let received = 0
+let start = 0
+
+// Event-loop lag: a timer that should fire every 10 ms.
+let maxLag = 0
+let lastTick = lseBinding.now()
+const lagTimer = setInterval(() => {
+    const now = lseBinding.now()
+    maxLag = Math.max(maxLag, (now - lastTick) / 1e6 - 10)
+    lastTick = now
+}, 10)
+
+register(handle, function () {
+    // The capture timestamp is always the last argument.
+    const timestamp = arguments[arguments.length - 1]
+    latencies[received++] = lseBinding.now() - timestamp
+    if (received === expected) finish()
+})
+
+function percentile(sorted, p) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))]
+}
+
+function finish() {
+    const elapsed = (lseBinding.now() - start) / 1e9
+    clearInterval(lagTimer)
+    register(handle, null)
+    lseBinding.LSCAN_Main_Release(handle, false)
+
+    const sorted = latencies.sort()
+    const us = (ns) => (ns / 1000).toFixed(1).padStart(10)
+    const stats = lseBinding.dispatcherStats()
+    console.log(`${expected} ${kindName} callbacks from ${threads} threads in ${elapsed.toFixed(3)} s`
+        + ` (${Math.round(expected / elapsed).toLocaleString("en-US")} events/s)`)
+    console.log("latency us:", "p50", us(percentile(sorted, 0.5)), " p90", us(percentile(sorted, 0.9)),
+        " p99", us(percentile(sorted, 0.99)), " p99.9", us(percentile(sorted, 0.999)),
+        " max", us(sorted[sorted.length - 1]))
+    console.log(`batches ${stats.batches}, mean batch ${(stats.delivered / stats.batches).toFixed(1)},`
+        + ` max batch ${stats.maxBatch}, discarded ${stats.discarded}, max timer lag ${maxLag.toFixed(1)} ms`)
+}
+
+start = lseBinding.now()
+const status = lseBinding.stubFireCallbacks(handle, kind, threads, perThread, intervalUs)
+if (status !== constants.LSCAN_STATUS_OK) {
+    console.error("stubFireCallbacks failed with status", status)
+    process.exit(1)
+}
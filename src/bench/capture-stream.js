@@ -0,0 +1,93 @@
+import lseBinding from "../lse-binding"
+import capture from "../capture"
+
+// JS invocations per capture: the eight per-callback registrations versus one
+// capture() event stream. Each capture runs Start, a burst of preview frames
+// and key presses from stub threads, then TakeResultImage. Run against the stub
+// library:
+//   npm run bench:capture [-- <captures> <previewFrames> <intervalUs>]
+const captures = Number(process.argv[2]) || 50
+const previewFrames = Number(process.argv[3]) || 60
+const intervalUs = Number(process.argv[4]) || 200
+
+const { constants } = lseBinding
+const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+    constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+// Keep every preview frame so that both variants see the same events.
+lseBinding.setPreviewPolicy(handle, { policy: "ring", capacity: 64 })
+
+const registrations = [
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage,
+    lseBinding.LSCAN_Capture_RegisterCallbackObjectCount,
+    lseBinding.LSCAN_Capture_RegisterCallbackObjectQuality,
+    lseBinding.LSCAN_Capture_RegisterCallbackTakingResultImage,
+    lseBinding.LSCAN_Capture_RegisterCallbackAcquisitionComplete,
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage,
+    lseBinding.LSCAN_Capture_RegisterCallbackClearObjectsFromPlaten,
+    lseBinding.LSCAN_Controls_RegisterCallbackKeys,
+]
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+function fireBurst() {
+    lseBinding.stubFireCallbacks(handle, constants.LSCAN_STUB_FIRE_PREVIEW, 1, previewFrames, intervalUs)
+    lseBinding.stubFireCallbacks(handle, constants.LSCAN_STUB_FIRE_KEYS, 1, previewFrames / 4, intervalUs * 4)
+    return sleep((previewFrames * intervalUs) / 1000 + 5)
+}
+
+async function callbacks() {
+    let calls = 0
+    let resultImage = null
+    for (const register of registrations) {
+        register(handle, (...args) => {
+            calls++
+            if (register === lseBinding.LSCAN_Capture_RegisterCallbackResultImage) resultImage()
+        })
+    }
+    for (let i = 0; i < captures; i++) {
+        const done = new Promise((resolve) => {
+            resultImage = resolve
+        })
+        lseBinding.LSCAN_Capture_Start(handle, 4)
+        await fireBurst()
+        lseBinding.LSCAN_Capture_TakeResultImage(handle)
+        await done
+    }
+    for (const register of registrations) register(handle, null)
+    return { calls, events: calls }
+}
+
+async function stream() {
+    let events = 0
+    const before = lseBinding.captureStreamStats(handle)
+    for (let i = 0; i < captures; i++) {
+        const current = await capture(handle, { numberOfObjects: 4, previewBacklog: 64 })
+        const burst = fireBurst().then(() => current.takeResultImage())
+        for await (const event of current) events++
+        await burst
+    }
+    const after = lseBinding.captureStreamStats(handle)
+    return { calls: after.batches - before.batches, events }
+}
+
+async function measure(name, body) {
+    const before = lseBinding.dispatcherStats()
+    const start = lseBinding.now()
+    const { calls, events } = await body()
+    const ms = (lseBinding.now() - start) / 1e6 / captures
+    const wakeups = lseBinding.dispatcherStats().batches - before.batches
+    console.log(name.padEnd(20), (events / captures).toFixed(1).padStart(10), (calls / captures).toFixed(1).padStart(10),
+        (wakeups / captures).toFixed(1).padStart(10), ms.toFixed(2).padStart(12))
+}
+
+async function main() {
+    console.log(`${captures} captures, ${previewFrames} preview frames every ${intervalUs} us`)
+    console.log("per capture".padEnd(20), "events".padStart(10), "JS calls".padStart(10), "wakeups".padStart(10),
+        "ms/capture".padStart(12))
+    await measure("eight callbacks", callbacks)
+    await measure("capture() stream", stream)
+    lseBinding.LSCAN_Main_Release(handle, false)
+}
+
+main()
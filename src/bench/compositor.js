@@ -0,0 +1,88 @@
+import lseBinding from "../lse-binding"
+import Compositor from "../compositor"
+
+// Headless preview compositing at video rates: 1 to `maxDevices` devices stream
+// preview at 30 and 60 fps while a Compositor per device scales every frame to
+// the output size, draws a handful of overlays and hands the pixels to JS.
+// Reports the output rate per device, frames dropped because rendering or the
+// handler fell behind, and the render time per frame, for the best SIMD level
+// and for the scalar kernels. Run against the stub library:
+//   npm run bench:compositor [-- <maxDevices> <durationMs> <width> <height> <format>]
+const maxDevices = Number(process.argv[2]) || 4
+const durationMs = Number(process.argv[3]) || 2000
+const width = Number(process.argv[4]) || 640
+const height = Number(process.argv[5]) || 480
+const format = process.argv[6] || "rgba"
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+// Finger boxes with a quality label each, as a capture UI would show them.
+const overlays = [0, 1, 2, 3].map((f) => [
+    { key: `box${f}`, type: "quadrangle", points: [40 + f * 180, 60, 190 + f * 180, 60, 190 + f * 180, 700, 40 + f * 180,
+        700], color: 0x0000ff00, lineWidth: 3, belongsToImage: true },
+    { key: `label${f}`, type: "text", text: `finger ${f + 1}: 87`, x: 40 + f * 180, y: 20, color: 0x40ffffff,
+        fontSize: 24, belongsToImage: true },
+]).flat().concat([{ key: "hint", type: "text", text: "Place four fingers", x: 8, y: 8, fontSize: 16 }])
+
+async function run(devices, fps, level) {
+    lseBinding.setSimdLevel(level)
+    lseBinding.stubSetPreview(constants.LSCAN_STUB_ALL_DEVICES, fps, 2)
+    const handles = []
+    for (let i = 0; i < devices; i++) {
+        const { handle } = lseBinding.LSCAN_Main_Initialize(i, false)
+        lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+            constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+        handles.push(handle)
+    }
+    let bytes = 0
+    const compositors = handles.map((handle) => {
+        const compositor = new Compositor(handle, { width, height, format }, (frame) => {
+            bytes += frame.data.length
+        })
+        compositor.setOverlays(overlays)
+        return compositor
+    })
+    for (const handle of handles) lseBinding.LSCAN_Capture_Start(handle, 4)
+    await sleep(durationMs)
+    for (const handle of handles) lseBinding.LSCAN_Capture_Abort(handle)
+    await sleep(50)
+
+    const stats = compositors.map((compositor) => compositor.stats())
+    for (const compositor of compositors) compositor.close()
+    for (const handle of handles) lseBinding.LSCAN_Main_Release(handle, false)
+    const sum = (key) => stats.reduce((total, s) => total + s[key], 0)
+    const rendered = sum("rendered")
+    return {
+        devices,
+        fps,
+        level,
+        outputFps: (sum("delivered") / devices / durationMs) * 1000,
+        dropped: sum("dropped"),
+        renderUs: rendered ? stats.reduce((total, s) => total + s.renderMean * s.rendered, 0) / rendered / 1000 : 0,
+        maxRenderUs: Math.max(...stats.map((s) => s.renderMax)) / 1000,
+        mbPerSecond: bytes / durationMs / 1000,
+    }
+}
+
+async function main() {
+    lseBinding.stubSetDeviceCount(maxDevices)
+    const best = lseBinding.simdLevel().detected
+    const levels = best === "scalar" ? ["scalar"] : [best, "scalar"]
+    console.log(`${width}x${height} ${format}, ${durationMs} ms per run, kernels: ${levels.join(" vs ")}`)
+    console.log("devices  fps  kernels   out fps/device  dropped  render us (mean / max)  MB/s to JS")
+    for (const level of levels) {
+        for (let devices = 1; devices <= maxDevices; devices++) {
+            for (const fps of [30, 60]) {
+                const r = await run(devices, fps, level)
+                console.log(`${String(r.devices).padStart(7)}  ${String(r.fps).padStart(3)}  ${r.level.padEnd(8)}` +
+                    `  ${r.outputFps.toFixed(1).padStart(14)}  ${String(r.dropped).padStart(7)}` +
+                    `  ${r.renderUs.toFixed(0).padStart(10)} / ${r.maxRenderUs.toFixed(0).padEnd(10)}` +
+                    `  ${r.mbPerSecond.toFixed(1).padStart(10)}`)
+            }
+        }
+    }
+    lseBinding.setSimdLevel(best)
+}
+
+main()
@@ -0,0 +1,99 @@
+import lseBinding from "../lse-binding"
+
+// Operator feedback from a UI state machine ticking at `uiHz`: every tick sets
+// the LEDs and redraws the capture progress screen for its state, and a beep
+// marks every second. The finger colours follow a quality meter, changing on
+// every tick while the fingers are placed (the first half) and rarely once they
+// rest; the LEDs change every 15 ticks. With the stub's per-call latencies below, the
+// same updates are run
+//   1. direct: one blocking LSCAN_Controls_* round trip per update, and
+//   2. queued: through queueControl() (native/controls_queue.h), which
+//      coalesces, skips repeats and gives way to the capture calls made on
+//      every fifth tick;
+// reporting the device round trips made and saved, the main-thread time per
+// tick and the capture call latency:
+//   npm run bench:controls [-- <ticks> <uiHz> <displayUs> <ledUs>]
+const ticks = Number(process.argv[2]) || 180
+const uiHz = Number(process.argv[3]) || 60
+const displayUs = Number(process.argv[4]) || 25000
+const ledUs = Number(process.argv[5]) || 3000
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+const ms = (ns) => (ns / 1e6).toFixed(2)
+
+// The controls of tick `t`: [name, ...args] calls.
+function updates(t) {
+    const state = t < ticks / 2 ? t : Math.floor(t / 30)
+    const colors = new Array(18).fill(constants.LSCAN_DISPLAY_COLOR_GRAY)
+    colors[5 + (state % 4)] = state % 2 ? constants.LSCAN_DISPLAY_COLOR_GREEN
+        : constants.LSCAN_DISPLAY_COLOR_RED
+    const calls = [
+        ["LSCAN_Controls_SetActiveLEDs", 1 << (Math.floor(t / 15) % 4)],
+        ["LSCAN_Controls_DisplayShowCaptureProgressScreen", constants.LSCAN_DISPLAY_CTRL_NONE,
+            constants.LSCAN_DISPLAY_CTRL_NONE, constants.LSCAN_DISPLAY_STAT_TOP_NONE,
+            constants.LSCAN_DISPLAY_STAT_BOTTOM_NONE, ...colors],
+    ]
+    if (t % uiHz === 0) calls.push(["LSCAN_Controls_Beeper", 1, 50])
+    return calls
+}
+
+async function run(handle, name, issue) {
+    const tickNs = []
+    const captureNs = []
+    const pending = []
+    let requests = 0
+    const start = lseBinding.now()
+    for (let t = 0; t < ticks; t++) {
+        const tickStart = lseBinding.now()
+        for (const [fn, ...args] of updates(t)) {
+            pending.push(issue(fn, args))
+            requests++
+        }
+        if (t % 5 === 0) {
+            const captureStart = lseBinding.now()
+            lseBinding.LSCAN_Capture_SetContrast(handle, 100 + (t % 50))
+            captureNs.push(lseBinding.now() - captureStart)
+        }
+        tickNs.push(lseBinding.now() - tickStart)
+        await sleep(1000 / uiHz)
+    }
+    const statuses = await Promise.all(pending)
+    const totalNs = lseBinding.now() - start
+    const failed = statuses.filter((status) => status !== constants.LSCAN_STATUS_OK).length
+    const mean = (values) => values.reduce((sum, value) => sum + value, 0) / values.length
+    return { name, requests, failed, totalNs, tickNs: mean(tickNs), maxTickNs: Math.max(...tickNs),
+        captureNs: mean(captureNs), maxCaptureNs: Math.max(...captureNs) }
+}
+
+function report(result, roundTrips, saved) {
+    console.log(`${result.name.padEnd(7)}  ${String(result.requests).padStart(8)}  ${String(roundTrips).padStart(11)}` +
+        `  ${String(saved).padStart(5)}  ${String(result.failed).padStart(6)}  ${ms(result.tickNs).padStart(7)}` +
+        `  ${ms(result.maxTickNs).padStart(11)}  ${ms(result.captureNs).padStart(10)}  ${ms(result.maxCaptureNs).padStart(14)}` +
+        `  ${ms(result.totalNs).padStart(8)}`)
+}
+
+async function main() {
+    lseBinding.stubSetDeviceCount(1)
+    const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+    lseBinding.stubSetLatency("LSCAN_Controls_DisplayShowCaptureProgressScreen", handle, displayUs)
+    lseBinding.stubSetLatency("LSCAN_Controls_SetActiveLEDs", handle, ledUs)
+    lseBinding.stubSetLatency("LSCAN_Controls_Beeper", handle, ledUs)
+    lseBinding.stubSetLatency("LSCAN_Capture_SetContrast", handle, 2000)
+    console.log(`${ticks} ticks at ${uiHz} Hz; display ${displayUs / 1000} ms, LEDs and beeper ${ledUs / 1000} ms,` +
+        " contrast 2 ms per call")
+    console.log("mode     requests  round trips  saved  failed  tick ms  max tick ms  capture ms  max capture ms  total ms")
+
+    const direct = await run(handle, "direct", (fn, args) => lseBinding[fn](handle, ...args))
+    report(direct, direct.requests, 0)
+
+    const queued = await run(handle, "queued", (fn, args) => lseBinding.queueControl(handle, fn, ...args))
+    const stats = lseBinding.controlsStats(handle)
+    report(queued, stats.calls, stats.saved)
+    console.log(`\nqueue: ${stats.coalesced} coalesced, ${stats.skipped} skipped, ${stats.yields} yields to capture calls` +
+        ` (${ms(stats.yieldNs)} ms), longest call ${ms(stats.maxCallNs)} ms`)
+
+    lseBinding.LSCAN_Main_Release(handle, false)
+}
+
+main()
@@ -0,0 +1,75 @@
+import lseBinding from "../lse-binding"
+import SessionManager from "../session-manager"
+
+// Load test against the stub library: many virtual devices capturing at once,
+// each streaming preview frames at a fixed rate during every capture. Reports
+// the preview rate reaching JS, frames lost on the way (the stub stamps a
+// sequence number into each frame), SDK-to-JS callback latency and capture
+// throughput:
+//   npm run bench:load [-- <devices> <fps> <durationMs> <previewMs>]
+const devices = Number(process.argv[2]) || 16
+const fps = Number(process.argv[3]) || 30
+const durationMs = Number(process.argv[4]) || 3000
+const previewMs = Number(process.argv[5]) || 250
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+function percentile(sorted, p) {
+    return sorted.length ? sorted[Math.min(sorted.length - 1, Math.floor((sorted.length * p) / 100))] : 0
+}
+
+async function captureLoop(device, end, counter) {
+    await device.call("LSCAN_Capture_SetMode", constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    while (lseBinding.now() < end) {
+        await device.call("LSCAN_Capture_Start", 4)
+        await sleep(previewMs)
+        if (await device.call("LSCAN_Capture_TakeResultImage") === constants.LSCAN_STATUS_OK) counter.captures++
+    }
+}
+
+async function main() {
+    // Attach the virtual devices like a hotplug would.
+    lseBinding.stubSetDeviceCount(devices)
+    lseBinding.stubSetPreview(constants.LSCAN_STUB_ALL_DEVICES, fps, 2)
+
+    const session = new SessionManager()
+    const opened = await session.open({ deviceIndices: Array.from({ length: devices }, (_, i) => i) })
+    const counter = { captures: 0, frames: 0, lost: 0, results: 0 }
+    const latencies = []
+    for (const device of opened) {
+        let last = -1
+        lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(device.handle, (handle, image, timestamp) => {
+            latencies.push(lseBinding.now() - timestamp)
+            const sequence = image.data.readUInt32LE(0)
+            if (sequence > last + 1) counter.lost += sequence - last - 1
+            last = sequence
+            counter.frames++
+        })
+        lseBinding.LSCAN_Capture_RegisterCallbackResultImage(device.handle, () => {
+            last = -1
+            counter.results++
+        })
+    }
+
+    const start = lseBinding.now()
+    await Promise.all(opened.map((device) => captureLoop(device, start + durationMs * 1e6, counter)))
+    const seconds = (lseBinding.now() - start) / 1e9
+    for (const device of opened) {
+        lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(device.handle, null)
+        lseBinding.LSCAN_Capture_RegisterCallbackResultImage(device.handle, null)
+    }
+    await session.close()
+
+    latencies.sort((a, b) => a - b)
+    const ms = (ns) => (ns / 1e6).toFixed(2)
+    console.log(`${devices} devices, ${fps} fps preview at half size, ${previewMs} ms per capture, ${seconds.toFixed(1)} s`)
+    console.log(`preview: ${(counter.frames / seconds / devices).toFixed(1)} fps per device reached JS, ` +
+        `${counter.lost} of ${counter.frames + counter.lost} frames lost`)
+    console.log(`callback latency ms: p50 ${ms(percentile(latencies, 50))}, p99 ${ms(percentile(latencies, 99))}, ` +
+        `max ${ms(latencies[latencies.length - 1] || 0)}`)
+    console.log(`captures: ${(counter.captures / seconds).toFixed(1)}/s, ${counter.results} result images`)
+}
+
+main()
@@ -0,0 +1,66 @@
+import path from "path"
+
+// The node-ffi binding that src/lse-binding.js used before the native addon,
+// kept as the baseline for call-overhead.js. ffi and ref are optional
+// dependencies (they do not build on current Node releases); the export is null
+// when they are missing.
+const lseLibraryLoc = process.env.LSE_LIBRARY || (process.platform === "win32"
+    ? path.join(__dirname, "../../resources/LScanEssentials-x86.dll")
+    : path.join(__dirname, "../../build/Release/LScanEssentials.so"))
+
+// 32-bit stdcall exports are decorated (_Name@ArgBytes); the Linux stub is not.
+function symbol(name, argBytes) {
+    return process.platform === "win32" && process.arch === "ia32" ? `_${name}@${argBytes}` : name
+}
+
+function loadFfiBinding() {
+    let ffi, ref
+    try {
+        ffi = require("ffi")
+        ref = require("ref")
+    } catch (e) {
+        return null
+    }
+
+    const int = ref.types.int
+    const intPtr = ref.refType(int)
+    const dword = ref.types.uint32
+
+    const library = ffi.Library(lseLibraryLoc, {
+        [symbol("LSCAN_Main_GetDeviceCount", 4)]: [int, [intPtr]],
+        [symbol("LSCAN_Main_Initialize", 12)]: [int, [int, int, intPtr]],
+        [symbol("LSCAN_Main_IsInitialized", 4)]: [int, [int]],
+        [symbol("LSCAN_Capture_GetContrast", 8)]: [int, [int, intPtr]],
+        [symbol("LSCAN_Controls_SetActiveLEDs", 8)]: [int, [int, dword]],
+    })
+
+    // Same calling convention as the native binding so the benchmark can drive
+    // both through identical code; each out-parameter costs a ref.alloc() per call.
+    return {
+        LSCAN_Main_GetDeviceCount() {
+            const outInt = ref.alloc("int")
+            const status = library[symbol("LSCAN_Main_GetDeviceCount", 4)](outInt)
+            return { status, deviceCount: outInt.deref() }
+        },
+        LSCAN_Main_Initialize(deviceIndex, reset) {
+            const outInt = ref.alloc("int")
+            const status = library[symbol("LSCAN_Main_Initialize", 12)](deviceIndex, reset ? 1 : 0, outInt)
+            return { status, handle: outInt.deref() }
+        },
+        LSCAN_Main_IsInitialized(handle) {
+            return library[symbol("LSCAN_Main_IsInitialized", 4)](handle)
+        },
+        LSCAN_Capture_GetContrast(handle) {
+            const outInt = ref.alloc("int")
+            const status = library[symbol("LSCAN_Capture_GetContrast", 8)](handle, outInt)
+            return { status, contrastValue: outInt.deref() }
+        },
+        LSCAN_Controls_SetActiveLEDs(handle, activeLEDs) {
+            return library[symbol("LSCAN_Controls_SetActiveLEDs", 8)](handle, activeLEDs)
+        },
+    }
+}
+
+const ffiBinding = loadFfiBinding()
+
+export default ffiBinding
@@ -0,0 +1,70 @@
+import { PerformanceObserver } from "perf_hooks"
+import lseBinding from "../lse-binding"
+
+// Frame memory over a long session: captures with a live preview, switching
+// between the four-finger and thumbs modes every `perMode` captures. Per mode
+// block, the handle's pool (native/frame_pool.h) reports how many captures
+// allocated no frame block, the blocks allocated, the peak resident set size
+// sampled during the captures and the garbage collections in between:
+//   npm run bench:framepool [-- <captures> <perMode> <previewFps>]
+const captures = Number(process.argv[2]) || 40
+const perMode = Number(process.argv[3]) || 10
+const previewFps = Number(process.argv[4]) || 50
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+let gcCount = 0
+let gcMs = 0
+new PerformanceObserver((list) => {
+    for (const entry of list.getEntries()) {
+        gcCount++
+        gcMs += entry.duration
+    }
+}).observe({ entryTypes: ["gc"] })
+
+async function main() {
+    lseBinding.stubSetDeviceCount(1)
+    const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+    lseBinding.stubSetPreview(handle, previewFps, 2)
+    let resultImage = null
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, () => {})
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, () => resultImage())
+    const modes = [["four fingers", constants.LSCAN_FLAT_FOUR_FINGERS], ["thumbs", constants.LSCAN_FLAT_THUMBS]]
+    console.log(`${captures} captures, ${perMode} per mode, ${previewFps} fps preview`)
+    console.log("block  mode          preallocated MB  steady  allocations  frames/capture  peak RSS MB  GCs  GC ms")
+    for (let block = 0; block * perMode < captures; block++) {
+        const [name, type] = modes[block % modes.length]
+        lseBinding.LSCAN_Capture_SetMode(handle, type, constants.LSCAN_RES_500, constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+        const before = lseBinding.framePoolStats(handle)
+        gcCount = 0
+        gcMs = 0
+        let frames = 0
+        let peakRss = 0
+        for (let i = 0; i < perMode; i++) {
+            const done = new Promise((resolve) => {
+                resultImage = resolve
+            })
+            lseBinding.LSCAN_Capture_Start(handle, 4)
+            await sleep(100)
+            lseBinding.LSCAN_Capture_TakeResultImage(handle)
+            await done
+            lseBinding.LSCAN_Capture_Abort(handle)
+            const { lastCapture } = lseBinding.framePoolStats(handle)
+            frames += lastCapture.frames
+            peakRss = Math.max(peakRss, lastCapture.peakRss)
+        }
+        const after = lseBinding.framePoolStats(handle)
+        console.log(`${String(block + 1).padStart(5)}  ${name.padEnd(12)}  ${(before.reservedBytes / 1e6).toFixed(1).padStart(15)}` +
+            `  ${`${after.steadyCaptures - before.steadyCaptures}/${perMode}`.padStart(6)}` +
+            `  ${String(after.allocations - before.allocations).padStart(11)}  ${(frames / perMode).toFixed(1).padStart(14)}` +
+            `  ${(peakRss / 1e6).toFixed(1).padStart(11)}  ${String(gcCount).padStart(3)}  ${gcMs.toFixed(1).padStart(5)}`)
+    }
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, null)
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, null)
+    lseBinding.LSCAN_Main_Release(handle, false)
+    const { pooledBytes } = lseBinding.framePoolStats(handle)
+    console.log(`after LSCAN_Main_Release: ${(pooledBytes / 1e6).toFixed(1)} MB pooled`)
+}
+
+main()
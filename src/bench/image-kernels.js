@@ -0,0 +1,102 @@
+import crypto from "crypto"
+import lseBinding from "../lse-binding"
+
+// Image transform kernels on synthetic 1600x1500 (500 ppi four-finger slap) and
+// 3200x3000 (1000 ppi) frames: a per-pixel JS loop versus the native scalar,
+// SSE4.1 and AVX2 variants. Levels the CPU lacks are skipped.
+//   npm run bench:kernels [-- <iterations>]
+const iterations = Number(process.argv[2]) || 20
+const sizes = [[1600, 1500], [3200, 3000]]
+const levels = ["scalar", "sse4.1", "avx2"]
+
+// Naive JS versions of the same transforms, i.e. what callers wrote before.
+const js = {
+    flip(image) {
+        const { width, height, data } = image
+        for (let y = 0; y < height >> 1; y++) {
+            const a = y * width
+            const b = (height - 1 - y) * width
+            for (let x = 0; x < width; x++) {
+                const t = data[a + x]
+                data[a + x] = data[b + x]
+                data[b + x] = t
+            }
+        }
+    },
+    crop(image) {
+        const { width, height, data } = image
+        const outWidth = width >> 1
+        const out = Buffer.allocUnsafe(outWidth * (height >> 1))
+        for (let y = 0; y < height >> 1; y++) {
+            const row = (y + (height >> 2)) * width + (width >> 2)
+            for (let x = 0; x < outWidth; x++) out[y * outWidth + x] = data[row + x]
+        }
+        return out
+    },
+    downscale(image, factor) {
+        const { width, height, data } = image
+        const outWidth = Math.floor(width / factor)
+        const outHeight = Math.floor(height / factor)
+        const out = Buffer.allocUnsafe(outWidth * outHeight)
+        const area = factor * factor
+        for (let oy = 0; oy < outHeight; oy++) {
+            for (let ox = 0; ox < outWidth; ox++) {
+                let sum = 0
+                for (let dy = 0; dy < factor; dy++) {
+                    const row = (oy * factor + dy) * width + ox * factor
+                    for (let dx = 0; dx < factor; dx++) sum += data[row + dx]
+                }
+                out[oy * outWidth + ox] = Math.floor((sum + area / 2) / area)
+            }
+        }
+        return out
+    },
+    stats(image) {
+        const histogram = new Uint32Array(256)
+        for (const value of image.data) histogram[value]++
+        return histogram
+    },
+}
+
+const kernels = [
+    ["flip", (image) => lseBinding.flipImage(image), js.flip],
+    ["crop 1/2", (image) => lseBinding.cropImage(image, {
+        x: image.width >> 2, y: image.height >> 2, width: image.width >> 1, height: image.height >> 1,
+    }), js.crop],
+    ["downscale 2:1", (image) => lseBinding.downscaleImage(image, 2), (image) => js.downscale(image, 2)],
+    ["downscale 4:1", (image) => lseBinding.downscaleImage(image, 4), (image) => js.downscale(image, 4)],
+    ["histogram+stats", (image) => lseBinding.imageStatistics(image), js.stats],
+]
+
+// Median milliseconds per call.
+function time(body, image) {
+    const samples = []
+    for (let i = 0; i < iterations; i++) {
+        const start = lseBinding.now()
+        body(image)
+        samples.push((lseBinding.now() - start) / 1e6)
+    }
+    samples.sort((a, b) => a - b)
+    return samples[samples.length >> 1]
+}
+
+const { detected } = lseBinding.simdLevel()
+const available = levels.slice(0, levels.indexOf(detected) + 1)
+console.log(`median ms per call over ${iterations} iterations; CPU supports ${detected}`)
+for (const [width, height] of sizes) {
+    const image = { width, height, resolution: 500, bitsPerPixel: 8, data: crypto.randomBytes(width * height) }
+    const megabytes = (width * height) / 1e6
+    console.log(`\n${width}x${height}`.padEnd(18), "js".padStart(9), ...available.map((l) => l.padStart(9)),
+        "best MB/s".padStart(10), "vs js".padStart(8))
+    for (const [name, native, naive] of kernels) {
+        const jsMs = time(naive, image)
+        const nativeMs = available.map((level) => {
+            lseBinding.setSimdLevel(level)
+            return time(native, image)
+        })
+        const best = Math.min(...nativeMs)
+        console.log(name.padEnd(17), jsMs.toFixed(3).padStart(9), ...nativeMs.map((ms) => ms.toFixed(3).padStart(9)),
+            (megabytes / (best / 1000)).toFixed(0).padStart(10), ((jsMs / best).toFixed(1) + "x").padStart(8))
+    }
+}
+lseBinding.setSimdLevel(detected)
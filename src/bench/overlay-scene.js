@@ -0,0 +1,120 @@
+import lseBinding from "../lse-binding"
+import OverlayScene from "../overlay-scene"
+
+// Overlay update cost per preview frame: redrawing every overlay, modifying
+// every overlay, and committing an OverlayScene that issues only the calls
+// that differ. Each frame moves a few finger boxes and changes one text; every
+// tenth frame one box disappears or comes back. The stub delays every
+// visualization call by `callUs` to stand in for the SDK's repaint. Run
+// against the stub library:
+//   npm run bench:overlays [-- <frames> <boxes> <callUs>]
+const frames = Number(process.argv[2]) || 300
+const boxes = Number(process.argv[3]) || 16
+const callUs = process.argv[4] !== undefined ? Number(process.argv[4]) : 50
+
+const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+lseBinding.stubSetLatency("", handle, callUs)
+
+// The overlay set of frame `f`: `boxes` quadrangles, a text per four boxes and
+// a guide line per box row; boxes f % boxes .. +3 move every frame.
+function frameOverlays(f) {
+    const overlays = []
+    for (let b = 0; b < boxes; b++) {
+        if (b === boxes - 1 && Math.floor(f / 10) % 2 === 1) continue
+        const moving = (b - f % boxes + boxes) % boxes < 4
+        const x = 20 + (b % 4) * 200 + (moving ? f % 7 : 0)
+        const y = 20 + Math.floor(b / 4) * 150
+        overlays.push({ key: `box${b}`, type: "quadrangle", points: [x, y, x + 150, y, x + 150, y + 120, x, y + 120],
+            color: 0x00ff00, lineWidth: 2, belongsToImage: true })
+    }
+    for (let t = 0; t < boxes / 4; t++) {
+        overlays.push({ key: `label${t}`, type: "text", text: t === 0 ? `quality ${f % 5}` : `row ${t}`, x: 10,
+            y: 150 * t + 5, color: 0xffffff })
+        overlays.push({ key: `guide${t}`, type: "line", points: [0, 150 * t + 145, 800, 150 * t + 145],
+            color: 0x808080 })
+    }
+    return overlays
+}
+
+function addOverlay(overlay) {
+    const [x1, y1, x2, y2, x3, y3, x4, y4] = overlay.points || []
+    switch (overlay.type) {
+        case "text":
+            return lseBinding.LSCAN_Visualization_AddOverlayText(handle, overlay.text, overlay.x, overlay.y,
+                overlay.color, "Arial", 12, false).overlayHandle
+        case "quadrangle":
+            return lseBinding.LSCAN_Visualization_AddOverlayQuadrangle(handle, x1, y1, x2, y2, x3, y3, x4, y4,
+                overlay.color, overlay.lineWidth, true).overlayHandle
+        default:
+            return lseBinding.LSCAN_Visualization_AddOverlayLine(handle, x1, y1, x2, y2, overlay.color, 1, false)
+                .overlayHandle
+    }
+}
+
+// Clear and add everything, as a renderer without retained state would.
+function redraw() {
+    let calls = 0
+    for (let f = 0; f < frames; f++) {
+        lseBinding.LSCAN_Visualization_RemoveAllOverlays(handle)
+        for (const overlay of frameOverlays(f)) addOverlay(overlay)
+        calls += 1 + frameOverlays(f).length
+    }
+    return calls
+}
+
+// Keep one SDK overlay per key and modify all of them every frame.
+function modifyAll() {
+    const handles = new Map()
+    let calls = 0
+    for (let f = 0; f < frames; f++) {
+        const overlays = frameOverlays(f)
+        const present = new Set()
+        for (const overlay of overlays) {
+            present.add(overlay.key)
+            const [x1, y1, x2, y2, x3, y3, x4, y4] = overlay.points || []
+            let overlayHandle = handles.get(overlay.key)
+            if (overlayHandle === undefined) {
+                handles.set(overlay.key, addOverlay(overlay))
+            } else if (overlay.type === "text") {
+                lseBinding.LSCAN_Visualization_ModifyOverlayText(handle, overlayHandle, overlay.text, overlay.x, overlay.y)
+            } else if (overlay.type === "quadrangle") {
+                lseBinding.LSCAN_Visualization_ModifyOverlayQuadrangle(handle, overlayHandle, x1, y1, x2, y2, x3, y3, x4,
+                    y4)
+            } else {
+                lseBinding.LSCAN_Visualization_ModifyOverlayLine(handle, overlayHandle, x1, y1, x2, y2)
+            }
+            calls++
+        }
+        for (const [key, overlayHandle] of handles) {
+            if (!present.has(key)) {
+                lseBinding.LSCAN_Visualization_RemoveOverlay(handle, overlayHandle)
+                handles.delete(key)
+                calls++
+            }
+        }
+    }
+    lseBinding.LSCAN_Visualization_RemoveAllOverlays(handle)
+    return calls
+}
+
+function scene() {
+    const overlayScene = new OverlayScene(handle)
+    for (let f = 0; f < frames; f++) overlayScene.commit(frameOverlays(f))
+    const { calls } = overlayScene.stats()
+    overlayScene.reset()
+    return calls
+}
+
+function measure(name, body) {
+    const start = lseBinding.now()
+    const calls = body()
+    const us = (lseBinding.now() - start) / 1e3 / frames
+    console.log(name.padEnd(14), (calls / frames).toFixed(1).padStart(12), us.toFixed(0).padStart(12))
+}
+
+console.log(`${frames} frames, ${frameOverlays(0).length} overlays, ${callUs} us per SDK call`)
+console.log("per frame".padEnd(14), "SDK calls".padStart(12), "us".padStart(12))
+measure("redraw", redraw)
+measure("modify all", modifyAll)
+measure("scene", scene)
+lseBinding.LSCAN_Main_Release(handle, false)
@@ -0,0 +1,128 @@
+import os from "os"
+import zlib from "zlib"
+import lseBinding from "../lse-binding"
+
+// PNG encoding throughput, in MB of raw pixels per second per core, of the
+// native encoder versus the JS route (filter loop + zlib.deflateSync), on a
+// synthetic 1600x1500 fingerprint-like frame. The last rows run captures with
+// result-image encoding on, to show encoding overlapping the next capture:
+//   npm run bench:png [-- <iterations>]
+const iterations = Number(process.argv[2]) || 10
+const { constants } = lseBinding
+const width = 1600
+const height = 1500
+
+// Four slanted ridge patterns with sensor noise on a white platen.
+function syntheticSlap() {
+    const data = Buffer.alloc(width * height, 255)
+    let seed = 1
+    const noise = () => {
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff
+        return (seed >> 16) % 17 - 8
+    }
+    for (let finger = 0; finger < 4; finger++) {
+        const cx = 250 + finger * 370
+        const cy = 650 + (finger === 0 || finger === 3 ? 150 : 0)
+        const angle = 0.3 + finger * 0.25
+        for (let y = 0; y < height; y++) {
+            for (let x = 0; x < width; x++) {
+                const dx = (x - cx) / 150
+                const dy = (y - cy) / 420
+                if (dx * dx + dy * dy > 1) continue
+                const phase = (x * Math.cos(angle) + y * Math.sin(angle)) / 4.5
+                data[y * width + x] = Math.max(0, Math.min(255, 120 + Math.round(90 * Math.sin(phase)) + noise()))
+            }
+        }
+    }
+    return { width, height, resolution: 500, bitsPerPixel: 8, data }
+}
+
+function jsPng(image, level) {
+    const { data } = image
+    const filtered = Buffer.allocUnsafe((width + 1) * height)
+    for (let y = 0; y < height; y++) {
+        const out = y * (width + 1)
+        filtered[out] = 2  // Up
+        for (let x = 0; x < width; x++) {
+            filtered[out + 1 + x] = (data[y * width + x] - (y > 0 ? data[(y - 1) * width + x] : 0)) & 0xff
+        }
+    }
+    return zlib.deflateSync(filtered, { level, strategy: zlib.constants.Z_FILTERED })
+}
+
+const megabytes = (width * height) / 1e6
+
+function row(name, seconds, bytes, extra = "") {
+    console.log(name.padEnd(30), (megabytes / seconds).toFixed(1).padStart(10),
+        ((width * height) / bytes).toFixed(2).padStart(8), extra)
+}
+
+async function native(image, level, filter) {
+    let bytes = 0
+    const start = lseBinding.now()
+    for (let i = 0; i < iterations; i++) bytes = (await lseBinding.encodePng(image, { level, filter })).length
+    return [(lseBinding.now() - start) / 1e9 / iterations, bytes]
+}
+
+async function captures(encode) {
+    const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+    lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    lseBinding.setResultImageEncoding(handle, encode ? { level: 6 } : null)
+    const files = []
+    let resultImage = null
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, (_, image) => {
+        if (image.encoded) files.push(image.encoded)
+        resultImage()
+    })
+    const start = lseBinding.now()
+    for (let i = 0; i < iterations * 2; i++) {
+        const done = new Promise((resolve) => {
+            resultImage = resolve
+        })
+        lseBinding.LSCAN_Capture_Start(handle, 4)
+        lseBinding.LSCAN_Capture_TakeResultImage(handle)
+        await done
+    }
+    await Promise.all(files)
+    const seconds = (lseBinding.now() - start) / 1e9
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, null)
+    lseBinding.setResultImageEncoding(handle, null)
+    lseBinding.LSCAN_Main_Release(handle, false)
+    return (iterations * 2) / seconds
+}
+
+async function main() {
+    const image = syntheticSlap()
+    console.log(`${width}x${height}, ${iterations} iterations, ${os.cpus().length} cores`)
+    console.log("encoder".padEnd(30), "MB/s/core".padStart(10), "ratio".padStart(8))
+    for (const level of [1, 6]) {
+        const start = lseBinding.now()
+        let bytes = 0
+        for (let i = 0; i < iterations; i++) bytes = jsPng(image, level).length
+        row(`js filter + deflateSync, ${level}`, (lseBinding.now() - start) / 1e9 / iterations, bytes)
+    }
+    for (const [level, filter] of [[1, "none"], [1, "up"], [1, "paeth"], [3, "up"], [6, "up"], [9, "up"]]) {
+        const [seconds, bytes] = await native(image, level, filter)
+        row(`native ${filter}, ${level}`, seconds, bytes)
+    }
+
+    // Concurrent encodes spread over the worker pool.
+    const parallel = Math.min(16, os.cpus().length * 2)
+    const start = lseBinding.now()
+    const results = await Promise.all(Array.from({ length: parallel * iterations },
+        () => lseBinding.encodePng(image, { level: 1 })))
+    const seconds = (lseBinding.now() - start) / 1e9
+    console.log(`native up, 1, ${parallel} at a time`.padEnd(30),
+        ((megabytes * results.length) / seconds / os.cpus().length).toFixed(1).padStart(10),
+        ((width * height) / results[0].length).toFixed(2).padStart(8),
+        `${((megabytes * results.length) / seconds).toFixed(1)} MB/s total`)
+
+    const plain = await captures(false)
+    const encoded = await captures(true)
+    console.log(`\ncaptures/s (stub, ${process.env.LSCAN_STUB_ACQUIRE_MS || 0} ms acquisition): ` +
+        `${plain.toFixed(1)} without encoding, ${encoded.toFixed(1)} with PNG level 6 encoding`)
+    console.log("encoder stats", lseBinding.encoderStats())
+}
+
+main()
@@ -0,0 +1,188 @@
+import { fork } from "child_process"
+import http from "http"
+import lseBinding from "../lse-binding"
+import PreviewBroadcast from "../preview-broadcast"
+
+// Load test of the preview broadcast: one stub device streams preview at 30 fps
+// into a PreviewBroadcast, and hundreds of local viewers, half MJPEG and half
+// WebSocket, subscribe to it from a separate client process. A share of them
+// read slowly, like viewers on a congested link. Reports the frames encoded
+// (once per frame, whatever the viewer count), the server's CPU time per
+// viewer, the frame rate fast viewers get and what slow viewers drop:
+//   npm run bench:broadcast [-- <viewers,...> <durationMs> <width> <height> <slowShare> <maxKBPerSecond>]
+// With maxKBPerSecond the encoder lowers the JPEG quality (down to 30) to keep
+// the stream within that budget.
+const viewerCounts = (process.argv[2] || "50,200,500").split(",").map(Number)
+const durationMs = Number(process.argv[3]) || 3000
+const width = Number(process.argv[4]) || 640
+const height = Number(process.argv[5]) || 480
+const slowShare = process.argv[6] !== undefined ? Number(process.argv[6]) : 0.1
+const maxBytesPerSecond = (Number(process.argv[7]) || 0) * 1024
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+const median = (values) => (values.length ? values.slice().sort((a, b) => a - b)[values.length >> 1] : 0)
+
+// --- Client process -------------------------------------------------------
+
+// Counts multipart parts from their Content-Length headers.
+function mjpegViewer(url, viewer, slow) {
+    http.get(url, (res) => {
+        let input = Buffer.alloc(0)
+        let need = -1
+        res.on("data", (chunk) => {
+            input = input.length ? Buffer.concat([input, chunk]) : chunk
+            for (;;) {
+                if (need < 0) {
+                    const end = input.indexOf("\r\n\r\n")
+                    if (end < 0) break
+                    need = Number(/Content-Length: (\d+)/.exec(input.toString("latin1", 0, end))[1]) + 2
+                    input = input.subarray(end + 4)
+                }
+                if (input.length < need) break
+                if (input[0] === 0xff && input[1] === 0xd8) viewer.frames++
+                input = input.subarray(need)
+                need = -1
+            }
+            throttle(res, slow)
+        })
+    })
+}
+
+// Counts binary messages; server frames are unmasked.
+function websocketViewer(url, viewer, slow) {
+    const key = Buffer.from(String(Math.random())).toString("base64")
+    const req = http.request(url, { headers: { Connection: "Upgrade", Upgrade: "websocket",
+        "Sec-WebSocket-Key": key, "Sec-WebSocket-Version": "13" } })
+    req.on("upgrade", (res, socket, head) => {
+        let input = head
+        socket.on("data", (chunk) => {
+            input = input.length ? Buffer.concat([input, chunk]) : chunk
+            for (;;) {
+                if (input.length < 2) break
+                let length = input[1] & 0x7f
+                let offset = 2
+                if (length === 126) {
+                    if (input.length < 4) break
+                    length = input.readUInt16BE(2)
+                    offset = 4
+                } else if (length === 127) {
+                    if (input.length < 10) break
+                    length = Number(input.readBigUInt64BE(2))
+                    offset = 10
+                }
+                if (input.length < offset + length) break
+                if (input[offset] === 0xff && input[offset + 1] === 0xd8) viewer.frames++
+                input = input.subarray(offset + length)
+            }
+            throttle(socket, slow)
+        })
+    })
+    req.end()
+}
+
+// A slow viewer takes a chunk, then nothing for a while.
+function throttle(stream, slow) {
+    if (!slow) return
+    stream.pause()
+    setTimeout(() => stream.resume(), 250)
+}
+
+async function clients([url, count, slowCount, ms]) {
+    const viewers = []
+    for (let i = 0; i < Number(count); i++) {
+        const viewer = { kind: i % 2 ? "websocket" : "mjpeg", slow: i < Number(slowCount), frames: 0 }
+        viewers.push(viewer)
+        ;(viewer.kind === "mjpeg" ? mjpegViewer : websocketViewer)(url, viewer, viewer.slow)
+    }
+    process.send({ ready: true })
+    await new Promise((resolve) => process.once("message", resolve))
+    for (const viewer of viewers) viewer.frames = 0
+    await sleep(Number(ms))
+    process.send({ viewers })
+    process.exit(0)
+}
+
+// --- Server process -------------------------------------------------------
+
+function message(child) {
+    return new Promise((resolve) => child.once("message", resolve))
+}
+
+async function run(viewerCount) {
+    lseBinding.stubSetPreview(constants.LSCAN_STUB_ALL_DEVICES, 30, 2)
+    const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+    lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    const broadcast = new PreviewBroadcast(handle, { width, height, quality: 75, minQuality: 30,
+        maxBytesPerSecond })
+    broadcast.setOverlays([{ key: "hint", type: "text", text: "Place four fingers", x: 8, y: 8, fontSize: 16 }])
+    const server = await broadcast.listen(0, "127.0.0.1")
+    const url = `http://127.0.0.1:${server.address().port}/preview`
+    lseBinding.LSCAN_Capture_Start(handle, 4)
+
+    const slowCount = Math.round(viewerCount * slowShare)
+    const child = fork(process.argv[1], ["--clients", url, viewerCount, slowCount, durationMs])
+    await message(child)
+    while (broadcast.stats().subscribers < viewerCount) await sleep(20)
+    await sleep(200)
+
+    const before = broadcast.stats()
+    const cpuBefore = process.cpuUsage()
+    const start = lseBinding.now()
+    child.send({ go: true })
+    const { viewers } = await message(child)
+    const elapsedMs = (lseBinding.now() - start) / 1e6
+    const cpu = process.cpuUsage(cpuBefore)
+    const after = broadcast.stats()
+
+    lseBinding.LSCAN_Capture_Abort(handle)
+    broadcast.close()
+    lseBinding.LSCAN_Main_Release(handle, false)
+    await sleep(50)
+
+    const seconds = durationMs / 1000
+    const frames = after.frames - before.frames
+    const fps = (list) => list.map((v) => v.frames / seconds)
+    const fast = fps(viewers.filter((v) => !v.slow))
+    const slow = fps(viewers.filter((v) => v.slow))
+    const encodeMs = after.compositor.encodeMean / 1e6
+    return {
+        viewerCount,
+        slowCount,
+        encodedFps: (frames / elapsedMs) * 1000,
+        encodeMs,
+        quality: after.compositor.quality,
+        kbPerFrame: frames ? (after.bytes - before.bytes) / frames / 1024 : 0,
+        fastFps: median(fast),
+        fastMinFps: fast.length ? Math.min(...fast) : 0,
+        slowFps: median(slow),
+        dropped: after.dropped - before.dropped,
+        cpuPercent: ((cpu.user + cpu.system) / 1000 / elapsedMs) * 100,
+        // What encoding per viewer would cost: one encode per frame per viewer.
+        perViewerEncodePercent: ((frames * viewerCount * encodeMs) / elapsedMs) * 100,
+    }
+}
+
+async function main() {
+    lseBinding.stubSetDeviceCount(1)
+    const budget = maxBytesPerSecond ? `, budget ${maxBytesPerSecond / 1024} KB/s` : ""
+    console.log(`${width}x${height} gray JPEG, 30 fps preview, ${durationMs} ms per run, ${slowShare * 100}% slow` +
+        ` viewers${budget}`)
+    console.log("viewers  slow  encoded fps  encode ms  q   KB/frame  fast fps (median/min)  slow fps  dropped" +
+        "  server CPU %  per-viewer encoding CPU %")
+    for (const viewerCount of viewerCounts) {
+        const r = await run(viewerCount)
+        console.log(`${String(r.viewerCount).padStart(7)}  ${String(r.slowCount).padStart(4)}` +
+            `  ${r.encodedFps.toFixed(1).padStart(11)}  ${r.encodeMs.toFixed(2).padStart(9)}  ${String(r.quality).padEnd(2)}` +
+            `  ${r.kbPerFrame.toFixed(1).padStart(8)}  ${r.fastFps.toFixed(1).padStart(10)} / ${r.fastMinFps.toFixed(1).padEnd(9)}` +
+            `  ${r.slowFps.toFixed(1).padStart(8)}  ${String(r.dropped).padStart(7)}  ${r.cpuPercent.toFixed(0).padStart(12)}` +
+            `  ${r.perViewerEncodePercent.toFixed(0).padStart(25)}`)
+    }
+}
+
+if (process.argv[2] === "--clients") {
+    clients(process.argv.slice(3))
+} else {
+    main()
+}
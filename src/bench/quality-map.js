@@ -0,0 +1,137 @@
+import os from "os"
+import lseBinding from "../lse-binding"
+import QualityMap from "../quality-map"
+
+// Block quality map (native/quality_map.h):
+//   1. analysis time of a synthetic four-finger slap at preview (800x750) and
+//      full (1600x1500) size per kernel level and thread count, against the
+//      33.3 ms a 30 fps preview leaves per frame;
+//   2. live captures from a stub device whose fingers settle over
+//      LSCAN_STUB_SETTLE_FRAMES preview frames (set by the npm script): the
+//      quality trigger against taking the result image a fixed time after the
+//      start, retaking while the captured frame is below the threshold.
+//   npm run bench:quality [-- <iterations> <captures> <fixedMs,...>]
+const iterations = Number(process.argv[2]) || 20
+const captures = Number(process.argv[3]) || 5
+const fixedDelays = (process.argv[4] || "400,1200").split(",").map(Number)
+const threshold = 0.6
+const maxAttempts = 4
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+// Four slanted ridge patterns in finger-shaped areas, with noise growing from
+// the index to the little finger.
+function slap(width, height) {
+    const data = Buffer.alloc(width * height, 255)
+    const period = width / 180
+    let seed = 1
+    for (let finger = 0; finger < 4; finger++) {
+        const cx = ((finger + 0.5) * width) / 4
+        const cy = height * (finger === 0 || finger === 3 ? 0.55 : 0.45)
+        const rx = width * 0.095
+        const ry = height * 0.38
+        const angle = 0.3 + 0.25 * finger
+        const kx = (Math.cos(angle) * 2 * Math.PI) / period
+        const ky = (Math.sin(angle) * 2 * Math.PI) / period
+        const spread = 8 + finger * 16
+        for (let y = Math.floor(cy - ry); y <= cy + ry; y++) {
+            for (let x = Math.floor(cx - rx); x <= cx + rx; x++) {
+                if (((x - cx) / rx) ** 2 + ((y - cy) / ry) ** 2 > 1) continue
+                seed = (seed * 1103515245 + 12345) >>> 0
+                const noise = ((seed >>> 16) % (2 * spread + 1)) - spread
+                const value = 120 + Math.round(90 * Math.sin(x * kx + y * ky)) + noise
+                data[y * width + x] = Math.max(0, Math.min(255, value))
+            }
+        }
+    }
+    return { width, height, data }
+}
+
+function analysisTable() {
+    const cores = os.cpus().length
+    const threadCounts = [...new Set([1, 2, 4, cores])].sort((a, b) => a - b)
+    const detected = lseBinding.simdLevel().detected
+    const levels = ["scalar", "sse4.1", "avx2"].slice(0, ["scalar", "sse4.1", "avx2"].indexOf(detected) + 1)
+    console.log(`analysis, ${cores} hardware threads, mean of ${iterations}`)
+    console.log("size        level    threads  ms/frame  frames/s  budget share  objects  quality")
+    for (const [width, height] of [[800, 750], [1600, 1500]]) {
+        const image = slap(width, height)
+        for (const level of levels) {
+            lseBinding.setSimdLevel(level)
+            for (const threads of threadCounts) {
+                let result = lseBinding.analyzeQuality(image, { threads, objects: 4 })
+                let ns = 0
+                for (let i = 0; i < iterations; i++) {
+                    result = lseBinding.analyzeQuality(image, { threads, objects: 4 })
+                    ns += result.analyzeNs
+                }
+                const ms = ns / iterations / 1e6
+                console.log(`${`${width}x${height}`.padEnd(10)}  ${level.padEnd(7)}  ${String(threads).padStart(7)}` +
+                    `  ${ms.toFixed(2).padStart(8)}  ${(1000 / ms).toFixed(0).padStart(8)}` +
+                    `  ${((ms / 33.3) * 100).toFixed(1).padStart(11)}%  ${String(result.objects.length).padStart(7)}` +
+                    `  ${result.objects.map((o) => o.quality.toFixed(2)).join(" ")}`)
+            }
+        }
+    }
+    lseBinding.setSimdLevel(detected)
+}
+
+// One capture: start, take the result image on the trigger or after `fixedMs`,
+// retake while the quality of the last analyzed frame is below the threshold.
+async function capture(handle, map, fixedMs) {
+    const start = lseBinding.now()
+    for (let attempt = 1; ; attempt++) {
+        map.lastFrame = null
+        let triggered = null
+        map.onTrigger = fixedMs ? null : (frame) => triggered(frame)
+        const taken = fixedMs ? null : new Promise((resolve) => { triggered = resolve })
+        lseBinding.LSCAN_Capture_Start(handle, 4)
+        map.rearm()
+        let frame
+        if (fixedMs) {
+            await sleep(fixedMs)
+            lseBinding.LSCAN_Capture_TakeResultImage(handle)
+            frame = map.lastFrame
+        } else {
+            frame = await taken
+        }
+        const quality = frame ? frame.quality : 0
+        await sleep(20)
+        lseBinding.LSCAN_Capture_Abort(handle)
+        if (quality >= threshold || attempt === maxAttempts) {
+            return { ms: (lseBinding.now() - start) / 1e6, attempts: attempt, quality }
+        }
+    }
+}
+
+async function liveTable() {
+    lseBinding.stubSetDeviceCount(1)
+    lseBinding.stubSetPreview(constants.LSCAN_STUB_ALL_DEVICES, 30, 2)
+    const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+    lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    console.log(`\nlive, 30 fps preview, fingers settle over ${process.env.LSCAN_STUB_SETTLE_FRAMES || 0} frames,` +
+        ` threshold ${threshold}, ${captures} captures each`)
+    console.log("policy        ms to good image  retakes  captured quality  analyze ms (mean/max)  over budget")
+    const policies = [["trigger", 0], ...fixedDelays.map((ms) => [`fixed ${ms} ms`, ms])]
+    for (const [name, fixedMs] of policies) {
+        const map = new QualityMap(handle, { objects: 4, threshold, autoCapture: !fixedMs })
+        const results = []
+        for (let i = 0; i < captures; i++) results.push(await capture(handle, map, fixedMs))
+        const stats = map.stats()
+        map.close()
+        const mean = (key) => results.reduce((sum, r) => sum + r[key], 0) / results.length
+        console.log(`${name.padEnd(12)}  ${mean("ms").toFixed(0).padStart(16)}` +
+            `  ${(mean("attempts") - 1).toFixed(1).padStart(7)}  ${mean("quality").toFixed(2).padStart(16)}  ${(stats.analyzeMean / 1e6).toFixed(2).padStart(10)} /` +
+            ` ${(stats.analyzeMax / 1e6).toFixed(2).padEnd(9)}  ${String(stats.overBudget).padStart(11)}`)
+    }
+    lseBinding.LSCAN_Main_Release(handle, false)
+}
+
+async function main() {
+    analysisTable()
+    await liveTable()
+}
+
+main()
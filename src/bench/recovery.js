@@ -0,0 +1,95 @@
+import lseBinding from "../lse-binding"
+import SessionManager from "../session-manager"
+import ResilientDevice from "../resilient-device"
+
+// Time-to-recover of a ResilientDevice (src/resilient-device.js) after stub
+// communication breaks, with the LSCAN_STUB_*_MS latencies of the npm script:
+//   1. a break with the device staying on the bus (stubDisconnect), and
+//      unplugs of growing length (stubUnplug), where the device count callback
+//      tells when to retry; each recovery is checked against the state applied
+//      before the break;
+//   2. the replay batched into the recovery task against the same calls made
+//      one round trip at a time.
+//   npm run bench:recovery [-- <breaks> <unplugMs,...>]
+const breaks = Number(process.argv[2]) || 5
+const unplugs = (process.argv[3] || "200,1000").split(",").map(Number)
+const { constants } = lseBinding
+
+let noticed = null
+
+const ms = (ns) => (ns / 1e6).toFixed(1)
+const mean = (values) => values.reduce((sum, value) => sum + value, 0) / values.length
+
+const state = [
+    ["LSCAN_Capture_SetMode", constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0],
+    ["LSCAN_Capture_SetActiveArea", 0, 0, 1200, 1000],
+    ["LSCAN_Capture_SetContrast", 150],
+    ["LSCAN_Controls_SetActiveLEDs", 3],
+]
+const overlays = [
+    { key: "frame", type: "quadrangle", points: [10, 10, 790, 10, 790, 740, 10, 740], color: 0x00ff00 },
+    { key: "hint", type: "text", text: "Place four fingers", x: 20, y: 20 },
+]
+
+function verify(handle) {
+    const contrast = lseBinding.LSCAN_Capture_GetContrast(handle)
+    const leds = lseBinding.LSCAN_Controls_GetActiveLEDs(handle)
+    return contrast.contrastValue === 150 && leds.activeLEDs === 3
+}
+
+async function scenario(device, name, fault) {
+    const recoveries = []
+    let verified = 0
+    for (let i = 0; i < breaks; i++) {
+        const broken = new Promise((resolve) => {
+            noticed = resolve
+        })
+        fault()
+        await broken
+        const recovery = await device.ready()
+        if (recovery) recoveries.push(recovery)
+        if (verify(device.handle)) verified++
+    }
+    const pick = (key) => recoveries.map((r) => r[key])
+    console.log(`${name.padEnd(16)}  ${ms(mean(pick("totalNs"))).padStart(9)}` +
+        `  ${ms(Math.max(...pick("totalNs"))).padStart(7)}  ${ms(mean(pick("waitNs"))).padStart(7)}  ${ms(mean(pick("initializeNs"))).padStart(7)}` +
+        `  ${ms(mean(pick("restoreNs"))).padStart(8)}  ${ms(mean(pick("replayNs"))).padStart(7)}` +
+        `  ${ms(mean(pick("overlayNs"))).padStart(8)}  ${mean(pick("attempts")).toFixed(1).padStart(8)}` +
+        `  ${verified}/${breaks}`)
+}
+
+async function main() {
+    lseBinding.stubSetDeviceCount(1)
+    const session = new SessionManager()
+    const [opened] = await session.open()
+    const device = new ResilientDevice(opened, { retryMs: 100, maxRetryMs: 1000, onBreak: () => noticed() })
+    for (const [name, ...args] of state) await device.call(name, ...args)
+    device.commitOverlays(overlays)
+
+    const env = (name) => `${name}=${process.env[name] || 0}`
+    console.log(`${breaks} breaks each; ${env("LSCAN_STUB_INIT_MS")}, ${env("LSCAN_STUB_MODE_MS")},` +
+        ` ${env("LSCAN_STUB_CALL_US")}`)
+    console.log("fault             total ms   max ms  wait ms  init ms  restore  replay  overlays  attempts  state")
+    await scenario(device, "disconnect", () => lseBinding.stubDisconnect(device.handle))
+    for (const unplugMs of unplugs) {
+        await scenario(device, `unplug ${unplugMs} ms`, () => lseBinding.stubUnplug(device.deviceIndex, unplugMs))
+    }
+
+    // The same calls one by one after a recovery that replayed nothing.
+    const replayNs = device.lastRecovery.replayNs
+    lseBinding.LSCAN_Capture_SetMode(device.handle, constants.LSCAN_TYPE_NONE, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    const start = lseBinding.now()
+    for (const [name, ...args] of state) await opened.call(name, ...args)
+    const oneByOne = lseBinding.now() - start
+    console.log(`\nreplay of ${state.length} calls: ${ms(replayNs)} ms batched, ${ms(oneByOne)} ms one round trip each`)
+    const stats = device.stats()
+    console.log(`breaks ${stats.breaks}, recoveries ${stats.recoveries}, attempts ${stats.attempts}` +
+        ` (${stats.failedAttempts} failed), time-to-recover p50 ${ms(stats.timeToRecover.p50)} ms`)
+
+    await device.close()
+    await session.close()
+}
+
+main()
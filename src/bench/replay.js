@@ -0,0 +1,66 @@
+import os from "os"
+import path from "path"
+import fs from "fs"
+import lseBinding from "../lse-binding"
+
+// Replay throughput of a recorded session. Records `captures` stub captures
+// with a live preview stream, then replays the recording unpaced into preview
+// and result image handlers and reports events, frames and megabytes per
+// second. Run against the stub library:
+//   npm run bench:replay [-- <captures> <previewFps> <replays>]
+const captures = Number(process.argv[2]) || 10
+const previewFps = Number(process.argv[3]) || 50
+const replays = Number(process.argv[4]) || 5
+
+const { constants } = lseBinding
+const file = path.join(os.tmpdir(), `lse-replay-bench-${process.pid}.lse`)
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+async function record(handle) {
+    // Only callbacks with a registered handler reach the recorder.
+    let resultImage = null
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, () => {})
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, () => resultImage())
+    lseBinding.startRecording(file, { handle })
+    for (let i = 0; i < captures; i++) {
+        const done = new Promise((resolve) => {
+            resultImage = resolve
+        })
+        lseBinding.LSCAN_Capture_Start(handle, 4)
+        await sleep(200)
+        lseBinding.LSCAN_Capture_TakeResultImage(handle)
+        await done
+    }
+    return lseBinding.stopRecording()
+}
+
+async function main() {
+    const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+    lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    lseBinding.setPreviewPolicy(handle, { policy: "ring", capacity: 64 })
+    lseBinding.stubSetPreview(handle, previewFps, 4)
+
+    const recorded = await record(handle)
+    console.log(`recorded ${recorded.events} events, ${(recorded.bytes / 1e6).toFixed(1)} MB`)
+
+    let frames = 0
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, () => frames++)
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, () => frames++)
+    console.log("replay".padEnd(10), "ms".padStart(10), "events/s".padStart(12), "frames/s".padStart(12),
+        "MB/s".padStart(10))
+    for (let i = 0; i < replays; i++) {
+        frames = 0
+        const { events, bytes, durationNs } = await lseBinding.replay(file, { speed: 0 })
+        const seconds = durationNs / 1e9
+        console.log(String(i + 1).padEnd(10), (durationNs / 1e6).toFixed(2).padStart(10),
+            (events / seconds).toFixed(0).padStart(12), (frames / seconds).toFixed(0).padStart(12),
+            (bytes / 1e6 / seconds).toFixed(0).padStart(10))
+    }
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, null)
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, null)
+    lseBinding.LSCAN_Main_Release(handle, false)
+    fs.unlinkSync(file)
+}
+
+main()
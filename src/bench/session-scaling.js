@@ -0,0 +1,63 @@
+import lseBinding from "../lse-binding"
+import SessionManager from "../session-manager"
+
+// Capture throughput of the session manager versus number of devices. Each
+// device runs Start + TakeResultImage cycles on its own worker thread against
+// the stub library, which simulates initialization and acquisition latency:
+//   npm run bench:sessions [-- <durationMs>]
+// (LSCAN_STUB_DEVICES, LSCAN_STUB_INIT_MS and LSCAN_STUB_ACQUIRE_MS are set by
+// the npm script.)
+const durationMs = Number(process.argv[2]) || 2000
+const { constants } = lseBinding
+const { deviceCount } = lseBinding.LSCAN_Main_GetDeviceCount()
+
+async function captureLoop(device, end, counter) {
+    await device.call("LSCAN_Capture_SetMode", constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    while (lseBinding.now() < end) {
+        await device.call("LSCAN_Capture_Start", 4)
+        const status = await device.call("LSCAN_Capture_TakeResultImage")
+        if (status === constants.LSCAN_STATUS_OK) counter.captures++
+    }
+}
+
+async function run(count) {
+    const session = new SessionManager()
+    const deviceIndices = Array.from({ length: count }, (_, i) => i)
+
+    const openStart = lseBinding.now()
+    const devices = await session.open({ deviceIndices })
+    const openMs = (lseBinding.now() - openStart) / 1e6
+
+    const counter = { captures: 0, images: 0 }
+    for (const device of devices) {
+        lseBinding.LSCAN_Capture_RegisterCallbackResultImage(device.handle, () => counter.images++)
+    }
+    const start = lseBinding.now()
+    const end = start + durationMs * 1e6
+    await Promise.all(devices.map((device) => captureLoop(device, end, counter)))
+    const seconds = (lseBinding.now() - start) / 1e9
+
+    for (const device of devices) {
+        lseBinding.LSCAN_Capture_RegisterCallbackResultImage(device.handle, null)
+    }
+    await session.close()
+    return { count, openMs, capturesPerSecond: counter.captures / seconds, images: counter.images }
+}
+
+async function main() {
+    const counts = [1, 2, 4, 8, 16].filter((n) => n <= deviceCount)
+    console.log("devices".padStart(7), "open ms".padStart(9), "captures/s".padStart(11), "scaling".padStart(8),
+        "efficiency".padStart(11))
+    let single = null
+    for (const count of counts) {
+        const result = await run(count)
+        single = single || result.capturesPerSecond || 1
+        const scaling = result.capturesPerSecond / single
+        console.log(String(count).padStart(7), result.openMs.toFixed(1).padStart(9),
+            result.capturesPerSecond.toFixed(1).padStart(11), (scaling.toFixed(2) + "x").padStart(8),
+            ((scaling / count) * 100).toFixed(0).padStart(10) + "%")
+    }
+}
+
+main()
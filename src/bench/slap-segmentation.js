@@ -0,0 +1,148 @@
+import os from "os"
+import path from "path"
+import fs from "fs"
+import lseBinding from "../lse-binding"
+
+// Slap segmentation (native/segmentation.h):
+//   1. synthetic slaps at 500 and 1000 ppi, fingers apart and pressed together,
+//      and two thumbs, segmented with segmentSlap() per kernel level and thread
+//      count;
+//   2. recorded result images (the stub's synthetic slaps, or the PGM files of
+//      LSCAN_STUB_IMAGES) replayed unpaced into a result image handler, without
+//      and with setResultImageSegmentation() on the handle.
+//   npm run bench:segment [-- <iterations> <captures> <replays>]
+const iterations = Number(process.argv[2]) || 20
+const captures = Number(process.argv[3]) || 10
+const replays = Number(process.argv[4]) || 3
+const { constants } = lseBinding
+const file = path.join(os.tmpdir(), `lse-segment-bench-${process.pid}.lse`)
+
+// `count` slanted ridge patterns in finger-shaped areas side by side, each
+// `spread` of its slot wide; above 0.5 neighbours overlap. The last of four is
+// the smaller little finger.
+function slap(width, height, count, spread) {
+    const data = Buffer.alloc(width * height, 250)
+    const period = width / 180
+    let seed = 1
+    for (let finger = 0; finger < count; finger++) {
+        const little = count === 4 && finger === 3 ? 0.8 : 1
+        const cx = ((finger + 0.5) * width) / count
+        const cy = height * (finger === 0 || finger === count - 1 ? 0.55 : 0.45)
+        const rx = (width / count) * spread * little
+        const ry = height * 0.38 * little
+        const angle = 0.3 + 0.25 * finger
+        const kx = (Math.cos(angle) * 2 * Math.PI) / period
+        const ky = (Math.sin(angle) * 2 * Math.PI) / period
+        for (let y = Math.max(0, Math.floor(cy - ry)); y <= Math.min(height - 1, cy + ry); y++) {
+            for (let x = Math.max(0, Math.floor(cx - rx)); x <= Math.min(width - 1, cx + rx); x++) {
+                if (((x - cx) / rx) ** 2 + ((y - cy) / ry) ** 2 > 1) continue
+                seed = (seed * 1103515245 + 12345) >>> 0
+                const noise = ((seed >>> 16) % 17) - 8
+                const value = 120 + Math.round(90 * Math.sin(x * kx + y * ky)) + noise
+                data[y * width + x] = Math.max(0, Math.min(255, value))
+            }
+        }
+    }
+    return { width, height, data, bitsPerPixel: 8 }
+}
+
+function syntheticTable() {
+    const cores = os.cpus().length
+    const threadCounts = [...new Set([1, 2, 4, cores])].sort((a, b) => a - b)
+    const cases = [
+        ["four apart 500 ppi", 1600, 1500, 4, 0.38, constants.LSCAN_FLAT_FOUR_FINGERS],
+        ["four touching 500", 1600, 1500, 4, 0.52, constants.LSCAN_FLAT_FOUR_FINGERS],
+        ["four apart 1000 ppi", 3200, 3000, 4, 0.38, constants.LSCAN_FLAT_FOUR_FINGERS],
+        ["thumbs 500 ppi", 1600, 1000, 2, 0.19, constants.LSCAN_FLAT_THUMBS],
+    ]
+    const detected = lseBinding.simdLevel().detected
+    const levels = ["scalar", "sse4.1", "avx2"].slice(0, ["scalar", "sse4.1", "avx2"].indexOf(detected) + 1)
+    console.log(`synthetic, ${cores} hardware threads, mean of ${iterations}`)
+    console.log("image                level    threads  ms/image  images/s  fingers  splits  positions")
+    for (const [name, width, height, count, spread, imageType] of cases) {
+        const image = slap(width, height, count, spread)
+        for (const level of levels) {
+            lseBinding.setSimdLevel(level)
+            for (const threads of threadCounts) {
+                let result = lseBinding.segmentSlap(image, { imageType, threads })
+                let ns = 0
+                for (let i = 0; i < iterations; i++) {
+                    result = lseBinding.segmentSlap(image, { imageType, threads })
+                    ns += result.segmentNs
+                }
+                const ms = ns / iterations / 1e6
+                console.log(`${name.padEnd(19)}  ${level.padEnd(7)}  ${String(threads).padStart(7)}` +
+                    `  ${ms.toFixed(2).padStart(8)}  ${(1000 / ms).toFixed(0).padStart(8)}` +
+                    `  ${String(result.fingers.length).padStart(7)}  ${String(result.splits).padStart(6)}` +
+                    `  ${result.fingers.map((f) => f.position).join(" ")}`)
+            }
+        }
+    }
+    lseBinding.setSimdLevel(detected)
+}
+
+// Records `captures` result images of the stub's four-finger slap at `resolution`.
+async function record(handle, resolution) {
+    let resultImage = null
+    lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, resolution,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    // Only callbacks with a registered handler reach the recorder.
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, () => resultImage())
+    lseBinding.startRecording(file, { handle })
+    for (let i = 0; i < captures; i++) {
+        const done = new Promise((resolve) => {
+            resultImage = resolve
+        })
+        lseBinding.LSCAN_Capture_Start(handle, 4)
+        lseBinding.LSCAN_Capture_TakeResultImage(handle)
+        await done
+        lseBinding.LSCAN_Capture_Abort(handle)
+    }
+    return lseBinding.stopRecording()
+}
+
+async function recordedTable() {
+    const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+    console.log(`\nrecorded, ${captures} result images of ${process.env.LSCAN_STUB_IMAGES || "synthetic slaps"},` +
+        ` replayed unpaced, best of ${replays}`)
+    console.log("resolution  segmentation  images/s  ms/image (segmenting)  fingers/image  incomplete")
+    for (const [name, resolution] of [["500 ppi", constants.LSCAN_RES_500], ["1000 ppi", constants.LSCAN_RES_1000]]) {
+        await record(handle, resolution)
+        let fingers = 0
+        lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, (h, image) => {
+            if (image.segmentation) fingers += image.segmentation.fingers.length
+        })
+        for (const segment of [false, true]) {
+            const options = segment ? { imageType: constants.LSCAN_FLAT_FOUR_FINGERS } : null
+            lseBinding.setResultImageSegmentation(handle, options)
+            const before = lseBinding.segmentationStats()
+            let best = Infinity
+            fingers = 0
+            for (let i = 0; i < replays; i++) {
+                // The replay settles after its events reached JS, segmented
+                // images included.
+                const start = lseBinding.now()
+                await lseBinding.replay(file, { speed: 0 })
+                best = Math.min(best, lseBinding.now() - start)
+            }
+            const after = lseBinding.segmentationStats()
+            const images = after.images - before.images
+            console.log(`${name.padEnd(10)}  ${(segment ? "on" : "off").padEnd(12)}` +
+                `  ${(captures / (best / 1e9)).toFixed(0).padStart(8)}` +
+                `  ${(images ? (after.segmentNs - before.segmentNs) / images / 1e6 : 0).toFixed(2).padStart(21)}` +
+                `  ${(images ? fingers / images : 0).toFixed(1).padStart(13)}` +
+                `  ${String(after.incomplete - before.incomplete).padStart(10)}`)
+        }
+        lseBinding.setResultImageSegmentation(handle, null)
+    }
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, null)
+    lseBinding.LSCAN_Main_Release(handle, false)
+    fs.unlinkSync(file)
+}
+
+async function main() {
+    syntheticTable()
+    await recordedTable()
+}
+
+main()
@@ -0,0 +1,78 @@
+import { fork } from "child_process"
+
+// Cold start: time from process start to the first ready device handle, with
+// every device initializing for LSCAN_STUB_INIT_MS (set by the npm script).
+// Each run is a fresh process:
+//   sequential  entry points resolved at load (LSE_BIND_NOW=1), then
+//               LSCAN_Main_GetDeviceInfo and LSCAN_Main_Initialize device by device
+//   parallel    lazy entry points, SessionManager.open() initializing all devices
+//               at once, with aggregated progress and per-device readiness
+// Times are milliseconds since the process started (performance.now()):
+//   npm run bench:startup [-- <runs>]
+const runs = Number(process.argv[2]) || 3
+
+function sequential(lseBinding) {
+    const { deviceCount } = lseBinding.LSCAN_Main_GetDeviceCount()
+    let firstReady = 0
+    for (let deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+        lseBinding.LSCAN_Main_GetDeviceInfo(deviceIndex)
+        const { status } = lseBinding.LSCAN_Main_Initialize(deviceIndex, false)
+        if (status >= 0 && !firstReady) firstReady = performance.now()
+    }
+    return { deviceCount, firstReady, allReady: performance.now(), progressUpdates: 0 }
+}
+
+async function parallel(lseBinding) {
+    const { default: SessionManager } = await import("../session-manager")
+    const session = new SessionManager()
+    let firstReady = 0
+    let progressUpdates = 0
+    const devices = await session.open({
+        minApiVersion: [1, 0],
+        onProgress: () => progressUpdates++,
+        onReady: (device) => {
+            if (device.ok && !firstReady) firstReady = performance.now()
+        },
+    })
+    const allReady = performance.now()
+    await session.close()
+    return { deviceCount: devices.length, firstReady, allReady, progressUpdates }
+}
+
+async function child(strategy) {
+    const started = performance.now()
+    const { default: lseBinding } = await import("../lse-binding")
+    const loaded = performance.now()
+    const result = strategy === "sequential" ? sequential(lseBinding) : await parallel(lseBinding)
+    process.send({ strategy, started, loadMs: loaded - started, ...result })
+    process.exit(0)
+}
+
+function run(strategy) {
+    const env = { ...process.env }
+    if (strategy === "sequential") env.LSE_BIND_NOW = "1"
+    const worker = fork(process.argv[1], ["--child", strategy], { env })
+    return new Promise((resolve) => worker.once("message", resolve))
+}
+
+async function main() {
+    console.log(`${process.env.LSCAN_STUB_DEVICES || 1} devices, ${process.env.LSCAN_STUB_INIT_MS || 0} ms` +
+        ` initialization each, best of ${runs} runs`)
+    console.log("strategy    script start  addon load  first ready  all ready  progress updates")
+    for (const strategy of ["sequential", "parallel"]) {
+        let best = null
+        for (let i = 0; i < runs; i++) {
+            const r = await run(strategy)
+            if (!best || r.firstReady < best.firstReady) best = r
+        }
+        console.log(`${strategy.padEnd(10)}  ${best.started.toFixed(1).padStart(12)}  ${best.loadMs.toFixed(2).padStart(10)}` +
+            `  ${best.firstReady.toFixed(1).padStart(11)}  ${best.allReady.toFixed(1).padStart(9)}` +
+            `  ${String(best.progressUpdates).padStart(16)}`)
+    }
+}
+
+if (process.argv[2] === "--child") {
+    child(process.argv[3])
+} else {
+    main()
+}
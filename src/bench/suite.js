@@ -0,0 +1,321 @@
+import fs from "fs"
+import os from "os"
+import lseBinding from "../lse-binding"
+import SessionManager from "../session-manager"
+import ffiBinding from "./ffi-binding"
+import defaultThresholds from "./thresholds"
+
+// End-to-end benchmark suite, headless against the stub library: native call
+// overhead per API group, preview frames per second reaching JS, result image
+// latency, frame memory and multi-device scaling. Every metric is checked
+// against its limit in thresholds.js and, with --baseline, against an earlier
+// run; the exit code is 1 if any check fails, so CI can gate on it:
+//   npm run bench:suite [-- --out results.json] [--json] [--thresholds limits.json]
+//       [--baseline results.json] [--tolerance 25] [--runs 5] [--only calls,preview,...]
+// Call overheads and preview metrics are the median of --runs measurements.
+// --thresholds merges a JSON object of the thresholds.js form over the
+// defaults; --baseline fails metrics with a limit that got worse than the
+// baseline value by more than --tolerance percent and by more than the
+// metric's absolute floor in thresholds.js.
+const options = parseOptions(process.argv.slice(2))
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+const toMs = (ns) => ns / 1e6
+
+function parseOptions(argv) {
+    const parsed = { out: null, json: false, thresholds: null, baseline: null, tolerance: 25, runs: 5, only: null }
+    for (let i = 0; i < argv.length; i++) {
+        const arg = argv[i]
+        if (arg === "--json") {
+            parsed.json = true
+        } else if (arg === "--out" || arg === "--thresholds" || arg === "--baseline") {
+            parsed[arg.slice(2)] = argv[++i]
+        } else if (arg === "--tolerance") {
+            parsed.tolerance = Number(argv[++i])
+        } else if (arg === "--runs") {
+            parsed.runs = Number(argv[++i])
+            if (!Number.isInteger(parsed.runs) || parsed.runs < 1) throw new TypeError("--runs must be an integer >= 1")
+        } else if (arg === "--only") {
+            parsed.only = argv[++i].split(",")
+        } else {
+            throw new TypeError(`Unknown option "${arg}"`)
+        }
+    }
+    return parsed
+}
+
+function percentile(values, p) {
+    if (!values.length) return 0
+    const sorted = values.slice().sort((a, b) => a - b)
+    return sorted[Math.min(sorted.length - 1, Math.floor((sorted.length * p) / 100))]
+}
+
+const median = (values) => percentile(values, 50)
+
+// { metric: median } over the metric objects of several runs.
+function medians(runs) {
+    const merged = {}
+    for (const metric of Object.keys(runs[0])) merged[metric] = median(runs.map((run) => run[metric]))
+    return merged
+}
+
+// Nanoseconds per call of `fn` after a warm-up: the median of `runs` runs of
+// about `durationMs` each.
+function nsPerCall(fn, runs = options.runs, durationMs = 100) {
+    for (let i = 0; i < 10000; i++) fn()
+    const samples = []
+    for (let run = 0; run < runs; run++) {
+        let calls = 0
+        const start = lseBinding.now()
+        const end = start + durationMs * 1e6
+        let now = start
+        while (now < end) {
+            for (let i = 0; i < 1000; i++) fn()
+            calls += 1000
+            now = lseBinding.now()
+        }
+        samples.push((now - start) / calls)
+    }
+    return median(samples)
+}
+
+// Call overhead through the addon, one representative pair of calls per API
+// group (cached property reads are left out on purpose), and a session call
+// round trip through a device worker.
+async function calls(handle) {
+    const groups = {
+        main: [() => lseBinding.LSCAN_Main_GetDeviceCount(), () => lseBinding.LSCAN_Main_IsInitialized(handle)],
+        capture: [() => lseBinding.LSCAN_Capture_GetContrast(handle), () => lseBinding.LSCAN_Capture_IsActive(handle)],
+        controls: [() => lseBinding.LSCAN_Controls_GetActiveLEDs(handle),
+            () => lseBinding.LSCAN_Controls_SetActiveLEDs(handle, 0x5)],
+        visualization: [() => lseBinding.LSCAN_Visualization_GetScaleFactor(handle)],
+    }
+    const metrics = {}
+    for (const [group, fns] of Object.entries(groups)) {
+        metrics[`calls.${group}.nsPerCall`] = fns.reduce((sum, fn) => sum + nsPerCall(fn), 0) / fns.length
+    }
+    if (ffiBinding) {
+        metrics["calls.ffi.nsPerCall"] = nsPerCall(() => ffiBinding.LSCAN_Main_GetDeviceCount())
+    }
+
+    lseBinding.LSCAN_Main_Release(handle, false)
+    const session = new SessionManager()
+    const [device] = await session.open({ deviceIndices: [0] })
+    const count = 400
+    const samples = []
+    for (let run = 0; run < options.runs; run++) {
+        const start = lseBinding.now()
+        for (let i = 0; i < count; i++) await device.call("LSCAN_Controls_SetActiveLEDs", i & 0x3)
+        samples.push((lseBinding.now() - start) / count)
+    }
+    metrics["calls.session.nsPerCall"] = median(samples)
+    await session.close()
+    return metrics
+}
+
+// Captures of `ms` with a 100 fps preview, the median of `runs`: frames per
+// second reaching the handler, frames lost (the stub numbers them),
+// SDK-to-handler latency, and the frame pool allocations and resident set
+// growth per frame.
+async function preview(handle, runs = options.runs, ms = 1000) {
+    const fps = 100
+    lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    lseBinding.stubSetPreview(handle, fps, 2)
+    let frames = 0
+    let lost = 0
+    let last = -1
+    const latencies = []
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, (h, image, timestamp) => {
+        latencies.push(lseBinding.now() - timestamp)
+        const sequence = image.data.readUInt32LE(0)
+        if (last >= 0 && sequence > last + 1) lost += sequence - last - 1
+        last = sequence
+        frames++
+    })
+
+    // A short capture first, for the pool and the JIT to warm up.
+    lseBinding.LSCAN_Capture_Start(handle, 4)
+    await sleep(200)
+    lseBinding.LSCAN_Capture_Abort(handle)
+    await sleep(20)
+
+    const samples = []
+    for (let run = 0; run < runs; run++) {
+        frames = 0
+        lost = 0
+        last = -1
+        latencies.length = 0
+        const pool = lseBinding.framePoolStats(handle)
+        const rss = process.memoryUsage().rss
+        const start = lseBinding.now()
+        lseBinding.LSCAN_Capture_Start(handle, 4)
+        await sleep(ms)
+        lseBinding.LSCAN_Capture_Abort(handle)
+        const seconds = (lseBinding.now() - start) / 1e9
+        await sleep(20)
+        const rssGrowth = Math.max(0, process.memoryUsage().rss - rss)
+        const allocations = lseBinding.framePoolStats(handle).allocations - pool.allocations
+        samples.push({
+            "preview.fps": frames / seconds,
+            "preview.lostRatio": lost / Math.max(1, frames + lost),
+            "preview.latencyP50Ms": toMs(percentile(latencies, 50)),
+            "preview.latencyP99Ms": toMs(percentile(latencies, 99)),
+            "memory.allocationsPerFrame": allocations / Math.max(1, frames),
+            "memory.rssGrowthBytesPerFrame": rssGrowth / Math.max(1, frames),
+        })
+    }
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, null)
+    lseBinding.stubSetPreview(handle, 0, 2)
+    return medians(samples)
+}
+
+// `captures` result images: LSCAN_Capture_TakeResultImage() until the handler
+// runs, and the part of it from the SDK's callback to the handler.
+async function result(handle, captures = 30) {
+    lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    let delivered = null
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, (h, image, status, timestamp) => delivered(timestamp))
+    const latencies = []
+    const bridge = []
+    for (let i = 0; i < captures; i++) {
+        const done = new Promise((resolve) => {
+            delivered = resolve
+        })
+        lseBinding.LSCAN_Capture_Start(handle, 4)
+        const start = lseBinding.now()
+        lseBinding.LSCAN_Capture_TakeResultImage(handle)
+        const timestamp = await done
+        const end = lseBinding.now()
+        latencies.push(end - start)
+        bridge.push(end - timestamp)
+        lseBinding.LSCAN_Capture_Abort(handle)
+    }
+    lseBinding.LSCAN_Capture_RegisterCallbackResultImage(handle, null)
+    return {
+        "result.latencyP50Ms": toMs(percentile(latencies, 50)),
+        "result.latencyP99Ms": toMs(percentile(latencies, 99)),
+        "result.bridgeP50Ms": toMs(percentile(bridge, 50)),
+    }
+}
+
+async function captureLoop(device, end, counter) {
+    await device.call("LSCAN_Capture_SetMode", constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    while (lseBinding.now() < end) {
+        await device.call("LSCAN_Capture_Start", 4)
+        if (await device.call("LSCAN_Capture_TakeResultImage") === constants.LSCAN_STATUS_OK) counter.captures++
+    }
+}
+
+// Sessions of 1, 2, 4 and 8 stub devices with a 100 ms initialization and a
+// 20 ms acquisition: open time and capture throughput against one device.
+async function scaling(ms = 1000) {
+    const all = constants.LSCAN_STUB_ALL_DEVICES
+    lseBinding.stubSetDeviceCount(8)
+    lseBinding.stubSetLatency("LSCAN_Main_Initialize", all, 100000)
+    lseBinding.stubSetLatency("LSCAN_Capture_TakeResultImage", all, 20000)
+    const metrics = {}
+    let single = null
+    for (const count of [1, 2, 4, 8]) {
+        const session = new SessionManager()
+        const openStart = lseBinding.now()
+        const devices = await session.open({ deviceIndices: Array.from({ length: count }, (_, i) => i) })
+        const openNs = lseBinding.now() - openStart
+        const counter = { captures: 0 }
+        const start = lseBinding.now()
+        await Promise.all(devices.map((device) => captureLoop(device, start + ms * 1e6, counter)))
+        const perSecond = counter.captures / ((lseBinding.now() - start) / 1e9)
+        await session.close()
+        single = single || { openNs, perSecond }
+        metrics[`scaling.capturesPerSecond${count}`] = perSecond
+        metrics[`scaling.openMs${count}`] = toMs(openNs)
+        if (count > 1) {
+            metrics[`scaling.efficiency${count}`] = perSecond / (single.perSecond * count)
+            metrics[`scaling.openRatio${count}`] = openNs / single.openNs
+        }
+    }
+    lseBinding.stubSetLatency("LSCAN_Main_Initialize", all, 0)
+    lseBinding.stubSetLatency("LSCAN_Capture_TakeResultImage", all, 0)
+    lseBinding.stubSetDeviceCount(1)
+    return metrics
+}
+
+// { metric, value, limit, kind: "min"|"max", source: "threshold"|"baseline", ok }
+// for every metric with a limit.
+function check(metrics, thresholds, baseline, tolerance) {
+    const checks = []
+    for (const [metric, limit] of Object.entries(thresholds)) {
+        const value = metrics[metric]
+        if (value === undefined) continue
+        const kind = limit.min !== undefined ? "min" : "max"
+        const bound = limit[kind]
+        checks.push({ metric, value, limit: bound, kind, source: "threshold",
+            ok: kind === "min" ? value >= bound : value <= bound })
+        const previous = baseline && baseline[metric]
+        if (previous === undefined || previous === null) continue
+        // The floor keeps tiny baselines (a lost ratio of 0, say) from failing on noise.
+        const floor = limit.floor || 0
+        const allowed = kind === "min" ? Math.min(previous * (1 - tolerance / 100), previous - floor)
+            : Math.max(previous * (1 + tolerance / 100), previous + floor)
+        checks.push({ metric, value, limit: allowed, kind, source: "baseline",
+            ok: kind === "min" ? value >= allowed : value <= allowed })
+    }
+    return checks
+}
+
+async function main() {
+    const thresholds = { ...defaultThresholds }
+    if (options.thresholds) Object.assign(thresholds, JSON.parse(fs.readFileSync(options.thresholds, "utf8")))
+    const baseline = options.baseline ? JSON.parse(fs.readFileSync(options.baseline, "utf8")).metrics : null
+    const selected = (name) => !options.only || options.only.includes(name)
+
+    lseBinding.stubSetDeviceCount(1)
+    const metrics = {}
+    const started = Date.now()
+    if (selected("calls")) {
+        const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+        Object.assign(metrics, await calls(handle))
+    }
+    if (selected("preview") || selected("result")) {
+        const { handle } = lseBinding.LSCAN_Main_Initialize(0, false)
+        if (selected("preview")) Object.assign(metrics, await preview(handle))
+        if (selected("result")) Object.assign(metrics, await result(handle))
+        lseBinding.LSCAN_Main_Release(handle, false)
+    }
+    if (selected("scaling")) Object.assign(metrics, await scaling())
+
+    const checks = check(metrics, thresholds, baseline, options.tolerance)
+    const failed = checks.filter((c) => !c.ok)
+    const report = {
+        date: new Date(started).toISOString(),
+        durationMs: Date.now() - started,
+        node: process.version,
+        platform: `${process.platform}-${process.arch}`,
+        cpus: os.cpus().length,
+        metrics,
+        checks,
+        ok: failed.length === 0,
+    }
+    if (options.out) fs.writeFileSync(options.out, JSON.stringify(report, null, 2) + "\n")
+    if (options.json) {
+        console.log(JSON.stringify(report, null, 2))
+    } else {
+        console.log("metric".padEnd(34), "value".padStart(12), "limit".padStart(12))
+        for (const [metric, value] of Object.entries(metrics)) {
+            const limit = thresholds[metric]
+            const bound = limit ? `${limit.min !== undefined ? ">=" : "<="} ${limit.min ?? limit.max}` : ""
+            const mark = checks.some((c) => c.metric === metric && !c.ok) ? "  FAIL" : ""
+            console.log(metric.padEnd(34), (+value.toPrecision(4)).toString().padStart(12), bound.padStart(12) + mark)
+        }
+        for (const c of failed) {
+            console.log(`FAIL ${c.metric} = ${+c.value.toPrecision(4)}, ${c.source} ${c.kind} ${+c.limit.toPrecision(4)}`)
+        }
+        console.log(failed.length ? `${failed.length} of ${checks.length} checks failed` : `all ${checks.length} checks passed`)
+    }
+    process.exitCode = failed.length ? 1 : 0
+}
+
+main()
@@ -0,0 +1,34 @@
+// Limits of the metrics of suite.js: { max } for lower-is-better metrics and
+// { min } for higher-is-better ones. They are set well clear of what the stub
+// library reaches on an idle developer machine, so that only real regressions
+// trip them; a --baseline run compares against earlier results more tightly,
+// failing a metric only if it moved past both the tolerance and its absolute
+// `floor`. Metrics not listed here are reported but never fail a run.
+export default {
+    // Native call overhead per API group, nanoseconds per call
+    "calls.main.nsPerCall": { max: 2000, floor: 50 },
+    "calls.capture.nsPerCall": { max: 2000, floor: 50 },
+    "calls.controls.nsPerCall": { max: 2000, floor: 50 },
+    "calls.visualization.nsPerCall": { max: 2000, floor: 50 },
+    "calls.session.nsPerCall": { max: 200000, floor: 5000 },
+
+    // Preview frames reaching JS at the stub's 100 fps, and those lost on the way
+    "preview.fps": { min: 90, floor: 2 },
+    "preview.lostRatio": { max: 0.05, floor: 0.01 },
+    "preview.latencyP99Ms": { max: 20, floor: 2 },
+
+    // LSCAN_Capture_TakeResultImage() until the result image handler runs
+    "result.latencyP50Ms": { max: 10, floor: 1 },
+    "result.latencyP99Ms": { max: 100, floor: 5 },
+
+    // Frame memory: pool allocations per frame once the pool is warm (blocks
+    // still held by uncollected Buffers make it allocate now and then), and the
+    // resident set growth over a preview run, a few KB per frame once warm; a
+    // leaked half-size four-finger preview frame is some 600 KB
+    "memory.allocationsPerFrame": { max: 0.5, floor: 0.05 },
+    "memory.rssGrowthBytesPerFrame": { max: 65536, floor: 16384 },
+
+    // Capture throughput of 8 devices over 8 times that of one
+    "scaling.efficiency8": { min: 0.7, floor: 0.05 },
+    "scaling.openRatio8": { max: 2, floor: 0.2 },
+}
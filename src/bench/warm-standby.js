@@ -0,0 +1,153 @@
+import lseBinding from "../lse-binding"
+import SessionManager from "../session-manager"
+import WarmStandby from "../warm-standby"
+
+// Time-to-first-preview of a tenprint-like workflow under three mode policies:
+//   none     LSCAN_TYPE_NONE after every capture: no idle streaming, every start cold
+//   armed    the last mode stays set: starts are warm unless the mode changes,
+//            but the sensor streams through every pause
+//   standby  WarmStandby: predicted mode armed, LSCAN_TYPE_NONE after idleMs,
+//            re-armed by a key press when the next subject arrives
+// Each subject gives left four fingers, right four fingers and both thumbs,
+// `pauseMs` apart; subjects arrive `gapMs` apart and press a key `cueMs`
+// before their first capture. The stub makes a mode change take
+// LSCAN_STUB_MODE_MS and the sensor LSCAN_STUB_WARMUP_MS to stream:
+//   npm run bench:standby [-- <subjects> <idleMs> <gapMs> <pauseMs> <cueMs>]
+const subjects = Number(process.argv[2]) || 4
+const idleMs = Number(process.argv[3]) || 1000
+const gapMs = Number(process.argv[4]) || 5000
+const pauseMs = Number(process.argv[5]) || 400
+const cueMs = Number(process.argv[6]) || 600
+const { constants } = lseBinding
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+const fourFingers = { imageType: constants.LSCAN_FLAT_FOUR_FINGERS }
+const thumbs = { imageType: constants.LSCAN_FLAT_THUMBS }
+const workflow = [[fourFingers, 4], [fourFingers, 4], [thumbs, 2]]
+
+// Plain SDK calls for the baselines; armedSince tracks idle streaming.
+class Baseline {
+    constructor(device, disarm) {
+        this.device = device
+        this.disarm = disarm
+        this.current = null
+        this.armedMs = 0
+        this.armedSince = 0
+        this.startups = []
+        this.hits = 0
+        this.mark = 0
+    }
+
+    async start(mode, objects) {
+        this.mark = lseBinding.latencyMarkStart(this.device.handle)
+        this.stopClock()
+        if (this.current === mode) {
+            this.hits++
+        } else {
+            await this.device.call("LSCAN_Capture_SetMode", mode.imageType, constants.LSCAN_RES_500,
+                constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+            this.current = mode
+        }
+        await this.device.call("LSCAN_Capture_Start", objects)
+    }
+
+    async finish() {
+        const { lastStart } = lseBinding.latencyStats(this.device.handle)
+        if (lastStart.start === this.mark) this.startups.push(lastStart.firstPreview - lastStart.start)
+        if (this.disarm) {
+            await this.device.call("LSCAN_Capture_SetMode", constants.LSCAN_TYPE_NONE, constants.LSCAN_RES_500,
+                constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+            this.current = null
+        } else {
+            this.armedSince = lseBinding.now()
+        }
+    }
+
+    stopClock() {
+        if (this.armedSince) this.armedMs += (lseBinding.now() - this.armedSince) / 1e6
+        this.armedSince = 0
+    }
+}
+
+// Start, wait for preview, take the result image.
+async function capture(policy, mode, objects) {
+    const startedAt = lseBinding.now()
+    await policy.start(mode, objects)
+    while (lseBinding.latencyStats(policy.device.handle).lastStart.start < startedAt &&
+        lseBinding.now() - startedAt < 5e9) {
+        await sleep(5)
+    }
+    await sleep(150)
+    await policy.device.call("LSCAN_Capture_TakeResultImage")
+    await policy.finish()
+}
+
+async function run(policy, device) {
+    lseBinding.latencyReset(device.handle)
+    await device.call("LSCAN_Capture_SetMode", constants.LSCAN_TYPE_NONE, constants.LSCAN_RES_500,
+        constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+    const standby = policy === "standby" ? new WarmStandby(device, { idleMs }) : null
+    const baseline = standby ? null : new Baseline(device, policy === "none")
+
+    const runStart = lseBinding.now()
+    for (let subject = 0; subject < subjects; subject++) {
+        if (subject > 0) {
+            await sleep(gapMs - cueMs)
+            // The next subject steps up and the operator presses a key.
+            lseBinding.stubFireCallbacks(device.handle, constants.LSCAN_STUB_FIRE_KEYS, 1, 1, 0)
+            await sleep(cueMs)
+        }
+        for (let i = 0; i < workflow.length; i++) {
+            if (i > 0) await sleep(pauseMs)
+            await capture(standby || baseline, ...workflow[i])
+        }
+    }
+    const totalMs = (lseBinding.now() - runStart) / 1e6
+
+    let startups
+    let armedMs
+    let hits = 0
+    if (standby) {
+        await standby.close()
+        const stats = standby.stats()
+        startups = { count: stats.warm.count + stats.cold.count, warm: stats.warm, cold: stats.cold }
+        startups.mean = (stats.warm.mean * stats.warm.count + stats.cold.mean * stats.cold.count) / startups.count
+        startups.max = Math.max(stats.warm.max, stats.cold.max)
+        armedMs = stats.armedMs
+        hits = stats.hits
+    } else {
+        baseline.stopClock()
+        const values = baseline.startups
+        startups = { count: values.length, mean: values.reduce((a, b) => a + b, 0) / values.length,
+            max: Math.max(...values) }
+        armedMs = baseline.armedMs
+        hits = baseline.hits
+    }
+    return { policy, startups, armedMs, totalMs, hits }
+}
+
+async function main() {
+    lseBinding.stubSetDeviceCount(1)
+    lseBinding.stubSetPreview(constants.LSCAN_STUB_ALL_DEVICES, 30, 2)
+    const session = new SessionManager()
+    const [device] = await session.open()
+    lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(device.handle, () => {})
+
+    console.log(`${subjects} subjects x ${workflow.length} captures, mode change ${process.env.LSCAN_STUB_MODE_MS || 0}` +
+        ` ms, sensor warm-up ${process.env.LSCAN_STUB_WARMUP_MS || 0} ms, idle timeout ${idleMs} ms`)
+    console.log("policy    starts  warm  first preview ms (mean/max)  idle streaming ms  share of run")
+    const ms = (ns) => (ns / 1e6).toFixed(1)
+    for (const policy of ["none", "armed", "standby"]) {
+        const r = await run(policy, device)
+        console.log(`${policy.padEnd(8)}  ${String(r.startups.count).padStart(6)}  ${String(r.hits).padStart(4)}` +
+            `  ${ms(r.startups.mean).padStart(14)} / ${ms(r.startups.max).padEnd(11)}` +
+            `  ${r.armedMs.toFixed(0).padStart(17)}  ${((r.armedMs / r.totalMs) * 100).toFixed(0).padStart(11)}%`)
+        if (r.startups.warm) {
+            console.log(`          warm starts ${ms(r.startups.warm.mean)} ms mean over ${r.startups.warm.count},` +
+                ` cold starts ${ms(r.startups.cold.mean)} ms mean over ${r.startups.cold.count}`)
+        }
+    }
+    await session.close()
+}
+
+main()
@@ -0,0 +1,139 @@
+import { Worker, isMainThread, parentPort, workerData } from "worker_threads"
+import { performance } from "perf_hooks"
+import lseBinding from "../lse-binding"
+
+// Main-thread cost of preview frames: `devices` stub devices stream 100 fps
+// previews for `ms` milliseconds each run, and every frame gets imageStatistics()
+// (a full-frame histogram) as its analysis, either
+//   1. main:   in a preview handler on the main thread, or
+//   2. worker: in one worker thread per device that took the frames with
+//      workerFramesOpen(), with no preview handler on the main thread;
+// reporting frames analysed and lost, the handler latency and the main thread's
+// event loop busy time per frame. A few result images per device follow to the
+// workers. Run against the stub library:
+//   npm run bench:workers [-- <devices> <ms>]
+const devices = Number(process.argv[2]) || 2
+const ms = Number(process.argv[3]) || 2000
+const captures = 5
+const { constants } = lseBinding
+
+const sleep = (time) => new Promise((resolve) => setTimeout(resolve, time))
+const percentile = (values, p) => {
+    const sorted = [...values].sort((a, b) => a - b)
+    return sorted.length ? sorted[Math.min(sorted.length - 1, Math.floor((sorted.length * p) / 100))] : 0
+}
+
+// Frame counters of one handler; the stub numbers its frames.
+function counter() {
+    const counts = { frames: 0, lost: 0, last: -1, latencies: [] }
+    counts.preview = (handle, image, timestamp) => {
+        lseBinding.imageStatistics(image)
+        counts.latencies.push(lseBinding.now() - timestamp)
+        const sequence = image.data.readUInt32LE(0)
+        if (counts.last >= 0 && sequence > counts.last + 1) counts.lost += sequence - counts.last - 1
+        counts.last = sequence
+        counts.frames++
+    }
+    return counts
+}
+
+function frameWorker() {
+    const { handle } = workerData
+    const counts = counter()
+    let results = 0
+    lseBinding.workerFramesOpen(handle, "preview", counts.preview, { policy: "ring", capacity: 4 })
+    lseBinding.workerFramesOpen(handle, "result", (h, image) => {
+        lseBinding.imageStatistics(image)
+        results++
+    })
+    parentPort.on("message", (message) => {
+        if (message === "reset") {
+            Object.assign(counts, { frames: 0, lost: 0, last: -1, latencies: [] })
+        }
+        if (message === "close") {
+            lseBinding.workerFramesClose(handle, "preview")
+            lseBinding.workerFramesClose(handle, "result")
+        }
+        parentPort.postMessage({ frames: counts.frames, lost: counts.lost, latencies: counts.latencies, results })
+        if (message === "close") parentPort.close()
+    })
+    parentPort.postMessage("ready")
+}
+
+function ask(worker, message) {
+    return new Promise((resolve) => {
+        worker.once("message", resolve)
+        worker.postMessage(message)
+    })
+}
+
+// One streaming run of all handles; `collect` returns the frame counters.
+async function stream(handles, reset, collect) {
+    for (const handle of handles) lseBinding.LSCAN_Capture_Start(handle, 4)
+    await sleep(200)
+    await reset()
+    const elu = performance.eventLoopUtilization()
+    await sleep(ms)
+    const busy = performance.eventLoopUtilization(elu)
+    for (const handle of handles) lseBinding.LSCAN_Capture_Abort(handle)
+    const counts = await collect()
+    const frames = counts.reduce((sum, count) => sum + count.frames, 0)
+    const lost = counts.reduce((sum, count) => sum + count.lost, 0)
+    const latencies = counts.flatMap((count) => count.latencies)
+    return { frames, lost, busyMs: busy.active, utilization: busy.utilization,
+        p99: percentile(latencies, 99) / 1e6 }
+}
+
+function report(name, run) {
+    console.log(`${name.padEnd(7)}  ${String(run.frames).padStart(6)}  ${String(run.lost).padStart(4)}` +
+        `  ${run.p99.toFixed(2).padStart(7)}  ${run.busyMs.toFixed(1).padStart(12)}` +
+        `  ${(run.utilization * 100).toFixed(1).padStart(6)}  ${(run.busyMs * 1000 / Math.max(1, run.frames)).toFixed(1).padStart(14)}`)
+}
+
+async function main() {
+    lseBinding.stubSetDeviceCount(devices)
+    const handles = []
+    for (let i = 0; i < devices; i++) {
+        const { handle } = lseBinding.LSCAN_Main_Initialize(i, false)
+        lseBinding.LSCAN_Capture_SetMode(handle, constants.LSCAN_FLAT_FOUR_FINGERS, constants.LSCAN_RES_500,
+            constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+        lseBinding.setPreviewPolicy(handle, { policy: "ring", capacity: 4 })
+        lseBinding.stubSetPreview(handle, 100, 2)
+        handles.push(handle)
+    }
+    console.log(`${devices} devices at 100 fps for ${ms} ms, imageStatistics() per frame`)
+    console.log("mode     frames  lost  p99 ms  main busy ms  busy %  main us/frame")
+
+    const counts = handles.map(() => counter())
+    handles.forEach((handle, i) => lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, counts[i].preview))
+    report("main", await stream(handles, () => {
+        for (const count of counts) Object.assign(count, { frames: 0, lost: 0, last: -1, latencies: [] })
+    }, () => counts))
+    for (const handle of handles) lseBinding.LSCAN_Capture_RegisterCallbackPreviewImage(handle, null)
+
+    const workers = handles.map((handle) => new Worker(__filename, { workerData: { handle }, argv: process.argv.slice(2) }))
+    await Promise.all(workers.map((worker) => new Promise((resolve) => worker.once("message", resolve))))
+    report("worker", await stream(handles, () => Promise.all(workers.map((worker) => ask(worker, "reset"))),
+        () => Promise.all(workers.map((worker) => ask(worker, "stats")))))
+
+    for (let i = 0; i < captures; i++) {
+        for (const handle of handles) {
+            lseBinding.LSCAN_Capture_Start(handle, 4)
+            lseBinding.LSCAN_Capture_TakeResultImage(handle)
+        }
+        await sleep(20)
+        for (const handle of handles) lseBinding.LSCAN_Capture_Abort(handle)
+    }
+    await sleep(50)
+    const stats = handles.map((handle) => lseBinding.workerFrameStats(handle))
+    const closed = await Promise.all(workers.map((worker) => ask(worker, "close")))
+    console.log(`\nresult images in workers: ${closed.map((count) => count.results).join(", ")}` +
+        ` of ${captures} each; worker preview queues dropped ${stats.map((s) => s.dropped).join(", ")}`)
+    for (const handle of handles) lseBinding.LSCAN_Main_Release(handle, false)
+}
+
+if (isMainThread) {
+    main()
+} else {
+    frameWorker()
+}
@@ -0,0 +1,204 @@
+import { Readable } from "stream"
+import lseBinding from "./lse-binding"
+
+// One capture as a stream of typed events instead of eight callbacks:
+//
+//   const capture = await startCapture(handle, { imageType: constants.LSCAN_FLAT_SINGLE_FINGER })
+//   for await (const event of capture) {
+//       if (event.type === "objectQuality" && event.qualities.every((q) => q === constants.LSCAN_QUALITY_GOOD)) {
+//           capture.takeResultImage()
+//       }
+//   }
+//
+// The native side (native/capture_stream.h) takes over every capture callback of
+// the handle and hands JS all events that fired since the last event-loop turn
+// in one call, in SDK order. Events are
+//   { type: "preview", handle, timestamp, image }
+//   { type: "objectCount", handle, timestamp, state }
+//   { type: "objectQuality", handle, timestamp, qualities }
+//   { type: "takingResultImage", handle, timestamp }
+//   { type: "acquisitionComplete", handle, timestamp }
+//   { type: "resultImage", handle, timestamp, image, imageStatus }
+//   { type: "clearObjectsFromPlaten", handle, timestamp, state }
+//   { type: "keys", handle, timestamp, pressedKeys }
+// with timestamps from now() and images as described in lse-binding.js. The
+// iteration ends after the result image or abort(); breaking out of it aborts
+// the capture. Only one capture per handle can be open at a time.
+const { constants } = lseBinding
+
+// Event type per native CallbackKind value (native/callbacks.h).
+const eventTypes = [null, null, null, "preview", "objectCount", "objectQuality", "takingResultImage",
+    "acquisitionComplete", "resultImage", "clearObjectsFromPlaten", "keys"]
+const recordSize = 8
+
+function statusError(call, status) {
+    const error = new Error(`${call} failed with status ${status}`)
+    error.status = status
+    return error
+}
+
+function toEvent(handle, records, offset, extras) {
+    const type = eventTypes[records[offset]]
+    const value = records[offset + 1]
+    const event = { type, handle, timestamp: records[offset + 2] }
+    const extra = records[offset + 3]
+    switch (type) {
+        case "preview":
+            event.image = extras[extra]
+            break
+        case "resultImage":
+            event.image = extras[extra]
+            event.imageStatus = value
+            break
+        case "objectQuality":
+            event.qualities = Array.from(records.subarray(offset + 4, offset + 4 + value))
+            break
+        case "objectCount":
+        case "clearObjectsFromPlaten":
+            event.state = value
+            break
+        case "keys":
+            event.pressedKeys = value
+            break
+    }
+    return event
+}
+
+export class Capture {
+    constructor(handle, { previewBacklog = 1 } = {}) {
+        if (!Number.isInteger(previewBacklog) || previewBacklog < 0) {
+            throw new TypeError(`previewBacklog must be an integer >= 0, got ${previewBacklog}`)
+        }
+        this.handle = handle
+        // Preview events kept for a consumer that is behind; older ones are
+        // dropped first, and with 0 every preview is. Other events are never
+        // dropped.
+        this.previewBacklog = previewBacklog
+        this.droppedPreviews = 0
+        this.events = []
+        this.pendingPreviews = 0
+        this.waiting = null
+        this.finished = false
+        this.closed = false
+        this.onBatch = (records, extras) => this.receive(records, extras)
+    }
+
+    open() {
+        const status = lseBinding.captureStreamOpen(this.handle, this.onBatch)
+        if (status < 0) throw statusError("captureStreamOpen", status)
+    }
+
+    receive(records, extras) {
+        if (this.finished) return
+        for (let offset = 0; offset < records.length; offset += recordSize) {
+            const event = toEvent(this.handle, records, offset, extras)
+            if (event.type === "preview" && ++this.pendingPreviews > this.previewBacklog) {
+                this.pendingPreviews--
+                this.droppedPreviews++
+                const oldest = this.events.findIndex((e) => e.type === "preview")
+                if (oldest < 0) continue
+                this.events.splice(oldest, 1)
+            }
+            this.events.push(event)
+            if (event.type === "resultImage") {
+                this.finish()
+                break
+            }
+        }
+        this.wake()
+    }
+
+    wake() {
+        if (!this.waiting || (this.events.length === 0 && !this.finished)) return
+        const resolve = this.waiting
+        this.waiting = null
+        resolve(this.next())
+    }
+
+    finish() {
+        this.finished = true
+        if (!this.closed) {
+            this.closed = true
+            lseBinding.captureStreamClose(this.handle)
+        }
+        this.wake()
+    }
+
+    next() {
+        if (this.events.length > 0) {
+            const value = this.events.shift()
+            if (value.type === "preview") this.pendingPreviews--
+            return Promise.resolve({ value, done: false })
+        }
+        if (this.finished) return Promise.resolve({ value: undefined, done: true })
+        return new Promise((resolve) => {
+            this.waiting = resolve
+        })
+    }
+
+    // Early end of iteration (break, throw): abort the capture.
+    return() {
+        if (!this.finished) this.abort()
+        this.events = []
+        return Promise.resolve({ value: undefined, done: true })
+    }
+
+    [Symbol.asyncIterator]() {
+        return this
+    }
+
+    // Acquire the result image; it arrives as the final "resultImage" event.
+    takeResultImage() {
+        const status = lseBinding.LSCAN_Capture_TakeResultImage(this.handle)
+        if (status < 0) throw statusError("LSCAN_Capture_TakeResultImage", status)
+    }
+
+    abort() {
+        const status = lseBinding.LSCAN_Capture_Abort(this.handle)
+        this.finish()
+        return status
+    }
+
+    // The events as an object-mode Readable.
+    readable() {
+        return Readable.from(this)
+    }
+
+    // { events, batches, maxBatch } of the native stream: batches is the number of
+    // JS calls that delivered the events.
+    stats() {
+        return lseBinding.captureStreamStats(this.handle)
+    }
+}
+
+// Set the capture mode, open the event stream and start the capture of
+// `numberOfObjects` objects. Rejects with an Error carrying the SDK `status`.
+export async function startCapture(handle, {
+    imageType,
+    resolution = constants.LSCAN_RES_500,
+    lineOrder = constants.LSCAN_ORIENTATION_TOP_DOWN,
+    captureOptions = 0,
+    numberOfObjects = 1,
+    previewBacklog = 1,
+} = {}) {
+    if (imageType !== undefined) {
+        const { status } = lseBinding.LSCAN_Capture_SetMode(handle, imageType, resolution, lineOrder, captureOptions)
+        if (status < 0) throw statusError("LSCAN_Capture_SetMode", status)
+    }
+    const capture = new Capture(handle, { previewBacklog })
+    capture.open()
+    const status = lseBinding.LSCAN_Capture_Start(handle, numberOfObjects)
+    if (status < 0) {
+        capture.finish()
+        throw statusError("LSCAN_Capture_Start", status)
+    }
+    return capture
+}
+
+// capture(handle, mode): startCapture() where `mode` is the image type or the
+// full option object.
+export function capture(handle, mode) {
+    return startCapture(handle, typeof mode === "object" ? mode : { imageType: mode })
+}
+
+export default capture
@@ -0,0 +1,61 @@
+import lseBinding from "./lse-binding"
+import { OverlayRecords } from "./overlay-scene"
+
+// Headless preview rendering for servers without a window (native/compositor.h):
+//
+//   const compositor = new Compositor(handle, { width: 640, height: 480 }, (frame) => {
+//       websocket.send(frame.data)   // 640 x 480 RGBA
+//   })
+//   compositor.setOverlays([
+//       { key: "finger1", type: "quadrangle", points: [x1, y1, x2, y2, x3, y3, x4, y4], color: 0x00ff00,
+//         belongsToImage: true },
+//       { key: "hint", type: "text", text: "Press harder", x: 10, y: 10, fontSize: 16 },
+//   ])
+//
+// Every preview frame of the device is scaled to the output size natively, on
+// the addon's worker threads, and the overlays are drawn on top; overlays take
+// the same objects as OverlayScene (src/overlay-scene.js). belongsToImage
+// coordinates are preview image pixels, others output pixels. A colour's top
+// byte is its transparency, so 0x80ffffff is a half-transparent white. When
+// frames arrive faster than they are rendered and handled, only the newest is
+// rendered.
+//
+// Options: { width, height, format: "rgba" | "gray", background: 0x00bbggrr,
+// keepAspect: true }. onFrame(frame, timestamp) receives
+// { width, height, channels, data }; data is a pooled Buffer as with preview
+// images.
+//
+// encoding: "jpeg" (or "png" with format "gray") delivers data as the encoded
+// file instead, encoded once on the worker that rendered it, and frame.quality
+// as the JPEG quality used. quality (75) is where JPEG starts and its ceiling;
+// with maxBytesPerSecond set, it drops as far as minQuality to keep the encoded
+// stream within that budget and recovers when frames get smaller again.
+// maxFps skips preview frames beyond that rate before they are even copied. The preview callback keeps running while the compositor is open,
+// with or without an LSCAN_Capture_RegisterCallbackPreviewImage handler.
+export default class Compositor {
+    constructor(handle, options, onFrame) {
+        this.handle = handle
+        this.encoder = new OverlayRecords()
+        const status = lseBinding.compositorOpen(handle, options, (h, frame, timestamp) => onFrame(frame, timestamp))
+        if (status < 0) {
+            throw new Error(`Opening the compositor of handle ${handle} failed with status ${status}`)
+        }
+    }
+
+    // Draw exactly `overlays` from the next frame on.
+    setOverlays(overlays) {
+        const { records, strings } = this.encoder.encode(overlays)
+        return lseBinding.compositorSetOverlays(this.handle, records, strings)
+    }
+
+    // { open, received, rendered, delivered, dropped, skipped, renderMean,
+    //   renderMax, renderLast, encodeMean, bytes, quality }; times in
+    //   nanoseconds, bytes as delivered (encoded or not).
+    stats() {
+        return lseBinding.compositorStats(this.handle)
+    }
+
+    close() {
+        return lseBinding.compositorClose(this.handle)
+    }
+}
@@ -1,10 +1,8 @@
 import lseBinding from "./lse-binding"
-import ref from "ref"
 
 let result = null
 
-var outInt = ref.alloc('int'); // allocate a 4-byte (32-bit) chunk for the output data
-result = lseBinding["_LSCAN_Main_GetDeviceCount@4"](outInt);
-var deviceCount = outInt.deref();
+result = lseBinding.LSCAN_Main_GetDeviceCount();
+var deviceCount = result.deviceCount;
 
-console.log("device count: ", deviceCount);
\ No newline at end of file
+console.log("device count: ", deviceCount);
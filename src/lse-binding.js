@@ -1,21 +1,696 @@
-import ffi from "ffi"
-import ref from "ref"
+import path from "path"
+import native from "../build/Release/lse_native.node"
 
-const int = ref.types.int
-const lseDllLoc = "../resources/LScanEssentials-x86.dll"
+// The native addon (binding.gyp, native/) binds every function of
+// resources/reference/LScanEssentialsApi.h under its SDK name. It loads the SDK
+// at runtime so the same build can run against the vendor DLL on Windows or the
+// stub library (native/stub) on Linux. LSE_LIBRARY overrides the location.
+// Entry points are looked up on first use; LSE_BIND_NOW=1 resolves all of them
+// while loading instead.
+// With the stub loaded, the stub* functions (native/bind_stub.cc) add and remove
+// virtual devices and inject preview streams, latency, errors and disconnects.
+//
+// Functions return the SDK status code; functions with [out] parameters return
+// { status, ...outputs } instead, e.g.
+//   LSCAN_Main_GetDeviceCount() -> { status, deviceCount }
+//
+// Preview and result image callbacks receive
+// { width, height, resolution, bitsPerPixel, data }, where data is a Buffer
+// backed by pooled native memory that returns to the pool when the Buffer is
+// collected (see framePoolStats()). Copy it if it must outlive the handler.
+// Each handle has a pool of its own, preallocated by LSCAN_Capture_SetMode()
+// and LSCAN_Capture_SetActiveArea() for the mode's frames and emptied by
+// LSCAN_TYPE_NONE and LSCAN_Main_Release().
+//
+// Callbacks run on the main thread in the order the SDK fired them, batched
+// into as few event-loop turns as possible (see dispatcherStats()). Every
+// callback gets one extra last argument: the now() timestamp, in nanoseconds,
+// at which the SDK invoked it.
+//
+// The SDK belongs to the main thread, which must load this module before any
+// worker thread does; loading it in a worker first throws ERR_LSE_WORKER_FIRST.
+// Worker threads (worker_threads) may load it after, for a frame consumer's
+// share: workerFramesOpen() takes the preview frames or result images of a
+// handle straight from the SDK thread to a handler in the worker, so the main
+// thread does no work per frame. Workers also get now(),
+// constants and the image kernels (imageCrop(), imageStats(), qualityAnalyze(),
+// segmentSlap() ...); the other functions throw there. Pass the handle
+// to the worker with postMessage().
+const lseLibraryLoc = process.env.LSE_LIBRARY || (process.platform === "win32"
+    ? path.join(__dirname, "../resources/LScanEssentials-x86.dll")
+    : path.join(__dirname, "../build/Release/LScanEssentials.so"))
 
-// /// Retrieve count of connected L SCAN live scanner devices.
-// /// @return status code as defined in LScanEssentialsApi_err.h
-// int WINAPI LSCAN_Main_GetDeviceCount(
-//     int *deviceCount                                ///< [out] Number of connected devices \n
-//     ///  Memory must be provided by caller
-// );
+// Workers have no load(): the library is loaded once, by the first thread.
+if (native.load) native.load(lseLibraryLoc, process.env.LSE_BIND_NOW === "1")
 
-var intType = ref.types.int
-var intPtr = ref.refType(intType);
+// Numeric [out] parameters come back through the addon's shared output slots;
+// the result objects are built here because object literals are far cheaper in
+// JS than from native code.
+const out = native.outputs
 
-const lseBinding = ffi.Library(lseDllLoc, {
-    "_LSCAN_Main_GetDeviceCount@4": [int, [intPtr]],
-})
+// Image kinds of workerFramesOpen(), in native order.
+const workerFrameKinds = ["preview", "result"]
 
-export default lseBinding
\ No newline at end of file
+function workerFrameKind(kind) {
+    const index = workerFrameKinds.indexOf(kind)
+    if (index < 0) throw new TypeError(`Unknown image kind "${kind}"; expected one of ${workerFrameKinds.join(", ")}`)
+    return index
+}
+
+// Preview backpressure policies understood by setPreviewPolicy(), by name.
+const previewPolicies = ["latest", "ring", "block"]
+
+// Kernel variants understood by setSimdLevel(), by name.
+const simdLevels = ["scalar", "sse4.1", "avx2"]
+
+// Planes of a quality map, in native order (QualityPlane in native/quality_map.h).
+const qualityPlaneNames = ["quality", "coherence", "contrast", "clarity", "orientation"]
+
+// Splits the maps Buffer of a quality frame into one view per plane.
+function qualityPlanes(frame) {
+    if (frame.maps) {
+        const size = frame.blocksWide * frame.blocksHigh
+        const planes = {}
+        qualityPlaneNames.forEach((name, i) => {
+            planes[name] = frame.maps.subarray(i * size, (i + 1) * size)
+        })
+        frame.maps = planes
+    }
+    return frame
+}
+
+// Hands of a slap segmentation, in native order (Hand in native/segmentation.h).
+const hands = ["unknown", "right", "left"]
+
+function segmentationArgs({ imageType = native.constants.LSCAN_FLAT_FOUR_FINGERS, hand = "unknown", fingers = 0,
+    minContrast = 10, minBlocks = 6, threads = 0 } = {}) {
+    const index = hands.indexOf(hand)
+    if (index < 0) throw new TypeError(`Unknown hand "${hand}"; expected one of ${hands.join(", ")}`)
+    return [imageType, index, fingers, minContrast, minBlocks, threads]
+}
+
+// Output formats of compositorOpen(), by name.
+const compositorFormats = ["gray", "rgba"]
+
+// PNG row filters and result image encodings, by name.
+const pngFilters = ["none", "sub", "up", "paeth"]
+const encodings = ["none", "png", "jpeg"]
+
+function pngFilter(filter) {
+    const index = pngFilters.indexOf(filter)
+    if (index < 0) throw new TypeError(`Unknown PNG filter "${filter}"; expected one of ${pngFilters.join(", ")}`)
+    return index
+}
+
+function eightBit(image) {
+    if (image.bitsPerPixel !== undefined && image.bitsPerPixel !== 8) {
+        throw new TypeError(`Only 8-bit images are supported, got ${image.bitsPerPixel} bits per pixel`)
+    }
+    return image
+}
+
+// Device index of every open handle, from the Initialize calls and the session
+// functions. Progress is reported per device index, so handle-based calls need
+// it to route progress; a handle not listed here gets none.
+const handleDevices = new Map()
+const deviceOf = (handle) => handleDevices.get(handle)
+
+// Handle of every session device, by device index, to forget on sessionClose().
+const sessionHandles = new Map()
+
+function noteSessionHandle(deviceIndex, handle) {
+    if (sessionHandles.has(deviceIndex)) handleDevices.delete(sessionHandles.get(deviceIndex))
+    sessionHandles.delete(deviceIndex)
+    if (handle >= 0) {
+        handleDevices.set(handle, deviceIndex)
+        sessionHandles.set(deviceIndex, handle)
+    }
+}
+
+// The SDK has a single progress callback. It is shared between the function
+// registered with LSCAN_Main_RegisterCallbackProgress() and the onProgress
+// options of the *Async calls in flight.
+let userProgress = null
+const progressListeners = new Map()
+
+function dispatchProgress(deviceIndex, progressValue, timestamp) {
+    if (userProgress) userProgress(deviceIndex, progressValue, timestamp)
+    const listeners = progressListeners.get(deviceIndex)
+    if (listeners) {
+        for (const listener of listeners) listener(progressValue, deviceIndex)
+    }
+}
+
+function updateProgressRegistration() {
+    const wanted = userProgress || progressListeners.size > 0 ? dispatchProgress : null
+    return native.LSCAN_Main_RegisterCallbackProgress(wanted)
+}
+
+function abortError(signal, result) {
+    const error = new Error("The operation was aborted")
+    error.name = "AbortError"
+    error.cause = signal.reason
+    error.result = result
+    return error
+}
+
+function addProgressListener(deviceIndex, listener) {
+    if (!progressListeners.has(deviceIndex)) progressListeners.set(deviceIndex, new Set())
+    progressListeners.get(deviceIndex).add(listener)
+    if (progressListeners.size === 1 && !userProgress) updateProgressRegistration()
+}
+
+function removeProgressListener(deviceIndex, listener) {
+    const listeners = progressListeners.get(deviceIndex)
+    if (!listeners || !listeners.delete(listener) || listeners.size > 0) return
+    progressListeners.delete(deviceIndex)
+    if (progressListeners.size === 0 && !userProgress) updateProgressRegistration()
+}
+
+// The device count callback is single too, shared with the onDeviceCount()
+// listeners the same way.
+let userDeviceCount = null
+const deviceCountListeners = new Set()
+
+function dispatchDeviceCount(deviceCount, timestamp) {
+    if (userDeviceCount) userDeviceCount(deviceCount, timestamp)
+    for (const listener of deviceCountListeners) listener(deviceCount, timestamp)
+}
+
+function updateDeviceCountRegistration() {
+    const wanted = userDeviceCount || deviceCountListeners.size > 0 ? dispatchDeviceCount : null
+    return native.LSCAN_Main_RegisterCallbackDeviceCount(wanted)
+}
+
+// Common part of the *Async calls: progress subscription for `deviceIndex` and
+// cancellation through `signal`. `cancel` asks the SDK to stop early; calls the
+// SDK cannot interrupt still run to completion before the promise rejects.
+async function runAsync(start, deviceIndex, { onProgress, signal } = {}, cancel) {
+    if (signal && signal.aborted) throw abortError(signal)
+    if (deviceIndex === undefined) onProgress = null
+    if (onProgress) addProgressListener(deviceIndex, onProgress)
+    const onAbort = () => cancel && cancel()
+    if (signal) signal.addEventListener("abort", onAbort, { once: true })
+    try {
+        const result = await start()
+        if (signal && signal.aborted) throw abortError(signal, result)
+        return result
+    } finally {
+        if (signal) signal.removeEventListener("abort", onAbort)
+        if (onProgress) removeProgressListener(deviceIndex, onProgress)
+    }
+}
+
+const lseBinding = {
+    ...native,
+
+    LSCAN_Main_GetAPIVersion() {
+        const status = native.LSCAN_Main_GetAPIVersion()
+        return { status, majorVersion: out[0], minorVersion: out[1], patchVersion: out[2], buildVersion: out[3] }
+    },
+    LSCAN_Main_GetDeviceCount() {
+        const status = native.LSCAN_Main_GetDeviceCount()
+        return { status, deviceCount: out[0] }
+    },
+    LSCAN_Main_Initialize(deviceIndex, reset) {
+        const status = native.LSCAN_Main_Initialize(deviceIndex, reset)
+        if (status >= 0) handleDevices.set(out[0], deviceIndex)
+        return { status, handle: out[0] }
+    },
+    LSCAN_Main_Initialize_ExternalVisualization(deviceIndex, reset, pipeName) {
+        const status = native.LSCAN_Main_Initialize_ExternalVisualization(deviceIndex, reset, pipeName)
+        if (status >= 0) handleDevices.set(out[0], deviceIndex)
+        return { status, handle: out[0] }
+    },
+    LSCAN_Main_Release(handle, sendToStandby) {
+        handleDevices.delete(handle)
+        return native.LSCAN_Main_Release(handle, sendToStandby)
+    },
+    LSCAN_Main_RegisterCallbackProgress(callback) {
+        userProgress = callback
+        return updateProgressRegistration()
+    },
+    // Calls `listener(progressValue, deviceIndex)` with the progress of
+    // `deviceIndex`, next to the LSCAN_Main_RegisterCallbackProgress() handler;
+    // returns the function that unsubscribes it.
+    onProgress(deviceIndex, listener) {
+        addProgressListener(deviceIndex, listener)
+        return () => removeProgressListener(deviceIndex, listener)
+    },
+
+    LSCAN_Main_RegisterCallbackDeviceCount(callback) {
+        userDeviceCount = callback
+        return updateDeviceCountRegistration()
+    },
+    // Calls `listener(deviceCount, timestamp)` whenever devices come or go, next
+    // to the LSCAN_Main_RegisterCallbackDeviceCount() handler; returns the
+    // function that unsubscribes it.
+    onDeviceCount(listener) {
+        deviceCountListeners.add(listener)
+        if (deviceCountListeners.size === 1 && !userDeviceCount) updateDeviceCountRegistration()
+        return () => {
+            if (deviceCountListeners.delete(listener) && deviceCountListeners.size === 0 && !userDeviceCount) {
+                updateDeviceCountRegistration()
+            }
+        }
+    },
+
+    // Promise variants of the calls that block for seconds. They run on native
+    // threads, so the event loop keeps serving other work. Each takes an optional
+    // last argument { onProgress(progressValue, deviceIndex), signal }; an
+    // aborted signal rejects the promise with an AbortError. The handle-based
+    // calls are interrupted with LSCAN_Capture_Abort(); Initialize and the
+    // infield test cannot be interrupted, and a device initialized after its
+    // signal was aborted is released again. onProgress of a handle-based call
+    // needs a handle from an Initialize call or the session functions.
+    LSCAN_Main_InitializeAsync(deviceIndex, reset, options) {
+        return runAsync(async () => {
+            const result = await native.LSCAN_Main_InitializeAsync(deviceIndex, reset)
+            if (result.status >= 0) {
+                handleDevices.set(result.handle, deviceIndex)
+                if (options && options.signal && options.signal.aborted) {
+                    handleDevices.delete(result.handle)
+                    native.LSCAN_Main_Release(result.handle, false)
+                }
+            }
+            return result
+        }, deviceIndex, options)
+    },
+    LSCAN_Main_ImageQualityInfieldTestAsync(deviceIndex, logFilePath, options) {
+        return runAsync(() => native.LSCAN_Main_ImageQualityInfieldTestAsync(deviceIndex, logFilePath),
+            deviceIndex, options)
+    },
+    LSCAN_Main_CheckCleanlinessAsync(handle, options) {
+        return runAsync(() => native.LSCAN_Main_CheckCleanlinessAsync(handle), deviceOf(handle), options,
+            () => native.LSCAN_Capture_Abort(handle))
+    },
+    LSCAN_Main_ForceReadjustmentAsync(handle, options) {
+        return runAsync(() => native.LSCAN_Main_ForceReadjustmentAsync(handle), deviceOf(handle), options,
+            () => native.LSCAN_Capture_Abort(handle))
+    },
+    LSCAN_Capture_OptimizeContrastAsync(handle, options) {
+        return runAsync(() => native.LSCAN_Capture_OptimizeContrastAsync(handle), deviceOf(handle), options,
+            () => native.LSCAN_Capture_Abort(handle))
+    },
+
+    // The session functions of native/bind_session.cc, keeping track of the
+    // session handles for progress routing.
+    sessionOpen(reset, deviceIndices) {
+        return native.sessionOpen(reset, deviceIndices).then((results) => {
+            for (const result of results) noteSessionHandle(result.deviceIndex, result.handle)
+            return results
+        })
+    },
+    sessionCall(deviceIndex, name, ...args) {
+        const promise = native.sessionCall(deviceIndex, name, ...args)
+        if (name !== "LSCAN_Main_Release") return promise
+        return promise.then((status) => {
+            noteSessionHandle(deviceIndex, -1)
+            return status
+        })
+    },
+    sessionRecover(deviceIndex, reset, calls) {
+        return native.sessionRecover(deviceIndex, reset, calls).then((result) => {
+            noteSessionHandle(deviceIndex, result.handle)
+            return result
+        })
+    },
+    sessionClose(sendToStandby) {
+        return native.sessionClose(sendToStandby).then((results) => {
+            for (const result of results) noteSessionHandle(result.deviceIndex, -1)
+            return results
+        })
+    },
+
+    // Several LScanPropertyIds in one call, through the native property cache
+    // that LSCAN_Main_GetProperty also uses (see native/property_cache.h).
+    // Returns { status, values, statuses, hits }, values in the order of `ids`.
+    // The Async variant reads uncached properties off the main thread.
+    getProperties(handle, ids) {
+        return native.getProperties(handle, ids)
+    },
+    getPropertiesAsync(handle, ids) {
+        return native.getPropertiesAsync(handle, ids)
+    },
+    // { hits, misses, invalidations, entries, deviceInfoHits, deviceInfoMisses };
+    // the device infos are those sessionOpen() reports, cached per device index
+    // until devices come or go.
+    propertyCacheStats() {
+        return native.propertyCacheStats()
+    },
+    // Forgets the cached properties of `handle`, or of every handle and the
+    // cached device infos.
+    propertyCacheClear(handle = -1) {
+        return native.propertyCacheClear(handle)
+    },
+
+    LSCAN_Capture_IsModeAvailable(handle, imageType, imageResolution) {
+        const status = native.LSCAN_Capture_IsModeAvailable(handle, imageType, imageResolution)
+        return { status, isAvailable: out[0] !== 0 }
+    },
+    LSCAN_Capture_SetMode(handle, imageType, imageResolution, lineOrder, captureOptions) {
+        const status = native.LSCAN_Capture_SetMode(handle, imageType, imageResolution, lineOrder, captureOptions)
+        return { status, resultWidth: out[0], resultHeight: out[1], baseResolutionX: out[2], baseResolutionY: out[3] }
+    },
+    LSCAN_Capture_IsActive(handle) {
+        const status = native.LSCAN_Capture_IsActive(handle)
+        return { status, isActive: out[0] !== 0 }
+    },
+    LSCAN_Capture_GetContrast(handle) {
+        const status = native.LSCAN_Capture_GetContrast(handle)
+        return { status, contrastValue: out[0] }
+    },
+
+    LSCAN_Controls_GetAvailableBeeper(handle) {
+        const status = native.LSCAN_Controls_GetAvailableBeeper(handle)
+        return { status, beeperType: out[0] }
+    },
+    LSCAN_Controls_GetAvailableKeys(handle) {
+        const status = native.LSCAN_Controls_GetAvailableKeys(handle)
+        return { status, keypadType: out[0], keyCount: out[1], availableKeys: out[2] }
+    },
+    LSCAN_Controls_GetAvailableLEDs(handle) {
+        const status = native.LSCAN_Controls_GetAvailableLEDs(handle)
+        return { status, ledType: out[0], ledCount: out[1], availableLEDs: out[2] }
+    },
+    LSCAN_Controls_GetActiveLEDs(handle) {
+        const status = native.LSCAN_Controls_GetActiveLEDs(handle)
+        return { status, activeLEDs: out[0] }
+    },
+    LSCAN_Controls_DisplayShowNextFingerSelection(handle) {
+        const status = native.LSCAN_Controls_DisplayShowNextFingerSelection(handle)
+        return { status, nextCtrlLeft: out[0] }
+    },
+    // Queues the LED, key, beeper or display screen call `name` (e.g.
+    // "LSCAN_Controls_SetActiveLEDs") with its arguments after the handle, as
+    // the direct binding takes them, on the controls queue of `handle`
+    // (native/controls_queue.h); resolves to its status. A call replaces the
+    // waiting call of the same control (every display screen is one control),
+    // calls that would leave the device as it is are skipped, and the queue
+    // waits while a capture call of the handle runs.
+    queueControl(handle, name, ...args) {
+        return native.queueControl(handle, name, ...args)
+    },
+    // { requests, calls, coalesced, skipped, saved, failed, pending, callNs,
+    //   maxCallNs, yields, yieldNs } of the controls queue of `handle`: saved
+    // counts queued calls that needed no device round trip of their own, yields
+    // the waits for capture calls; nanoseconds.
+    controlsStats(handle) {
+        return native.controlsStats(handle)
+    },
+
+    LSCAN_Visualization_GetScaleFactor(handle) {
+        const status = native.LSCAN_Visualization_GetScaleFactor(handle)
+        return { status, scaleFactor: out[0] }
+    },
+    LSCAN_Visualization_AddOverlayText(handle, text, posX, posY, color, fontName, fontSize, belongsToImage) {
+        const status = native.LSCAN_Visualization_AddOverlayText(handle, text, posX, posY, color, fontName,
+            fontSize, belongsToImage)
+        return { status, overlayHandle: out[0] }
+    },
+    LSCAN_Visualization_AddOverlayQuadrangle(handle, x1, y1, x2, y2, x3, y3, x4, y4, color, lineWidth,
+        belongsToImage) {
+        const status = native.LSCAN_Visualization_AddOverlayQuadrangle(handle, x1, y1, x2, y2, x3, y3, x4, y4,
+            color, lineWidth, belongsToImage)
+        return { status, overlayHandle: out[0] }
+    },
+    LSCAN_Visualization_AddOverlayLine(handle, x1, y1, x2, y2, color, lineWidth, belongsToImage) {
+        const status = native.LSCAN_Visualization_AddOverlayLine(handle, x1, y1, x2, y2, color, lineWidth,
+            belongsToImage)
+        return { status, overlayHandle: out[0] }
+    },
+    // Low-level entry of OverlayScene (src/overlay-scene.js), which builds the records.
+    overlaySceneCommit(handle, records, strings) {
+        const status = native.overlaySceneCommit(handle, records, strings)
+        return { status, calls: out[0], adds: out[1], modifies: out[2], shows: out[3], removes: out[4], reused: out[5] }
+    },
+    // Headless replacement of the SDK's preview window (native/compositor.h):
+    // every preview frame of `handle`, scaled to width x height and overlaid,
+    // is passed to onFrame(handle, { width, height, channels, data }, timestamp)
+    // as 8-bit gray or RGBA pixels. keepAspect letterboxes the preview on the
+    // background colour (0x00bbggrr) instead of stretching it. Calling it again
+    // reconfigures. Returns the SDK status code. See Compositor (src/compositor.js).
+    compositorOpen(handle, { width, height, format = "rgba", background = 0, keepAspect = true, encoding = "none",
+        quality = 75, minQuality = 1, maxBytesPerSecond = 0, maxFps = 0 }, onFrame) {
+        const index = compositorFormats.indexOf(format)
+        if (index < 0) {
+            throw new TypeError(`Unknown compositor format "${format}"; expected one of ${compositorFormats.join(", ")}`)
+        }
+        const encodingIndex = encodings.indexOf(encoding)
+        if (encodingIndex < 0) {
+            throw new TypeError(`Unknown encoding "${encoding}"; expected one of ${encodings.join(", ")}`)
+        }
+        return native.compositorOpen(handle, width, height, index, background, keepAspect, encodingIndex, quality,
+            Math.min(minQuality, quality), maxBytesPerSecond, maxFps, onFrame)
+    },
+
+    // What happens to preview frames the handler of `handle` cannot keep up with:
+    //   latest: only the newest frame waits (default)
+    //   ring:   the newest `capacity` frames wait; the oldest is overwritten
+    //   block:  up to `capacity` frames wait; the SDK's preview thread then
+    //           waits up to `timeoutMs` for room before dropping the new frame
+    // Returns the SDK status code (LSCAN_ERR_INVALID_PARAM_VALUE for bad values).
+    setPreviewPolicy(handle, { policy = "latest", capacity = 1, timeoutMs = 0 } = {}) {
+        const index = previewPolicies.indexOf(policy)
+        if (index < 0) {
+            throw new TypeError(`Unknown preview policy "${policy}"; expected one of ${previewPolicies.join(", ")}`)
+        }
+        return native.setPreviewPolicy(handle, index, capacity, timeoutMs)
+    },
+    // { policy, capacity, timeoutMs, received, delivered, dropped, queued }
+    previewStats(handle) {
+        const stats = native.previewStats(handle)
+        stats.policy = previewPolicies[stats.policy]
+        return stats
+    },
+    // Worker threads only: call handler(handle, image, timestamp) for every
+    // preview frame (`kind` "preview") or handler(handle, image, imageStatus,
+    // timestamp) for every result image (`kind` "result") of `handle`, on this
+    // worker and without passing through the main thread. The images are those
+    // of the main thread's callbacks, over pooled native memory; result images
+    // are neither encoded nor segmented. Preview frames wait per the options of
+    // setPreviewPolicy(), in a queue of the worker's own. The main thread's
+    // callbacks keep working alongside. Returns the SDK status code:
+    // LSCAN_ERR_RESOURCE_LOCKED if another worker takes these images,
+    // LSCAN_ERR_NOT_SUPPORTED on the main thread. The images stop when the
+    // worker exits or calls workerFramesClose().
+    workerFramesOpen(handle, kind, handler, { policy = "latest", capacity = 1, timeoutMs = 0 } = {}) {
+        const index = previewPolicies.indexOf(policy)
+        if (index < 0) {
+            throw new TypeError(`Unknown preview policy "${policy}"; expected one of ${previewPolicies.join(", ")}`)
+        }
+        return native.workerFramesOpen(handle, workerFrameKind(kind), handler, index, capacity, timeoutMs)
+    },
+    workerFramesClose(handle, kind) {
+        return native.workerFramesOpen(handle, workerFrameKind(kind), null, 0, 1, 0)
+    },
+    // Any thread: { preview, result, policy, capacity, received, delivered,
+    // dropped, queued, results }, where preview and result tell whether a
+    // worker takes those images of `handle`, the counters in between are of its
+    // preview queue and results counts the result images handed over.
+    workerFrameStats(handle) {
+        const stats = native.workerFrameStats(handle)
+        stats.policy = previewPolicies[stats.policy]
+        return stats
+    },
+    // Always-on capture latency of `handle`, in nanoseconds (see native/latency.h):
+    // { captures, fps, previewFrames, previewDropped, lastCapture, lastStart, stages },
+    // where stages.{device, processing, bridge, handler, capture, preview, startup}
+    // are { count, min, max, mean, p50, p90, p99, p999 } and lastStart holds the
+    // { start, firstPreview } timestamps of the last startup measured.
+    latencyStats(handle) {
+        return native.latencyStats(handle)
+    },
+    // Counters of the pool behind image Buffers: { allocations, reuses,
+    // preallocated, outstanding, peakOutstanding, pooledBlocks, pooledBytes }.
+    // With a handle, those of its own pool plus { imageType, resolution,
+    // reservedBytes, captures, steadyCaptures, lastCapture, rss }, where
+    // steadyCaptures counts captures that allocated no frame memory and
+    // lastCapture is { capturing, frames, allocations, peakRss }; bytes.
+    framePoolStats(handle) {
+        return native.framePoolStats(handle)
+    },
+    // Clears the latency histograms of `handle`, or of every handle.
+    latencyReset(handle = -1) {
+        return native.latencyReset(handle)
+    },
+    // Measures the next startup of `handle` (first preview frame) from now rather
+    // than from its LSCAN_Capture_Start(), e.g. to include a LSCAN_Capture_SetMode().
+    // Returns the now() timestamp.
+    latencyMarkStart(handle) {
+        return native.latencyMarkStart(handle)
+    },
+    // The latency histograms and frame counters of every handle as Prometheus
+    // text, e.g. for a /metrics endpoint.
+    latencyPrometheus() {
+        return native.latencyPrometheus()
+    },
+
+    // Host-side transforms of delivered 8-bit images, run natively with SIMD
+    // kernels (see native/image_kernels.h). Results are new pooled images.
+    flipImage(image) {
+        eightBit(image)
+        native.imageFlipVertical(image.data, image.width, image.height)
+        return image
+    },
+    cropImage(image, { x, y, width, height }) {
+        eightBit(image)
+        return native.imageCrop(image.data, image.width, image.height, image.resolution || 0, x, y, width, height)
+    },
+    // factor 2 or 4, e.g. 1000 ppi to 500 ppi; the result's resolution is divided too.
+    downscaleImage(image, factor = 2) {
+        eightBit(image)
+        return native.imageDownscale(image.data, image.width, image.height, image.resolution || 0, factor)
+    },
+    // { count, min, max, mean, stdDev, p1, p50, p99, histogram: Uint32Array(256) }
+    imageStatistics(image) {
+        eightBit(image)
+        return native.imageStats(image.data, image.width, image.height)
+    },
+    // { active, detected }: kernel variant in use and the best the CPU supports.
+    simdLevel() {
+        const { active, detected } = native.simdLevel()
+        return { active: simdLevels[active], detected: simdLevels[detected] }
+    },
+    // PNG-encode an 8-bit image on the native worker pool. The pixels are copied
+    // first, so `image` may be changed as soon as the call returns.
+    //   level:  zlib level 0-9; 1 is fast and usually within a few percent of 6
+    //   filter: PNG row filter, "none", "sub", "up" (default) or "paeth"
+    encodePng(image, { level = 1, filter = "up" } = {}) {
+        eightBit(image)
+        return native.encodePng(image.data, image.width, image.height, image.resolution || 0, level, pngFilter(filter))
+    },
+    // Baseline JPEG of an 8-bit gray image; resolves to a Buffer.
+    //   quality: 1-100 on the IJG scale
+    encodeJpeg(image, { quality = 75 } = {}) {
+        eightBit(image)
+        return native.encodeJpeg(image.data, image.width, image.height, quality)
+    },
+    // Encode every result image of `handle` in the background, starting on the
+    // SDK thread as the image arrives. Result images then carry an `encoded`
+    // promise for the file. Pass null to turn encoding off. Returns the status.
+    //   format: "png" (default), "jpeg" or "none"; level and filter apply to
+    //   PNG, quality (default 75) to JPEG
+    setResultImageEncoding(handle, options) {
+        const { format = "png", level = 1, filter = "up", quality = 75 } = options || { format: "none" }
+        const index = encodings.indexOf(format)
+        if (index < 0) throw new TypeError(`Unknown encoding "${format}"; expected one of ${encodings.join(", ")}`)
+        return native.setResultImageEncoding(handle, index, level, pngFilter(filter), quality)
+    },
+    // { jobs, failed, bytesIn, bytesOut, encodeNs, pending, mbPerSecondPerCore }
+    encoderStats() {
+        const stats = native.encoderStats()
+        stats.mbPerSecondPerCore = stats.encodeNs > 0 ? (stats.bytesIn / stats.encodeNs) * 1000 : 0
+        return stats
+    },
+    // Use a lower kernel variant ("scalar", "sse4.1", "avx2"); returns the one in effect.
+    setSimdLevel(level) {
+        const index = simdLevels.indexOf(level)
+        if (index < 0) throw new TypeError(`Unknown SIMD level "${level}"; expected one of ${simdLevels.join(", ")}`)
+        return simdLevels[native.setSimdLevel(index)]
+    },
+
+    // Fingerprint quality of an 8-bit image in 16 x 16 blocks, computed natively
+    // on several threads (native/quality_map.h), without the auto-capture
+    // licence. Returns { width, height, blocksWide, blocksHigh, maps, objects,
+    // quality, analyzeNs }:
+    //   maps:    { quality, coherence, contrast, clarity, orientation }, one byte
+    //            per block, row by row (scores * 255; orientation in degrees), or
+    //            null with maps: false
+    //   objects: fingers left to right, { x, y, width, height, blocks, quality,
+    //            coherence, contrast, clarity, orientation, mean }, scores 0-1
+    //   quality: that of the worst object, 0 without objects
+    // Options: objects (how many to report and judge; 0 for up to four),
+    // minContrast (10: block standard deviation that counts as finger),
+    // minBlocks (6: smallest object), threads (0: one per core), maps (true).
+    analyzeQuality(image, { objects = 0, minContrast = 10, minBlocks = 6, threads = 0, maps = true } = {}) {
+        eightBit(image)
+        return qualityPlanes(native.qualityAnalyze(image.data, image.width, image.height, objects, minContrast,
+            minBlocks, threads, maps))
+    },
+    // analyzeQuality() of every preview frame of `handle`, delivered to
+    // onFrame(handle, frame, timestamp); frames arriving during an analysis
+    // replace each other. Frames also carry `stable`, the frames in a row with
+    // `objects` objects (at least one if 0) all at `threshold` quality, and
+    // `trigger`, set once when that reaches `stableFrames`: the moment to take
+    // the result image. maxFps caps the analysis rate. Calling it again
+    // reconfigures. Returns the SDK status code. See QualityMap (src/quality-map.js).
+    qualityMapOpen(handle, { objects = 0, minContrast = 10, minBlocks = 6, threads = 0, maps = true, threshold = 0.6,
+        stableFrames = 3, maxFps = 0 } = {}, onFrame) {
+        return native.qualityMapOpen(handle, objects, minContrast, minBlocks, threads, maps, threshold, stableFrames,
+            maxFps, (h, frame, timestamp) => onFrame(h, qualityPlanes(frame), timestamp))
+    },
+    // Lets the trigger of `handle` fire again; call when a capture starts.
+    qualityMapRearm(handle) {
+        return native.qualityMapRearm(handle)
+    },
+    qualityMapClose(handle) {
+        return native.qualityMapClose(handle)
+    },
+    // { open, received, analyzed, delivered, dropped, skipped, triggers,
+    //   analyzeMean, analyzeMax, analyzeLast, frameInterval, overBudget,
+    //   hardwareThreads }: times in nanoseconds; frameInterval is the smoothed
+    //   preview interval, the budget overBudget counts analyses beyond.
+    qualityMapStats(handle) {
+        return native.qualityMapStats(handle)
+    },
+
+    // The fingers of an 8-bit slap image, segmented natively (native/segmentation.h)
+    // with one thread per finger. Returns { width, height, expected, complete,
+    // hand, handInferred, splits, fingers, segmentNs }, fingers left to right as
+    // { x, y, width, height, stride, position, hand, pixels, centerX, centerY,
+    // orientation, quality, data }:
+    //   position:    ANSI/NIST-ITL finger position (1 right thumb ... 10 left
+    //                little finger), 0 when unknown
+    //   orientation: principal axis in degrees from the x axis, 90 upright
+    //   data:        view into image.data, no copy: row r of the finger starts
+    //                at data[r * stride]; cropImage(image, finger) packs it
+    // Options: imageType (LSCAN_FLAT_FOUR_FINGERS; sets the fingers expected and
+    // their positions), hand ("unknown": inferred for four fingers, "right",
+    // "left"), fingers (0: those of imageType), minContrast, minBlocks and
+    // threads as for analyzeQuality().
+    segmentSlap(image, options) {
+        eightBit(image)
+        return native.segmentSlap(image.data, image.width, image.height, ...segmentationArgs(options))
+    },
+    // Segment every result image of `handle` on the native thread pool as it
+    // arrives; result images then carry `segmentation`, as from segmentSlap(), its
+    // finger data viewing the image's own buffer. Pass null to turn it off.
+    // Returns the status.
+    setResultImageSegmentation(handle, options) {
+        return native.setResultImageSegmentation(handle, !!options, ...segmentationArgs(options || {}))
+    },
+    // { images, fingers, incomplete, splits, segmentNs, maxSegmentNs } over all
+    // segmentations; times in nanoseconds.
+    segmentationStats() {
+        return native.segmentationStats()
+    },
+
+    // Record every SDK callback (of `handle` only, if given) with its images to
+    // a memory-mapped file at `path`, for replay() on a machine without a scanner.
+    // Throws if the file cannot be created. Returns the status.
+    startRecording(path, { handle = -1 } = {}) {
+        return native.recordStart(path, handle)
+    },
+    // Stops recording; returns { active, events, bytes, failed }.
+    stopRecording() {
+        return native.recordStop()
+    },
+    // { active, events, bytes, failed }
+    recordingStats() {
+        return native.recordStats()
+    },
+    // Fire the callbacks of a recording again, to the registered callbacks or an
+    // open capture() stream, at `speed` times the recorded pace; speed 0 replays
+    // as fast as the handlers take them. `handle` replaces the recorded handle.
+    // Resolves with { events, bytes, durationNs, stopped }.
+    replay(path, { speed = 1, handle = -1 } = {}) {
+        return native.replay(path, speed, handle)
+    },
+    // Stops every replay in progress; returns how many there were.
+    stopReplay() {
+        return native.replayStop()
+    },
+}
+
+export default lseBinding
@@ -0,0 +1,115 @@
+import lseBinding from "./lse-binding"
+
+// The overlays of one device as a declarative scene:
+//
+//   const scene = new OverlayScene(handle)
+//   // every preview frame:
+//   scene.commit([
+//       { key: "finger1", type: "quadrangle", points: [x1, y1, x2, y2, x3, y3, x4, y4], color: 0x00ff00 },
+//       { key: "hint", type: "text", text: "Press harder", x: 10, y: 10, fontSize: 14 },
+//   ])
+//
+// commit() hands the whole set to native code (native/overlay_scene.h) in one
+// call, which diffs it against the previous commit and issues only the
+// LSCAN_Visualization_* calls that differ. Overlays are matched by `key`;
+// overlays that disappear are hidden and reused for later ones of the same
+// type, color, line width and font. Overlays are
+//   { key, type: "text", text, x, y, color, font, fontSize, belongsToImage, visible }
+//   { key, type: "quadrangle", points: [8 coordinates], color, lineWidth, belongsToImage, visible }
+//   { key, type: "line", points: [4 coordinates], color, lineWidth, belongsToImage, visible }
+// color (0x00bbggrr) defaults to 0, lineWidth to 1, font to "Arial", fontSize
+// to 12, belongsToImage to false and visible to true.
+//
+// The scene owns the overlays it creates: after LSCAN_Visualization_RemoveAllOverlays()
+// or ShowAllOverlays(), call reset({ remove: false }) before the next commit().
+
+// Overlay type per native OverlayKind value, and the values per record.
+const overlayTypes = ["text", "quadrangle", "line"]
+const recordSize = 16
+
+// Overlay objects as the Int32Array records and strings native code reads
+// (native/bind_visualization.cc), with stable numeric ids per key. Shared with
+// the headless Compositor (src/compositor.js).
+export class OverlayRecords {
+    constructor() {
+        this.ids = new Map()
+        this.records = new Int32Array(recordSize * 32)
+    }
+
+    idOf(key) {
+        let id = this.ids.get(key)
+        if (id === undefined) {
+            id = this.ids.size
+            this.ids.set(key, id)
+        }
+        return id
+    }
+
+    // { records, strings } for `overlays`; records is a view valid until the next encode().
+    encode(overlays) {
+        if (this.records.length < overlays.length * recordSize) {
+            this.records = new Int32Array(overlays.length * recordSize * 2)
+        }
+        const records = this.records
+        const strings = []
+        overlays.forEach((overlay, i) => {
+            const kind = overlayTypes.indexOf(overlay.type)
+            if (kind < 0) {
+                throw new TypeError(`Unknown overlay type "${overlay.type}"; expected one of ${overlayTypes.join(", ")}`)
+            }
+            const offset = i * recordSize
+            records[offset] = this.idOf(overlay.key)
+            records[offset + 1] = kind
+            records[offset + 2] = overlay.visible === false ? 0 : 1
+            records[offset + 3] = overlay.color || 0
+            records[offset + 4] = overlay.lineWidth || 1
+            records[offset + 5] = overlay.fontSize || 12
+            records[offset + 6] = overlay.belongsToImage ? 1 : 0
+            records[offset + 7] = strings.length
+            records.fill(0, offset + 8, offset + recordSize)
+            if (kind === 0) {
+                records[offset + 8] = overlay.x
+                records[offset + 9] = overlay.y
+                strings.push(String(overlay.text), overlay.font || "Arial")
+            } else {
+                const count = kind === 1 ? 8 : 4
+                if (!overlay.points || overlay.points.length !== count) {
+                    throw new TypeError(`A ${overlay.type} overlay needs ${count} point coordinates`)
+                }
+                records.set(overlay.points, offset + 8)
+            }
+        })
+        return { records: records.subarray(0, overlays.length * recordSize), strings }
+    }
+
+    clear() {
+        this.ids.clear()
+    }
+}
+
+export default class OverlayScene {
+    constructor(handle) {
+        this.handle = handle
+        this.encoder = new OverlayRecords()
+    }
+
+    // Show exactly `overlays`. Returns { status, calls, adds, modifies, shows,
+    // removes, reused } for this commit; status is the first failing SDK status.
+    commit(overlays) {
+        const { records, strings } = this.encoder.encode(overlays)
+        return lseBinding.overlaySceneCommit(this.handle, records, strings)
+    }
+
+    // Forget the scene; with remove (default) its overlays are removed from the device too.
+    reset({ remove = true } = {}) {
+        this.encoder.clear()
+        return lseBinding.overlaySceneReset(this.handle, remove)
+    }
+
+    // { frames, calls, adds, modifies, shows, removes, reused, lastFrameCalls,
+    //   callsPerFrame, redrawCalls, overlays, parked }; redrawCalls is what
+    //   clearing and re-adding every overlay each commit would have taken.
+    stats() {
+        return lseBinding.overlaySceneStats(this.handle)
+    }
+}
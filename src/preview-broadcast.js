@@ -0,0 +1,301 @@
+import crypto from "crypto"
+import http from "http"
+import Compositor from "./compositor"
+
+// One scanner's preview for many viewers (supervisor screens, dashboards):
+//
+//   const broadcast = new PreviewBroadcast(handle, { width: 640, height: 480, maxFps: 15 })
+//   broadcast.setOverlays([...])                 // as Compositor.setOverlays()
+//   const server = await broadcast.listen(8080)  // GET /preview: MJPEG, WebSocket on /preview
+//
+// or, inside an existing server:
+//
+//   server.on("request", (req, res) => broadcast.handleRequest(req, res) || app(req, res))
+//   server.on("upgrade", (req, socket, head) => broadcast.handleUpgrade(req, socket, head) || socket.destroy())
+//
+// Every preview frame is scaled, drawn on and JPEG-encoded once, natively (see
+// Compositor with encoding "jpeg"), and the same Buffer is written to every
+// viewer: as a multipart/x-mixed-replace part for HTTP clients (an <img> tag
+// plays it) and as one binary message per frame for WebSocket clients. Viewers
+// cost socket writes, not encodes.
+//
+// A viewer whose socket has not taken `maxQueuedFrames` earlier frames yet
+// skips the new one, so a slow link sees a lower frame rate while everyone
+// else keeps the full one and nothing queues up in memory. New viewers get the
+// newest frame right away.
+//
+// Options are the Compositor's (encoding is always "jpeg"; format defaults to
+// "gray", quality to 75 and minQuality to 30) plus:
+//   path:            URL path served (default "/preview")
+//   maxQueuedFrames: frames a viewer may have in flight (default 2)
+export default class PreviewBroadcast {
+    constructor(handle, options = {}) {
+        const { path = "/preview", maxQueuedFrames = 2, ...compositorOptions } = options
+        this.path = path
+        this.maxQueuedFrames = maxQueuedFrames
+        this.subscribers = new Set()
+        this.nextId = 1
+        this.latest = null
+        this.counters = { frames: 0, bytes: 0, deliveries: 0, dropped: 0, joined: 0, left: 0 }
+        this.compositor = new Compositor(handle, {
+            width: 640, height: 480, format: "gray", quality: 75, minQuality: 30, ...compositorOptions, encoding: "jpeg",
+        }, (frame) => this.publish(frame))
+    }
+
+    setOverlays(overlays) {
+        return this.compositor.setOverlays(overlays)
+    }
+
+    // Serve MJPEG for a GET of `path`; returns false for other requests.
+    handleRequest(req, res) {
+        if (req.method !== "GET" || !this.matches(req)) return false
+        res.writeHead(200, {
+            "Content-Type": `multipart/x-mixed-replace; boundary=${boundary}`,
+            "Cache-Control": "no-cache, no-store, must-revalidate",
+            Pragma: "no-cache",
+            Connection: "close",
+        })
+        res.socket.setNoDelay(true)
+        this.add(new MjpegSubscriber(this.nextId++, res))
+        return true
+    }
+
+    // Accept a WebSocket upgrade to `path`; returns false for other requests.
+    handleUpgrade(req, socket, head) {
+        const key = req.headers["sec-websocket-key"]
+        if (!this.matches(req) || String(req.headers.upgrade).toLowerCase() !== "websocket" || !key) return false
+        const accept = crypto.createHash("sha1").update(key + websocketGuid).digest("base64")
+        socket.write("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n" +
+            `Sec-WebSocket-Accept: ${accept}\r\n\r\n`)
+        socket.setNoDelay(true)
+        const subscriber = new WebSocketSubscriber(this.nextId++, socket)
+        if (head && head.length) subscriber.receive(head)
+        this.add(subscriber)
+        return true
+    }
+
+    // An http.Server serving only the broadcast, listening on `port`.
+    listen(port, host) {
+        const server = http.createServer((req, res) => {
+            if (!this.handleRequest(req, res)) {
+                res.writeHead(404)
+                res.end()
+            }
+        })
+        server.on("upgrade", (req, socket, head) => {
+            if (!this.handleUpgrade(req, socket, head)) socket.destroy()
+        })
+        this.server = server
+        return new Promise((resolve, reject) => {
+            server.once("error", reject)
+            server.listen(port, host, () => {
+                server.off("error", reject)
+                resolve(server)
+            })
+        })
+    }
+
+    // { subscribers, frames, bytes, deliveries, dropped, joined, left, compositor }:
+    // frames and bytes encoded, deliveries and dropped summed over viewers,
+    // compositor the Compositor.stats() of the encoding side.
+    stats() {
+        return { subscribers: this.subscribers.size, ...this.counters, compositor: this.compositor.stats() }
+    }
+
+    // [{ id, kind, sent, dropped, queued }] per connected viewer.
+    subscriberStats() {
+        return Array.from(this.subscribers, (s) => ({ id: s.id, kind: s.kind, sent: s.sent, dropped: s.dropped,
+            queued: s.queued }))
+    }
+
+    // Stop encoding and disconnect every viewer; the HTTP server from listen(),
+    // if any, stops listening.
+    close() {
+        this.compositor.close()
+        for (const subscriber of this.subscribers) subscriber.end()
+        this.subscribers.clear()
+        if (this.server) this.server.close()
+    }
+
+    matches(req) {
+        const query = req.url.indexOf("?")
+        return (query < 0 ? req.url : req.url.slice(0, query)) === this.path
+    }
+
+    add(subscriber) {
+        this.subscribers.add(subscriber)
+        this.counters.joined++
+        subscriber.onClose = () => {
+            if (this.subscribers.delete(subscriber)) this.counters.left++
+        }
+        if (this.latest) subscriber.send(this.latest, this.maxQueuedFrames)
+    }
+
+    publish(frame) {
+        // Framing is built once per frame too; only the writes are per viewer.
+        const message = new EncodedFrame(frame.data)
+        this.latest = message
+        this.counters.frames++
+        this.counters.bytes += frame.data.length
+        for (const subscriber of this.subscribers) {
+            if (subscriber.send(message, this.maxQueuedFrames)) {
+                this.counters.deliveries++
+            } else {
+                this.counters.dropped++
+            }
+        }
+    }
+}
+
+const boundary = "lsepreviewframe"
+const websocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+// One encoded frame and its per-protocol framing, built on first use.
+class EncodedFrame {
+    constructor(data) {
+        this.data = data
+        this.part = null
+        this.header = null
+    }
+
+    mjpegPart() {
+        if (!this.part) {
+            this.part = Buffer.from(`--${boundary}\r\nContent-Type: image/jpeg\r\n` +
+                `Content-Length: ${this.data.length}\r\n\r\n`)
+        }
+        return this.part
+    }
+
+    // Header of an unmasked, final, binary WebSocket frame.
+    websocketHeader() {
+        if (!this.header) {
+            const length = this.data.length
+            if (length < 126) {
+                this.header = Buffer.from([0x82, length])
+            } else if (length < 0x10000) {
+                this.header = Buffer.from([0x82, 126, length >> 8, length & 0xff])
+            } else {
+                this.header = Buffer.alloc(10)
+                this.header[0] = 0x82
+                this.header[1] = 127
+                this.header.writeBigUInt64BE(BigInt(length), 2)
+            }
+        }
+        return this.header
+    }
+}
+
+const crlf = Buffer.from("\r\n")
+
+class Subscriber {
+    constructor(id, kind, stream) {
+        this.id = id
+        this.kind = kind
+        this.stream = stream
+        this.queued = 0
+        this.sent = 0
+        this.dropped = 0
+        this.closed = false
+        this.onClose = null
+        this.written = () => {
+            this.queued--
+        }
+        const close = () => {
+            if (this.closed) return
+            this.closed = true
+            if (this.onClose) this.onClose()
+        }
+        stream.on("close", close)
+        stream.on("error", close)
+    }
+
+    // Write `frame` unless `limit` earlier ones are still on their way.
+    send(frame, limit) {
+        if (this.closed) return false
+        if (this.queued >= limit) {
+            this.dropped++
+            return false
+        }
+        this.queued++
+        this.sent++
+        this.stream.cork()
+        this.write(frame)
+        this.stream.uncork()
+        return true
+    }
+}
+
+class MjpegSubscriber extends Subscriber {
+    constructor(id, res) {
+        super(id, "mjpeg", res)
+    }
+
+    write(frame) {
+        this.stream.write(frame.mjpegPart())
+        this.stream.write(frame.data)
+        this.stream.write(crlf, this.written)
+    }
+
+    end() {
+        this.stream.end()
+    }
+}
+
+class WebSocketSubscriber extends Subscriber {
+    constructor(id, socket) {
+        super(id, "websocket", socket)
+        this.input = Buffer.alloc(0)
+        socket.on("data", (chunk) => this.receive(chunk))
+    }
+
+    write(frame) {
+        this.stream.write(frame.websocketHeader())
+        this.stream.write(frame.data, this.written)
+    }
+
+    end() {
+        this.control(0x8, Buffer.alloc(0))
+        this.stream.end()
+    }
+
+    control(opcode, payload) {
+        if (!this.stream.writable) return
+        this.stream.write(Buffer.concat([Buffer.from([0x80 | opcode, payload.length]), payload]))
+    }
+
+    // Viewers only send control frames: answer pings and closes, ignore the rest.
+    receive(chunk) {
+        this.input = this.input.length ? Buffer.concat([this.input, chunk]) : chunk
+        for (;;) {
+            const input = this.input
+            if (input.length < 2) return
+            const opcode = input[0] & 0x0f
+            const masked = (input[1] & 0x80) !== 0
+            let length = input[1] & 0x7f
+            let offset = 2
+            if (length === 126) {
+                if (input.length < 4) return
+                length = input.readUInt16BE(2)
+                offset = 4
+            } else if (length === 127) {
+                if (input.length < 10) return
+                length = Number(input.readBigUInt64BE(2))
+                offset = 10
+            }
+            const mask = masked ? input.subarray(offset, offset + 4) : null
+            if (masked) offset += 4
+            if (input.length < offset + length) return
+            const payload = Buffer.from(input.subarray(offset, offset + length))
+            if (mask) {
+                for (let i = 0; i < payload.length; i++) payload[i] ^= mask[i & 3]
+            }
+            this.input = input.subarray(offset + length)
+            if (opcode === 0x8) {
+                this.control(0x8, payload.subarray(0, 125))
+                this.stream.end()
+                return
+            }
+            if (opcode === 0x9) this.control(0xa, payload.subarray(0, 125))
+        }
+    }
+}
@@ -0,0 +1,67 @@
+import lseBinding from "./lse-binding"
+
+// Licence-independent capture trigger from the preview (native/quality_map.h):
+//
+//   const map = new QualityMap(device, { objects: 4, autoCapture: true }, (frame) => {
+//       showHint(frame.objects)       // per finger: box, quality, contrast, ...
+//   })
+//   await device.call("LSCAN_Capture_Start", 4)
+//   map.rearm()                       // once per capture
+//
+// Every preview frame of the device is analyzed natively in 16 x 16 blocks, on
+// as many threads as there are cores: ridge orientation coherence, contrast and
+// ridge clarity per block, fingers as connected blocks with their mean scores.
+// When `stableFrames` frames in a row show `objects` fingers (at least one if
+// 0) all at `threshold` quality, the frame carries trigger: true, once per
+// rearm(). With autoCapture the result image is then taken right away: through
+// the device's session worker when given a DeviceSession, else by a direct
+// LSCAN_Capture_TakeResultImage().
+//
+// Options are those of lseBinding.qualityMapOpen() plus autoCapture and
+// onTrigger(frame, status), called after the result image was requested (status
+// undefined without autoCapture). onFrame(frame, timestamp) receives every
+// analyzed frame; frames arriving during an analysis replace each other, so it
+// always sees the newest.
+export default class QualityMap {
+    constructor(target, options = {}, onFrame = null) {
+        const { autoCapture = false, onTrigger = null, ...mapOptions } = options
+        this.device = typeof target === "number" ? null : target
+        this.handle = this.device ? this.device.handle : target
+        this.autoCapture = autoCapture
+        this.onTrigger = onTrigger
+        this.onFrame = onFrame
+        this.lastFrame = null
+        const status = lseBinding.qualityMapOpen(this.handle, mapOptions, (h, frame, timestamp) =>
+            this.receive(frame, timestamp))
+        if (status < 0) {
+            throw new Error(`Opening the quality map of handle ${this.handle} failed with status ${status}`)
+        }
+    }
+
+    // Let the trigger fire again; call when a capture starts.
+    rearm() {
+        return lseBinding.qualityMapRearm(this.handle)
+    }
+
+    // lseBinding.qualityMapStats() of the handle.
+    stats() {
+        return lseBinding.qualityMapStats(this.handle)
+    }
+
+    close() {
+        return lseBinding.qualityMapClose(this.handle)
+    }
+
+    async receive(frame, timestamp) {
+        this.lastFrame = frame
+        if (this.onFrame) this.onFrame(frame, timestamp)
+        if (!frame.trigger) return
+        let status
+        if (this.autoCapture) {
+            status = this.device
+                ? await this.device.call("LSCAN_Capture_TakeResultImage")
+                : lseBinding.LSCAN_Capture_TakeResultImage(this.handle)
+        }
+        if (this.onTrigger) this.onTrigger(frame, status)
+    }
+}
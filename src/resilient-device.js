@@ -0,0 +1,324 @@
+import lseBinding from "./lse-binding"
+import OverlayScene from "./overlay-scene"
+import summary from "./summary"
+
+// A device of the SessionManager that comes back on its own after a
+// communication break:
+//
+//   const device = new ResilientDevice(devices[0], { onRecovered: (r) => log(r.totalNs) })
+//   await device.call("LSCAN_Capture_SetMode", type, resolution, lineOrder, options)
+//   device.register("LSCAN_Capture_RegisterCallbackResultImage", onResult)
+//   device.commitOverlays([...])                  // as OverlayScene.commit()
+//   device.stats()                                // breaks, recoveries, time-to-recover
+//
+// Once LSCAN_Main_RegisterCallbackCommunicationBreak fires, every call fails
+// with LSCAN_ERR_DEVICE_IO until the handle is released and the device is
+// initialized again, which also forgets its mode, active area, contrast, keys,
+// LEDs, overlays and callbacks. The wrapper keeps what was applied through it
+// and restores it without help:
+//
+//   - a break (the callback, or a call failing with LSCAN_ERR_DEVICE_IO) starts
+//     recovery at once. While the device is off the bus, it retries whenever
+//     the device count changes (LSCAN_Main_RegisterCallbackDeviceCount) and
+//     otherwise after `retryMs`, doubling up to `maxRetryMs`. A device is only
+//     taken back at its device index and with the serial number it had;
+//   - sessionRecover() then releases the broken handle, initializes the device,
+//     re-registers the callbacks of the handle and replays the state in one task
+//     on the device's worker: the last mode, active area, contrast, keys and
+//     LEDs, each once and only where it differs from a fresh initialization;
+//   - finally the last overlay commit is shown again.
+//
+// Calls made while recovering wait for it. A setting that failed with
+// LSCAN_ERR_DEVICE_IO is kept and applied by the replay; other calls (a capture
+// start, say) return the error, as no capture survives a break. The wrapper
+// owns the communication break callback of the handle; callbacks registered
+// through register() follow the device should it come back with a new handle.
+//
+// Options:
+//   retryMs:     first retry interval while the device is away (default 250)
+//   maxRetryMs:  longest retry interval (default 5000)
+//   reset:       reset argument of the re-initialization (default false)
+//   onBreak:     (handle, timestamp) when a break is noticed
+//   onRecovered: (recovery) after each recovery, with the object stats() keeps
+//                as lastRecovery
+const { constants } = lseBinding
+
+// Calls whose effect the wrapper keeps, in replay order.
+const settings = [
+    "LSCAN_Capture_SetMode",
+    "LSCAN_Capture_SetActiveArea",
+    "LSCAN_Capture_SetContrast",
+    "LSCAN_Controls_SetActiveKeys",
+    "LSCAN_Controls_SetActiveLEDs",
+]
+
+export default class ResilientDevice {
+    constructor(device, options = {}) {
+        const { retryMs = 250, maxRetryMs = 5000, reset = false, onBreak = null, onRecovered = null } = options
+        this.device = device
+        this.serialNumber = device.info ? device.info.serialNumber : ""
+        this.retryMs = retryMs
+        this.maxRetryMs = maxRetryMs
+        this.reset = reset
+        this.onBreak = onBreak
+        this.onRecovered = onRecovered
+        this.applied = new Map()     // Setting name -> arguments, as the device has them
+        this.callbacks = new Map()   // Registration name -> function, see register()
+        this.overlays = null         // Last commitOverlays() argument
+        this.scene = null
+        this.recovering = null       // Promise of the recovery in progress
+        this.brokenAt = 0
+        this.wake = null             // Ends the wait for the device to come back
+        this.counters = { breaks: 0, recoveries: 0, attempts: 0, failedAttempts: 0, replayedCalls: 0,
+            replayFailures: 0, waitingCalls: 0 }
+        this.times = []
+        this.lastRecovery = null
+        this.lastError = null        // What ended the last recovery that gave up
+        this.closed = false
+        this.unsubscribe = lseBinding.onDeviceCount(() => {
+            if (this.wake) this.wake()
+        })
+        this.onCommunicationBreak = (handle, timestamp) => this.noticeBreak(timestamp)
+        lseBinding.LSCAN_Main_RegisterCallbackCommunicationBreak(this.handle, this.onCommunicationBreak)
+    }
+
+    get handle() {
+        return this.device.handle
+    }
+
+    get deviceIndex() {
+        return this.device.deviceIndex
+    }
+
+    // As DeviceSession.call(), waiting out a recovery in progress.
+    async call(name, ...args) {
+        if (this.recovering) {
+            this.counters.waitingCalls++
+            await this.recovering
+        }
+        const status = await this.device.call(name, ...args)
+        if (status === constants.LSCAN_ERR_DEVICE_IO && !this.closed) {
+            const recovering = this.noticeBreak(lseBinding.now())
+            if (!settings.includes(name)) return status
+            this.apply(name, args)
+            const recovery = await recovering
+            if (!recovery) return status
+            return recovery.failed === name ? recovery.failedStatus : constants.LSCAN_STATUS_OK
+        }
+        if (status >= 0) this.apply(name, args)
+        return status
+    }
+
+    // Register `callback` (null to unregister) with the SDK function `name`, e.g.
+    // "LSCAN_Capture_RegisterCallbackResultImage", for the current handle.
+    register(name, callback) {
+        if (callback) {
+            this.callbacks.set(name, callback)
+        } else {
+            this.callbacks.delete(name)
+        }
+        return lseBinding[name](this.handle, callback)
+    }
+
+    // Show exactly `overlays` through an OverlayScene of the device. While
+    // recovering the overlays are only kept, for the recovery to show, and
+    // null is returned.
+    commitOverlays(overlays) {
+        this.overlays = overlays
+        if (this.recovering) return null
+        if (!this.scene) this.scene = new OverlayScene(this.handle)
+        const result = this.scene.commit(overlays)
+        if (result.status === constants.LSCAN_ERR_DEVICE_IO) this.noticeBreak(lseBinding.now())
+        return result
+    }
+
+    // Resolves once the device works again (at once if it does), to the
+    // recovery if there was one.
+    ready() {
+        return this.recovering || Promise.resolve(null)
+    }
+
+    // { state, handle, breaks, recoveries, attempts, failedAttempts,
+    //   replayedCalls, replayFailures, waitingCalls, lastRecovery, lastError,
+    //   timeToRecover }:
+    // attempts counts re-initializations, failedAttempts those that failed,
+    // waitingCalls the calls that waited for a recovery, and timeToRecover the
+    // { count, mean, p50, max } nanoseconds from break to working device.
+    stats() {
+        return {
+            state: this.closed ? "closed" : this.recovering ? "recovering" : "ready",
+            handle: this.handle,
+            ...this.counters,
+            lastRecovery: this.lastRecovery,
+            lastError: this.lastError,
+            timeToRecover: summary(this.times),
+        }
+    }
+
+    resetStats() {
+        for (const key of Object.keys(this.counters)) this.counters[key] = 0
+        this.times = []
+        this.lastRecovery = null
+        this.lastError = null
+    }
+
+    // Stop watching the device; a recovery in progress ends after its current
+    // attempt. The device stays open in its session.
+    close() {
+        this.closed = true
+        this.unsubscribe()
+        lseBinding.LSCAN_Main_RegisterCallbackCommunicationBreak(this.handle, null)
+        if (this.wake) this.wake()
+        return this.ready()
+    }
+
+    noticeBreak(timestamp) {
+        if (this.recovering || this.closed) return this.recovering
+        this.counters.breaks++
+        this.brokenAt = timestamp
+        if (this.onBreak) this.onBreak(this.handle, timestamp)
+        const recovering = this.recover()
+        this.recovering = recovering
+        recovering.finally(() => {
+            if (this.recovering === recovering) this.recovering = null
+        })
+        return recovering
+    }
+
+    // Resolves to the recovery, or to null if the wrapper was closed or the
+    // recovery failed for good; never rejects. Once the device is no longer
+    // open in its session (after SessionManager.close(), say) sessionRecover()
+    // throws and no retry could succeed.
+    async recover() {
+        try {
+            return await this.retry()
+        } catch (error) {
+            this.lastError = error
+            return null
+        }
+    }
+
+    async retry() {
+        let delay = this.retryMs
+        let attempts = 0
+        for (;;) {
+            if (this.closed) return null
+            if (this.present()) {
+                attempts++
+                this.counters.attempts++
+                const calls = this.replayCalls()
+                const attemptAt = lseBinding.now()
+                const result = await lseBinding.sessionRecover(this.deviceIndex, this.reset, calls)
+                if (result.status >= 0) return this.recovered(result, calls, attemptAt, attempts)
+                this.counters.failedAttempts++
+            }
+            await this.waitForDevice(delay)
+            delay = Math.min(delay * 2, this.maxRetryMs)
+        }
+    }
+
+    // Whether the device may be back: it is on the bus at its index, and still
+    // the same one. Other failures leave it to the re-initialization to tell.
+    present() {
+        const info = lseBinding.LSCAN_Main_GetDeviceInfo(this.deviceIndex)
+        if (info.status === constants.LSCAN_ERR_INVALID_DEVICE_INDEX) return false
+        return info.status < 0 || !this.serialNumber || info.serialNumber === this.serialNumber
+    }
+
+    waitForDevice(ms) {
+        return new Promise((resolve) => {
+            const timer = setTimeout(() => this.wake(), ms)
+            this.wake = () => {
+                clearTimeout(timer)
+                this.wake = null
+                resolve()
+            }
+        })
+    }
+
+    // The calls that bring a freshly initialized device to the applied state.
+    // A fresh device has no mode, keys or LEDs; the contrast is replayed as
+    // set, since its initial value depends on the device.
+    replayCalls() {
+        const calls = []
+        for (const name of settings) {
+            const args = this.applied.get(name)
+            if (!args) continue
+            if (name === "LSCAN_Controls_SetActiveKeys" || name === "LSCAN_Controls_SetActiveLEDs") {
+                if (args[0] === 0) continue
+            }
+            calls.push([name, ...args])
+        }
+        return calls
+    }
+
+    apply(name, args) {
+        if (name === "LSCAN_Capture_SetMode") {
+            // The active area belongs to the mode it was set in.
+            const previous = this.applied.get(name)
+            if (!previous || previous[0] !== args[0] || previous[1] !== args[1]) {
+                this.applied.delete("LSCAN_Capture_SetActiveArea")
+            }
+            if (args[0] === constants.LSCAN_TYPE_NONE) {
+                this.applied.delete(name)
+                return
+            }
+        } else if (name === "LSCAN_Capture_OptimizeContrast") {
+            const { status, contrastValue } = lseBinding.LSCAN_Capture_GetContrast(this.handle)
+            if (status >= 0) this.applied.set("LSCAN_Capture_SetContrast", [contrastValue])
+            return
+        } else if (!settings.includes(name)) {
+            return
+        }
+        this.applied.set(name, args.slice())
+    }
+
+    recovered(result, calls, attemptAt, attempts) {
+        const restoredAt = lseBinding.now()
+        if (result.handle !== result.previousHandle) {
+            for (const [name, callback] of this.callbacks) {
+                if (result.previousHandle >= 0) lseBinding[name](result.previousHandle, null)
+                lseBinding[name](result.handle, callback)
+            }
+            if (result.previousHandle >= 0) {
+                lseBinding.LSCAN_Main_RegisterCallbackCommunicationBreak(result.previousHandle, null)
+            }
+            lseBinding.LSCAN_Main_RegisterCallbackCommunicationBreak(result.handle, this.onCommunicationBreak)
+            this.scene = null
+        }
+        this.device.handle = result.handle
+        let overlayStatus = constants.LSCAN_STATUS_OK
+        if (this.overlays) {
+            if (this.scene) {
+                this.scene.reset({ remove: false })
+            } else {
+                this.scene = new OverlayScene(result.handle)
+            }
+            overlayStatus = this.scene.commit(this.overlays).status
+        }
+        const end = lseBinding.now()
+        const recovery = {
+            handle: result.handle,
+            attempts,
+            calls: calls.length,
+            failed: result.failed >= 0 ? calls[result.failed][0] : null,
+            failedStatus: result.failedStatus,
+            callbackStatus: result.callbackStatus,
+            overlayStatus,
+            totalNs: end - this.brokenAt,
+            waitNs: attemptAt - this.brokenAt,
+            releaseNs: result.releaseNs,
+            initializeNs: result.initializeNs,
+            restoreNs: result.restoreNs,
+            replayNs: result.replayNs,
+            overlayNs: end - restoredAt,
+        }
+        this.counters.recoveries++
+        this.counters.replayedCalls += result.replayed
+        if (result.failed >= 0) this.counters.replayFailures++
+        this.times.push(recovery.totalNs)
+        this.lastRecovery = recovery
+        if (this.onRecovered) this.onRecovered(recovery)
+        return recovery
+    }
+}
@@ -0,0 +1,131 @@
+import lseBinding from "./lse-binding"
+
+// Several scanners per process. Every opened device gets a dedicated native
+// worker thread that runs its SDK calls one at a time, so a slow call on one
+// device (LSCAN_Main_Initialize takes seconds) never delays the others.
+//
+//   const session = new SessionManager()
+//   const devices = await session.open()          // all connected devices, in parallel
+//   await devices[0].call("LSCAN_Capture_SetMode", type, resolution, lineOrder, options)
+//   await session.close()
+//
+// call() takes the SDK function name and its [in] parameters after the handle
+// and resolves to the SDK status code once the call has returned and every
+// callback it fired has been delivered. Callbacks are registered per handle as
+// usual, e.g. lseBinding.LSCAN_Capture_RegisterCallbackResultImage(device.handle, fn).
+//
+// For a fast start (kiosks that must reach the first capture soon after boot),
+// open() reports each device the moment it is ready rather than when the
+// slowest one is, and sums up the LSCAN_Main_RegisterCallbackProgress values of
+// all devices into one progress figure:
+//
+//   await session.open({
+//       minApiVersion: [1, 100],                   // fail before initializing anything
+//       onProgress: (percent, perDevice) => splash.update(percent),
+//       onReady: (device) => device.ok && startWork(device),
+//   })
+
+export class DeviceSession {
+    constructor(result) {
+        this.deviceIndex = result.deviceIndex
+        this.status = result.status
+        this.handle = result.handle
+        this.info = {
+            serialNumber: result.serialNumber,
+            productName: result.productName,
+            interfaceType: result.interfaceType,
+            firmwareVersion: result.firmwareVersion,
+            hardwareVersion: result.hardwareVersion,
+        }
+    }
+
+    get ok() {
+        return this.status >= 0
+    }
+
+    call(name, ...args) {
+        return lseBinding.sessionCall(this.deviceIndex, name, ...args)
+    }
+}
+
+export class SessionManager {
+    constructor() {
+        this.devices = []
+    }
+
+    // Initialize `deviceIndices` (default: every connected device) in parallel.
+    // Devices that fail to initialize are returned with their error status.
+    // Options besides `reset` and `deviceIndices`:
+    //   minApiVersion: [major, minor]; an older SDK rejects before any device
+    //                  is touched (the version is read once per process)
+    //   onProgress:    (percent, perDevice) as initialization advances, percent
+    //                  the mean over the devices and perDevice { [deviceIndex]: percent }
+    //   onReady:       (device) for each device as soon as its initialization ends
+    async open({ reset = false, deviceIndices, minApiVersion, onProgress, onReady } = {}) {
+        if (minApiVersion) checkApiVersion(minApiVersion)
+        const indices = deviceIndices || Array.from({ length: deviceCount() }, (_, i) => i)
+        const progress = {}
+        const report = () => {
+            if (!onProgress || !indices.length) return
+            const sum = indices.reduce((total, index) => total + progress[index], 0)
+            onProgress(sum / indices.length, { ...progress })
+        }
+        const unsubscribe = indices.map((deviceIndex) => {
+            progress[deviceIndex] = 0
+            return onProgress ? lseBinding.onProgress(deviceIndex, (value) => {
+                progress[deviceIndex] = Math.max(progress[deviceIndex], Math.min(100, value))
+                report()
+            }) : null
+        })
+        // One sessionOpen() per device, so each settles on its own.
+        let opened
+        try {
+            opened = await Promise.all(indices.map(async (deviceIndex) => {
+                const [result] = await lseBinding.sessionOpen(reset, [deviceIndex])
+                const device = new DeviceSession(result)
+                if (progress[deviceIndex] < 100) {
+                    progress[deviceIndex] = 100
+                    report()
+                }
+                if (onReady) onReady(device)
+                return device
+            }))
+        } finally {
+            for (const stop of unsubscribe) if (stop) stop()
+        }
+        this.devices = this.devices.filter((d) => !opened.some((o) => o.deviceIndex === d.deviceIndex))
+            .concat(opened)
+        return opened
+    }
+
+    // Release every device after its pending calls and stop the worker threads.
+    async close({ sendToStandby = false } = {}) {
+        const results = await lseBinding.sessionClose(sendToStandby)
+        this.devices = []
+        return results
+    }
+}
+
+function deviceCount() {
+    const { status, deviceCount: count } = lseBinding.LSCAN_Main_GetDeviceCount()
+    return status >= 0 ? count : 0
+}
+
+// Throw unless the loaded SDK is at least `major`.`minor`.
+export function checkApiVersion([major, minor = 0]) {
+    const version = lseBinding.LSCAN_Main_GetAPIVersion()
+    if (version.status < 0) {
+        const error = new Error(`LSCAN_Main_GetAPIVersion failed with status ${version.status}`)
+        error.status = version.status
+        throw error
+    }
+    if (version.majorVersion < major || (version.majorVersion === major && version.minorVersion < minor)) {
+        const error = new Error(`LScanEssentials ${version.majorVersion}.${version.minorVersion} is older than the` +
+            ` required ${major}.${minor}`)
+        error.code = "ERR_LSE_API_VERSION"
+        throw error
+    }
+    return version
+}
+
+export default SessionManager
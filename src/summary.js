@@ -0,0 +1,11 @@
+// { count, mean, p50, max } of `values`; all 0 when there are none.
+export default function summary(values) {
+    if (!values.length) return { count: 0, mean: 0, p50: 0, max: 0 }
+    const sorted = values.slice().sort((a, b) => a - b)
+    return {
+        count: sorted.length,
+        mean: sorted.reduce((sum, value) => sum + value, 0) / sorted.length,
+        p50: sorted[sorted.length >> 1],
+        max: sorted[sorted.length - 1],
+    }
+}
@@ -0,0 +1,288 @@
+import lseBinding from "./lse-binding"
+import summary from "./summary"
+
+// Keeps a scanner ready for the next capture without streaming forever:
+//
+//   const standby = new WarmStandby(device, { idleMs: 20000 })   // device: a DeviceSession
+//   await standby.start({ imageType: constants.LSCAN_FLAT_FOUR_FINGERS }, 4)
+//   ...                                                           // capture as usual
+//   standby.finish()                                              // after the result image or abort
+//   standby.stats()                                               // time-to-first-preview, warm vs cold
+//
+// After a capture the SDK keeps the sensor streaming in the background so the
+// next LSCAN_Capture_Start() of the same mode shows preview at once; only
+// LSCAN_TYPE_NONE stops it. Leaving every device armed wastes bus bandwidth,
+// and setting LSCAN_TYPE_NONE after every capture pays the full mode change
+// and sensor start-up again on the next one. The manager does neither:
+//
+//   - after a capture it arms the mode predicted to come next: the mode that
+//     most often followed the last two (a tenprint workflow cycles through the
+//     same slaps, such as four fingers twice, then thumbs), else the last one,
+//     else the same mode, else `options.mode`;
+//   - after `idleMs` without a capture it sets LSCAN_TYPE_NONE;
+//   - a key press (LSCAN_Controls_RegisterCallbackKeys) or cue() while idle
+//     arms the predicted mode again, so the mode change overlaps the time the
+//     operator needs to place the fingers.
+//
+// Mode changes run on the device's session worker, one at a time and never
+// during a capture. Every start is measured natively from before its mode
+// change to the first preview frame (the "startup" stage of latencyStats());
+// stats() splits those times into starts that found their mode armed (warm)
+// and starts that had to set it (cold).
+//
+// A mode is { imageType, resolution, lineOrder, options } with the SDK's
+// LSCAN_Capture_SetMode() values; resolution defaults to LSCAN_RES_500,
+// lineOrder to LSCAN_ORIENTATION_TOP_DOWN and options to 0.
+//
+// Options:
+//   mode:    mode to arm before anything has been captured (default none)
+//   idleMs:  armed time without a capture before LSCAN_TYPE_NONE (default 30000)
+//   cueKeys: arm on key events (default true); the manager then owns the keys
+//            callback of the handle
+//   onKeys:  called as the keys callback would be, with cueKeys
+const { constants } = lseBinding
+
+function normalize(mode) {
+    return {
+        imageType: mode.imageType,
+        resolution: mode.resolution === undefined ? constants.LSCAN_RES_500 : mode.resolution,
+        lineOrder: mode.lineOrder === undefined ? constants.LSCAN_ORIENTATION_TOP_DOWN : mode.lineOrder,
+        options: mode.options || 0,
+    }
+}
+
+const keyOf = (mode) => (mode ? `${mode.imageType}:${mode.resolution}:${mode.lineOrder}:${mode.options}` : "")
+
+export default class WarmStandby {
+    constructor(device, options = {}) {
+        const { mode = null, idleMs = 30000, cueKeys = true, onKeys = null } = options
+        this.device = device
+        this.handle = device.handle
+        this.fallback = mode ? normalize(mode) : null
+        this.idleMs = idleMs
+        this.cueKeys = cueKeys
+        this.onKeys = onKeys
+        this.armed = null        // Mode set on the device, null for LSCAN_TYPE_NONE
+        this.target = null       // Mode the queued changes end in
+        this.queue = Promise.resolve()
+        this.capturing = false
+        this.last = null         // Mode of the last capture
+        this.previous = null     // and of the one before
+        this.transitions = new Map()
+        this.timer = null
+        this.armedSince = 0
+        this.pending = null      // { mark, warm } of the capture in progress
+        this.counters = { starts: 0, hits: 0, misses: 0, arms: 0, disarms: 0, cues: 0, armedMs: 0, errors: 0 }
+        this.startups = { warm: [], cold: [] }
+        this.closed = false
+        if (cueKeys) {
+            lseBinding.LSCAN_Controls_RegisterCallbackKeys(this.handle, (handle, pressedKeys, timestamp) => {
+                this.cue()
+                if (this.onKeys) this.onKeys(handle, pressedKeys, timestamp)
+            })
+        }
+        if (this.fallback) this.arm(this.fallback)
+    }
+
+    // Arm `mode`, or the predicted next mode, unless a capture is running.
+    // Resolves once the device is in that mode.
+    cue(mode) {
+        if (this.closed || this.capturing) return this.queue
+        this.counters.cues++
+        const next = mode ? normalize(mode) : this.predict()
+        return next ? this.arm(next) : this.queue
+    }
+
+    // Set `mode` if needed and start a capture of `numberOfObjects`; resolves
+    // to the SDK status of the first call that fails, or of the start.
+    async start(mode, numberOfObjects) {
+        const wanted = normalize(mode)
+        this.capturing = true
+        this.cancelIdle()
+        const mark = lseBinding.latencyMarkStart(this.handle)
+        const warm = keyOf(this.target) === keyOf(wanted)
+        this.counters.starts++
+        this.counters[warm ? "hits" : "misses"]++
+        if (!warm) this.change(wanted)
+        const changed = await this.queue
+        if (changed < 0) {
+            this.abandon()
+            return changed
+        }
+        this.stopArmedClock()
+        const status = await this.device.call("LSCAN_Capture_Start", numberOfObjects)
+        if (status < 0) {
+            this.abandon()
+            return status
+        }
+        this.pending = { mark, warm }
+        this.learn(wanted)
+        return status
+    }
+
+    // The capture is over (result image taken or aborted): record its startup
+    // time and arm the predicted next mode.
+    finish() {
+        if (!this.capturing) return this.queue
+        const pending = this.pending
+        this.pending = null
+        this.capturing = false
+        if (pending) {
+            const { lastStart } = lseBinding.latencyStats(this.handle)
+            if (lastStart.start === pending.mark && lastStart.firstPreview > 0) {
+                this.startups[pending.warm ? "warm" : "cold"].push(lastStart.firstPreview - lastStart.start)
+            }
+        }
+        if (this.closed) return this.queue
+        this.startArmedClock()
+        const next = this.predict()
+        return next ? this.arm(next) : this.queue
+    }
+
+    // The mode the manager would arm now: the most frequent successor of the
+    // last two modes captured, else of the last one.
+    predict() {
+        for (const context of this.contexts()) {
+            const successors = this.transitions.get(context)
+            if (!successors) continue
+            let best = null
+            for (const entry of successors.values()) {
+                if (!best || entry.count > best.count) best = entry
+            }
+            return best.mode
+        }
+        return this.last || this.fallback
+    }
+
+    // { armed, capturing, starts, hits, misses, arms, disarms, cues, armedMs,
+    //   errors, warm, cold }: hits and misses count starts that found their mode
+    // armed or not, armedMs the time spent armed outside captures (streaming
+    // nobody watched), and warm and cold the { count, mean, p50, max }
+    // time-to-first-preview in nanoseconds of either kind of start.
+    stats() {
+        const armedMs = this.counters.armedMs + (this.armedSince ? (lseBinding.now() - this.armedSince) / 1e6 : 0)
+        return {
+            armed: this.armed,
+            capturing: this.capturing,
+            ...this.counters,
+            armedMs,
+            warm: summary(this.startups.warm),
+            cold: summary(this.startups.cold),
+        }
+    }
+
+    resetStats() {
+        for (const key of Object.keys(this.counters)) this.counters[key] = 0
+        this.startups = { warm: [], cold: [] }
+        if (this.armedSince) this.armedSince = lseBinding.now()
+    }
+
+    // Stop managing the device; with `disarm` (default) it is left in
+    // LSCAN_TYPE_NONE. Resolves once the mode changes are done.
+    close({ disarm = true } = {}) {
+        this.closed = true
+        this.cancelIdle()
+        if (this.cueKeys) lseBinding.LSCAN_Controls_RegisterCallbackKeys(this.handle, null)
+        if (disarm && !this.capturing) this.disarm()
+        return this.queue
+    }
+
+    arm(mode) {
+        if (keyOf(this.target) !== keyOf(mode)) this.change(mode)
+        this.scheduleIdle()
+        return this.queue
+    }
+
+    disarm() {
+        if (this.target) {
+            this.counters.disarms++
+            this.change(null)
+        }
+        return this.queue
+    }
+
+    // Queue a mode change to `mode` (null: LSCAN_TYPE_NONE). The queue resolves
+    // to the status of the last change.
+    change(mode) {
+        this.target = mode
+        if (mode) this.counters.arms++
+        this.queue = this.queue.then(async () => {
+            const status = mode
+                ? await this.device.call("LSCAN_Capture_SetMode", mode.imageType, mode.resolution, mode.lineOrder,
+                    mode.options)
+                : await this.device.call("LSCAN_Capture_SetMode", constants.LSCAN_TYPE_NONE, constants.LSCAN_RES_500,
+                    constants.LSCAN_ORIENTATION_TOP_DOWN, 0)
+            if (status < 0) {
+                this.counters.errors++
+                this.armed = null
+                if (this.target === mode) this.target = null
+                this.stopArmedClock()
+                return status
+            }
+            this.armed = mode
+            if (!mode) {
+                this.stopArmedClock()
+            } else if (!this.capturing) {
+                this.startArmedClock()
+            }
+            return status
+        })
+        return this.queue
+    }
+
+    // A start that failed leaves the device in whatever mode it reached.
+    abandon() {
+        this.capturing = false
+        this.pending = null
+        if (!this.closed) this.scheduleIdle()
+    }
+
+    learn(mode) {
+        for (const context of this.contexts()) {
+            let successors = this.transitions.get(context)
+            if (!successors) {
+                successors = new Map()
+                this.transitions.set(context, successors)
+            }
+            const entry = successors.get(keyOf(mode))
+            if (entry) {
+                entry.count++
+            } else {
+                successors.set(keyOf(mode), { mode, count: 1 })
+            }
+        }
+        this.previous = this.last
+        this.last = mode
+    }
+
+    // Transition table keys of the modes captured last, longest first.
+    contexts() {
+        if (!this.last) return []
+        const last = keyOf(this.last)
+        return this.previous ? [`${keyOf(this.previous)}>${last}`, last] : [last]
+    }
+
+    scheduleIdle() {
+        this.cancelIdle()
+        if (this.closed) return
+        this.timer = setTimeout(() => {
+            this.timer = null
+            if (!this.capturing) this.disarm()
+        }, this.idleMs)
+        if (this.timer.unref) this.timer.unref()
+    }
+
+    cancelIdle() {
+        if (this.timer) clearTimeout(this.timer)
+        this.timer = null
+    }
+
+    startArmedClock() {
+        if (this.armed && !this.armedSince) this.armedSince = lseBinding.now()
+    }
+
+    stopArmedClock() {
+        if (this.armedSince) this.counters.armedMs += (lseBinding.now() - this.armedSince) / 1e6
+        this.armedSince = 0
+    }
+}